@@ -0,0 +1,236 @@
+#ifndef _CLIBS_EVENT_LOOP_H_
+#define _CLIBS_EVENT_LOOP_H_ 1
+
+#include <iostream>
+#include <map>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <functional>
+#include <sys/epoll.h>
+#include "clibs/net/socket.hpp"
+
+#define EVENT_READ EPOLLIN
+#define EVENT_WRITE EPOLLOUT
+#define EVENT_ERROR (EPOLLERR | EPOLLHUP)
+
+namespace clibs {
+    namespace io {
+        typedef std::chrono::steady_clock event_clock;
+
+        /** 描述符事件回调, events为触发的事件 */
+        typedef std::function<void(SOCKET sockfd, int events)> event_callback;
+
+        /** 定时器回调 */
+        typedef std::function<void()> timer_callback;
+
+        /**
+         * 基于epoll的事件循环
+         */
+        typedef struct {
+            int epoll_fd;
+            int maxevents;
+            bool running;
+            std::map<SOCKET, event_callback> handlers; // 描述符对应的回调
+            std::map<std::pair<event_clock::time_point, unsigned long long int>, timer_callback> timers; // 按到期时间排序的定时器
+            std::map<unsigned long long int, event_clock::time_point> timer_index; // 定时器id对应的到期时间
+            unsigned long long int next_timer_id;
+        } event_loop_t;
+
+        /**
+         * 初始化事件循环
+         * @param  loop event_loop_t
+         * @return      true/false
+         */
+        bool event_loop_init(event_loop_t* loop) {
+            loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            loop->maxevents = 128;
+            loop->running = false;
+            loop->next_timer_id = 1;
+
+            return loop->epoll_fd >= 0;
+        }
+
+        /**
+         * 设置单次等待时最大获取事件数量
+         * @param loop      event_loop_t
+         * @param maxevents 最大事件数量
+         */
+        void event_loop_maxevents(event_loop_t* loop, int maxevents) {
+            loop->maxevents = maxevents;
+        }
+
+        /**
+         * 添加一个描述符的监听
+         * @param  loop     event_loop_t
+         * @param  sockfd   套字节描述符
+         * @param  events   监听的事件
+         * @param  callback 事件回调
+         * @return          true/false
+         */
+        bool event_loop_add(event_loop_t* loop, SOCKET sockfd, int events, event_callback callback) {
+            struct epoll_event event;
+            event.data.fd = sockfd;
+            event.events = events;
+
+            if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, sockfd, &event) < 0) {
+                return false;
+            }
+
+            loop->handlers[sockfd] = callback;
+
+            return true;
+        }
+
+        /**
+         * 修改描述符监听的事件
+         * @param  loop   event_loop_t
+         * @param  sockfd 套字节描述符
+         * @param  events 新的监听事件
+         * @return        true/false
+         */
+        bool event_loop_modify(event_loop_t* loop, SOCKET sockfd, int events) {
+            struct epoll_event event;
+            event.data.fd = sockfd;
+            event.events = events;
+
+            return epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, sockfd, &event) == 0;
+        }
+
+        /**
+         * 移除描述符的监听, 可以在回调中调用
+         * @param  loop   event_loop_t
+         * @param  sockfd 套字节描述符
+         * @return        true/false
+         */
+        bool event_loop_remove(event_loop_t* loop, SOCKET sockfd) {
+            struct epoll_event event;
+            loop->handlers.erase(sockfd);
+
+            return epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, sockfd, &event) == 0;
+        }
+
+        /**
+         * 添加一个单次定时器
+         * @param  loop     event_loop_t
+         * @param  delay    延迟时间(毫秒)
+         * @param  callback 到期后的回调
+         * @return          定时器id
+         */
+        unsigned long long int event_loop_add_timer(event_loop_t* loop, unsigned int delay, timer_callback callback) {
+            unsigned long long int id = loop->next_timer_id++;
+            event_clock::time_point when = event_clock::now() + std::chrono::milliseconds(delay);
+
+            loop->timers[std::make_pair(when, id)] = callback;
+            loop->timer_index[id] = when;
+
+            return id;
+        }
+
+        /**
+         * 取消定时器
+         * @param loop event_loop_t
+         * @param id   定时器id
+         */
+        void event_loop_cancel_timer(event_loop_t* loop, unsigned long long int id) {
+            std::map<unsigned long long int, event_clock::time_point>::iterator it = loop->timer_index.find(id);
+
+            if (it != loop->timer_index.end()) {
+                loop->timers.erase(std::make_pair(it->second, id));
+                loop->timer_index.erase(it);
+            }
+        }
+
+        /**
+         * 计算距离最近的定时器到期还需要等待的毫秒数
+         * 向上取整, 不足1毫秒时等待1毫秒, 避免在定时器到期前反复以0超时唤醒
+         */
+        int __event_loop_next_timeout(event_loop_t* loop, int timeout) {
+            if (loop->timers.empty()) {
+                return timeout;
+            }
+
+            long long int nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(loop->timers.begin()->first.first - event_clock::now()).count();
+            long long int wait = nanos > 0 ? (nanos + 999999) / 1000000 : 0;
+
+            return (timeout < 0 || wait < timeout) ? (int)wait : timeout;
+        }
+
+        /** 执行所有已到期的定时器 */
+        void __event_loop_run_timers(event_loop_t* loop) {
+            event_clock::time_point now = event_clock::now();
+
+            while (!loop->timers.empty() && loop->timers.begin()->first.first <= now) {
+                timer_callback callback = loop->timers.begin()->second;
+                loop->timer_index.erase(loop->timers.begin()->first.second);
+                loop->timers.erase(loop->timers.begin());
+                callback();
+            }
+        }
+
+        /**
+         * 等待并分发一轮事件
+         * @param  loop    event_loop_t
+         * @param  timeout 最大等待时间(毫秒), -1为一直等待
+         * @return         触发的描述符事件数量, 出错时为-1
+         */
+        int event_loop_run_once(event_loop_t* loop, int timeout) {
+            struct epoll_event events[loop->maxevents];
+
+            int nfds = epoll_wait(loop->epoll_fd, events, loop->maxevents, __event_loop_next_timeout(loop, timeout));
+
+            if (nfds < 0 && errno != EINTR) {
+                return -1;
+            }
+
+            for (int i = 0; i < nfds; i ++) {
+                // 回调中可能移除了其它描述符, 每次都重新查找
+                std::map<SOCKET, event_callback>::iterator it = loop->handlers.find(events[i].data.fd);
+
+                if (it != loop->handlers.end()) {
+                    event_callback callback = it->second;
+                    callback(events[i].data.fd, events[i].events);
+                }
+            }
+
+            __event_loop_run_timers(loop);
+
+            return nfds < 0 ? 0 : nfds;
+        }
+
+        /**
+         * 运行事件循环, 直到调用event_loop_stop或者没有任何监听与定时器
+         * @param loop event_loop_t
+         */
+        void event_loop_run(event_loop_t* loop) {
+            loop->running = true;
+
+            while (loop->running && (!loop->handlers.empty() || !loop->timers.empty())) {
+                if (event_loop_run_once(loop, -1) < 0) {
+                    break;
+                }
+            }
+
+            loop->running = false;
+        }
+
+        /** 停止事件循环 */
+        void event_loop_stop(event_loop_t* loop) {
+            loop->running = false;
+        }
+
+        /** 关闭事件循环 */
+        void event_loop_close(event_loop_t* loop) {
+            if (loop->epoll_fd > -1) {
+                close(loop->epoll_fd);
+                loop->epoll_fd = -1;
+            }
+
+            loop->handlers.clear();
+            loop->timers.clear();
+            loop->timer_index.clear();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef _CLIBS_ACCEPTOR_H_
+#define _CLIBS_ACCEPTOR_H_ 1
+
+#include <iostream>
+#include <functional>
+#include "clibs/os.h"
+#include "clibs/net/socket.hpp"
+
+#ifdef OS_LINUX
+#include "clibs/io/event_loop.hpp"
+#endif
+
+namespace clibs {
+    namespace net {
+        /** 接收到新连接时的回调, 新连接为非阻塞模式 */
+        typedef std::function<void(socket_t* sock)> accept_callback;
+
+        /** 监听暂停(true)或恢复(false)时的通知 */
+        typedef std::function<void(bool paused)> accept_pause_callback;
+
+        /**
+         * 批量接收连接的封装
+         */
+        typedef struct {
+            socket_t listener; // 监听套字节
+            unsigned int budget; // 每次唤醒最多接收的连接数量
+            unsigned int max_connections; // 最大连接数量, 0为不限制
+            unsigned int active; // 当前连接数量
+            bool paused; // 是否已暂停接收
+            int reserve_fd; // 文件描述符耗尽时用来拒绝连接的预留描述符
+            unsigned long long int accepted; // 已接收的连接数量
+            unsigned long long int rejected; // 因描述符耗尽被拒绝的连接数量
+            unsigned long long int emfile; // 发生EMFILE/ENFILE的次数
+            accept_pause_callback on_pause;
+        } acceptor_t;
+
+        /** 打开预留描述符 */
+        int __acceptor_reserve() {
+    #ifdef _WIN32
+            return -1;
+    #else
+            return open("/dev/null", O_RDONLY | O_CLOEXEC);
+    #endif
+        }
+
+        /**
+         * 初始化, 监听套字节会被设置为非阻塞
+         * @param  acceptor        acceptor_t
+         * @param  listener        已经listen的套字节
+         * @param  budget          每次唤醒最多接收的连接数量
+         * @param  max_connections 最大连接数量, 0为不限制
+         * @return                 true/false
+         */
+        bool acceptor_init(acceptor_t* acceptor, const socket_t* listener, unsigned int budget, unsigned int max_connections) {
+            acceptor->listener = *listener;
+            acceptor->budget = budget;
+            acceptor->max_connections = max_connections;
+            acceptor->active = 0;
+            acceptor->paused = false;
+            acceptor->reserve_fd = __acceptor_reserve();
+            acceptor->accepted = 0;
+            acceptor->rejected = 0;
+            acceptor->emfile = 0;
+            acceptor->on_pause = NULL;
+
+            return socket_blocking(&acceptor->listener, false);
+        }
+
+        /**
+         * 接收一个非阻塞且带有close-on-exec标志的连接
+         * @param  sock       监听套字节
+         * @param  new_socket 用来接收新连接的socket_t
+         * @return            新连接的socket描述符
+         */
+        SOCKET socket_accept_nonblocking(const socket_t* sock, socket_t* new_socket) {
+            socklen_t len = sizeof(new_socket->addr);
+    #ifdef OS_LINUX
+            new_socket->sockfd = accept4(sock->sockfd, (struct sockaddr*)&new_socket->addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    #else
+            new_socket->sockfd = accept(sock->sockfd, (struct sockaddr*)&new_socket->addr, &len);
+
+            if (new_socket->sockfd != -1) {
+                socket_blocking(new_socket, false);
+        #ifndef _WIN32
+                fcntl(new_socket->sockfd, F_SETFD, FD_CLOEXEC);
+        #endif
+            }
+    #endif
+            socket_stats_reset(new_socket);
+            return new_socket->sockfd;
+        }
+
+        /** 暂停或恢复接收 */
+        void __acceptor_pause(acceptor_t* acceptor, bool paused) {
+            if (acceptor->paused == paused) {
+                return;
+            }
+
+            acceptor->paused = paused;
+
+            if (acceptor->on_pause != NULL) {
+                acceptor->on_pause(paused);
+            }
+        }
+
+        /**
+         * 描述符耗尽时释放预留描述符来接收并立即关闭一个连接, 避免水平触发的监听不停唤醒
+         * @param acceptor acceptor_t
+         */
+        void __acceptor_shed(acceptor_t* acceptor) {
+            if (acceptor->reserve_fd < 0) {
+                return;
+            }
+
+            close(acceptor->reserve_fd);
+
+            socket_t sock;
+
+            if (socket_accept_nonblocking(&acceptor->listener, &sock) != -1) {
+                socket_close(&sock);
+                acceptor->rejected ++;
+            }
+
+            acceptor->reserve_fd = __acceptor_reserve();
+        }
+
+        /**
+         * 在监听套字节可读时调用, 最多接收budget个连接
+         * 连接数量达到上限时暂停接收, 剩余的连接留在内核的backlog中
+         * @param  acceptor acceptor_t
+         * @param  callback 新连接的回调
+         * @return          本次接收的连接数量
+         */
+        unsigned int acceptor_drain(acceptor_t* acceptor, accept_callback callback) {
+            unsigned int count = 0;
+
+            while (count < acceptor->budget) {
+                if (acceptor->max_connections > 0 && acceptor->active >= acceptor->max_connections) {
+                    __acceptor_pause(acceptor, true);
+                    break;
+                }
+
+                socket_t sock;
+
+                if (socket_accept_nonblocking(&acceptor->listener, &sock) == -1) {
+                    if (errno == EINTR || errno == ECONNABORTED) {
+                        continue;
+                    }
+
+                    if (errno == EMFILE || errno == ENFILE) {
+                        acceptor->emfile ++;
+                        __acceptor_shed(acceptor);
+                    }
+
+                    break;
+                }
+
+                count ++;
+                acceptor->active ++;
+                acceptor->accepted ++;
+                callback(&sock);
+            }
+
+            return count;
+        }
+
+        /**
+         * 一个连接关闭后调用, 低于上限时恢复接收
+         * @param acceptor acceptor_t
+         */
+        void acceptor_release(acceptor_t* acceptor) {
+            if (acceptor->active > 0) {
+                acceptor->active --;
+            }
+
+            if (acceptor->paused && (acceptor->max_connections == 0 || acceptor->active < acceptor->max_connections)) {
+                __acceptor_pause(acceptor, false);
+            }
+        }
+
+        /** 释放预留描述符, 监听套字节需要自行关闭 */
+        void acceptor_close(acceptor_t* acceptor) {
+            if (acceptor->reserve_fd >= 0) {
+                close(acceptor->reserve_fd);
+                acceptor->reserve_fd = -1;
+            }
+        }
+
+    #ifdef OS_LINUX
+        /**
+         * 将监听套字节加入事件循环, 暂停时停止监听可读事件
+         * @param  acceptor acceptor_t
+         * @param  loop     event_loop_t
+         * @param  callback 新连接的回调
+         * @return          true/false
+         */
+        bool acceptor_attach(acceptor_t* acceptor, io::event_loop_t* loop, accept_callback callback) {
+            // 水平触发下backlog中还有连接时, 恢复监听后会立即再次唤醒
+            acceptor->on_pause = [acceptor, loop](bool paused) {
+                io::event_loop_modify(loop, acceptor->listener.sockfd, paused ? 0 : (int)EVENT_READ);
+            };
+
+            return io::event_loop_add(loop, acceptor->listener.sockfd, EVENT_READ, [acceptor, callback](SOCKET, int) {
+                acceptor_drain(acceptor, callback);
+            });
+        }
+    #endif
+    }
+}
+
+#endif
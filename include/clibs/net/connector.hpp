@@ -0,0 +1,464 @@
+#ifndef _CLIBS_CONNECTOR_H_
+#define _CLIBS_CONNECTOR_H_ 1
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <climits>
+#include <functional>
+#include "clibs/os.h"
+#include "clibs/net/socket.hpp"
+#include "clibs/net/socket_tuning.hpp"
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#ifdef OS_LINUX
+#include "clibs/io/event_loop.hpp"
+#endif
+
+#define CONNECTOR_CONNECTING 0
+#define CONNECTOR_ESTABLISHED 1
+#define CONNECTOR_FAILED 2
+
+namespace clibs {
+    namespace net {
+        typedef std::chrono::steady_clock connector_clock;
+
+        /** 连接尝试开始(true)或结束(false)时的通知, 用来维护外部事件循环的监听 */
+        typedef std::function<void(SOCKET sockfd, bool watch)> connector_watch_callback;
+
+        /**
+         * 非阻塞连接的状态机
+         * 依次(RFC 8305)对解析出的地址发起非阻塞连接, 由调用方在描述符可写时驱动
+         */
+        typedef struct {
+            int type; // 套字节类型
+            int state; // 当前状态
+            int error; // 最后一次失败的错误码
+            unsigned int attempt_delay; // 发起下一个地址连接前的等待时间(毫秒)
+            size_t next; // 下一个需要尝试的地址
+            std::vector<socket_t> candidates; // 解析出的地址
+            std::vector<socket_t> pending; // 正在连接中的套字节
+            connector_clock::time_point deadline;
+            connector_clock::time_point next_attempt;
+            connector_watch_callback watch;
+            socket_tuning_t tuning; // 每次连接尝试前应用的调优参数
+            socket_t socket; // 连接成功后的套字节, 保持非阻塞模式
+        } connector_t;
+
+        /**
+         * 初始化连接器
+         * @param c             connector_t
+         * @param type          套字节类型
+         * @param timeout       整体超时时间(毫秒)
+         * @param attempt_delay 发起下一个地址连接前的等待时间(毫秒)
+         */
+        void connector_init(connector_t* c, int type, unsigned int timeout, unsigned int attempt_delay) {
+            c->type = type;
+            c->state = CONNECTOR_CONNECTING;
+            c->error = ETIMEDOUT;
+            c->attempt_delay = attempt_delay;
+            c->next = 0;
+            c->candidates.clear();
+            c->pending.clear();
+            c->deadline = connector_clock::now() + std::chrono::milliseconds(timeout);
+            c->next_attempt = connector_clock::now();
+            c->watch = NULL;
+            c->socket.sockfd = -1;
+            socket_tuning_init(&c->tuning);
+        }
+
+        /** 判断非阻塞connect是否处于连接中的状态 */
+        bool __connector_in_progress() {
+    #ifdef _WIN32
+            return WSAGetLastError() == WSAEWOULDBLOCK;
+    #else
+            return errno == EINPROGRESS;
+    #endif
+        }
+
+        /** 关闭一个连接尝试 */
+        void __connector_drop(connector_t* c, socket_t* sock) {
+            if (c->watch != NULL) {
+                c->watch(sock->sockfd, false);
+            }
+
+            socket_close(sock);
+        }
+
+        /** 结束连接, 关闭所有仍在进行的尝试 */
+        void __connector_finish(connector_t* c, int state) {
+            for (std::vector<socket_t>::iterator it = c->pending.begin(); it != c->pending.end(); it ++) {
+                __connector_drop(c, &(*it));
+            }
+
+            c->pending.clear();
+            c->state = state;
+        }
+
+        /**
+         * 中止连接
+         * @param c connector_t
+         */
+        void connector_abort(connector_t* c) {
+            if (c->state == CONNECTOR_CONNECTING) {
+                __connector_finish(c, CONNECTOR_FAILED);
+            }
+        }
+
+        /**
+         * 按RFC 8305的方式对地址列表排序, 从ipv6开始交替排列ipv6与ipv4地址
+         * @param list 解析后的地址列表
+         */
+        void connector_sort_addresses(std::vector<socket_t>* list) {
+            std::vector<socket_t> v6, v4;
+
+            for (std::vector<socket_t>::iterator it = list->begin(); it != list->end(); it ++) {
+                (it->addr.ss_family == AF_INET6 ? v6 : v4).push_back(*it);
+            }
+
+            list->clear();
+
+            for (size_t i = 0; i < v6.size() || i < v4.size(); i ++) {
+                if (i < v6.size()) {
+                    list->push_back(v6[i]);
+                }
+
+                if (i < v4.size()) {
+                    list->push_back(v4[i]);
+                }
+            }
+        }
+
+        /**
+         * 推进状态机: 检查超时并在需要时发起下一个地址的连接
+         * @param  c connector_t
+         * @return   当前状态
+         */
+        int connector_poll(connector_t* c) {
+            if (c->state != CONNECTOR_CONNECTING) {
+                return c->state;
+            }
+
+            connector_clock::time_point now = connector_clock::now();
+
+            if (now >= c->deadline) {
+                c->error = ETIMEDOUT;
+                __connector_finish(c, CONNECTOR_FAILED);
+                return c->state;
+            }
+
+            // 到达间隔时间或者前面的连接全部失败时发起下一个地址的连接
+            while (c->next < c->candidates.size() && (now >= c->next_attempt || c->pending.empty())) {
+                socket_t attempt = c->candidates[c->next++];
+
+                if (socket_new(attempt.addr.ss_family, c->type, 0, &attempt) == -1) {
+                    c->error = errno;
+                    continue;
+                }
+
+                if (!socket_blocking(&attempt, false)) {
+                    c->error = errno;
+                    socket_close(&attempt);
+                    continue;
+                }
+
+                // 调优失败不影响连接本身
+                socket_tune(&attempt, &c->tuning);
+
+                if (socket_connect(&attempt)) {
+                    c->socket = attempt;
+                    __connector_finish(c, CONNECTOR_ESTABLISHED);
+                    return c->state;
+                } else if (!__connector_in_progress()) {
+                    c->error = errno;
+                    socket_close(&attempt);
+                    continue;
+                }
+
+                c->pending.push_back(attempt);
+                c->next_attempt = now + std::chrono::milliseconds(c->attempt_delay);
+
+                if (c->watch != NULL) {
+                    c->watch(attempt.sockfd, true);
+                }
+            }
+
+            if (c->pending.empty() && c->next >= c->candidates.size()) {
+                __connector_finish(c, CONNECTOR_FAILED);
+            }
+
+            return c->state;
+        }
+
+        /**
+         * 解析主机地址并开始连接, DNS解析本身是阻塞的
+         * @param  c    connector_t
+         * @param  host 主机地址
+         * @param  port 端口
+         * @return      当前状态
+         */
+        int connector_start(connector_t* c, const char* host, unsigned int port) {
+            if (!socket_resolve(host, port, AF_UNSPEC, c->type, &c->candidates)) {
+                c->error = EHOSTUNREACH;
+                c->state = CONNECTOR_FAILED;
+                return c->state;
+            }
+
+            connector_sort_addresses(&c->candidates);
+
+            return connector_poll(c);
+        }
+
+        /**
+         * 处理连接中的套字节可写或出错的事件, 通过SO_ERROR确认连接结果
+         * @param  c      connector_t
+         * @param  sockfd 触发事件的描述符
+         * @return        当前状态
+         */
+        int connector_ready(connector_t* c, SOCKET sockfd) {
+            for (std::vector<socket_t>::iterator it = c->pending.begin(); it != c->pending.end(); it ++) {
+                if (it->sockfd != sockfd) {
+                    continue;
+                }
+
+                int error = 0;
+                socklen_t len = sizeof(error);
+
+                if (socket_getsockopt(&(*it), SOL_SOCKET, SO_ERROR, (SOCK_OPTVAL*)&error, &len) && error == 0) {
+                    c->socket = *it;
+                    c->pending.erase(it);
+
+                    if (c->watch != NULL) {
+                        c->watch(c->socket.sockfd, false);
+                    }
+
+                    __connector_finish(c, CONNECTOR_ESTABLISHED);
+                    return c->state;
+                }
+
+                c->error = error != 0 ? error : errno;
+                __connector_drop(c, &(*it));
+                c->pending.erase(it);
+                c->next_attempt = connector_clock::now(); // 连接失败时立即尝试下一个地址
+                break;
+            }
+
+            return connector_poll(c);
+        }
+
+        /**
+         * 距离下一次需要调用connector_poll的时间, 向上取整, 避免最后不足1毫秒时以0超时空转
+         * @param  c connector_t
+         * @return   毫秒数
+         */
+        long long int connector_timeout(connector_t* c) {
+            connector_clock::time_point wake = c->deadline;
+
+            if (c->next < c->candidates.size() && c->next_attempt < wake) {
+                wake = c->next_attempt;
+            }
+
+            long long int nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(wake - connector_clock::now()).count();
+
+            return nanos > 0 ? (nanos + 999999) / 1000000 : 0;
+        }
+
+        /**
+         * 使用poll同步等待连接结果, 描述符不受FD_SETSIZE的限制
+         * @param  c connector_t
+         * @return   是否连接成功
+         */
+        bool connector_wait(connector_t* c) {
+            std::vector<struct pollfd> fds;
+
+            while (connector_poll(c) == CONNECTOR_CONNECTING) {
+                long long int wait = connector_timeout(c);
+
+                fds.resize(c->pending.size());
+
+                for (size_t i = 0; i < c->pending.size(); i ++) {
+                    fds[i].fd = c->pending[i].sockfd;
+                    fds[i].events = POLLOUT;
+                    fds[i].revents = 0;
+                }
+
+    #ifdef _WIN32
+                int ret = WSAPoll(fds.data(), (ULONG)fds.size(), wait < INT_MAX ? (int)wait : INT_MAX);
+    #else
+                int ret = poll(fds.data(), fds.size(), wait < INT_MAX ? (int)wait : INT_MAX);
+    #endif
+
+                if (ret < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    c->error = errno;
+                    connector_abort(c);
+                    break;
+                }
+
+                std::vector<SOCKET> ready;
+
+                // 连接失败时除了POLLOUT还可能只有POLLERR/POLLHUP
+                for (size_t i = 0; i < fds.size(); i ++) {
+                    if (fds[i].revents & (POLLOUT | POLLERR | POLLHUP)) {
+                        ready.push_back(fds[i].fd);
+                    }
+                }
+
+                for (std::vector<SOCKET>::iterator it = ready.begin(); it != ready.end() && c->state == CONNECTOR_CONNECTING; it ++) {
+                    connector_ready(c, *it);
+                }
+            }
+
+            if (c->state != CONNECTOR_ESTABLISHED) {
+                errno = c->error;
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * 双栈连接, 尝试主机解析出的所有地址, 每隔attempt_delay毫秒并行发起下一个地址的连接(RFC 8305)
+         * 先成功的连接被保留, 其余连接会被关闭, 返回的socket恢复为阻塞模式
+         * @param  sock          用来接收连接结果的socket_t
+         * @param  host          主机地址
+         * @param  port          端口
+         * @param  type          套字节类型
+         * @param  timeout       整体超时时间(毫秒)
+         * @param  attempt_delay 发起下一个地址连接前的等待时间(毫秒)
+         * @param  tuning        连接前应用的调优参数, 可以为NULL
+         * @return               是否连接成功
+         */
+        bool socket_connect_dual_stack(socket_t* sock, const char* host, unsigned int port, int type, unsigned int timeout, unsigned int attempt_delay, const socket_tuning_t* tuning) {
+            connector_t c;
+            connector_init(&c, type, timeout, attempt_delay);
+
+            if (tuning != NULL) {
+                c.tuning = *tuning;
+            }
+
+            connector_start(&c, host, port);
+            sock->sockfd = -1;
+
+            if (!connector_wait(&c)) {
+                return false;
+            }
+
+            *sock = c.socket;
+
+            if (!socket_blocking(sock, true)) {
+                socket_close(sock);
+                sock->sockfd = -1;
+                return false;
+            }
+
+            return true;
+        }
+
+        bool socket_connect_dual_stack(socket_t* sock, const char* host, unsigned int port, int type, unsigned int timeout, unsigned int attempt_delay) {
+            return socket_connect_dual_stack(sock, host, port, type, timeout, attempt_delay, NULL);
+        }
+
+        bool socket_connect_dual_stack(socket_t* sock, const char* host, unsigned int port, int type, unsigned int timeout) {
+            return socket_connect_dual_stack(sock, host, port, type, timeout, 250, NULL);
+        }
+
+    #ifdef OS_LINUX
+        /** 异步连接完成的回调, 成功时sock为非阻塞的已连接套字节, 失败时error为错误码 */
+        typedef std::function<void(bool ok, socket_t* sock, int error)> connect_callback;
+
+        /** 异步连接过程中保存的状态 */
+        typedef struct {
+            connector_t connector;
+            io::event_loop_t* loop;
+            unsigned long long int timer;
+            connect_callback callback;
+        } __async_connect_t;
+
+        void __connector_async_step(std::shared_ptr<__async_connect_t> task);
+
+        /** 重新安排下一次检查超时与发起新连接的定时器 */
+        void __connector_async_schedule(std::shared_ptr<__async_connect_t> task) {
+            io::event_loop_cancel_timer(task->loop, task->timer);
+            task->timer = io::event_loop_add_timer(task->loop, connector_timeout(&task->connector), [task]() {
+                task->timer = 0;
+                connector_poll(&task->connector);
+                __connector_async_step(task);
+            });
+        }
+
+        /** 检查状态, 连接结束时执行回调 */
+        void __connector_async_step(std::shared_ptr<__async_connect_t> task) {
+            if (task->connector.state == CONNECTOR_CONNECTING) {
+                __connector_async_schedule(task);
+                return;
+            }
+
+            io::event_loop_cancel_timer(task->loop, task->timer);
+
+            if (task->connector.state == CONNECTOR_ESTABLISHED) {
+                task->callback(true, &task->connector.socket, 0);
+            } else {
+                task->callback(false, &task->connector.socket, task->connector.error);
+            }
+        }
+
+        /**
+         * 在事件循环上异步连接主机, 同一个线程可以同时进行大量连接
+         * @param loop          event_loop_t
+         * @param host          主机地址
+         * @param port          端口
+         * @param type          套字节类型
+         * @param timeout       整体超时时间(毫秒)
+         * @param attempt_delay 发起下一个地址连接前的等待时间(毫秒)
+         * @param tuning        连接前应用的调优参数, 可以为NULL
+         * @param callback      连接结束后的回调, 只会被调用一次
+         */
+        void connector_async(io::event_loop_t* loop, const char* host, unsigned int port, int type, unsigned int timeout, unsigned int attempt_delay, const socket_tuning_t* tuning, connect_callback callback) {
+            std::shared_ptr<__async_connect_t> task = std::make_shared<__async_connect_t>();
+
+            task->loop = loop;
+            task->timer = 0;
+            task->callback = callback;
+            connector_init(&task->connector, type, timeout, attempt_delay);
+
+            if (tuning != NULL) {
+                task->connector.tuning = *tuning;
+            }
+
+            // 监听回调只保存弱引用, 由描述符回调与定时器持有task, 避免循环引用
+            std::weak_ptr<__async_connect_t> weak = task;
+
+            task->connector.watch = [weak, loop](SOCKET sockfd, bool watch) {
+                if (!watch) {
+                    io::event_loop_remove(loop, sockfd);
+                    return;
+                }
+
+                std::shared_ptr<__async_connect_t> self = weak.lock();
+
+                io::event_loop_add(loop, sockfd, EVENT_WRITE, [self](SOCKET fd, int) {
+                    connector_ready(&self->connector, fd);
+                    __connector_async_step(self);
+                });
+            };
+
+            connector_start(&task->connector, host, port);
+            __connector_async_step(task);
+        }
+
+        void connector_async(io::event_loop_t* loop, const char* host, unsigned int port, int type, unsigned int timeout, connect_callback callback) {
+            connector_async(loop, host, port, type, timeout, 250, NULL, callback);
+        }
+    #endif
+    }
+}
+
+#endif
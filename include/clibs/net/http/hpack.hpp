@@ -0,0 +1,691 @@
+#ifndef _CLIBS_HPACK_H_
+#define _CLIBS_HPACK_H_ 1
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include "clibs/net/http/http_parser.hpp"
+
+#define HPACK_TABLE_SIZE 4096 // 动态表的默认大小(SETTINGS_HEADER_TABLE_SIZE)
+#define HPACK_STATIC_COUNT 61 // 静态表的项数
+#define HPACK_ENTRY_OVERHEAD 32 // 每一项在动态表中额外占用的大小
+
+#define HPACK_OK 0
+#define HPACK_ERROR -1 // 编码错误, 对应HTTP/2的COMPRESSION_ERROR
+#define HPACK_TOO_LARGE -2 // 头部超过了限制
+
+namespace clibs {
+    namespace net {
+        namespace http {
+            /**
+             * 解码后的一个头部字段
+             */
+            typedef struct {
+                std::string name;
+                std::string value;
+            } hpack_header_t;
+
+            /**
+             * 动态表, 最新的项在前面, 下标从HPACK_STATIC_COUNT + 1开始
+             */
+            typedef struct {
+                std::deque<hpack_header_t> entries;
+                size_t size; // 按RFC 7541计算的大小
+                size_t max_size;
+            } hpack_table_t;
+
+            /**
+             * 编码器, 每个连接一个, 只在发送方向使用
+             */
+            typedef struct {
+                hpack_table_t table;
+                size_t limit; // 对方允许的最大值(对方的SETTINGS_HEADER_TABLE_SIZE)
+                bool size_changed; // 下一个头部块需要先发送动态表大小更新
+            } hpack_encoder_t;
+
+            /**
+             * 解码器, 每个连接一个, 只在接收方向使用
+             */
+            typedef struct {
+                hpack_table_t table;
+                size_t limit; // 我方允许的最大值
+                size_t max_list_size; // 解码后头部列表的最大大小, 0为不限制
+            } hpack_decoder_t;
+
+            /** 静态表, 下标从1开始 */
+            const http_string_view_t* __hpack_static_table() {
+                static const http_string_view_t table[HPACK_STATIC_COUNT + 1][2] = {
+                    {{"", 0}, {"", 0}},
+                    {{":authority", 10}, {"", 0}}, {{":method", 7}, {"GET", 3}}, {{":method", 7}, {"POST", 4}},
+                    {{":path", 5}, {"/", 1}}, {{":path", 5}, {"/index.html", 11}}, {{":scheme", 7}, {"http", 4}},
+                    {{":scheme", 7}, {"https", 5}}, {{":status", 7}, {"200", 3}}, {{":status", 7}, {"204", 3}},
+                    {{":status", 7}, {"206", 3}}, {{":status", 7}, {"304", 3}}, {{":status", 7}, {"400", 3}},
+                    {{":status", 7}, {"404", 3}}, {{":status", 7}, {"500", 3}}, {{"accept-charset", 14}, {"", 0}},
+                    {{"accept-encoding", 15}, {"gzip, deflate", 13}}, {{"accept-language", 15}, {"", 0}}, {{"accept-ranges", 13}, {"", 0}},
+                    {{"accept", 6}, {"", 0}}, {{"access-control-allow-origin", 27}, {"", 0}}, {{"age", 3}, {"", 0}},
+                    {{"allow", 5}, {"", 0}}, {{"authorization", 13}, {"", 0}}, {{"cache-control", 13}, {"", 0}},
+                    {{"content-disposition", 19}, {"", 0}}, {{"content-encoding", 16}, {"", 0}}, {{"content-language", 16}, {"", 0}},
+                    {{"content-length", 14}, {"", 0}}, {{"content-location", 16}, {"", 0}}, {{"content-range", 13}, {"", 0}},
+                    {{"content-type", 12}, {"", 0}}, {{"cookie", 6}, {"", 0}}, {{"date", 4}, {"", 0}},
+                    {{"etag", 4}, {"", 0}}, {{"expect", 6}, {"", 0}}, {{"expires", 7}, {"", 0}},
+                    {{"from", 4}, {"", 0}}, {{"host", 4}, {"", 0}}, {{"if-match", 8}, {"", 0}},
+                    {{"if-modified-since", 17}, {"", 0}}, {{"if-none-match", 13}, {"", 0}}, {{"if-range", 8}, {"", 0}},
+                    {{"if-unmodified-since", 19}, {"", 0}}, {{"last-modified", 13}, {"", 0}}, {{"link", 4}, {"", 0}},
+                    {{"location", 8}, {"", 0}}, {{"max-forwards", 12}, {"", 0}}, {{"proxy-authenticate", 18}, {"", 0}},
+                    {{"proxy-authorization", 19}, {"", 0}}, {{"range", 5}, {"", 0}}, {{"referer", 7}, {"", 0}},
+                    {{"refresh", 7}, {"", 0}}, {{"retry-after", 11}, {"", 0}}, {{"server", 6}, {"", 0}},
+                    {{"set-cookie", 10}, {"", 0}}, {{"strict-transport-security", 25}, {"", 0}}, {{"transfer-encoding", 17}, {"", 0}},
+                    {{"user-agent", 10}, {"", 0}}, {{"vary", 4}, {"", 0}}, {{"via", 3}, {"", 0}},
+                    {{"www-authenticate", 16}, {"", 0}}
+                };
+
+                return &table[0][0];
+            }
+
+            /** 静态表第index项的名称 */
+            const http_string_view_t* __hpack_static_name(size_t index) {
+                return &__hpack_static_table()[index * 2];
+            }
+
+            /** 静态表第index项的值 */
+            const http_string_view_t* __hpack_static_value(size_t index) {
+                return &__hpack_static_table()[index * 2 + 1];
+            }
+
+            /** huffman编码, 下标为字节 */
+            const unsigned int* __hpack_huffman_codes() {
+                static const unsigned int codes[256] = {
+                0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+                0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+                0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+                0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+                0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+                0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+                0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+                0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+                0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+                0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+                0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+                0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+                0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+                0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+                0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+                0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+                0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+                0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+                0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+                0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+                0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+                0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+                0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+                0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+                0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+                0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+                0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+                0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+                0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+                0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+                0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+                0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+                };
+
+                return codes;
+            }
+
+            /** huffman编码的位数 */
+            const unsigned char* __hpack_huffman_lengths() {
+                static const unsigned char lengths[256] = {
+                13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+                28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+                6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+                5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+                13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+                7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+                15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+                6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+                20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+                24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+                22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+                21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+                26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+                19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+                20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+                26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+                };
+
+                return lengths;
+            }
+
+            /**
+             * huffman解码表, 每次处理4位
+             * 状态是huffman树的内部节点, 最短的编码有5位, 所以每4位最多输出一个字节
+             */
+            typedef struct {
+                unsigned char next[256][16]; // 下一个状态
+                short symbol[256][16]; // 输出的字节, 没有时为-1, 遇到EOS为-2
+                bool accept[256]; // 在这个状态结束时剩下的位是合法的填充(少于8位的1)
+            } hpack_huffman_table_t;
+
+            /** 构建huffman解码表 */
+            const hpack_huffman_table_t* __hpack_huffman_table() {
+                static hpack_huffman_table_t* table = NULL;
+                static std::once_flag once;
+
+                std::call_once(once, []() {
+                    // 先构建二叉树, 节点0为根, 叶子节点记录字节
+                    std::vector<int> children(1024, 0);
+                    std::vector<int> symbols(1024, -1);
+                    std::vector<int> states(1024, -1);
+                    int nodes = 1;
+
+                    for (int sym = 0; sym <= 256; sym ++) {
+                        unsigned int code = sym < 256 ? __hpack_huffman_codes()[sym] : 0x3fffffff;
+                        int length = sym < 256 ? __hpack_huffman_lengths()[sym] : 30;
+                        int node = 0;
+
+                        for (int i = length - 1; i >= 0; i --) {
+                            int bit = (code >> i) & 1;
+                            int& child = children[node * 2 + bit];
+
+                            if (child == 0) {
+                                child = nodes ++;
+                            }
+
+                            node = child;
+                        }
+
+                        symbols[node] = sym;
+                    }
+
+                    // 内部节点依次编号为状态, 并记录是否由全1的路径到达
+                    std::vector<int> internal;
+                    std::vector<int> ones(1024, -1);
+
+                    for (int node = 0; node < nodes; node ++) {
+                        if (symbols[node] < 0) {
+                            states[node] = internal.size();
+                            internal.push_back(node);
+                        }
+                    }
+
+                    for (int node = 0, depth = 0; depth < 8; depth ++) {
+                        ones[node] = depth;
+                        node = children[node * 2 + 1];
+
+                        if (symbols[node] >= 0) {
+                            break;
+                        }
+                    }
+
+                    table = new hpack_huffman_table_t();
+
+                    for (size_t state = 0; state < internal.size(); state ++) {
+                        table->accept[state] = ones[internal[state]] >= 0;
+
+                        for (int nibble = 0; nibble < 16; nibble ++) {
+                            int node = internal[state];
+                            short symbol = -1;
+
+                            for (int i = 3; i >= 0; i --) {
+                                node = children[node * 2 + ((nibble >> i) & 1)];
+
+                                if (symbols[node] >= 0) {
+                                    symbol = symbols[node] == 256 ? -2 : symbols[node];
+                                    node = 0;
+                                }
+                            }
+
+                            table->next[state][nibble] = states[node];
+                            table->symbol[state][nibble] = symbol;
+                        }
+                    }
+                });
+
+                return table;
+            }
+
+            /**
+             * huffman解码
+             * @param  data   编码的数据
+             * @param  len    长度
+             * @param  output 解码结果追加到之后
+             * @return        数据是否合法
+             */
+            bool hpack_huffman_decode(const char* data, size_t len, std::string* output) {
+                const hpack_huffman_table_t* table = __hpack_huffman_table();
+                unsigned char state = 0;
+                bool accept = true;
+
+                for (size_t i = 0; i < len; i ++) {
+                    unsigned char c = data[i];
+
+                    for (int shift = 4; shift >= 0; shift -= 4) {
+                        int nibble = (c >> shift) & 0x0f;
+                        short symbol = table->symbol[state][nibble];
+
+                        if (symbol == -2) {
+                            return false;
+                        } else if (symbol >= 0) {
+                            output->push_back((char)symbol);
+                        }
+
+                        state = table->next[state][nibble];
+                    }
+
+                    accept = table->accept[state];
+                }
+
+                return accept;
+            }
+
+            /** huffman编码后的长度 */
+            size_t hpack_huffman_length(const char* data, size_t len) {
+                size_t bits = 0;
+
+                for (size_t i = 0; i < len; i ++) {
+                    bits += __hpack_huffman_lengths()[(unsigned char)data[i]];
+                }
+
+                return (bits + 7) / 8;
+            }
+
+            /**
+             * huffman编码, 不足一个字节的部分用EOS的前缀(全1)填充
+             * @param data   原始数据
+             * @param len    长度
+             * @param output 编码结果追加到之后
+             */
+            void hpack_huffman_encode(const char* data, size_t len, std::string* output) {
+                unsigned long long int bits = 0;
+                int count = 0;
+
+                for (size_t i = 0; i < len; i ++) {
+                    unsigned char c = data[i];
+
+                    bits = (bits << __hpack_huffman_lengths()[c]) | __hpack_huffman_codes()[c];
+                    count += __hpack_huffman_lengths()[c];
+
+                    while (count >= 8) {
+                        count -= 8;
+                        output->push_back((char)(bits >> count));
+                    }
+                }
+
+                if (count > 0) {
+                    output->push_back((char)((bits << (8 - count)) | (0xff >> count)));
+                }
+            }
+
+            /**
+             * 编码整数
+             * @param output 输出
+             * @param first  第一个字节中前缀之外的位
+             * @param prefix 前缀的位数
+             * @param value  整数
+             */
+            void hpack_encode_int(std::string* output, unsigned char first, int prefix, size_t value) {
+                size_t max = (1 << prefix) - 1;
+
+                if (value < max) {
+                    output->push_back((char)(first | value));
+                    return;
+                }
+
+                output->push_back((char)(first | max));
+                value -= max;
+
+                while (value >= 128) {
+                    output->push_back((char)((value & 0x7f) | 0x80));
+                    value >>= 7;
+                }
+
+                output->push_back((char)value);
+            }
+
+            /**
+             * 解码整数
+             * @param  data   数据
+             * @param  len    长度
+             * @param  pos    当前位置, 成功后指向整数之后
+             * @param  prefix 前缀的位数
+             * @param  value  结果
+             * @return        数据是否完整合法
+             */
+            bool hpack_decode_int(const char* data, size_t len, size_t* pos, int prefix, size_t* value) {
+                size_t max = (1 << prefix) - 1;
+
+                if (*pos >= len) {
+                    return false;
+                }
+
+                *value = (unsigned char)data[(*pos) ++] & max;
+
+                if (*value < max) {
+                    return true;
+                }
+
+                for (int shift = 0; *pos < len; shift += 7) {
+                    unsigned char c = data[(*pos) ++];
+
+                    // 超过28位的整数没有实际意义, 按错误处理防止溢出
+                    if (shift > 21) {
+                        return false;
+                    }
+
+                    *value += (size_t)(c & 0x7f) << shift;
+
+                    if (!(c & 0x80)) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            /** 编码字符串, huffman编码更短时使用huffman编码 */
+            void hpack_encode_string(std::string* output, const char* data, size_t len) {
+                size_t huffman = hpack_huffman_length(data, len);
+
+                if (huffman < len) {
+                    hpack_encode_int(output, 0x80, 7, huffman);
+                    hpack_huffman_encode(data, len, output);
+                } else {
+                    hpack_encode_int(output, 0, 7, len);
+                    output->append(data, len);
+                }
+            }
+
+            /** 解码字符串 */
+            bool hpack_decode_string(const char* data, size_t len, size_t* pos, std::string* output) {
+                size_t length;
+
+                if (*pos >= len) {
+                    return false;
+                }
+
+                bool huffman = (unsigned char)data[*pos] & 0x80;
+
+                if (!hpack_decode_int(data, len, pos, 7, &length) || length > len - *pos) {
+                    return false;
+                }
+
+                output->clear();
+
+                if (huffman) {
+                    if (!hpack_huffman_decode(data + *pos, length, output)) {
+                        return false;
+                    }
+                } else {
+                    output->assign(data + *pos, length);
+                }
+
+                *pos += length;
+
+                return true;
+            }
+
+            /** 初始化动态表 */
+            void hpack_table_init(hpack_table_t* table, size_t max_size) {
+                table->entries.clear();
+                table->size = 0;
+                table->max_size = max_size;
+            }
+
+            /** 删除最旧的项直到不超过max_size */
+            void __hpack_table_evict(hpack_table_t* table, size_t max_size) {
+                while (table->size > max_size && !table->entries.empty()) {
+                    const hpack_header_t& entry = table->entries.back();
+                    table->size -= entry.name.size() + entry.value.size() + HPACK_ENTRY_OVERHEAD;
+                    table->entries.pop_back();
+                }
+            }
+
+            /** 修改动态表的大小 */
+            void hpack_table_resize(hpack_table_t* table, size_t max_size) {
+                table->max_size = max_size;
+                __hpack_table_evict(table, max_size);
+            }
+
+            /** 添加一项, 比整个表大的项会清空动态表 */
+            void hpack_table_add(hpack_table_t* table, const std::string& name, const std::string& value) {
+                size_t size = name.size() + value.size() + HPACK_ENTRY_OVERHEAD;
+
+                if (size > table->max_size) {
+                    __hpack_table_evict(table, 0);
+                    return;
+                }
+
+                // 名称可能引用了将被删除的项, 先拷贝
+                hpack_header_t entry = {name, value};
+                __hpack_table_evict(table, table->max_size - size);
+                table->entries.push_front(std::move(entry));
+                table->size += size;
+            }
+
+            /**
+             * 查找静态表与动态表中的项
+             * @param  table 动态表
+             * @param  index 下标, 从1开始
+             * @param  name  名称
+             * @param  value 值
+             * @return       下标是否存在
+             */
+            bool hpack_table_get(const hpack_table_t* table, size_t index, std::string* name, std::string* value) {
+                if (index == 0) {
+                    return false;
+                } else if (index <= HPACK_STATIC_COUNT) {
+                    name->assign(__hpack_static_name(index)->data, __hpack_static_name(index)->len);
+
+                    if (value != NULL) {
+                        value->assign(__hpack_static_value(index)->data, __hpack_static_value(index)->len);
+                    }
+
+                    return true;
+                } else if (index - HPACK_STATIC_COUNT - 1 < table->entries.size()) {
+                    const hpack_header_t& entry = table->entries[index - HPACK_STATIC_COUNT - 1];
+                    name->assign(entry.name);
+
+                    if (value != NULL) {
+                        value->assign(entry.value);
+                    }
+
+                    return true;
+                }
+
+                return false;
+            }
+
+            /** 初始化编码器 */
+            void hpack_encoder_init(hpack_encoder_t* encoder) {
+                hpack_table_init(&encoder->table, HPACK_TABLE_SIZE);
+                encoder->limit = HPACK_TABLE_SIZE;
+                encoder->size_changed = false;
+            }
+
+            /**
+             * 对方修改了SETTINGS_HEADER_TABLE_SIZE, 动态表不超过默认大小
+             * @param encoder hpack_encoder_t
+             * @param limit   对方允许的大小
+             */
+            void hpack_encoder_set_limit(hpack_encoder_t* encoder, size_t limit) {
+                size_t size = limit < HPACK_TABLE_SIZE ? limit : HPACK_TABLE_SIZE;
+                encoder->limit = limit;
+
+                if (size != encoder->table.max_size) {
+                    hpack_table_resize(&encoder->table, size);
+                    encoder->size_changed = true;
+                }
+            }
+
+            /** 查找完全相同的项与名称相同的项, 返回下标, 不存在时为0 */
+            size_t __hpack_encoder_find(const hpack_encoder_t* encoder, const http_string_view_t* name, const http_string_view_t* value, size_t* name_index) {
+                *name_index = 0;
+
+                for (size_t i = 1; i <= HPACK_STATIC_COUNT; i ++) {
+                    const http_string_view_t* entry = __hpack_static_name(i);
+
+                    if (entry->len == name->len && memcmp(entry->data, name->data, name->len) == 0) {
+                        const http_string_view_t* entry_value = __hpack_static_value(i);
+
+                        if (entry_value->len == value->len && memcmp(entry_value->data, value->data, value->len) == 0) {
+                            return i;
+                        }
+
+                        if (*name_index == 0) {
+                            *name_index = i;
+                        }
+                    }
+                }
+
+                for (size_t i = 0; i < encoder->table.entries.size(); i ++) {
+                    const hpack_header_t& entry = encoder->table.entries[i];
+
+                    if (entry.name.size() == name->len && memcmp(entry.name.data(), name->data, name->len) == 0) {
+                        if (entry.value.size() == value->len && memcmp(entry.value.data(), value->data, value->len) == 0) {
+                            return HPACK_STATIC_COUNT + 1 + i;
+                        }
+
+                        if (*name_index == 0) {
+                            *name_index = HPACK_STATIC_COUNT + 1 + i;
+                        }
+                    }
+                }
+
+                return 0;
+            }
+
+            /**
+             * 编码一个头部字段, 名称需要是小写的
+             * 每次请求都不同的值(:path, content-length)不加入动态表, 认证信息使用never indexed
+             * @param encoder hpack_encoder_t
+             * @param name    名称
+             * @param value   值
+             * @param output  输出
+             */
+            void hpack_encode_field(hpack_encoder_t* encoder, const http_string_view_t& name, const http_string_view_t& value, std::string* output) {
+                // 动态表大小更新必须在头部块的开头
+                if (encoder->size_changed) {
+                    hpack_encode_int(output, 0x20, 5, encoder->table.max_size);
+                    encoder->size_changed = false;
+                }
+
+                size_t name_index;
+                size_t index = __hpack_encoder_find(encoder, &name, &value, &name_index);
+
+                if (index > 0) {
+                    hpack_encode_int(output, 0x80, 7, index);
+                    return;
+                }
+
+                bool sensitive = http_view_equals(&name, "authorization") || http_view_equals(&name, "proxy-authorization")
+                    || (http_view_equals(&name, "cookie") && value.len < 20);
+                bool indexing = !sensitive && !http_view_equals(&name, ":path") && !http_view_equals(&name, "content-length")
+                    && name.len + value.len + HPACK_ENTRY_OVERHEAD <= encoder->table.max_size / 2;
+
+                if (indexing) {
+                    hpack_encode_int(output, 0x40, 6, name_index);
+                } else {
+                    hpack_encode_int(output, sensitive ? 0x10 : 0, 4, name_index);
+                }
+
+                if (name_index == 0) {
+                    hpack_encode_string(output, name.data, name.len);
+                }
+
+                hpack_encode_string(output, value.data, value.len);
+
+                if (indexing) {
+                    hpack_table_add(&encoder->table, std::string(name.data, name.len), std::string(value.data, value.len));
+                }
+            }
+
+            /**
+             * 初始化解码器
+             * @param decoder       hpack_decoder_t
+             * @param max_list_size 解码后头部列表的最大大小, 0为不限制
+             */
+            void hpack_decoder_init(hpack_decoder_t* decoder, size_t max_list_size) {
+                hpack_table_init(&decoder->table, HPACK_TABLE_SIZE);
+                decoder->limit = HPACK_TABLE_SIZE;
+                decoder->max_list_size = max_list_size;
+            }
+
+            /**
+             * 解码一个完整的头部块, 出错后连接上的动态表已经不可用, 需要关闭连接
+             * 超过大小限制时仍然会解码完整个块以保持动态表同步
+             * @param  decoder hpack_decoder_t
+             * @param  data    头部块
+             * @param  len     长度
+             * @param  headers 解码结果追加到之后
+             * @return         HPACK_OK/HPACK_ERROR/HPACK_TOO_LARGE
+             */
+            int hpack_decode(hpack_decoder_t* decoder, const char* data, size_t len, std::vector<hpack_header_t>* headers) {
+                size_t pos = 0, list_size = 0;
+                bool fields = false, too_large = false;
+
+                while (pos < len) {
+                    unsigned char c = data[pos];
+                    size_t index;
+
+                    if (c & 0x80) {
+                        // 完整的索引
+                        hpack_header_t header;
+
+                        if (!hpack_decode_int(data, len, &pos, 7, &index) || !hpack_table_get(&decoder->table, index, &header.name, &header.value)) {
+                            return HPACK_ERROR;
+                        }
+
+                        list_size += header.name.size() + header.value.size() + HPACK_ENTRY_OVERHEAD;
+                        fields = true;
+
+                        if (!too_large) {
+                            headers->push_back(std::move(header));
+                        }
+                    } else if ((c & 0xe0) == 0x20) {
+                        // 动态表大小更新, 只能出现在头部块的开头
+                        if (fields || !hpack_decode_int(data, len, &pos, 5, &index) || index > decoder->limit) {
+                            return HPACK_ERROR;
+                        }
+
+                        hpack_table_resize(&decoder->table, index);
+                    } else {
+                        // 字面量, 01为加入动态表, 0000为不加入, 0001为永不加入
+                        bool indexing = (c & 0xc0) == 0x40;
+                        hpack_header_t header;
+
+                        if (!hpack_decode_int(data, len, &pos, indexing ? 6 : 4, &index)) {
+                            return HPACK_ERROR;
+                        }
+
+                        if (index > 0 ? !hpack_table_get(&decoder->table, index, &header.name, NULL) : !hpack_decode_string(data, len, &pos, &header.name)) {
+                            return HPACK_ERROR;
+                        }
+
+                        if (!hpack_decode_string(data, len, &pos, &header.value)) {
+                            return HPACK_ERROR;
+                        }
+
+                        if (indexing) {
+                            hpack_table_add(&decoder->table, header.name, header.value);
+                        }
+
+                        list_size += header.name.size() + header.value.size() + HPACK_ENTRY_OVERHEAD;
+                        fields = true;
+
+                        if (!too_large) {
+                            headers->push_back(std::move(header));
+                        }
+                    }
+
+                    too_large = too_large || (decoder->max_list_size > 0 && list_size > decoder->max_list_size);
+                }
+
+                return too_large ? HPACK_TOO_LARGE : HPACK_OK;
+            }
+        }
+    }
+}
+
+#endif
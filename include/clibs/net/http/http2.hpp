@@ -0,0 +1,1227 @@
+#ifndef _CLIBS_HTTP2_H_
+#define _CLIBS_HTTP2_H_ 1
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <iterator>
+#include <poll.h>
+#include "clibs/net/socket.hpp"
+#include "clibs/net/sslsocket.hpp"
+#include "clibs/net/connector.hpp"
+#include "clibs/net/output_buffer.hpp"
+#include "clibs/net/url.hpp"
+#include "clibs/net/http/http_header.hpp"
+#include "clibs/net/http/http_parser.hpp"
+#include "clibs/net/http/http_reader.hpp"
+#include "clibs/net/http/hpack.hpp"
+
+#define HTTP2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n" // 客户端连接前言
+#define HTTP2_PREFACE_LENGTH 24
+#define HTTP2_FRAME_HEADER_SIZE 9
+
+#define HTTP2_FRAME_DATA 0x0
+#define HTTP2_FRAME_HEADERS 0x1
+#define HTTP2_FRAME_PRIORITY 0x2
+#define HTTP2_FRAME_RST_STREAM 0x3
+#define HTTP2_FRAME_SETTINGS 0x4
+#define HTTP2_FRAME_PUSH_PROMISE 0x5
+#define HTTP2_FRAME_PING 0x6
+#define HTTP2_FRAME_GOAWAY 0x7
+#define HTTP2_FRAME_WINDOW_UPDATE 0x8
+#define HTTP2_FRAME_CONTINUATION 0x9
+
+#define HTTP2_FLAG_END_STREAM 0x1
+#define HTTP2_FLAG_ACK 0x1 // SETTINGS与PING
+#define HTTP2_FLAG_END_HEADERS 0x4
+#define HTTP2_FLAG_PADDED 0x8
+#define HTTP2_FLAG_PRIORITY 0x20
+
+#define HTTP2_SETTINGS_HEADER_TABLE_SIZE 0x1
+#define HTTP2_SETTINGS_ENABLE_PUSH 0x2
+#define HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS 0x3
+#define HTTP2_SETTINGS_INITIAL_WINDOW_SIZE 0x4
+#define HTTP2_SETTINGS_MAX_FRAME_SIZE 0x5
+#define HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE 0x6
+
+#define HTTP2_NO_ERROR 0x0
+#define HTTP2_PROTOCOL_ERROR 0x1
+#define HTTP2_INTERNAL_ERROR 0x2
+#define HTTP2_FLOW_CONTROL_ERROR 0x3
+#define HTTP2_SETTINGS_TIMEOUT 0x4
+#define HTTP2_STREAM_CLOSED 0x5
+#define HTTP2_FRAME_SIZE_ERROR 0x6
+#define HTTP2_REFUSED_STREAM 0x7
+#define HTTP2_CANCEL 0x8
+#define HTTP2_COMPRESSION_ERROR 0x9
+#define HTTP2_CONNECT_ERROR 0xa
+#define HTTP2_ENHANCE_YOUR_CALM 0xb
+#define HTTP2_INADEQUATE_SECURITY 0xc
+#define HTTP2_HTTP_1_1_REQUIRED 0xd
+
+#define HTTP2_DEFAULT_WINDOW 65535 // 协议默认的流量控制窗口
+#define HTTP2_DEFAULT_FRAME_SIZE 16384 // 协议默认的最大帧长度, 我方不修改
+#define HTTP2_MAX_FRAME_SIZE 16777215
+#define HTTP2_MAX_WINDOW 0x7fffffff
+#define HTTP2_MAX_STREAM_ID 0x7fffffff
+#define HTTP2_STREAM_WINDOW (1 << 20) // 我方每个流的接收窗口
+#define HTTP2_CONNECTION_WINDOW (16 << 20) // 我方连接的接收窗口
+#define HTTP2_MAX_STREAMS 100 // 默认同时打开的流的数量
+#define HTTP2_BUFFER 16384 // 单次读取的长度
+#define HTTP2_MAX_FAILURES 3 // 连续多少个连接没有任何响应后放弃
+
+#define HTTP2_OK 0 // 收到了完整的响应
+#define HTTP2_PENDING 1 // 还没有执行
+#define HTTP2_CONNECT -1 // 无法建立连接或者对方不支持HTTP/2
+#define HTTP2_CLOSED -2 // 连接在响应之前关闭, 请求不能安全地重发
+#define HTTP2_PROTOCOL -3 // 响应不合法或超过限制
+#define HTTP2_TIMEOUT -4 // 读取或发送超时
+#define HTTP2_RESET -5 // 对方重置了流
+
+#define __HTTP2_MORE 0 // 连接还可以继续使用
+#define __HTTP2_EOF 1 // 连接已经关闭或者不能再打开新的流
+
+namespace clibs {
+    namespace net {
+        namespace http {
+            /**
+             * 帧头
+             */
+            typedef struct {
+                unsigned int length;
+                unsigned char type; // HTTP2_FRAME_*
+                unsigned char flags; // HTTP2_FLAG_*
+                unsigned int stream_id;
+            } http2_frame_t;
+
+            /**
+             * SETTINGS帧中的一项
+             */
+            typedef struct {
+                unsigned short id; // HTTP2_SETTINGS_*
+                unsigned int value;
+            } http2_setting_t;
+
+            /** 读取网络字节序的32位整数 */
+            unsigned int __http2_get32(const char* data) {
+                const unsigned char* p = (const unsigned char*)data;
+
+                return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+            }
+
+            /** 追加网络字节序的32位整数 */
+            void __http2_put32(std::string* output, unsigned int value) {
+                char data[4] = {(char)(value >> 24), (char)(value >> 16), (char)(value >> 8), (char)value};
+                output->append(data, 4);
+            }
+
+            /**
+             * 解析9字节的帧头
+             * @param data  帧头数据
+             * @param frame 结果
+             */
+            void http2_frame_parse(const char* data, http2_frame_t* frame) {
+                const unsigned char* p = (const unsigned char*)data;
+
+                frame->length = ((unsigned int)p[0] << 16) | ((unsigned int)p[1] << 8) | p[2];
+                frame->type = p[3];
+                frame->flags = p[4];
+                frame->stream_id = __http2_get32(data + 5) & HTTP2_MAX_STREAM_ID;
+            }
+
+            /**
+             * 追加一个帧
+             * @param output    输出
+             * @param type      HTTP2_FRAME_*
+             * @param flags     HTTP2_FLAG_*
+             * @param stream_id 流
+             * @param payload   帧的内容
+             * @param length    长度, 不能超过对方的SETTINGS_MAX_FRAME_SIZE
+             */
+            void http2_frame_append(std::string* output, unsigned char type, unsigned char flags, unsigned int stream_id, const char* payload, size_t length) {
+                char head[5] = {(char)(length >> 16), (char)(length >> 8), (char)length, (char)type, (char)flags};
+
+                output->append(head, 5);
+                __http2_put32(output, stream_id & HTTP2_MAX_STREAM_ID);
+                output->append(payload, length);
+            }
+
+            /** 追加SETTINGS帧 */
+            void http2_settings_append(std::string* output, const std::vector<http2_setting_t>& settings) {
+                std::string payload;
+
+                for (size_t i = 0; i < settings.size(); i ++) {
+                    payload.push_back((char)(settings[i].id >> 8));
+                    payload.push_back((char)settings[i].id);
+                    __http2_put32(&payload, settings[i].value);
+                }
+
+                http2_frame_append(output, HTTP2_FRAME_SETTINGS, 0, 0, payload.data(), payload.size());
+            }
+
+            /** 追加WINDOW_UPDATE帧 */
+            void http2_window_update_append(std::string* output, unsigned int stream_id, unsigned int increment) {
+                std::string payload;
+                __http2_put32(&payload, increment & HTTP2_MAX_WINDOW);
+                http2_frame_append(output, HTTP2_FRAME_WINDOW_UPDATE, 0, stream_id, payload.data(), payload.size());
+            }
+
+            /** 追加RST_STREAM帧 */
+            void http2_rst_stream_append(std::string* output, unsigned int stream_id, unsigned int error) {
+                std::string payload;
+                __http2_put32(&payload, error);
+                http2_frame_append(output, HTTP2_FRAME_RST_STREAM, 0, stream_id, payload.data(), payload.size());
+            }
+
+            /** 追加GOAWAY帧 */
+            void http2_goaway_append(std::string* output, unsigned int last_stream_id, unsigned int error) {
+                std::string payload;
+                __http2_put32(&payload, last_stream_id & HTTP2_MAX_STREAM_ID);
+                __http2_put32(&payload, error);
+                http2_frame_append(output, HTTP2_FRAME_GOAWAY, 0, 0, payload.data(), payload.size());
+            }
+
+            /**
+             * 追加头部块, 超过最大帧长度时拆分为HEADERS与CONTINUATION
+             * @param output     输出
+             * @param stream_id  流
+             * @param block      hpack编码后的头部块
+             * @param end_stream 之后没有body
+             * @param max_frame  对方的SETTINGS_MAX_FRAME_SIZE
+             */
+            void http2_headers_append(std::string* output, unsigned int stream_id, const std::string& block, bool end_stream, size_t max_frame) {
+                size_t offset = 0;
+                unsigned char type = HTTP2_FRAME_HEADERS;
+
+                do {
+                    size_t length = block.size() - offset < max_frame ? block.size() - offset : max_frame;
+                    unsigned char flags = offset + length == block.size() ? HTTP2_FLAG_END_HEADERS : 0;
+
+                    if (type == HTTP2_FRAME_HEADERS && end_stream) {
+                        flags |= HTTP2_FLAG_END_STREAM;
+                    }
+
+                    http2_frame_append(output, type, flags, stream_id, block.data() + offset, length);
+                    type = HTTP2_FRAME_CONTINUATION;
+                    offset += length;
+                } while (offset < block.size());
+            }
+
+            /**
+             * 去掉DATA与HEADERS帧中的填充与优先级字段
+             * @param  frame   帧头
+             * @param  payload 帧的内容
+             * @param  offset  有效数据的开始位置
+             * @param  length  有效数据的长度
+             * @return         填充长度是否合法
+             */
+            bool http2_frame_payload(const http2_frame_t* frame, const char* payload, size_t* offset, size_t* length) {
+                size_t padding = 0;
+
+                *offset = 0;
+                *length = frame->length;
+
+                if (frame->flags & HTTP2_FLAG_PADDED) {
+                    if (frame->length < 1) {
+                        return false;
+                    }
+
+                    padding = (unsigned char)payload[0];
+                    *offset = 1;
+                }
+
+                if (frame->type == HTTP2_FRAME_HEADERS && (frame->flags & HTTP2_FLAG_PRIORITY)) {
+                    *offset += 5;
+                }
+
+                if (*offset + padding > frame->length) {
+                    return false;
+                }
+
+                *length = frame->length - *offset - padding;
+
+                return true;
+            }
+
+            /**
+             * HTTP/2的请求
+             */
+            typedef struct {
+                std::string method;
+                std::string target; // 路径与查询参数
+                CHttpHeader headers;
+                std::string body;
+            } http2_request_t;
+
+            /**
+             * 打开的流
+             */
+            typedef struct {
+                size_t index; // 请求的下标
+                long long int send_window; // 发送窗口, 对方修改SETTINGS_INITIAL_WINDOW_SIZE后可能为负数
+                long long int recv_window; // 接收窗口的剩余
+                size_t sent; // 已发送的body长度
+                bool has_headers; // 已经收到了最终响应的头部
+                unsigned long long int body_size;
+            } http2_stream_t;
+
+            /**
+             * HTTP/2客户端, 同一个主机的多个请求在一个连接上的多个流中并发执行
+             * https使用ALPN协商h2, http直接使用h2c(prior knowledge)
+             * 连接在多次execute之间保持, 对方发送GOAWAY或关闭连接后自动重连, 没有处理的请求在新连接上重发
+             */
+            class CHttp2Client {
+                protected:
+                    url_t m_url;
+                    bool m_is_ssl;
+                    std::string m_authority;
+                    socket_t m_socket;
+                    ssl_socket_t m_ssl_socket;
+                    bool m_connected;
+                    std::vector<http2_request_t> m_requests;
+                    std::vector<http_response_t> m_responses;
+                    std::vector<int> m_results; // 每个请求的结果, HTTP2_*
+                    std::deque<size_t> m_waiting; // 还没有打开流的请求
+                    std::map<unsigned int, http2_stream_t> m_streams; // 打开的流, 按流编号排序
+                    unsigned int m_next_stream;
+                    unsigned int m_max_streams; // 我方同时打开的流的上限
+                    unsigned int m_peer_max_streams; // 对方的SETTINGS_MAX_CONCURRENT_STREAMS
+                    long long int m_peer_window; // 对方的SETTINGS_INITIAL_WINDOW_SIZE
+                    size_t m_peer_frame_size; // 对方的SETTINGS_MAX_FRAME_SIZE
+                    long long int m_send_window; // 连接的发送窗口
+                    long long int m_recv_window; // 连接的接收窗口的剩余
+                    unsigned int m_window; // 我方每个流的接收窗口
+                    bool m_goaway;
+                    unsigned int m_goaway_last; // GOAWAY中对方处理过的最后一个流
+                    unsigned int m_header_stream; // 正在接收头部块的流, 0为没有
+                    bool m_header_end_stream;
+                    std::string m_header_block;
+                    std::string m_input; // 不完整的帧
+                    size_t m_answered; // 当前连接上完成的响应数量
+                    unsigned int m_connect_timeout; // 连接超时时间(秒)
+                    unsigned int m_read_timeout; // 读取超时时间(秒)
+                    unsigned int m_connections; // 本次execute建立的连接数
+                    socket_tuning_t m_tuning;
+                    ssl_context_t* m_ssl_context;
+                    http_limits_t m_limits;
+                    output_buffer_t m_output;
+                    hpack_encoder_t m_encoder;
+                    hpack_decoder_t m_decoder;
+                    std::string m_error;
+
+                public:
+                    CHttp2Client() {
+                        m_is_ssl = false;
+                        m_socket.sockfd = -1;
+                        m_ssl_socket.ssl = NULL;
+                        m_ssl_socket.ctx = NULL;
+                        m_connected = false;
+                        m_max_streams = HTTP2_MAX_STREAMS;
+                        m_window = HTTP2_STREAM_WINDOW;
+                        m_connect_timeout = 15;
+                        m_read_timeout = 15;
+                        m_connections = 0;
+                        m_ssl_context = NULL;
+                        socket_tuning_preset(&m_tuning, TUNING_LOW_LATENCY);
+                        http_limits_init(&m_limits);
+                        output_buffer_init(&m_output);
+                    }
+
+                    ~CHttp2Client() {
+                        close();
+                    }
+
+                    /**
+                     * 设置主机, 之后添加的请求只需要路径, 修改主机会关闭当前连接
+                     * @param  url scheme://host:port, 路径会被忽略
+                     * @return     true/false
+                     */
+                    bool set_url(const std::string& url) {
+                        if (!url_parse(&m_url, url) || (m_url.protocol != "http" && m_url.protocol != "https")) {
+                            m_error = "Failed to parse URL.";
+                            return false;
+                        }
+
+                        close();
+                        m_is_ssl = m_url.protocol == "https";
+                        m_authority = m_url.host;
+
+                        if (m_url.port != (m_is_ssl ? 443 : 80)) {
+                            m_authority += ":" + std::to_string(m_url.port);
+                        }
+
+                        return true;
+                    }
+
+                    /** 设置同时打开的流的上限, 实际不超过对方的SETTINGS_MAX_CONCURRENT_STREAMS */
+                    void set_max_streams(unsigned int max_streams) {
+                        m_max_streams = max_streams > 0 ? max_streams : 1;
+                    }
+
+                    /** 设置每个流的接收窗口, 在下一个连接生效 */
+                    void set_window(unsigned int window) {
+                        m_window = window < HTTP2_DEFAULT_WINDOW ? HTTP2_DEFAULT_WINDOW : (window > HTTP2_MAX_WINDOW ? HTTP2_MAX_WINDOW : window);
+                    }
+
+                    /** 设置连接超时(秒) */
+                    void set_connect_timeout(unsigned int timeout) {
+                        m_connect_timeout = timeout;
+                    }
+
+                    /** 设置读取超时(秒), 有打开的流时超过该时间没有收到任何数据则失败 */
+                    void set_read_timeout(unsigned int timeout) {
+                        m_read_timeout = timeout;
+                    }
+
+                    /** 设置tcp调优参数 */
+                    void set_tuning(const socket_tuning_t* tuning) {
+                        m_tuning = *tuning;
+                    }
+
+                    /** 设置ssl上下文 */
+                    void set_ssl_context(ssl_context_t* context) {
+                        m_ssl_context = context;
+                    }
+
+                    /** 设置对每个响应的限制, max_header_size作为SETTINGS_MAX_HEADER_LIST_SIZE */
+                    void set_limits(const http_limits_t* limits) {
+                        m_limits = *limits;
+                    }
+
+                    /**
+                     * 添加请求
+                     * @param  method  请求方法
+                     * @param  target  路径与查询参数
+                     * @param  body    请求body
+                     * @param  headers 请求头, 可以为NULL, 连接相关的请求头会被忽略
+                     * @return         请求的下标
+                     */
+                    size_t add(const std::string& method, const std::string& target, const std::string& body, const CHttpHeader* headers) {
+                        http2_request_t request;
+
+                        request.method = method;
+                        request.target = target.empty() ? "/" : target;
+                        request.body = body;
+
+                        if (headers != NULL) {
+                            request.headers = *headers;
+                        }
+
+                        m_requests.push_back(request);
+                        m_responses.push_back(http_response_t());
+                        m_results.push_back(HTTP2_PENDING);
+
+                        return m_requests.size() - 1;
+                    }
+
+                    /** 添加GET请求 */
+                    size_t get(const std::string& target) {
+                        return add("GET", target, "", NULL);
+                    }
+
+                    /** 请求数量 */
+                    size_t size() {
+                        return m_requests.size();
+                    }
+
+                    /** 清空请求与响应, 连接保持不变 */
+                    void clear() {
+                        m_requests.clear();
+                        m_responses.clear();
+                        m_results.clear();
+                    }
+
+                    /** 获取请求的结果, HTTP2_* */
+                    int get_result(size_t index) {
+                        return m_results[index];
+                    }
+
+                    /** 获取请求的响应, HTTP/2没有状态描述, status_message为空 */
+                    http_response_t* get_response(size_t index) {
+                        return &m_responses[index];
+                    }
+
+                    /** 最近一次execute建立的连接数 */
+                    unsigned int get_connections() {
+                        return m_connections;
+                    }
+
+                    /** 是否有可以继续使用的连接 */
+                    bool connected() {
+                        return m_connected;
+                    }
+
+                    /** 获取错误描述 */
+                    std::string error() {
+                        return m_error;
+                    }
+
+                    /** 发送GOAWAY并关闭连接 */
+                    void close() {
+                        if (m_connected) {
+                            std::string frame;
+                            http2_goaway_append(&frame, 0, HTTP2_NO_ERROR);
+                            output_buffer_append(&m_output, std::move(frame));
+                            __flush();
+                        }
+
+                        __close();
+                    }
+
+                    /** 请求是否可以安全地重发 */
+                    bool __replayable(size_t index) {
+                        const std::string& method = m_requests[index].method;
+
+                        return method == "GET" || method == "HEAD" || method == "OPTIONS" || method == "TRACE"
+                            || method == "PUT" || method == "DELETE" || m_requests[index].headers.contains("Idempotency-Key");
+                    }
+
+                    /** 关闭连接, 不发送任何数据 */
+                    void __close() {
+                        if (m_ssl_socket.ctx != NULL) {
+                            socket_ssl_close(&m_ssl_socket);
+                            m_ssl_socket.ssl = NULL;
+                            m_ssl_socket.ctx = NULL;
+                        }
+
+                        if (m_socket.sockfd != -1) {
+                            socket_shutdown(&m_socket, SHUT_RDWR);
+                            socket_close(&m_socket);
+                            m_socket.sockfd = -1;
+                        }
+
+                        output_buffer_clear(&m_output);
+                        m_connected = false;
+                    }
+
+                    /** 发送输出缓冲区中的数据, 不等待 */
+                    int __flush() {
+                        if (output_buffer_size(&m_output) == 0) {
+                            return OUTPUT_FLUSHED;
+                        }
+
+                        return m_is_ssl ? output_buffer_flush(&m_output, &m_ssl_socket, &m_socket) : output_buffer_flush(&m_output, &m_socket);
+                    }
+
+                    /** 建立连接, 发送连接前言与SETTINGS */
+                    bool __open() {
+                        __close();
+                        m_connections ++;
+
+                        if (!socket_connect_dual_stack(&m_socket, m_url.host.c_str(), m_url.port, SOCK_STREAM, m_connect_timeout * 1000, 250, &m_tuning)) {
+                            m_error = "Failed to connect to the server";
+                            return false;
+                        }
+
+                        if (m_is_ssl) {
+                            if (!socket_ssl_use_context(&m_ssl_socket, m_ssl_context != NULL ? m_ssl_context : socket_ssl_shared_context())
+                                || !socket_ssl_bind(&m_ssl_socket, &m_socket) || !socket_ssl_set_host(&m_ssl_socket, m_url.host.c_str(), m_url.port)
+                                || !socket_ssl_set_alpn(&m_ssl_socket, {"h2"}) || !socket_ssl_connect(&m_ssl_socket)) {
+                                m_error = "SSL connection failed";
+                                return false;
+                            }
+
+                            if (socket_ssl_alpn(&m_ssl_socket) != "h2") {
+                                m_error = "Server did not negotiate HTTP/2";
+                                return false;
+                            }
+                        }
+
+                        if (!socket_blocking(&m_socket, false)) {
+                            m_error = "Failed to set non-blocking mode";
+                            return false;
+                        }
+
+                        m_connected = true;
+                        m_next_stream = 1;
+                        m_peer_max_streams = HTTP2_MAX_STREAM_ID;
+                        m_peer_window = HTTP2_DEFAULT_WINDOW;
+                        m_peer_frame_size = HTTP2_DEFAULT_FRAME_SIZE;
+                        m_send_window = HTTP2_DEFAULT_WINDOW;
+                        m_recv_window = HTTP2_CONNECTION_WINDOW;
+                        m_goaway = false;
+                        m_goaway_last = HTTP2_MAX_STREAM_ID;
+                        m_header_stream = 0;
+                        m_input.clear();
+                        hpack_encoder_init(&m_encoder);
+                        hpack_decoder_init(&m_decoder, m_limits.max_header_size);
+
+                        std::string data(HTTP2_PREFACE, HTTP2_PREFACE_LENGTH);
+                        http2_settings_append(&data, {
+                            {HTTP2_SETTINGS_ENABLE_PUSH, 0},
+                            {HTTP2_SETTINGS_INITIAL_WINDOW_SIZE, m_window},
+                            {HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE, (unsigned int)m_limits.max_header_size}
+                        });
+                        http2_window_update_append(&data, 0, HTTP2_CONNECTION_WINDOW - HTTP2_DEFAULT_WINDOW);
+                        output_buffer_append(&m_output, std::move(data));
+
+                        return true;
+                    }
+
+                    /** 编码一个头部字段 */
+                    void __encode(const char* name, size_t name_len, const char* value, size_t value_len, std::string* block) {
+                        hpack_encode_field(&m_encoder, http_string_view_t{name, name_len}, http_string_view_t{value, value_len}, block);
+                    }
+
+                    /** 为请求打开一个流, 没有body时HEADERS带END_STREAM */
+                    void __start(size_t index) {
+                        const http2_request_t* request = &m_requests[index];
+                        unsigned int id = m_next_stream;
+                        std::string block, name;
+
+                        m_next_stream += 2;
+                        m_responses[index] = http_response_t();
+
+                        http_string_view_t host = request->headers.get_view(HTTP_HEADER_HOST);
+                        const char* scheme = m_is_ssl ? "https" : "http";
+
+                        __encode(":method", 7, request->method.data(), request->method.size(), &block);
+                        __encode(":scheme", 7, scheme, strlen(scheme), &block);
+                        __encode(":authority", 10, host.data != NULL ? host.data : m_authority.data(), host.data != NULL ? host.len : m_authority.size(), &block);
+                        __encode(":path", 5, request->target.data(), request->target.size(), &block);
+
+                        for (size_t i = 0; i < request->headers.size(); i ++) {
+                            http_string_view_t field = request->headers.name_at(i);
+                            http_string_view_t value = request->headers.value_at(i);
+
+                            // HTTP/2禁止连接相关的请求头, 名称必须是小写
+                            if (http_view_equals(&field, "host") || http_view_equals(&field, "connection") || http_view_equals(&field, "keep-alive")
+                                || http_view_equals(&field, "proxy-connection") || http_view_equals(&field, "transfer-encoding") || http_view_equals(&field, "upgrade")
+                                || (http_view_equals(&field, "te") && !http_view_equals(&value, "trailers"))) {
+                                continue;
+                            }
+
+                            name.assign(field.data, field.len);
+
+                            for (size_t j = 0; j < name.size(); j ++) {
+                                name[j] = tolower(name[j]);
+                            }
+
+                            __encode(name.data(), name.size(), value.data, value.len, &block);
+                        }
+
+                        if ((!request->body.empty() || request->method == "POST" || request->method == "PUT") && !request->headers.contains(HTTP_HEADER_CONTENT_LENGTH)) {
+                            std::string length = std::to_string(request->body.size());
+                            __encode("content-length", 14, length.data(), length.size(), &block);
+                        }
+
+                        std::string data;
+                        http2_headers_append(&data, id, block, request->body.empty(), m_peer_frame_size);
+                        output_buffer_append(&m_output, std::move(data));
+
+                        http2_stream_t stream;
+                        stream.index = index;
+                        stream.send_window = m_peer_window;
+                        stream.recv_window = m_window;
+                        stream.sent = 0;
+                        stream.has_headers = false;
+                        stream.body_size = 0;
+                        m_streams[id] = stream;
+                    }
+
+                    /** 在流量控制窗口内发送请求body, 输出缓冲区较多时等待发送完成 */
+                    void __send_bodies() {
+                        for (std::map<unsigned int, http2_stream_t>::iterator it = m_streams.begin(); it != m_streams.end(); it ++) {
+                            http2_stream_t* stream = &it->second;
+                            const std::string& body = m_requests[stream->index].body;
+
+                            while (stream->sent < body.size() && stream->send_window > 0 && m_send_window > 0 && output_buffer_size(&m_output) < HTTP2_BUFFER * 16) {
+                                long long int length = body.size() - stream->sent;
+                                length = length < (long long int)m_peer_frame_size ? length : m_peer_frame_size;
+                                length = length < stream->send_window ? length : stream->send_window;
+                                length = length < m_send_window ? length : m_send_window;
+
+                                std::string data;
+                                unsigned char flags = stream->sent + length == body.size() ? HTTP2_FLAG_END_STREAM : 0;
+                                http2_frame_append(&data, HTTP2_FRAME_DATA, flags, it->first, body.data() + stream->sent, length);
+                                output_buffer_append(&m_output, std::move(data));
+
+                                stream->sent += length;
+                                stream->send_window -= length;
+                                m_send_window -= length;
+                            }
+                        }
+                    }
+
+                    /** 流结束, 对方提前结束时不再发送剩余的body */
+                    void __finish(unsigned int id, int result) {
+                        std::map<unsigned int, http2_stream_t>::iterator it = m_streams.find(id);
+
+                        if (it == m_streams.end()) {
+                            return;
+                        }
+
+                        if (result == HTTP2_OK) {
+                            m_answered ++;
+
+                            if (it->second.sent < m_requests[it->second.index].body.size()) {
+                                std::string data;
+                                http2_rst_stream_append(&data, id, HTTP2_NO_ERROR);
+                                output_buffer_append(&m_output, std::move(data));
+                            }
+                        }
+
+                        m_results[it->second.index] = result;
+                        m_streams.erase(it);
+                    }
+
+                    /** 重置流, 请求以result失败 */
+                    void __reset(unsigned int id, unsigned int error, int result) {
+                        std::string data;
+                        http2_rst_stream_append(&data, id, error);
+                        output_buffer_append(&m_output, std::move(data));
+                        __finish(id, result);
+                    }
+
+                    /** 连接错误, 发送GOAWAY之后关闭连接 */
+                    bool __error(unsigned int error, const char* message) {
+                        std::string data;
+                        http2_goaway_append(&data, 0, error);
+                        output_buffer_append(&m_output, std::move(data));
+                        __flush();
+                        m_error = message;
+
+                        return false;
+                    }
+
+                    /** 头部块接收完成, 解码后更新响应 */
+                    bool __headers() {
+                        std::vector<hpack_header_t> headers;
+                        unsigned int id = m_header_stream;
+                        int ret = hpack_decode(&m_decoder, m_header_block.data(), m_header_block.size(), &headers);
+
+                        m_header_stream = 0;
+
+                        // 解码失败后动态表无法与对方保持一致
+                        if (ret == HPACK_ERROR) {
+                            return __error(HTTP2_COMPRESSION_ERROR, "Invalid header block");
+                        }
+
+                        std::map<unsigned int, http2_stream_t>::iterator it = m_streams.find(id);
+
+                        if (it == m_streams.end()) {
+                            return true;
+                        } else if (ret == HPACK_TOO_LARGE) {
+                            __reset(id, HTTP2_CANCEL, HTTP2_PROTOCOL);
+                            return true;
+                        }
+
+                        http2_stream_t* stream = &it->second;
+                        http_response_t* response = &m_responses[stream->index];
+
+                        if (!stream->has_headers) {
+                            int status = 0;
+
+                            for (size_t i = 0; i < headers.size(); i ++) {
+                                if (headers[i].name == ":status") {
+                                    status = atoi(headers[i].value.c_str());
+                                }
+                            }
+
+                            // 100 Continue等临时响应之后还有最终的响应
+                            if (status >= 100 && status < 200 && !m_header_end_stream) {
+                                return true;
+                            } else if (status < 200 || status > 999 || headers.size() > m_limits.max_headers) {
+                                __reset(id, HTTP2_PROTOCOL_ERROR, HTTP2_PROTOCOL);
+                                return true;
+                            }
+
+                            response->status_code = status;
+                            stream->has_headers = true;
+                        } else if (!m_header_end_stream) {
+                            __reset(id, HTTP2_PROTOCOL_ERROR, HTTP2_PROTOCOL);
+                            return true;
+                        }
+
+                        // 第二个头部块是trailer, 同样追加到headers中
+                        for (size_t i = 0; i < headers.size(); i ++) {
+                            if (headers[i].name.empty() || headers[i].name[0] != ':') {
+                                response->headers.append(headers[i].name, headers[i].value);
+                            }
+                        }
+
+                        if (m_header_end_stream) {
+                            __finish(id, HTTP2_OK);
+                        }
+
+                        return true;
+                    }
+
+                    /** 处理DATA帧, 消费的数据超过窗口的一半时更新窗口 */
+                    bool __data(const http2_frame_t* frame, const char* payload) {
+                        size_t offset, length;
+
+                        if (frame->stream_id == 0 || !http2_frame_payload(frame, payload, &offset, &length)) {
+                            return __error(HTTP2_PROTOCOL_ERROR, "Invalid DATA frame");
+                        } else if (frame->length > m_recv_window) {
+                            return __error(HTTP2_FLOW_CONTROL_ERROR, "Connection flow control window exceeded");
+                        }
+
+                        m_recv_window -= frame->length;
+
+                        if (HTTP2_CONNECTION_WINDOW - m_recv_window >= HTTP2_CONNECTION_WINDOW / 2) {
+                            std::string data;
+                            http2_window_update_append(&data, 0, HTTP2_CONNECTION_WINDOW - m_recv_window);
+                            output_buffer_append(&m_output, std::move(data));
+                            m_recv_window = HTTP2_CONNECTION_WINDOW;
+                        }
+
+                        std::map<unsigned int, http2_stream_t>::iterator it = m_streams.find(frame->stream_id);
+
+                        // 已经重置的流可能还有在途中的数据
+                        if (it == m_streams.end()) {
+                            return true;
+                        }
+
+                        http2_stream_t* stream = &it->second;
+
+                        if (!stream->has_headers) {
+                            __reset(frame->stream_id, HTTP2_PROTOCOL_ERROR, HTTP2_PROTOCOL);
+                            return true;
+                        } else if (frame->length > stream->recv_window) {
+                            __reset(frame->stream_id, HTTP2_FLOW_CONTROL_ERROR, HTTP2_PROTOCOL);
+                            return true;
+                        }
+
+                        stream->recv_window -= frame->length;
+                        stream->body_size += length;
+
+                        if (!http_check_body(stream->body_size, &m_limits)) {
+                            __reset(frame->stream_id, HTTP2_CANCEL, HTTP2_PROTOCOL);
+                            return true;
+                        }
+
+                        m_responses[stream->index].body.append(payload + offset, length);
+
+                        if (frame->flags & HTTP2_FLAG_END_STREAM) {
+                            __finish(frame->stream_id, HTTP2_OK);
+                        } else if (m_window - stream->recv_window >= m_window / 2) {
+                            std::string data;
+                            http2_window_update_append(&data, frame->stream_id, m_window - stream->recv_window);
+                            output_buffer_append(&m_output, std::move(data));
+                            stream->recv_window = m_window;
+                        }
+
+                        return true;
+                    }
+
+                    /** 应用对方的SETTINGS */
+                    bool __settings(const http2_frame_t* frame, const char* payload) {
+                        if (frame->stream_id != 0) {
+                            return __error(HTTP2_PROTOCOL_ERROR, "Invalid SETTINGS frame");
+                        } else if (frame->flags & HTTP2_FLAG_ACK) {
+                            return frame->length == 0 ? true : __error(HTTP2_FRAME_SIZE_ERROR, "Invalid SETTINGS ACK");
+                        } else if (frame->length % 6 != 0) {
+                            return __error(HTTP2_FRAME_SIZE_ERROR, "Invalid SETTINGS frame");
+                        }
+
+                        for (size_t i = 0; i < frame->length; i += 6) {
+                            unsigned short id = ((unsigned char)payload[i] << 8) | (unsigned char)payload[i + 1];
+                            unsigned int value = __http2_get32(payload + i + 2);
+
+                            if (id == HTTP2_SETTINGS_HEADER_TABLE_SIZE) {
+                                hpack_encoder_set_limit(&m_encoder, value);
+                            } else if (id == HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS) {
+                                m_peer_max_streams = value;
+                            } else if (id == HTTP2_SETTINGS_INITIAL_WINDOW_SIZE) {
+                                if (value > HTTP2_MAX_WINDOW) {
+                                    return __error(HTTP2_FLOW_CONTROL_ERROR, "Invalid initial window size");
+                                }
+
+                                // 修改对已经打开的流同样生效
+                                for (std::map<unsigned int, http2_stream_t>::iterator it = m_streams.begin(); it != m_streams.end(); it ++) {
+                                    it->second.send_window += (long long int)value - m_peer_window;
+                                }
+
+                                m_peer_window = value;
+                            } else if (id == HTTP2_SETTINGS_MAX_FRAME_SIZE) {
+                                if (value < HTTP2_DEFAULT_FRAME_SIZE || value > HTTP2_MAX_FRAME_SIZE) {
+                                    return __error(HTTP2_PROTOCOL_ERROR, "Invalid max frame size");
+                                }
+
+                                m_peer_frame_size = value;
+                            }
+                        }
+
+                        std::string data;
+                        http2_frame_append(&data, HTTP2_FRAME_SETTINGS, HTTP2_FLAG_ACK, 0, NULL, 0);
+                        output_buffer_append(&m_output, std::move(data));
+
+                        return true;
+                    }
+
+                    /** 对方不再处理编号大于last的流, 这些请求可以在新连接上重发 */
+                    void __goaway(unsigned int last, unsigned int error) {
+                        m_goaway = true;
+                        m_goaway_last = last < m_goaway_last ? last : m_goaway_last;
+
+                        if (error != HTTP2_NO_ERROR) {
+                            m_error = "Connection closed by server with error " + std::to_string(error);
+                        }
+
+                        while (!m_streams.empty() && m_streams.rbegin()->first > m_goaway_last) {
+                            m_waiting.push_front(m_streams.rbegin()->second.index);
+                            m_streams.erase(std::prev(m_streams.end()));
+                        }
+                    }
+
+                    /** 处理一个完整的帧 */
+                    bool __frame(const http2_frame_t* frame, const char* payload) {
+                        // 头部块必须由连续的CONTINUATION帧组成
+                        if (m_header_stream != 0 && (frame->type != HTTP2_FRAME_CONTINUATION || frame->stream_id != m_header_stream)) {
+                            return __error(HTTP2_PROTOCOL_ERROR, "Expected CONTINUATION frame");
+                        }
+
+                        switch (frame->type) {
+                            case HTTP2_FRAME_DATA:
+                                return __data(frame, payload);
+                            case HTTP2_FRAME_HEADERS: {
+                                size_t offset, length;
+
+                                if (frame->stream_id == 0 || !http2_frame_payload(frame, payload, &offset, &length)) {
+                                    return __error(HTTP2_PROTOCOL_ERROR, "Invalid HEADERS frame");
+                                }
+
+                                m_header_stream = frame->stream_id;
+                                m_header_end_stream = frame->flags & HTTP2_FLAG_END_STREAM;
+                                m_header_block.assign(payload + offset, length);
+
+                                return (frame->flags & HTTP2_FLAG_END_HEADERS) ? __headers() : true;
+                            }
+                            case HTTP2_FRAME_CONTINUATION:
+                                if (m_header_stream == 0) {
+                                    return __error(HTTP2_PROTOCOL_ERROR, "Unexpected CONTINUATION frame");
+                                }
+
+                                m_header_block.append(payload, frame->length);
+
+                                // 头部块不会比解码后的头部列表更大
+                                if (m_header_block.size() > m_limits.max_header_size) {
+                                    return __error(HTTP2_ENHANCE_YOUR_CALM, "Header block too large");
+                                }
+
+                                return (frame->flags & HTTP2_FLAG_END_HEADERS) ? __headers() : true;
+                            case HTTP2_FRAME_RST_STREAM: {
+                                if (frame->length != 4 || frame->stream_id == 0) {
+                                    return __error(HTTP2_FRAME_SIZE_ERROR, "Invalid RST_STREAM frame");
+                                }
+
+                                std::map<unsigned int, http2_stream_t>::iterator it = m_streams.find(frame->stream_id);
+
+                                if (it != m_streams.end()) {
+                                    // REFUSED_STREAM表示请求没有被处理, 可以重发
+                                    if (__http2_get32(payload) == HTTP2_REFUSED_STREAM && !it->second.has_headers) {
+                                        m_waiting.push_front(it->second.index);
+                                        m_streams.erase(it);
+                                    } else {
+                                        __finish(frame->stream_id, HTTP2_RESET);
+                                    }
+                                }
+
+                                return true;
+                            }
+                            case HTTP2_FRAME_SETTINGS:
+                                return __settings(frame, payload);
+                            case HTTP2_FRAME_PUSH_PROMISE:
+                                return __error(HTTP2_PROTOCOL_ERROR, "Server push is disabled");
+                            case HTTP2_FRAME_PING:
+                                if (frame->length != 8 || frame->stream_id != 0) {
+                                    return __error(HTTP2_FRAME_SIZE_ERROR, "Invalid PING frame");
+                                }
+
+                                if (!(frame->flags & HTTP2_FLAG_ACK)) {
+                                    std::string data;
+                                    http2_frame_append(&data, HTTP2_FRAME_PING, HTTP2_FLAG_ACK, 0, payload, 8);
+                                    output_buffer_append(&m_output, std::move(data));
+                                }
+
+                                return true;
+                            case HTTP2_FRAME_GOAWAY:
+                                if (frame->length < 8 || frame->stream_id != 0) {
+                                    return __error(HTTP2_FRAME_SIZE_ERROR, "Invalid GOAWAY frame");
+                                }
+
+                                __goaway(__http2_get32(payload) & HTTP2_MAX_STREAM_ID, __http2_get32(payload + 4));
+
+                                return true;
+                            case HTTP2_FRAME_WINDOW_UPDATE: {
+                                if (frame->length != 4) {
+                                    return __error(HTTP2_FRAME_SIZE_ERROR, "Invalid WINDOW_UPDATE frame");
+                                }
+
+                                unsigned int increment = __http2_get32(payload) & HTTP2_MAX_WINDOW;
+
+                                if (frame->stream_id == 0) {
+                                    m_send_window += increment;
+
+                                    if (increment == 0 || m_send_window > HTTP2_MAX_WINDOW) {
+                                        return __error(increment == 0 ? HTTP2_PROTOCOL_ERROR : HTTP2_FLOW_CONTROL_ERROR, "Invalid WINDOW_UPDATE frame");
+                                    }
+
+                                    return true;
+                                }
+
+                                std::map<unsigned int, http2_stream_t>::iterator it = m_streams.find(frame->stream_id);
+
+                                if (it != m_streams.end()) {
+                                    it->second.send_window += increment;
+
+                                    if (increment == 0 || it->second.send_window > HTTP2_MAX_WINDOW) {
+                                        __reset(frame->stream_id, increment == 0 ? HTTP2_PROTOCOL_ERROR : HTTP2_FLOW_CONTROL_ERROR, HTTP2_PROTOCOL);
+                                    }
+                                }
+
+                                return true;
+                            }
+                            default:
+                                // PRIORITY与未知的帧直接忽略
+                                return true;
+                        }
+                    }
+
+                    /** 处理收到的数据, 不完整的帧保存到下一次 */
+                    bool __process(const char* buf, size_t len) {
+                        m_input.append(buf, len);
+                        size_t offset = 0;
+                        bool ok = true;
+
+                        while (ok && m_connected && m_input.size() - offset >= HTTP2_FRAME_HEADER_SIZE) {
+                            http2_frame_t frame;
+                            http2_frame_parse(m_input.data() + offset, &frame);
+
+                            if (frame.length > HTTP2_DEFAULT_FRAME_SIZE) {
+                                ok = __error(HTTP2_FRAME_SIZE_ERROR, "Frame too large");
+                                break;
+                            } else if (m_input.size() - offset - HTTP2_FRAME_HEADER_SIZE < frame.length) {
+                                break;
+                            }
+
+                            ok = __frame(&frame, m_input.data() + offset + HTTP2_FRAME_HEADER_SIZE);
+                            offset += HTTP2_FRAME_HEADER_SIZE + frame.length;
+                        }
+
+                        m_input.erase(0, offset);
+
+                        return ok;
+                    }
+
+                    /**
+                     * 发送输出缓冲区中的数据并读取所有可读的数据
+                     * @param  wait 没有可读的数据时是否等待
+                     * @return      __HTTP2_*, HTTP2_PROTOCOL或HTTP2_TIMEOUT
+                     */
+                    int __step(bool wait) {
+                        bool want_write = false;
+                        int ret = __flush();
+
+                        if (ret == OUTPUT_ERROR) {
+                            return __HTTP2_EOF;
+                        }
+
+                        want_write = ret == OUTPUT_PENDING;
+
+                        char buffer[HTTP2_BUFFER];
+                        bool waited = !wait;
+
+                        while (true) {
+                            int len;
+
+                            if (m_is_ssl) {
+                                size_t bytes;
+                                int status = socket_ssl_read(&m_ssl_socket, buffer, sizeof(buffer), &bytes);
+
+                                if (status == SSL_STATUS_WANT_READ || status == SSL_STATUS_WANT_WRITE) {
+                                    len = -1;
+                                    want_write = want_write || status == SSL_STATUS_WANT_WRITE;
+                                } else if (status != SSL_STATUS_OK) {
+                                    len = 0;
+                                } else {
+                                    len = bytes;
+                                }
+                            } else {
+                                len = socket_recv(&m_socket, buffer, sizeof(buffer));
+
+                                if (len < 0 && errno == EINTR) {
+                                    continue;
+                                } else if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                                    len = 0;
+                                }
+                            }
+
+                            if (len == 0) {
+                                return __HTTP2_EOF;
+                            } else if (len > 0) {
+                                if (!__process(buffer, len)) {
+                                    return HTTP2_PROTOCOL;
+                                }
+
+                                // 处理帧时可能产生了需要发送的WINDOW_UPDATE等帧, 或者可以打开新的流
+                                waited = true;
+                                continue;
+                            }
+
+                            // 已经读完了可读的数据, 回到外层发送新的帧
+                            if (waited) {
+                                return __HTTP2_MORE;
+                            }
+
+                            struct pollfd pfd;
+                            pfd.fd = m_socket.sockfd;
+                            pfd.events = POLLIN | (want_write ? POLLOUT : 0);
+                            pfd.revents = 0;
+
+                            int ret = poll(&pfd, 1, m_read_timeout * 1000);
+
+                            if (ret < 0 && errno == EINTR) {
+                                continue;
+                            } else if (ret == 0) {
+                                return HTTP2_TIMEOUT;
+                            } else if (ret < 0) {
+                                return __HTTP2_EOF;
+                            }
+
+                            if (!(pfd.revents & (POLLIN | POLLERR | POLLHUP))) {
+                                return __HTTP2_MORE;
+                            }
+
+                            waited = true;
+                        }
+                    }
+
+                    /** 在当前连接上执行请求, 直到全部完成或者需要新的连接 */
+                    int __run() {
+                        int ret = __HTTP2_MORE;
+
+                        while (ret == __HTTP2_MORE && (!m_waiting.empty() || !m_streams.empty())) {
+                            size_t max_streams = m_max_streams < m_peer_max_streams ? m_max_streams : m_peer_max_streams;
+
+                            while (!m_goaway && !m_waiting.empty() && m_streams.size() < max_streams && m_next_stream <= HTTP2_MAX_STREAM_ID) {
+                                size_t index = m_waiting.front();
+                                m_waiting.pop_front();
+                                __start(index);
+                            }
+
+                            // 流编号用完或者对方发送了GOAWAY, 剩余的请求需要新的连接
+                            if (m_streams.empty() && !m_waiting.empty() && (m_goaway || m_next_stream > HTTP2_MAX_STREAM_ID)) {
+                                return __HTTP2_EOF;
+                            }
+
+                            __send_bodies();
+                            ret = __step(true);
+                        }
+
+                        return ret;
+                    }
+
+                    /** 连接断开, 可以安全重发的请求放回队列的前面 */
+                    void __requeue() {
+                        while (!m_streams.empty()) {
+                            std::map<unsigned int, http2_stream_t>::iterator it = std::prev(m_streams.end());
+
+                            if (__replayable(it->second.index)) {
+                                m_waiting.push_front(it->second.index);
+                            } else {
+                                m_results[it->second.index] = HTTP2_CLOSED;
+                            }
+
+                            m_streams.erase(it);
+                        }
+                    }
+
+                    /** 将剩余的请求全部标记为失败 */
+                    void __fail(int result) {
+                        for (std::map<unsigned int, http2_stream_t>::iterator it = m_streams.begin(); it != m_streams.end(); it ++) {
+                            m_results[it->second.index] = result;
+                        }
+
+                        for (std::deque<size_t>::iterator it = m_waiting.begin(); it != m_waiting.end(); it ++) {
+                            m_results[*it] = result;
+                        }
+
+                        m_streams.clear();
+                        m_waiting.clear();
+                    }
+
+                    /**
+                     * 并发执行所有请求, 结果通过get_result与get_response获取
+                     * @return 所有请求都收到了响应时返回true
+                     */
+                    bool execute() {
+                        unsigned int failures = 0;
+
+                        m_waiting.clear();
+                        m_streams.clear();
+                        m_connections = 0;
+                        m_error = "";
+
+                        for (size_t i = 0; i < m_requests.size(); i ++) {
+                            m_results[i] = HTTP2_PENDING;
+                            m_waiting.push_back(i);
+                        }
+
+                        // 先处理连接空闲时收到的GOAWAY或关闭
+                        if (m_connected && (__step(false) != __HTTP2_MORE || m_goaway)) {
+                            __close();
+                        }
+
+                        while (!m_waiting.empty()) {
+                            if (!m_connected && !__open()) {
+                                __close();
+                                __fail(HTTP2_CONNECT);
+                                return false;
+                            }
+
+                            m_answered = 0;
+                            int ret = __run();
+
+                            if (ret == __HTTP2_MORE && !m_goaway) {
+                                break;
+                            }
+
+                            if (ret == HTTP2_TIMEOUT || ret == HTTP2_PROTOCOL) {
+                                // 打开的流全部失败, 剩余的请求使用新的连接, 连续失败时放弃
+                                for (std::map<unsigned int, http2_stream_t>::iterator it = m_streams.begin(); it != m_streams.end(); it ++) {
+                                    m_results[it->second.index] = ret;
+                                }
+
+                                if (ret == HTTP2_TIMEOUT) {
+                                    m_error = "Timed out reading the response";
+                                }
+
+                                m_streams.clear();
+                            }
+
+                            failures = m_answered > 0 ? 0 : failures + 1;
+                            __requeue();
+                            __close();
+
+                            if (failures >= HTTP2_MAX_FAILURES) {
+                                if (m_error.empty()) {
+                                    m_error = "Connection closed without responses";
+                                }
+
+                                __fail(HTTP2_CLOSED);
+                                break;
+                            }
+                        }
+
+                        if (m_goaway) {
+                            __close();
+                        }
+
+                        for (size_t i = 0; i < m_results.size(); i ++) {
+                            if (m_results[i] != HTTP2_OK) {
+                                return false;
+                            }
+                        }
+
+                        return true;
+                    }
+            };
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,467 @@
+#ifndef _CLIBS_HTTP_ASYNC_H_
+#define _CLIBS_HTTP_ASYNC_H_ 1
+
+#include "clibs/os.h"
+
+#ifdef OS_LINUX
+#include <iostream>
+#include <string>
+#include <memory>
+#include <functional>
+#include "clibs/net/socket.hpp"
+#include "clibs/net/sslsocket.hpp"
+#include "clibs/net/connector.hpp"
+#include "clibs/net/output_buffer.hpp"
+#include "clibs/net/url.hpp"
+#include "clibs/io/event_loop.hpp"
+#include "clibs/net/http/http_header.hpp"
+#include "clibs/net/http/http_parser.hpp"
+#include "clibs/net/http/http_reader.hpp"
+
+#define HTTP_ASYNC_TIMEOUT 30000 // 默认的请求超时时间(毫秒)
+#define HTTP_ASYNC_BUFFER 16384 // 单次读取的长度
+
+#define HTTP_ASYNC_OK 0 // 请求完成
+#define HTTP_ASYNC_BAD_URL -1 // url无法解析
+#define HTTP_ASYNC_CONNECT -2 // 连接失败
+#define HTTP_ASYNC_TLS -3 // ssl握手失败
+#define HTTP_ASYNC_SEND -4 // 发送请求失败
+#define HTTP_ASYNC_CLOSED -5 // 响应完成之前连接被关闭或出错
+#define HTTP_ASYNC_PARSE -6 // 响应不合法或超过限制
+#define HTTP_ASYNC_TIMEOUT_ERROR -7 // 超过请求的超时时间
+#define HTTP_ASYNC_ABORTED -8 // body回调返回false
+
+namespace clibs {
+    namespace net {
+        namespace http {
+            /**
+             * 异步请求的参数
+             */
+            typedef struct {
+                std::string method; // 请求方法
+                std::string url; // 请求url
+                CHttpHeader headers; // 请求头, Host与Content-Length会自动添加
+                std::string body; // 请求body
+                unsigned int timeout; // 从发起到读取完响应的超时时间(毫秒), 包括dns解析之后的连接与握手, 0为不限制
+                http_limits_t limits; // 对响应头与body的限制
+                socket_tuning_t tuning; // 连接时应用的tcp调优参数
+                ssl_context_t* ssl_context; // ssl上下文, 为NULL时使用进程内共享的上下文
+                http_body_callback on_body; // 设置后body交给回调处理, 不保存在响应中
+            } http_request_t;
+
+            /** 请求结束的回调, error为HTTP_ASYNC_*, 只会被调用一次 */
+            typedef std::function<void(int error, http_response_t* response)> http_response_callback;
+
+            /**
+             * 初始化请求参数
+             * @param request http_request_t
+             * @param method  请求方法
+             * @param url     请求url
+             */
+            void http_request_init(http_request_t* request, const std::string& method, const std::string& url) {
+                request->method = method;
+                request->url = url;
+                request->headers.clear();
+                request->body.clear();
+                request->timeout = HTTP_ASYNC_TIMEOUT;
+                http_limits_init(&request->limits);
+                socket_tuning_preset(&request->tuning, TUNING_LOW_LATENCY);
+                request->ssl_context = NULL;
+                request->on_body = NULL;
+            }
+
+            /** 异步请求过程中保存的状态 */
+            typedef struct {
+                io::event_loop_t* loop;
+                url_t url;
+                bool is_ssl;
+                bool head; // HEAD请求的响应没有body
+                socket_t socket;
+                ssl_socket_t ssl_socket;
+                ssl_context_t* ssl_context;
+                int events; // 当前监听的事件, 0为还未加入事件循环
+                bool read_wants_write; // ssl读取需要等待可写
+                output_buffer_t output;
+                http_parser_t parser;
+                http_response_t response;
+                http_body_callback on_body;
+                http_response_callback callback;
+                unsigned long long int timer;
+                bool done;
+            } __http_async_t;
+
+            /** 结束请求, 释放连接并执行回调 */
+            void __http_async_finish(std::shared_ptr<__http_async_t> task, int error) {
+                if (task->done) {
+                    return;
+                }
+
+                task->done = true;
+                io::event_loop_cancel_timer(task->loop, task->timer);
+
+                if (task->socket.sockfd != -1) {
+                    // 握手期间描述符由握手的监听持有, 同样需要移除
+                    io::event_loop_remove(task->loop, task->socket.sockfd);
+                }
+
+                if (task->ssl_socket.ctx != NULL) {
+                    socket_ssl_close(&task->ssl_socket);
+                    task->ssl_socket.ssl = NULL;
+                    task->ssl_socket.ctx = NULL;
+                }
+
+                if (task->socket.sockfd != -1) {
+                    socket_close(&task->socket);
+                    task->socket.sockfd = -1;
+                }
+
+                output_buffer_clear(&task->output);
+                task->callback(error, &task->response);
+            }
+
+            /** 将请求写入输出缓冲区 */
+            void __http_async_build(__http_async_t* task, const http_request_t* request) {
+                std::string data;
+
+                data.reserve(256 + request->body.size());
+                data.append(request->method).append(" ").append(task->url.path).append(task->url.query).append(" HTTP/1.1\r\n");
+
+                if (!request->headers.contains(HTTP_HEADER_HOST)) {
+                    data.append("Host: ").append(task->url.host).append("\r\n");
+                }
+
+                request->headers.write(&data);
+
+                if (!request->body.empty() || request->method == "POST" || request->method == "PUT") {
+                    data.append("Content-Length: ").append(std::to_string(request->body.size())).append("\r\n");
+                }
+
+                // 每个请求使用单独的连接, 响应结束后关闭
+                data.append("Connection: close\r\n\r\n").append(request->body);
+
+                output_buffer_append(&task->output, std::move(data));
+            }
+
+            /** 根据输出缓冲区与ssl的状态更新监听的事件 */
+            void __http_async_watch(std::shared_ptr<__http_async_t> task);
+
+            /**
+             * 处理一段响应数据
+             * @return 是否需要继续读取
+             */
+            bool __http_async_feed(std::shared_ptr<__http_async_t> task, const char* buf, size_t len) {
+                size_t offset = 0;
+
+                while (true) {
+                    http_event_t event;
+                    offset += http_parser_feed(&task->parser, buf + offset, len - offset, &event);
+
+                    switch (event.type) {
+                        case HTTP_EVENT_NEED_MORE:
+                            return true;
+                        case HTTP_EVENT_HEADERS: {
+                            http_message_t* msg = &task->parser.message;
+
+                            task->response.status_code = msg->status;
+                            task->response.status_message = http_view_str(&msg->reason);
+                            task->response.headers.clear();
+
+                            for (size_t i = 0; i < msg->num_headers; i ++) {
+                                task->response.headers.append(msg->headers[i].name, msg->headers[i].value);
+                            }
+
+                            break;
+                        }
+                        case HTTP_EVENT_BODY:
+                            if (task->on_body != NULL) {
+                                if (!task->on_body(event.data.data, event.data.len)) {
+                                    __http_async_finish(task, HTTP_ASYNC_ABORTED);
+                                    return false;
+                                }
+                            } else {
+                                task->response.body.append(event.data.data, event.data.len);
+                            }
+
+                            break;
+                        case HTTP_EVENT_COMPLETE:
+                            // 100 Continue等临时响应之后还有最终的响应
+                            if (task->response.status_code >= 100 && task->response.status_code < 200 && task->response.status_code != 101) {
+                                task->response.body.clear();
+                                break;
+                            }
+
+                            __http_async_finish(task, HTTP_ASYNC_OK);
+                            return false;
+                        default:
+                            __http_async_finish(task, HTTP_ASYNC_PARSE);
+                            return false;
+                    }
+                }
+            }
+
+            /** 连接关闭时结束以关闭连接为结尾的响应 */
+            void __http_async_eof(std::shared_ptr<__http_async_t> task) {
+                http_event_t event;
+                http_parser_eof(&task->parser, &event);
+
+                if (event.type == HTTP_EVENT_COMPLETE) {
+                    __http_async_finish(task, HTTP_ASYNC_OK);
+                } else {
+                    __http_async_finish(task, HTTP_ASYNC_CLOSED);
+                }
+            }
+
+            /** 描述符可读写时发送剩余的请求并读取所有可读的数据 */
+            void __http_async_io(std::shared_ptr<__http_async_t> task) {
+                if (output_buffer_size(&task->output) > 0) {
+                    int ret = task->is_ssl ? output_buffer_flush(&task->output, &task->ssl_socket, &task->socket) : output_buffer_flush(&task->output, &task->socket);
+
+                    if (ret == OUTPUT_ERROR) {
+                        __http_async_finish(task, HTTP_ASYNC_SEND);
+                        return;
+                    }
+                }
+
+                char buffer[HTTP_ASYNC_BUFFER];
+                task->read_wants_write = false;
+
+                while (!task->done) {
+                    int len;
+
+                    if (task->is_ssl) {
+                        size_t bytes;
+                        int status = socket_ssl_read(&task->ssl_socket, buffer, sizeof(buffer), &bytes);
+
+                        if (status == SSL_STATUS_WANT_READ) {
+                            break;
+                        } else if (status == SSL_STATUS_WANT_WRITE) {
+                            task->read_wants_write = true;
+                            break;
+                        } else if (status != SSL_STATUS_OK) {
+                            // 没有close_notify直接关闭连接的服务端同样按连接关闭处理
+                            __http_async_eof(task);
+                            return;
+                        }
+
+                        len = bytes;
+                    } else {
+                        len = socket_recv(&task->socket, buffer, sizeof(buffer));
+
+                        if (len < 0) {
+                            if (errno == EINTR) {
+                                continue;
+                            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                                break;
+                            }
+
+                            __http_async_finish(task, HTTP_ASYNC_CLOSED);
+                            return;
+                        } else if (len == 0) {
+                            __http_async_eof(task);
+                            return;
+                        }
+                    }
+
+                    if (!__http_async_feed(task, buffer, len)) {
+                        return;
+                    }
+                }
+
+                if (!task->done) {
+                    __http_async_watch(task);
+                }
+            }
+
+            void __http_async_watch(std::shared_ptr<__http_async_t> task) {
+                int events = (output_buffer_size(&task->output) > 0 || task->read_wants_write) ? EVENT_WRITE : EVENT_READ;
+
+                if (task->events == 0) {
+                    // 监听回调持有task, 请求结束移除监听时释放
+                    if (!io::event_loop_add(task->loop, task->socket.sockfd, events, [task](SOCKET, int) {
+                        __http_async_io(task);
+                    })) {
+                        __http_async_finish(task, HTTP_ASYNC_SEND);
+                        return;
+                    }
+                } else if (task->events != events) {
+                    io::event_loop_modify(task->loop, task->socket.sockfd, events);
+                }
+
+                task->events = events;
+            }
+
+            /** 连接建立后开始握手或直接发送请求 */
+            void __http_async_connected(std::shared_ptr<__http_async_t> task) {
+                if (!task->is_ssl) {
+                    __http_async_io(task);
+                    return;
+                }
+
+                if (!socket_ssl_use_context(&task->ssl_socket, task->ssl_context != NULL ? task->ssl_context : socket_ssl_shared_context())) {
+                    __http_async_finish(task, HTTP_ASYNC_TLS);
+                    return;
+                }
+
+                if (!socket_ssl_bind(&task->ssl_socket, &task->socket) || !socket_ssl_set_host(&task->ssl_socket, task->url.host.c_str(), task->url.port)) {
+                    __http_async_finish(task, HTTP_ASYNC_TLS);
+                    return;
+                }
+
+                // 超时由请求的定时器处理
+                socket_ssl_handshake_async(task->loop, &task->ssl_socket, task->socket.sockfd, false, 0, [task](bool ok, int) {
+                    if (!ok) {
+                        __http_async_finish(task, HTTP_ASYNC_TLS);
+                    } else if (!task->done) {
+                        __http_async_io(task);
+                    }
+                });
+            }
+
+            /**
+             * 在事件循环上发起异步请求, 一个线程可以同时处理大量请求
+             * 每个请求使用单独的连接, dns解析是阻塞的, 之后的连接, 握手, 发送与读取都不会阻塞事件循环
+             * @param loop     event_loop_t
+             * @param request  http_request_t, 调用后可以释放
+             * @param callback 请求结束后的回调, 只会被调用一次, 可能在本函数返回之前调用
+             */
+            void http_async_request(io::event_loop_t* loop, const http_request_t* request, http_response_callback callback) {
+                std::shared_ptr<__http_async_t> task = std::make_shared<__http_async_t>();
+
+                task->loop = loop;
+                task->socket.sockfd = -1;
+                task->ssl_socket.ssl = NULL;
+                task->ssl_socket.ctx = NULL;
+                task->ssl_context = request->ssl_context;
+                task->events = 0;
+                task->read_wants_write = false;
+                task->head = request->method == "HEAD";
+                task->response.status_code = 0;
+                task->on_body = request->on_body;
+                task->callback = callback;
+                task->timer = 0;
+                task->done = false;
+                output_buffer_init(&task->output);
+                http_parser_init(&task->parser);
+                task->parser.limits = request->limits;
+
+                if (task->head) {
+                    http_parser_skip_body(&task->parser);
+                }
+
+                if (!url_parse(&task->url, request->url) || (task->url.protocol != "http" && task->url.protocol != "https")) {
+                    __http_async_finish(task, HTTP_ASYNC_BAD_URL);
+                    return;
+                }
+
+                task->is_ssl = task->url.protocol == "https";
+                __http_async_build(task.get(), request);
+
+                if (request->timeout > 0) {
+                    task->timer = io::event_loop_add_timer(loop, request->timeout, [task]() {
+                        task->timer = 0;
+                        __http_async_finish(task, HTTP_ASYNC_TIMEOUT_ERROR);
+                    });
+                }
+
+                connector_async(loop, task->url.host.c_str(), task->url.port, SOCK_STREAM, request->timeout > 0 ? request->timeout : HTTP_ASYNC_TIMEOUT, 250, &request->tuning, [task](bool ok, socket_t* sock, int) {
+                    if (task->done) {
+                        // 请求已经超时, 丢弃迟到的连接
+                        if (ok) {
+                            socket_close(sock);
+                        }
+
+                        return;
+                    }
+
+                    if (!ok) {
+                        __http_async_finish(task, HTTP_ASYNC_CONNECT);
+                        return;
+                    }
+
+                    task->socket = *sock;
+                    __http_async_connected(task);
+                });
+            }
+
+            /**
+             * 异步请求的类形式封装, 持有一个事件循环
+             */
+            class CHttpAsyncClient {
+                public:
+                    CHttpAsyncClient() {
+                        io::event_loop_init(&m_loop);
+                        m_timeout = HTTP_ASYNC_TIMEOUT;
+                        http_limits_init(&m_limits);
+                        m_ssl_context = NULL;
+                    }
+
+                    ~CHttpAsyncClient() {
+                        io::event_loop_close(&m_loop);
+                    }
+
+                    /** 设置请求的超时时间(毫秒) */
+                    void set_timeout(unsigned int timeout) {
+                        m_timeout = timeout;
+                    }
+
+                    /** 设置对响应的限制 */
+                    void set_limits(const http_limits_t* limits) {
+                        m_limits = *limits;
+                    }
+
+                    /** 设置ssl上下文 */
+                    void set_ssl_context(ssl_context_t* context) {
+                        m_ssl_context = context;
+                    }
+
+                    /**
+                     * 发起请求, 在run中完成
+                     * @param method   请求方法
+                     * @param url      请求url
+                     * @param body     请求body
+                     * @param callback 请求结束后的回调
+                     */
+                    void request(const std::string& method, const std::string& url, const std::string& body, http_response_callback callback) {
+                        http_request_t request;
+
+                        http_request_init(&request, method, url);
+                        request.body = body;
+                        request.timeout = m_timeout;
+                        request.limits = m_limits;
+                        request.ssl_context = m_ssl_context;
+
+                        http_async_request(&m_loop, &request, callback);
+                    }
+
+                    /** 发起GET请求 */
+                    void get(const std::string& url, http_response_callback callback) {
+                        request("GET", url, "", callback);
+                    }
+
+                    /** 使用完整的参数发起请求 */
+                    void request(const http_request_t* request, http_response_callback callback) {
+                        http_async_request(&m_loop, request, callback);
+                    }
+
+                    /** 运行事件循环直到所有请求结束 */
+                    void run() {
+                        io::event_loop_run(&m_loop);
+                    }
+
+                    /** 获取事件循环, 用来与其它异步操作共用 */
+                    io::event_loop_t* loop() {
+                        return &m_loop;
+                    }
+
+                protected:
+                    io::event_loop_t m_loop;
+                    unsigned int m_timeout;
+                    http_limits_t m_limits;
+                    ssl_context_t* m_ssl_context;
+            };
+        }
+    }
+}
+#endif
+
+#endif
@@ -0,0 +1,822 @@
+#ifndef _CLIBS_HTTP_DOWNLOAD_H_
+#define _CLIBS_HTTP_DOWNLOAD_H_ 1
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "clibs/thread_pool.hpp"
+#include "clibs/net/http/httpclient.hpp"
+#include "clibs/net/http/http_pool.hpp"
+
+#define HTTP_DOWNLOAD_CONNECTIONS 4 // 默认的并发连接数
+#define HTTP_DOWNLOAD_RANGE_SIZE 4194304 // 默认每个分段的长度
+#define HTTP_DOWNLOAD_MIN_RANGE 262144 // 文件较小时分段的最小长度
+#define HTTP_DOWNLOAD_RETRIES 3 // 分段没有任何进展时最多重试的次数
+#define HTTP_DOWNLOAD_RETRY_DELAY 200 // 重试前等待的时间(毫秒), 随重试次数增加
+#define HTTP_DOWNLOAD_MAGIC "CLIBS-DOWNLOAD 1" // 断点文件的第一行
+
+#define HTTP_DOWNLOAD_OK 0 // 下载完成
+#define HTTP_DOWNLOAD_CONNECT -1 // 探测请求失败
+#define HTTP_DOWNLOAD_STATUS -2 // 服务端返回了错误的状态码
+#define HTTP_DOWNLOAD_FILE -3 // 无法创建, 预分配或写入文件
+#define HTTP_DOWNLOAD_INCOMPLETE -4 // 部分分段重试后仍然失败, 已下载的部分保存在断点文件中
+#define HTTP_DOWNLOAD_CHANGED -5 // 下载过程中服务端的文件发生了变化
+
+#define __HTTP_DOWNLOAD_RETRY 1 // 分段暂时失败, 可以重试
+
+namespace clibs {
+    namespace net {
+        namespace http {
+            /**
+             * 下载的分段, 包含start与end
+             */
+            typedef struct {
+                unsigned long long int start;
+                unsigned long long int end;
+                unsigned long long int done; // 已经写入文件的长度
+            } http_range_t;
+
+            /**
+             * 解析Content-Range: bytes start-end/total
+             * @param  value Content-Range的值
+             * @param  start 起始位置, 不满足的range(bytes * /total)时为0
+             * @param  end   结束位置
+             * @param  total 完整长度, 未知时为-1
+             * @return       true/false
+             */
+            bool http_parse_content_range(const std::string& value, unsigned long long int* start, unsigned long long int* end, long long int* total) {
+                const char* p = value.c_str();
+                char* next;
+
+                if (strncmp(p, "bytes ", 6) != 0) {
+                    return false;
+                }
+
+                p += 6;
+                *start = *end = 0;
+
+                if (*p == '*') {
+                    p ++;
+                } else {
+                    if (*p < '0' || *p > '9') {
+                        return false;
+                    }
+
+                    *start = strtoull(p, &next, 10);
+
+                    if (*next != '-' || next[1] < '0' || next[1] > '9') {
+                        return false;
+                    }
+
+                    *end = strtoull(next + 1, &next, 10);
+                    p = next;
+
+                    if (*end < *start) {
+                        return false;
+                    }
+                }
+
+                if (*p != '/') {
+                    return false;
+                }
+
+                if (p[1] == '*' && p[2] == '\0') {
+                    *total = -1;
+                    return true;
+                } else if (p[1] < '0' || p[1] > '9') {
+                    return false;
+                }
+
+                *total = strtoll(p + 1, &next, 10);
+
+                return *next == '\0';
+            }
+
+            /**
+             * 将文件划分为分段
+             * @param size       文件长度
+             * @param range_size 每个分段的长度
+             * @param ranges     保存分段
+             */
+            void http_range_split(unsigned long long int size, unsigned long long int range_size, std::vector<http_range_t>* ranges) {
+                ranges->clear();
+
+                for (unsigned long long int start = 0; start < size; start += range_size) {
+                    http_range_t range;
+
+                    range.start = start;
+                    range.end = (size - start > range_size ? start + range_size : size) - 1;
+                    range.done = 0;
+                    ranges->push_back(range);
+                }
+            }
+
+            /**
+             * 多连接分段下载, 通过Range: bytes=0-0探测服务端是否支持分段, 不支持时退化为单个连接下载
+             * 分段在线程池中并发下载, 通过pwrite写入预分配的文件
+             * 进度保存在断点文件中, 失败后再次下载同一个文件时从断点继续, ETag或Last-Modified变化时重新下载
+             */
+            class CHttpDownloader {
+                protected:
+                    std::string m_url;
+                    CHttpHeader m_headers; // 附加的请求头
+                    unsigned int m_connections; // 并发连接数
+                    unsigned long long int m_range_size; // 每个分段的长度
+                    unsigned int m_retries; // 没有进展的分段最多重试的次数
+                    unsigned int m_connect_timeout; // 连接超时时间(秒)
+                    unsigned int m_read_timeout; // 读取超时时间(秒)
+                    socket_tuning_t m_tuning;
+                    ssl_context_t* m_ssl_context;
+                    CThreadPool* m_thread_pool; // 外部的线程池, 为NULL时每次下载创建
+                    std::string m_checkpoint; // 断点文件, 为空时使用 文件名.download
+                    http_pool_t* m_pool; // 本次下载的连接池
+
+                    long long int m_size; // 文件长度, 未知时为-1
+                    std::string m_etag;
+                    std::string m_last_modified;
+                    bool m_ranged; // 服务端是否支持分段
+                    bool m_resumed; // 是否从断点继续
+                    int m_fd;
+                    std::string m_checkpoint_path; // 本次下载实际使用的断点文件
+                    std::mutex m_checkpoint_lock; // 串行写断点文件, 同步磁盘时不阻塞m_lock
+
+                    std::mutex m_lock; // 保护以下的分段状态
+                    std::condition_variable m_done;
+                    std::vector<http_range_t> m_ranges;
+                    std::vector<unsigned int> m_attempts; // 每个分段没有进展的失败次数
+                    std::deque<size_t> m_queue; // 等待下载的分段
+                    unsigned int m_active; // 正在运行的任务数
+                    std::atomic<bool> m_abort; // 遇到了不能重试的错误
+                    bool m_failed; // 有分段超过了重试次数
+                    std::atomic<unsigned long long int> m_downloaded;
+
+                    int m_result;
+                    std::string m_error;
+
+                public:
+                    CHttpDownloader() {
+                        m_connections = HTTP_DOWNLOAD_CONNECTIONS;
+                        m_range_size = HTTP_DOWNLOAD_RANGE_SIZE;
+                        m_retries = HTTP_DOWNLOAD_RETRIES;
+                        m_connect_timeout = 15;
+                        m_read_timeout = 15;
+                        m_ssl_context = NULL;
+                        m_thread_pool = NULL;
+                        m_pool = NULL;
+                        m_size = -1;
+                        m_ranged = false;
+                        m_resumed = false;
+                        m_fd = -1;
+                        m_active = 0;
+                        m_abort = false;
+                        m_failed = false;
+                        m_downloaded = 0;
+                        m_result = HTTP_DOWNLOAD_OK;
+                        socket_tuning_preset(&m_tuning, TUNING_BULK);
+                    }
+
+                    /**
+                     * 设置下载的url
+                     * @param  url http或https的url
+                     * @return     true/false
+                     */
+                    bool set_url(const std::string& url) {
+                        url_t parsed;
+
+                        if (!url_parse(&parsed, url) || (parsed.protocol != "http" && parsed.protocol != "https")) {
+                            m_error = "Failed to parse URL.";
+                            return false;
+                        }
+
+                        m_url = url;
+
+                        return true;
+                    }
+
+                    /** 添加请求头, 每个分段的请求都会带上 */
+                    void add_header(const std::string& name, const std::string& value) {
+                        m_headers.append(name, value);
+                    }
+
+                    /** 设置并发连接数 */
+                    void set_connections(unsigned int connections) {
+                        m_connections = connections > 0 ? connections : 1;
+                    }
+
+                    /** 设置每个分段的长度, 文件较小时会缩小分段使所有连接都能用上 */
+                    void set_range_size(unsigned long long int size) {
+                        m_range_size = size > 0 ? size : HTTP_DOWNLOAD_RANGE_SIZE;
+                    }
+
+                    /** 设置分段没有任何进展时最多重试的次数 */
+                    void set_retries(unsigned int retries) {
+                        m_retries = retries;
+                    }
+
+                    /** 设置连接超时(秒) */
+                    void set_connect_timeout(unsigned int timeout) {
+                        m_connect_timeout = timeout;
+                    }
+
+                    /** 设置读取超时(秒) */
+                    void set_read_timeout(unsigned int timeout) {
+                        m_read_timeout = timeout;
+                    }
+
+                    /** 设置tcp调优参数, 默认使用TUNING_BULK */
+                    void set_tuning(const socket_tuning_t* tuning) {
+                        m_tuning = *tuning;
+                    }
+
+                    /** 设置ssl上下文 */
+                    void set_ssl_context(ssl_context_t* context) {
+                        m_ssl_context = context;
+                    }
+
+                    /**
+                     * 使用外部的线程池, 线程数决定实际的并发数, 需要比下载器先创建后关闭
+                     * @param pool CThreadPool
+                     */
+                    void set_thread_pool(CThreadPool* pool) {
+                        m_thread_pool = pool;
+                    }
+
+                    /** 设置断点文件的路径, 默认为 文件名.download */
+                    void set_checkpoint(const std::string& path) {
+                        m_checkpoint = path;
+                    }
+
+                    /** 下载的结果, HTTP_DOWNLOAD_* */
+                    int get_result() {
+                        return m_result;
+                    }
+
+                    /** 文件长度, 未知时为-1 */
+                    long long int get_size() {
+                        return m_size;
+                    }
+
+                    /** 已经写入文件的长度, 包括断点之前的部分, 可以在其它线程中读取 */
+                    unsigned long long int get_downloaded() {
+                        return m_downloaded;
+                    }
+
+                    /** 服务端是否支持分段 */
+                    bool ranges_supported() {
+                        return m_ranged;
+                    }
+
+                    /** 本次下载是否从断点继续 */
+                    bool resumed() {
+                        return m_resumed;
+                    }
+
+                    /** 获取错误描述 */
+                    std::string error() {
+                        return m_error;
+                    }
+
+                    /**
+                     * 下载文件
+                     * @param  path 保存的路径
+                     * @return      true/false, 失败原因通过get_result与error获取
+                     */
+                    bool download(const std::string& path) {
+                        CHttpPool pool(m_connections, m_connections, HTTP_POOL_IDLE_TIMEOUT);
+                        CHttpClient client;
+
+                        m_pool = pool.pool();
+                        m_size = -1;
+                        m_etag = m_last_modified = m_error = "";
+                        m_ranged = m_resumed = false;
+                        m_abort = m_failed = false;
+                        m_downloaded = 0;
+                        m_ranges.clear();
+                        m_checkpoint_path = m_checkpoint.empty() ? path + ".download" : m_checkpoint;
+
+                        m_result = __probe(&client);
+
+                        if (m_result == HTTP_DOWNLOAD_OK) {
+                            if (!m_ranged) {
+                                m_result = __download_stream(&client, path);
+                            } else {
+                                client.close();
+                                m_result = __download_ranges(path);
+                            }
+                        }
+
+                        client.close();
+
+                        if (m_fd != -1) {
+                            ::close(m_fd);
+                            m_fd = -1;
+                        }
+
+                        m_pool = NULL;
+
+                        return m_result == HTTP_DOWNLOAD_OK;
+                    }
+
+                    /** 创建请求, 带上附加的请求头 */
+                    void __prepare(CHttpClient* client) {
+                        client->set_url(m_url);
+                        client->set_method("GET");
+                        client->set_pool(m_pool);
+                        client->set_connect_timeout(m_connect_timeout);
+                        client->set_read_timeout(m_read_timeout);
+                        client->set_tuning(&m_tuning);
+                        client->set_ssl_context(m_ssl_context);
+                        client->add_headers(&m_headers);
+                    }
+
+                    /**
+                     * 请求第一个字节, 206时从Content-Range得到长度, 200时服务端不支持分段, 响应body直接用于下载
+                     */
+                    int __probe(CHttpClient* client) {
+                        unsigned long long int start, end;
+                        long long int total;
+
+                        __prepare(client);
+                        client->add_header("Range", "bytes=0-0");
+
+                        if (!client->connect() || !client->get_response()) {
+                            m_error = client->error();
+                            return HTTP_DOWNLOAD_CONNECT;
+                        }
+
+                        int status = client->get_status_code();
+                        m_etag = client->get_field("ETag");
+                        m_last_modified = client->get_field("Last-Modified");
+
+                        if (status == 200) {
+                            m_size = client->get_content_length();
+                            return HTTP_DOWNLOAD_OK;
+                        }
+
+                        // 空文件无法满足bytes=0-0
+                        if (status == 416 && http_parse_content_range(client->get_field("Content-Range"), &start, &end, &total) && total == 0) {
+                            m_size = 0;
+                            m_ranged = true;
+                            return HTTP_DOWNLOAD_OK;
+                        }
+
+                        if (status != 206) {
+                            m_error = "Unexpected status " + std::to_string(status);
+                            return HTTP_DOWNLOAD_STATUS;
+                        }
+
+                        if (!http_parse_content_range(client->get_field("Content-Range"), &start, &end, &total) || start != 0 || total < 0) {
+                            m_error = "Invalid Content-Range: " + client->get_field("Content-Range");
+                            return HTTP_DOWNLOAD_STATUS;
+                        }
+
+                        // 读完剩余的1个字节, 连接可以给分段使用
+                        client->read();
+                        m_size = total;
+                        m_ranged = true;
+
+                        return HTTP_DOWNLOAD_OK;
+                    }
+
+                    /** 预分配文件空间, 减少碎片并提前发现空间不足 */
+                    bool __preallocate(unsigned long long int size) {
+                        if (size == 0) {
+                            return true;
+                        }
+
+                        int ret = posix_fallocate(m_fd, 0, size);
+
+                        if (ret == ENOSPC || ret == EFBIG) {
+                            errno = ret;
+                            return false;
+                        }
+
+                        return ret == 0 || ftruncate(m_fd, size) == 0;
+                    }
+
+                    /** 写入文件的指定位置 */
+                    bool __write(const char* data, size_t length, unsigned long long int offset) {
+                        while (length > 0) {
+                            ssize_t len = pwrite(m_fd, data, length, offset);
+
+                            if (len < 0 && errno == EINTR) {
+                                continue;
+                            } else if (len <= 0) {
+                                return false;
+                            }
+
+                            data += len;
+                            length -= len;
+                            offset += len;
+                        }
+
+                        return true;
+                    }
+
+                    /** 服务端不支持分段时使用探测请求的响应下载, 不能断点继续 */
+                    int __download_stream(CHttpClient* client, const std::string& path) {
+                        unsigned long long int offset = 0;
+                        bool file_error = false;
+
+                        m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+                        if (m_fd < 0 || (m_size > 0 && !__preallocate(m_size))) {
+                            m_error = "Failed to create " + path + ": " + strerror(errno);
+                            return HTTP_DOWNLOAD_FILE;
+                        }
+
+                        long long int len = client->read([this, &offset, &file_error](const char* data, size_t length) -> bool {
+                            if (!__write(data, length, offset)) {
+                                file_error = true;
+                                return false;
+                            }
+
+                            offset += length;
+                            m_downloaded += length;
+
+                            return true;
+                        });
+
+                        if (file_error) {
+                            m_error = "Failed to write " + path + ": " + strerror(errno);
+                            return HTTP_DOWNLOAD_FILE;
+                        }
+
+                        if (len < 0 || (m_size >= 0 && offset != (unsigned long long int)m_size)) {
+                            m_error = "Connection closed before the download finished";
+                            return HTTP_DOWNLOAD_INCOMPLETE;
+                        }
+
+                        m_size = offset;
+
+                        return ftruncate(m_fd, offset) == 0 ? HTTP_DOWNLOAD_OK : HTTP_DOWNLOAD_FILE;
+                    }
+
+                    /**
+                     * 读取断点文件, 长度与校验信息一致并且文件存在时使用其中的分段
+                     */
+                    bool __load_checkpoint(const std::string& path) {
+                        std::ifstream in(m_checkpoint_path);
+                        std::string line;
+                        struct stat st;
+
+                        if (!in || !std::getline(in, line) || line != HTTP_DOWNLOAD_MAGIC) {
+                            return false;
+                        }
+
+                        std::string url, etag, last_modified;
+                        long long int size = -1;
+                        size_t count = 0;
+
+                        while (std::getline(in, line)) {
+                            if (line.compare(0, 4, "url ") == 0) {
+                                url = line.substr(4);
+                            } else if (line.compare(0, 5, "size ") == 0) {
+                                size = strtoll(line.c_str() + 5, NULL, 10);
+                            } else if (line.compare(0, 5, "etag ") == 0) {
+                                etag = line.substr(5);
+                            } else if (line.compare(0, 14, "last-modified ") == 0) {
+                                last_modified = line.substr(14);
+                            } else if (line.compare(0, 7, "ranges ") == 0) {
+                                count = strtoull(line.c_str() + 7, NULL, 10);
+                                break;
+                            }
+                        }
+
+                        if (url != m_url || size != m_size || etag != m_etag || last_modified != m_last_modified) {
+                            return false;
+                        }
+
+                        if (stat(path.c_str(), &st) != 0 || st.st_size != m_size) {
+                            return false;
+                        }
+
+                        m_ranges.clear();
+
+                        for (size_t i = 0; i < count; i ++) {
+                            http_range_t range;
+
+                            if (!(in >> range.start >> range.end >> range.done) || range.end < range.start || range.end >= (unsigned long long int)m_size || range.done > range.end - range.start + 1) {
+                                return false;
+                            }
+
+                            m_ranges.push_back(range);
+                        }
+
+                        return !m_ranges.empty();
+                    }
+
+                    /**
+                     * 保存断点文件, 先同步数据再通过rename替换, 断点中的进度不会超过磁盘上的数据
+                     * 不能持有m_lock, 只在复制分段进度时加锁
+                     */
+                    bool __save_checkpoint() {
+                        std::lock_guard<std::mutex> checkpoint_lock(m_checkpoint_lock);
+                        std::string tmp = m_checkpoint_path + ".tmp";
+                        std::vector<http_range_t> ranges;
+
+                        // 先复制进度再同步, 复制时计入的数据都已经写入了文件
+                        {
+                            std::lock_guard<std::mutex> lock(m_lock);
+                            ranges = m_ranges;
+                        }
+
+                        if (fdatasync(m_fd) != 0) {
+                            return false;
+                        }
+
+                        {
+                            std::ofstream out(tmp, std::ios::trunc);
+
+                            out << HTTP_DOWNLOAD_MAGIC << "\n";
+                            out << "url " << m_url << "\n";
+                            out << "size " << m_size << "\n";
+                            out << "etag " << m_etag << "\n";
+                            out << "last-modified " << m_last_modified << "\n";
+                            out << "ranges " << ranges.size() << "\n";
+
+                            for (size_t i = 0; i < ranges.size(); i ++) {
+                                out << ranges[i].start << " " << ranges[i].end << " " << ranges[i].done << "\n";
+                            }
+
+                            out.flush();
+
+                            if (!out) {
+                                return false;
+                            }
+                        }
+
+                        return rename(tmp.c_str(), m_checkpoint_path.c_str()) == 0;
+                    }
+
+                    /** 分段下载, 所有分段完成后删除断点文件 */
+                    int __download_ranges(const std::string& path) {
+                        m_resumed = __load_checkpoint(path);
+
+                        if (m_resumed) {
+                            m_fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+                        } else {
+                            unsigned long long int size = (unsigned long long int)m_size; // 此时m_size > 0
+                            unsigned long long int range_size = m_range_size;
+
+                            // 文件较小时缩小分段, 使每个连接都有分段
+                            if (size / m_connections < range_size) {
+                                range_size = (size + m_connections - 1) / m_connections;
+                                range_size = range_size > HTTP_DOWNLOAD_MIN_RANGE ? range_size : HTTP_DOWNLOAD_MIN_RANGE;
+                            }
+
+                            http_range_split(size, range_size, &m_ranges);
+                            m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                        }
+
+                        if (m_fd < 0 || (!m_resumed && !__preallocate(m_size))) {
+                            m_error = "Failed to create " + path + ": " + strerror(errno);
+                            return HTTP_DOWNLOAD_FILE;
+                        }
+
+                        m_queue.clear();
+                        m_attempts.assign(m_ranges.size(), 0);
+
+                        for (size_t i = 0; i < m_ranges.size(); i ++) {
+                            m_downloaded += m_ranges[i].done;
+
+                            if (m_ranges[i].done < m_ranges[i].end - m_ranges[i].start + 1) {
+                                m_queue.push_back(i);
+                            }
+                        }
+
+                        if (!m_queue.empty()) {
+                            __run();
+                        }
+
+                        if (m_abort) {
+                            // 文件已经变化时断点没有意义
+                            if (m_result == HTTP_DOWNLOAD_CHANGED) {
+                                unlink(m_checkpoint_path.c_str());
+                            }
+
+                            return m_result;
+                        }
+
+                        if (m_failed) {
+                            return HTTP_DOWNLOAD_INCOMPLETE;
+                        }
+
+                        unlink(m_checkpoint_path.c_str());
+
+                        return HTTP_DOWNLOAD_OK;
+                    }
+
+                    /** 在线程池中启动下载任务并等待全部结束 */
+                    void __run() {
+                        CThreadPool* pool = m_thread_pool;
+                        std::unique_ptr<CThreadPool> owned;
+                        unsigned int tasks = m_connections < m_queue.size() ? m_connections : m_queue.size();
+
+                        if (pool == NULL) {
+                            owned.reset(new CThreadPool(tasks));
+                            pool = owned.get();
+                        }
+
+                        m_result = HTTP_DOWNLOAD_OK;
+                        m_active = tasks;
+
+                        for (unsigned int i = 0; i < tasks; i ++) {
+                            pool->add_task([this]() {
+                                __worker();
+                            });
+                        }
+
+                        std::unique_lock<std::mutex> lock(m_lock);
+
+                        m_done.wait(lock, [this]() {
+                            return m_active == 0;
+                        });
+                    }
+
+                    /**
+                     * 下载任务, 每次从队列中取一个分段, 没有进展的失败计入重试次数, 队列为空时结束
+                     */
+                    void __worker() {
+                        while (true) {
+                            size_t index;
+                            unsigned int attempts;
+
+                            {
+                                std::lock_guard<std::mutex> lock(m_lock);
+
+                                if (m_abort || m_queue.empty()) {
+                                    break;
+                                }
+
+                                index = m_queue.front();
+                                attempts = m_attempts[index];
+                                m_queue.pop_front();
+                            }
+
+                            if (attempts > 0) {
+                                std::this_thread::sleep_for(std::chrono::milliseconds(HTTP_DOWNLOAD_RETRY_DELAY * attempts));
+                            }
+
+                            unsigned long long int before = m_ranges[index].done;
+                            std::string error;
+                            int ret = __fetch(index, &error);
+
+                            {
+                                std::lock_guard<std::mutex> lock(m_lock);
+
+                                if (ret == __HTTP_DOWNLOAD_RETRY) {
+                                    m_attempts[index] = m_ranges[index].done > before ? 0 : m_attempts[index] + 1;
+
+                                    if (m_attempts[index] <= m_retries) {
+                                        m_queue.push_back(index);
+                                    } else {
+                                        m_failed = true;
+                                        m_error = error;
+                                    }
+                                } else if (ret != HTTP_DOWNLOAD_OK && !m_abort) {
+                                    m_abort = true;
+                                    m_result = ret;
+                                    m_error = error;
+                                }
+                            }
+
+                            if (ret != HTTP_DOWNLOAD_CHANGED && !__save_checkpoint()) {
+                                std::lock_guard<std::mutex> lock(m_lock);
+
+                                if (!m_abort) {
+                                    m_abort = true;
+                                    m_result = HTTP_DOWNLOAD_FILE;
+                                    m_error = "Failed to save checkpoint " + m_checkpoint_path;
+                                }
+                            }
+                        }
+
+                        std::lock_guard<std::mutex> lock(m_lock);
+
+                        m_active --;
+                        m_done.notify_all();
+                    }
+
+                    /**
+                     * 下载分段中剩余的部分, 通过If-Range保证与探测时是同一个文件
+                     * @param  index 分段的下标
+                     * @param  error 失败的原因
+                     * @return       HTTP_DOWNLOAD_OK, __HTTP_DOWNLOAD_RETRY或其它HTTP_DOWNLOAD_*
+                     */
+                    int __fetch(size_t index, std::string* error) {
+                        CHttpClient client;
+                        http_range_t range;
+                        unsigned long long int start, end;
+                        long long int total;
+                        bool file_error = false;
+                        bool overflow = false;
+
+                        {
+                            std::lock_guard<std::mutex> lock(m_lock);
+                            range = m_ranges[index];
+                        }
+
+                        unsigned long long int offset = range.start + range.done;
+
+                        __prepare(&client);
+                        client.add_header("Range", "bytes=" + std::to_string(offset) + "-" + std::to_string(range.end));
+
+                        // If-Range只能使用强校验的ETag
+                        if (!m_etag.empty() && m_etag.compare(0, 2, "W/") != 0) {
+                            client.add_header("If-Range", m_etag);
+                        } else if (!m_last_modified.empty()) {
+                            client.add_header("If-Range", m_last_modified);
+                        }
+
+                        if (!client.connect() || !client.get_response()) {
+                            *error = client.error();
+                            client.close();
+                            return __HTTP_DOWNLOAD_RETRY;
+                        }
+
+                        int status = client.get_status_code();
+
+                        if (status == 200) {
+                            *error = "The file changed during the download";
+                            client.close();
+                            return HTTP_DOWNLOAD_CHANGED;
+                        } else if (status != 206) {
+                            *error = "Unexpected status " + std::to_string(status);
+                            client.close();
+                            return status >= 500 || status == 408 || status == 429 ? __HTTP_DOWNLOAD_RETRY : HTTP_DOWNLOAD_STATUS;
+                        }
+
+                        if (!http_parse_content_range(client.get_field("Content-Range"), &start, &end, &total) || start != offset || end != range.end || total != m_size) {
+                            *error = "The file changed during the download";
+                            client.close();
+                            return HTTP_DOWNLOAD_CHANGED;
+                        }
+
+                        // body比Content-Range长时会覆盖相邻的分段
+                        if (client.get_content_length() >= 0 && (unsigned long long int)client.get_content_length() != range.end - offset + 1) {
+                            *error = "Content-Length does not match Content-Range";
+                            client.close();
+                            return HTTP_DOWNLOAD_STATUS;
+                        }
+
+                        client.read([this, index, &range, &offset, &file_error, &overflow](const char* data, size_t length) -> bool {
+                            if (m_abort) {
+                                return false;
+                            }
+
+                            if (offset + length > range.end + 1) {
+                                overflow = true;
+                                return false;
+                            }
+
+                            if (!__write(data, length, offset)) {
+                                file_error = true;
+                                return false;
+                            }
+
+                            offset += length;
+                            m_downloaded += length;
+
+                            std::lock_guard<std::mutex> lock(m_lock);
+                            m_ranges[index].done += length;
+
+                            return true;
+                        });
+
+                        client.close();
+
+                        if (file_error) {
+                            *error = std::string("Failed to write the file: ") + strerror(errno);
+                            return HTTP_DOWNLOAD_FILE;
+                        }
+
+                        if (overflow) {
+                            *error = "The response is longer than the requested range";
+                            return HTTP_DOWNLOAD_STATUS;
+                        }
+
+                        if (offset != range.end + 1) {
+                            *error = "Connection closed before the range finished";
+                            return __HTTP_DOWNLOAD_RETRY;
+                        }
+
+                        return HTTP_DOWNLOAD_OK;
+                    }
+            };
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,373 @@
+#ifndef _CLIBS_HTTP_ENCODING_H_
+#define _CLIBS_HTTP_ENCODING_H_ 1
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cctype>
+#include <zlib.h>
+#include "clibs/net/http/http_reader.hpp"
+
+#ifdef CLIBS_HTTP_BROTLI
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#endif
+
+#define HTTP_ENCODING_UNSUPPORTED -1
+#define HTTP_ENCODING_IDENTITY 0
+#define HTTP_ENCODING_GZIP 1
+#define HTTP_ENCODING_DEFLATE 2
+#define HTTP_ENCODING_BROTLI 3
+
+#define HTTP_DECODER_BUFFER 16384 // 解压输出缓冲区的大小
+
+namespace clibs {
+    namespace net {
+        namespace http {
+            /**
+             * 流式的内容解码器, 压缩数据分段写入, 解压后的数据通过回调输出
+             * gzip与deflate需要链接zlib(-lz), 定义CLIBS_HTTP_BROTLI后支持br, 需要链接-lbrotlidec(http_encode还需要-lbrotlienc)
+             */
+            typedef struct {
+                int encoding; // HTTP_ENCODING_*
+                z_stream zstream;
+                bool zstream_ready;
+    #ifdef CLIBS_HTTP_BROTLI
+                BrotliDecoderState* brotli;
+    #endif
+                bool finished; // 压缩流已经结束
+                unsigned long long int max_size; // 解压后的最大长度, 0为不限制, 用于防止压缩炸弹
+                unsigned long long int total; // 已输出的长度
+                std::vector<char> output;
+            } http_decoder_t;
+
+            /**
+             * 解析Content-Encoding
+             * @param  value 请求头的值
+             * @return       HTTP_ENCODING_*, 多重编码或不支持的编码返回HTTP_ENCODING_UNSUPPORTED
+             */
+            int http_encoding_parse(const std::string& value) {
+                std::string name;
+
+                for (size_t i = 0; i < value.size(); i ++) {
+                    if (value[i] != ' ' && value[i] != '\t') {
+                        name += tolower((unsigned char)value[i]);
+                    }
+                }
+
+                if (name == "" || name == "identity") {
+                    return HTTP_ENCODING_IDENTITY;
+                } else if (name == "gzip" || name == "x-gzip") {
+                    return HTTP_ENCODING_GZIP;
+                } else if (name == "deflate") {
+                    return HTTP_ENCODING_DEFLATE;
+    #ifdef CLIBS_HTTP_BROTLI
+                } else if (name == "br") {
+                    return HTTP_ENCODING_BROTLI;
+    #endif
+                }
+
+                return HTTP_ENCODING_UNSUPPORTED;
+            }
+
+            /** 编码在请求头中的名称 */
+            const char* http_encoding_name(int encoding) {
+                switch (encoding) {
+                    case HTTP_ENCODING_GZIP:
+                        return "gzip";
+                    case HTTP_ENCODING_DEFLATE:
+                        return "deflate";
+                    case HTTP_ENCODING_BROTLI:
+                        return "br";
+                    default:
+                        return "identity";
+                }
+            }
+
+            /** 支持解码的编码, 用作Accept-Encoding */
+            std::string http_accept_encoding() {
+    #ifdef CLIBS_HTTP_BROTLI
+                return "br, gzip, deflate";
+    #else
+                return "gzip, deflate";
+    #endif
+            }
+
+            /**
+             * 初始化解码器
+             * @param  decoder  http_decoder_t
+             * @param  encoding HTTP_ENCODING_*
+             * @return          是否支持该编码
+             */
+            bool http_decoder_init(http_decoder_t* decoder, int encoding) {
+                decoder->encoding = encoding;
+                decoder->zstream_ready = false;
+    #ifdef CLIBS_HTTP_BROTLI
+                decoder->brotli = NULL;
+    #endif
+                decoder->finished = false;
+                decoder->max_size = 0;
+                decoder->total = 0;
+
+                switch (encoding) {
+                    case HTTP_ENCODING_IDENTITY:
+                        return true;
+                    case HTTP_ENCODING_GZIP:
+                    case HTTP_ENCODING_DEFLATE:
+                        // deflate在收到第一个字节时才能判断是否带有zlib头
+                        memset(&decoder->zstream, 0, sizeof(decoder->zstream));
+                        break;
+    #ifdef CLIBS_HTTP_BROTLI
+                    case HTTP_ENCODING_BROTLI:
+                        decoder->brotli = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+
+                        if (decoder->brotli == NULL) {
+                            return false;
+                        }
+
+                        break;
+    #endif
+                    default:
+                        return false;
+                }
+
+                decoder->output.resize(HTTP_DECODER_BUFFER);
+
+                return true;
+            }
+
+            /** 输出一段解压后的数据 */
+            bool __http_decoder_emit(http_decoder_t* decoder, size_t size, const http_body_callback& callback) {
+                if (size == 0) {
+                    return true;
+                }
+
+                decoder->total += size;
+
+                if (decoder->max_size > 0 && decoder->total > decoder->max_size) {
+                    return false;
+                }
+
+                return callback(decoder->output.data(), size);
+            }
+
+            /** 使用zlib解压gzip与deflate */
+            bool __http_decoder_inflate(http_decoder_t* decoder, const char* data, size_t length, const http_body_callback& callback) {
+                z_stream* zs = &decoder->zstream;
+
+                if (!decoder->zstream_ready) {
+                    // 有的服务器发送不带zlib头的deflate数据
+                    int window = decoder->encoding == HTTP_ENCODING_GZIP ? 16 + MAX_WBITS
+                        : ((unsigned char)data[0] & 0x0f) == Z_DEFLATED && ((unsigned char)data[0] >> 4) <= 7 ? MAX_WBITS : -MAX_WBITS;
+
+                    if (inflateInit2(zs, window) != Z_OK) {
+                        return false;
+                    }
+
+                    decoder->zstream_ready = true;
+                }
+
+                zs->next_in = (Bytef*)data;
+                zs->avail_in = length;
+
+                do {
+                    zs->next_out = (Bytef*)decoder->output.data();
+                    zs->avail_out = decoder->output.size();
+
+                    int ret = inflate(zs, Z_NO_FLUSH);
+
+                    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                        return false;
+                    }
+
+                    size_t size = decoder->output.size() - zs->avail_out;
+
+                    if (!__http_decoder_emit(decoder, size, callback)) {
+                        return false;
+                    }
+
+                    if (ret == Z_STREAM_END) {
+                        // gzip允许多个成员首尾相连
+                        if (decoder->encoding == HTTP_ENCODING_GZIP && zs->avail_in > 0) {
+                            inflateReset(zs);
+                            continue;
+                        }
+
+                        decoder->finished = true;
+                        break;
+                    }
+
+                    if (ret == Z_BUF_ERROR && size == 0) {
+                        break;
+                    }
+                } while (zs->avail_in > 0 || zs->avail_out == 0);
+
+                return true;
+            }
+
+    #ifdef CLIBS_HTTP_BROTLI
+            /** 使用brotli解压 */
+            bool __http_decoder_brotli(http_decoder_t* decoder, const char* data, size_t length, const http_body_callback& callback) {
+                const uint8_t* next_in = (const uint8_t*)data;
+                size_t avail_in = length;
+
+                while (true) {
+                    uint8_t* next_out = (uint8_t*)decoder->output.data();
+                    size_t avail_out = decoder->output.size();
+                    BrotliDecoderResult ret = BrotliDecoderDecompressStream(decoder->brotli, &avail_in, &next_in, &avail_out, &next_out, NULL);
+
+                    if (ret == BROTLI_DECODER_RESULT_ERROR || !__http_decoder_emit(decoder, decoder->output.size() - avail_out, callback)) {
+                        return false;
+                    }
+
+                    if (ret == BROTLI_DECODER_RESULT_SUCCESS) {
+                        decoder->finished = true;
+                        return true;
+                    } else if (ret == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT) {
+                        return true;
+                    }
+                }
+            }
+    #endif
+
+            /**
+             * 写入一段压缩数据
+             * @param  decoder  http_decoder_t
+             * @param  data     压缩数据
+             * @param  length   长度
+             * @param  callback 接收解压后数据的回调
+             * @return          数据格式错误, 超过max_size或回调返回false时返回false
+             */
+            bool http_decoder_write(http_decoder_t* decoder, const char* data, size_t length, const http_body_callback& callback) {
+                // 压缩流结束后的数据直接忽略
+                if (length == 0 || decoder->finished) {
+                    return true;
+                }
+
+                switch (decoder->encoding) {
+                    case HTTP_ENCODING_IDENTITY:
+                        decoder->total += length;
+                        return (decoder->max_size == 0 || decoder->total <= decoder->max_size) && callback(data, length);
+                    case HTTP_ENCODING_GZIP:
+                    case HTTP_ENCODING_DEFLATE:
+                        return __http_decoder_inflate(decoder, data, length, callback);
+    #ifdef CLIBS_HTTP_BROTLI
+                    case HTTP_ENCODING_BROTLI:
+                        return __http_decoder_brotli(decoder, data, length, callback);
+    #endif
+                    default:
+                        return false;
+                }
+            }
+
+            /**
+             * 所有数据写入后检查压缩流是否完整
+             * @param  decoder http_decoder_t
+             * @return         true/false
+             */
+            bool http_decoder_finish(const http_decoder_t* decoder) {
+                return decoder->encoding == HTTP_ENCODING_IDENTITY || decoder->finished;
+            }
+
+            /**
+             * 释放解码器
+             * @param decoder http_decoder_t
+             */
+            void http_decoder_free(http_decoder_t* decoder) {
+                if (decoder->zstream_ready) {
+                    inflateEnd(&decoder->zstream);
+                    decoder->zstream_ready = false;
+                }
+
+    #ifdef CLIBS_HTTP_BROTLI
+                if (decoder->brotli != NULL) {
+                    BrotliDecoderDestroyInstance(decoder->brotli);
+                    decoder->brotli = NULL;
+                }
+    #endif
+
+                std::vector<char>().swap(decoder->output);
+            }
+
+            /**
+             * 压缩数据, 用于请求body
+             * @param  encoding HTTP_ENCODING_*
+             * @param  data     原始数据
+             * @param  length   长度
+             * @param  output   压缩后的数据
+             * @param  level    压缩级别, -1为默认级别
+             * @return          true/false
+             */
+            bool http_encode(int encoding, const char* data, size_t length, std::string* output, int level = -1) {
+                if (encoding == HTTP_ENCODING_IDENTITY) {
+                    output->assign(data, length);
+                    return true;
+                }
+
+    #ifdef CLIBS_HTTP_BROTLI
+                if (encoding == HTTP_ENCODING_BROTLI) {
+                    size_t size = BrotliEncoderMaxCompressedSize(length);
+                    output->resize(size > 0 ? size : length + 1024);
+                    size = output->size();
+
+                    if (!BrotliEncoderCompress(level < 0 ? BROTLI_DEFAULT_QUALITY : level, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC,
+                            length, (const uint8_t*)data, &size, (uint8_t*)&(*output)[0])) {
+                        return false;
+                    }
+
+                    output->resize(size);
+                    return true;
+                }
+    #endif
+
+                if (encoding != HTTP_ENCODING_GZIP && encoding != HTTP_ENCODING_DEFLATE) {
+                    return false;
+                }
+
+                z_stream zs;
+                memset(&zs, 0, sizeof(zs));
+
+                if (deflateInit2(&zs, level < 0 ? Z_DEFAULT_COMPRESSION : level, Z_DEFLATED,
+                        encoding == HTTP_ENCODING_GZIP ? 16 + MAX_WBITS : MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    return false;
+                }
+
+                // 一次分配足够的空间, 一次调用完成压缩
+                output->resize(deflateBound(&zs, length) + 32);
+                zs.next_in = (Bytef*)data;
+                zs.avail_in = length;
+                zs.next_out = (Bytef*)&(*output)[0];
+                zs.avail_out = output->size();
+
+                int ret = deflate(&zs, Z_FINISH);
+                output->resize(zs.total_out);
+                deflateEnd(&zs);
+
+                return ret == Z_STREAM_END;
+            }
+
+            /**
+             * 以流的方式读取并解码body, 可以用于chunked的body
+             * @param  reader   http_reader_t
+             * @param  decoder  已经按Content-Encoding初始化的解码器
+             * @param  callback 接收解码后数据的回调
+             * @return          解码后的总长度, 出错或压缩流不完整时返回-1
+             */
+            long long int reader_read_decoded(http_reader_t* reader, http_decoder_t* decoder, const http_body_callback& callback) {
+                unsigned long long int start = decoder->total;
+
+                long long int len = reader_read_to(reader, [decoder, &callback](const char* data, size_t length) -> bool {
+                    return http_decoder_write(decoder, data, length, callback);
+                });
+
+                if (len < 0 || !http_decoder_finish(decoder)) {
+                    return -1;
+                }
+
+                return decoder->total - start;
+            }
+        }
+    }
+}
+
+#endif
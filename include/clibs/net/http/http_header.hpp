@@ -3,69 +3,306 @@
 
 #include <iostream>
 #include <sstream>
+#include <string>
 #include <map>
 #include <vector>
+#include <type_traits>
+#include "clibs/net/http/http_parser.hpp"
+
+/**
+ * 常用请求头的编号, 可以直接作为下标查找
+ */
+#define HTTP_HEADER_UNKNOWN -1
+#define HTTP_HEADER_HOST 0
+#define HTTP_HEADER_CONTENT_LENGTH 1
+#define HTTP_HEADER_CONTENT_TYPE 2
+#define HTTP_HEADER_CONTENT_ENCODING 3
+#define HTTP_HEADER_TRANSFER_ENCODING 4
+#define HTTP_HEADER_CONNECTION 5
+#define HTTP_HEADER_KEEP_ALIVE 6
+#define HTTP_HEADER_ACCEPT 7
+#define HTTP_HEADER_ACCEPT_ENCODING 8
+#define HTTP_HEADER_USER_AGENT 9
+#define HTTP_HEADER_AUTHORIZATION 10
+#define HTTP_HEADER_COOKIE 11
+#define HTTP_HEADER_SET_COOKIE 12
+#define HTTP_HEADER_LOCATION 13
+#define HTTP_HEADER_DATE 14
+#define HTTP_HEADER_SERVER 15
+#define HTTP_HEADER_CACHE_CONTROL 16
+#define HTTP_HEADER_EXPECT 17
+#define HTTP_HEADER_RANGE 18
+#define HTTP_HEADER_CONTENT_RANGE 19
+#define HTTP_HEADER_ETAG 20
+#define HTTP_HEADER_LAST_MODIFIED 21
+#define HTTP_HEADER_UPGRADE 22
+#define HTTP_HEADER_SEC_WEBSOCKET_KEY 23
+#define HTTP_HEADER_SEC_WEBSOCKET_ACCEPT 24
+#define HTTP_HEADER_KNOWN_COUNT 25
 
 namespace clibs {
     namespace net {
         namespace http {
+            /** 常用请求头的名称, 下标为HTTP_HEADER_* */
+            const http_string_view_t* __http_header_known_names() {
+                static const http_string_view_t names[HTTP_HEADER_KNOWN_COUNT] = {
+                    {"Host", 4}, {"Content-Length", 14}, {"Content-Type", 12}, {"Content-Encoding", 16}, {"Transfer-Encoding", 17},
+                    {"Connection", 10}, {"Keep-Alive", 10}, {"Accept", 6}, {"Accept-Encoding", 15}, {"User-Agent", 10},
+                    {"Authorization", 13}, {"Cookie", 6}, {"Set-Cookie", 10}, {"Location", 8}, {"Date", 4},
+                    {"Server", 6}, {"Cache-Control", 13}, {"Expect", 6}, {"Range", 5}, {"Content-Range", 13},
+                    {"ETag", 4}, {"Last-Modified", 13}, {"Upgrade", 7}, {"Sec-WebSocket-Key", 17}, {"Sec-WebSocket-Accept", 20}
+                };
+
+                return names;
+            }
+
+            /**
+             * 常用请求头的名称
+             * @param  id HTTP_HEADER_*
+             * @return    不是常用请求头时为NULL
+             */
+            const http_string_view_t* http_header_known_name(int id) {
+                return id >= 0 && id < HTTP_HEADER_KNOWN_COUNT ? &__http_header_known_names()[id] : NULL;
+            }
+
+            /**
+             * 查找常用请求头的编号, 忽略大小写
+             * @param  name 请求头名称
+             * @return      HTTP_HEADER_*, 不是常用请求头时为HTTP_HEADER_UNKNOWN
+             */
+            int http_header_known_id(const http_string_view_t* name) {
+                const http_string_view_t* names = __http_header_known_names();
+
+                // 绝大多数名称在长度比较时就被排除
+                for (int id = 0; id < HTTP_HEADER_KNOWN_COUNT; id ++) {
+                    if (names[id].len == name->len && http_view_equals(name, &names[id])) {
+                        return id;
+                    }
+                }
+
+                return HTTP_HEADER_UNKNOWN;
+            }
+
+            /**
+             * 请求头表中的一项, 名称与值保存在表的arena中
+             */
+            typedef struct {
+                int id; // HTTP_HEADER_*, 常用请求头的名称不保存在arena中
+                size_t name_offset;
+                size_t name_length;
+                size_t value_offset;
+                size_t value_length;
+            } http_header_entry_t;
+
             /**
              * http请求头封装
+             * 所有数据连续保存在一块arena中, 按添加顺序保存, 名称忽略大小写
              */
             class CHttpHeader {
                 private:
-                    std::map<std::string, std::vector<std::string>> m_data;
+                    std::string m_arena; // 名称与值
+                    std::vector<http_header_entry_t> m_entries;
+                    int m_known[HTTP_HEADER_KNOWN_COUNT]; // 常用请求头的第一项的下标, 不存在时为-1
+                    size_t m_garbage; // arena中已删除数据的长度
+
+                    /** 重建常用请求头的下标 */
+                    void __reindex() {
+                        for (int i = 0; i < HTTP_HEADER_KNOWN_COUNT; i ++) {
+                            m_known[i] = -1;
+                        }
+
+                        for (size_t i = m_entries.size(); i > 0; i --) {
+                            if (m_entries[i - 1].id != HTTP_HEADER_UNKNOWN) {
+                                m_known[m_entries[i - 1].id] = i - 1;
+                            }
+                        }
+                    }
+
+                    /** 删除的数据超过一半时重建arena */
+                    void __compact() {
+                        if (m_garbage < 4096 || m_garbage * 2 < m_arena.size()) {
+                            return;
+                        }
+
+                        std::string arena;
+                        arena.reserve(m_arena.size() - m_garbage);
+
+                        for (size_t i = 0; i < m_entries.size(); i ++) {
+                            http_header_entry_t* entry = &m_entries[i];
+                            size_t name_offset = arena.size();
+
+                            arena.append(m_arena, entry->name_offset, entry->name_length);
+                            size_t value_offset = arena.size();
+                            arena.append(m_arena, entry->value_offset, entry->value_length);
+                            entry->name_offset = name_offset;
+                            entry->value_offset = value_offset;
+                        }
+
+                        m_arena.swap(arena);
+                        m_garbage = 0;
+                    }
+
+                    /** 名称与一项是否相同 */
+                    bool __matches(const http_header_entry_t* entry, int id, const http_string_view_t* name) const {
+                        if (id != HTTP_HEADER_UNKNOWN || entry->id != HTTP_HEADER_UNKNOWN) {
+                            return entry->id == id;
+                        }
+
+                        http_string_view_t entry_name = {m_arena.data() + entry->name_offset, entry->name_length};
+
+                        return http_view_equals(&entry_name, name);
+                    }
+
+                    /** 查找第index个同名的项 */
+                    const http_header_entry_t* __find(const http_string_view_t* name, int index) const {
+                        int id = http_header_known_id(name);
+                        size_t start = 0;
+
+                        if (id != HTTP_HEADER_UNKNOWN) {
+                            if (m_known[id] < 0) {
+                                return NULL;
+                            }
+
+                            start = m_known[id];
+
+                            if (index == 0) {
+                                return &m_entries[start];
+                            }
+                        }
+
+                        for (size_t i = start; i < m_entries.size(); i ++) {
+                            if (__matches(&m_entries[i], id, name) && index -- == 0) {
+                                return &m_entries[i];
+                            }
+                        }
+
+                        return NULL;
+                    }
+
+                    template<typename T>
+                    static std::string __to_value(const T& value, std::true_type) {
+                        return std::to_string(value);
+                    }
+
+                    template<typename T>
+                    static std::string __to_value(const T& value, std::false_type) {
+                        std::stringstream s_val;
+                        s_val << value;
+                        return s_val.str();
+                    }
                 public:
-                    CHttpHeader() {}
+                    CHttpHeader() {
+                        clear();
+                    }
 
                     CHttpHeader(std::map<std::string, std::vector<std::string>> data) {
-                        m_data = data;
+                        clear();
+
+                        for (std::map<std::string, std::vector<std::string>>::iterator it = data.begin(); it != data.end(); it ++) {
+                            for (size_t i = 0; i < it->second.size(); i ++) {
+                                append(it->first, it->second[i]);
+                            }
+                        }
                     }
 
                     /**
-                     * 添加请求头信息
+                     * 添加请求头信息, 名称与值直接拷贝到arena中
+                     * @param name   名称
+                     * @param value  值
                      */
-                    template<typename T>
-                    void append(std::string name, T value) {
-                        std::stringstream s_val;
-                        s_val << value;
-                        std::map<std::string, std::vector<std::string>>::iterator it;
-                        
-                        it = m_data.find(name);
+                    void append(const http_string_view_t& name, const http_string_view_t& value) {
+                        http_header_entry_t entry;
+                        entry.id = http_header_known_id(&name);
+                        entry.name_offset = m_arena.size();
+                        entry.name_length = entry.id == HTTP_HEADER_UNKNOWN ? name.len : 0;
 
-                        if (it == m_data.end()) {
-                            std::vector<std::string> field_array;
-                            field_array.push_back(s_val.str());
-                            m_data.insert(std::pair<std::string, std::vector<std::string>>(name, field_array));
-                        } else {
-                            it->second.push_back(s_val.str());
+                        m_arena.append(name.data, entry.name_length);
+                        entry.value_offset = m_arena.size();
+                        entry.value_length = value.len;
+                        m_arena.append(value.data, value.len);
+
+                        if (entry.id != HTTP_HEADER_UNKNOWN && m_known[entry.id] < 0) {
+                            m_known[entry.id] = m_entries.size();
                         }
+
+                        m_entries.push_back(entry);
+                    }
+
+                    void append(const std::string& name, const std::string& value) {
+                        append(http_string_view_t{name.data(), name.size()}, http_string_view_t{value.data(), value.size()});
+                    }
+
+                    void append(const std::string& name, const char* value) {
+                        append(http_string_view_t{name.data(), name.size()}, http_string_view_t{value, strlen(value)});
+                    }
+
+                    /**
+                     * 添加请求头信息, 数字直接转换, 其它类型通过stringstream转换
+                     */
+                    template<typename T>
+                    void append(const std::string& name, T value) {
+                        append(name, __to_value(value, std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, char>::value>()));
                     }
 
                     /**
                      * 判断是否包含请求头
-                     * @param  name 请求头列名
+                     * @param  name 请求头列名, 忽略大小写
                      * @return      true/false
                      */
-                    bool contains(std::string name) {
-                        std::map<std::string, std::vector<std::string>>::iterator it;
-                        it = m_data.find(name);
+                    bool contains(const std::string& name) const {
+                        http_string_view_t view = {name.data(), name.size()};
+                        return __find(&view, 0) != NULL;
+                    }
+
+                    /** 是否包含常用请求头 */
+                    bool contains(int id) const {
+                        return id >= 0 && id < HTTP_HEADER_KNOWN_COUNT && m_known[id] >= 0;
+                    }
+
+                    /**
+                     * 获取请求头的值, 不做拷贝, 在下一次修改之前有效
+                     * @param  name  请求头列名, 忽略大小写
+                     * @param  index 下标
+                     * @return       不存在时data为NULL
+                     */
+                    http_string_view_t get_view(const std::string& name, int index = 0) const {
+                        http_string_view_t view = {name.data(), name.size()};
+                        const http_header_entry_t* entry = __find(&view, index);
+
+                        if (entry == NULL) {
+                            return http_string_view_t{NULL, 0};
+                        }
 
-                        return it != m_data.end();
+                        return http_string_view_t{m_arena.data() + entry->value_offset, entry->value_length};
+                    }
+
+                    /**
+                     * 按编号获取常用请求头的第一个值, 不做拷贝
+                     * @param  id HTTP_HEADER_*
+                     * @return    不存在时data为NULL
+                     */
+                    http_string_view_t get_view(int id) const {
+                        if (!contains(id)) {
+                            return http_string_view_t{NULL, 0};
+                        }
+
+                        const http_header_entry_t* entry = &m_entries[m_known[id]];
+
+                        return http_string_view_t{m_arena.data() + entry->value_offset, entry->value_length};
                     }
 
                     /**
                      * 获取对应请求头信息的所有数据
                      */
-                    std::vector<std::string> get_fields(std::string name) {
-                        std::map<std::string, std::vector<std::string>>::iterator it;
-                        it = m_data.find(name);
+                    std::vector<std::string> get_fields(const std::string& name) const {
+                        std::vector<std::string> fields;
+                        http_string_view_t view;
 
-                        if (it == m_data.end()) {
-                            return std::vector<std::string>();
-                        } else {
-                            return it->second;
+                        for (int i = 0; (view = get_view(name, i)).data != NULL; i ++) {
+                            fields.push_back(http_view_str(&view));
                         }
+
+                        return fields;
                     }
 
                     /**
@@ -74,74 +311,119 @@ namespace clibs {
                      * @param  index 下标
                      * @return       结果文本
                      */
-                    std::string get(std::string name, int index) {
-                        std::vector<std::string> field_array = get_fields(name);
-
-                        if (index < field_array.size()) {
-                            return field_array[index];
-                        }
+                    std::string get(const std::string& name, int index) const {
+                        http_string_view_t view = get_view(name, index);
 
-                        return "";
+                        return http_view_str(&view);
                     }
 
                     /**
                      * 获取请求头信息的内容
                      * @param  name  请求头列名
-                     * @param  index 下标
                      */
-                    std::string get(std::string name) {
+                    std::string get(const std::string& name) const {
                         return get(name, 0);
                     }
 
+                    /** 请求头的数量 */
+                    size_t size() const {
+                        return m_entries.size();
+                    }
+
+                    /** 第index项的名称 */
+                    http_string_view_t name_at(size_t index) const {
+                        const http_header_entry_t* entry = &m_entries[index];
+
+                        if (entry->id != HTTP_HEADER_UNKNOWN) {
+                            return *http_header_known_name(entry->id);
+                        }
+
+                        return http_string_view_t{m_arena.data() + entry->name_offset, entry->name_length};
+                    }
+
+                    /** 第index项的值 */
+                    http_string_view_t value_at(size_t index) const {
+                        return http_string_view_t{m_arena.data() + m_entries[index].value_offset, m_entries[index].value_length};
+                    }
+
                     /**
-                     * 拼接成请求头格式数据
-                     * @return 拼接后的请求头
+                     * 拼接成请求头格式的数据, 追加到output之后
+                     * @param output 输出
                      */
-                    std::string str() {
-                        std::stringstream ss;
+                    void write(std::string* output) const {
+                        size_t size = output->size();
 
-                        std::map<std::string, std::vector<std::string>>::iterator map_iter, map_end;
-                        std::vector<std::string>::iterator field_iter, field_end;
+                        for (size_t i = 0; i < m_entries.size(); i ++) {
+                            size += name_at(i).len + m_entries[i].value_length + 4;
+                        }
 
-                        for (map_iter = m_data.begin(), map_end = m_data.end(); map_iter != map_end; map_iter++) {
-                            for (field_iter = map_iter->second.begin(), field_end = map_iter->second.end(); field_iter != field_end; field_iter ++) {
-                                ss << map_iter->first << ": " << *field_iter << "\r\n";
-                            }
+                        output->reserve(size);
+
+                        for (size_t i = 0; i < m_entries.size(); i ++) {
+                            http_string_view_t name = name_at(i);
+
+                            output->append(name.data, name.len);
+                            output->append(": ", 2);
+                            output->append(m_arena, m_entries[i].value_offset, m_entries[i].value_length);
+                            output->append("\r\n", 2);
                         }
+                    }
+
+                    /**
+                     * 拼接成请求头格式数据
+                     * @return 拼接后的请求头
+                     */
+                    std::string str() const {
+                        std::string data;
+                        write(&data);
 
-                        return ss.str();
+                        return data;
                     }
 
                     /** 删除整个请求头信息 */
-                    void remove(std::string name) {
-                        std::map<std::string, std::vector<std::string>>::iterator it;
+                    void remove(const std::string& name) {
+                        while (remove(name, 0)) {}
+                    }
 
-                        it = m_data.find(name);
+                    /** 删除请求头信息下的指定位置内容 */
+                    bool remove(const std::string& name, int index) {
+                        http_string_view_t view = {name.data(), name.size()};
+                        const http_header_entry_t* entry = __find(&view, index);
 
-                        if (it != m_data.end()) {
-                            m_data.erase(it);
+                        if (entry == NULL) {
+                            return false;
                         }
+
+                        m_garbage += entry->name_length + entry->value_length;
+                        m_entries.erase(m_entries.begin() + (entry - m_entries.data()));
+                        __reindex();
+                        __compact();
+
+                        return true;
                     }
 
-                    /** 删除请求头信息下的指定位置内容 */
-                    void remove(std::string name, int index) {
-                        std::map<std::string, std::vector<std::string>>::iterator it;
+                    /** 清空所有请求头, 保留已分配的内存 */
+                    void clear() {
+                        m_arena.clear();
+                        m_entries.clear();
+                        m_garbage = 0;
+                        __reindex();
+                    }
 
-                        it = m_data.find(name);
+                    std::map<std::string, std::vector<std::string>> data() const {
+                        std::map<std::string, std::vector<std::string>> result;
 
-                        if (it != m_data.end()) {
-                            if (index < it->second.size()) {
-                                it->second.erase(it->second.begin() + index);
-                            }
+                        for (size_t i = 0; i < m_entries.size(); i ++) {
+                            http_string_view_t name = name_at(i);
+                            http_string_view_t value = value_at(i);
+                            result[http_view_str(&name)].push_back(http_view_str(&value));
                         }
-                    }
 
-                    std::map<std::string, std::vector<std::string>> data() {
-                        return m_data;
+                        return result;
                     }
             };
         }
     }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,1049 @@
+#ifndef _CLIBS_HTTP_PARSER_H_
+#define _CLIBS_HTTP_PARSER_H_ 1
+
+#include <iostream>
+#include <string>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HTTP_PARSER_SSE2 1
+#endif
+
+#define HTTP_MAX_HEADERS 100 // 单个消息最多解析的请求头数量
+#define HTTP_MAX_START_LINE 8192 // 起始行的默认最大长度
+#define HTTP_MAX_HEADER_SIZE 65536 // 头部的默认最大长度
+
+#define HTTP_PARSE_INCOMPLETE -2 // 数据不完整, 需要读取更多数据后重新解析
+#define HTTP_PARSE_ERROR -1 // 格式错误
+
+#define HTTP_MESSAGE_REQUEST 0
+#define HTTP_MESSAGE_RESPONSE 1
+
+#define HTTP_EVENT_NEED_MORE 0 // 输入已全部处理, 需要更多数据
+#define HTTP_EVENT_HEADERS 1 // 头部解析完成, message可用
+#define HTTP_EVENT_BODY 2 // 一段body数据
+#define HTTP_EVENT_COMPLETE 3 // 一个消息结束, 之后的数据属于下一个消息
+#define HTTP_EVENT_ERROR -1 // 格式错误, 连接不能继续使用
+
+#define HTTP_STATE_HEAD 0
+#define HTTP_STATE_BODY 1 // 按Content-Length读取
+#define HTTP_STATE_BODY_EOF 2 // 读取到连接关闭
+#define HTTP_STATE_CHUNKED 3 // 由http_chunked_decoder_t解码
+#define HTTP_STATE_COMPLETE 4
+#define HTTP_STATE_ERROR 5
+
+#define HTTP_CHUNKED_NEED_MORE 0 // 输入已全部处理, 需要更多数据
+#define HTTP_CHUNKED_DATA 1 // 一段chunk数据
+#define HTTP_CHUNKED_DONE 2 // 最后一个chunk与trailer已经结束
+#define HTTP_CHUNKED_ERROR -1 // 格式错误
+
+#define HTTP_CHUNK_SIZE 0
+#define HTTP_CHUNK_EXT 1
+#define HTTP_CHUNK_DATA 2
+#define HTTP_CHUNK_END 3
+#define HTTP_CHUNK_TRAILER 4
+#define HTTP_CHUNK_DONE 5
+#define HTTP_CHUNK_ERROR 6
+
+#define HTTP_MAX_TRAILER_SIZE 8192 // trailer的最大长度
+
+namespace clibs {
+    namespace net {
+        namespace http {
+            /**
+             * 指向接收缓冲区的字符串片段, 不持有数据
+             */
+            typedef struct {
+                const char* data;
+                size_t len;
+            } http_string_view_t;
+
+            typedef struct {
+                http_string_view_t name;
+                http_string_view_t value;
+            } http_header_field_t;
+
+            /**
+             * 解析出的请求或响应头, 所有片段都指向被解析的缓冲区
+             */
+            typedef struct {
+                int type; // HTTP_MESSAGE_REQUEST/HTTP_MESSAGE_RESPONSE
+                int minor_version; // HTTP/1.x中的x
+
+                http_string_view_t method; // 请求方法
+                http_string_view_t path; // 请求路径
+
+                int status; // 响应状态码
+                http_string_view_t reason; // 响应状态描述
+
+                http_header_field_t headers[HTTP_MAX_HEADERS];
+                size_t num_headers;
+                size_t start_line_len; // 起始行的长度, 包括换行符
+            } http_message_t;
+
+            /**
+             * 对不可信的对端的限制, 只在头部解析完成或数据不完整时检查, 不影响正常的解析
+             */
+            typedef struct {
+                size_t max_start_line; // 起始行的最大长度
+                size_t max_headers; // 请求头的最大数量, 不超过HTTP_MAX_HEADERS
+                size_t max_header_size; // 整个头部的最大长度
+                unsigned long long int max_body_size; // body的最大长度, 0为不限制
+            } http_limits_t;
+
+            /**
+             * 使用默认的限制
+             * @param limits http_limits_t
+             */
+            void http_limits_init(http_limits_t* limits) {
+                limits->max_start_line = HTTP_MAX_START_LINE;
+                limits->max_headers = HTTP_MAX_HEADERS;
+                limits->max_header_size = HTTP_MAX_HEADER_SIZE;
+                limits->max_body_size = 0;
+            }
+
+            /**
+             * 检查解析完成的头部是否超过限制
+             * @param  msg      http_message_t
+             * @param  head_len 头部的长度
+             * @param  limits   http_limits_t
+             * @return          是否在限制之内
+             */
+            bool http_check_head(const http_message_t* msg, size_t head_len, const http_limits_t* limits) {
+                return msg->start_line_len <= limits->max_start_line && msg->num_headers <= limits->max_headers && head_len <= limits->max_header_size;
+            }
+
+            /**
+             * 检查不完整的头部是否已经超过限制, 避免一直等待没有结尾的头部
+             * @param  buf    已收到的头部数据
+             * @param  len    数据长度
+             * @param  limits http_limits_t
+             * @return        是否在限制之内
+             */
+            bool http_check_partial_head(const char* buf, size_t len, const http_limits_t* limits) {
+                if (len > limits->max_header_size) {
+                    return false;
+                }
+
+                return len <= limits->max_start_line || memchr(buf, '\n', limits->max_start_line) != NULL;
+            }
+
+            /** body的长度是否超过限制 */
+            bool http_check_body(unsigned long long int size, const http_limits_t* limits) {
+                return limits->max_body_size == 0 || size <= limits->max_body_size;
+            }
+
+            /** 转为std::string */
+            std::string http_view_str(const http_string_view_t* view) {
+                return std::string(view->data, view->len);
+            }
+
+            /** 忽略大小写比较 */
+            bool http_view_equals(const http_string_view_t* view, const char* str) {
+                size_t len = strlen(str);
+
+                if (view->len != len) {
+                    return false;
+                }
+
+                for (size_t i = 0; i < len; i ++) {
+                    if (::tolower((unsigned char)view->data[i]) != ::tolower((unsigned char)str[i])) {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            /** 两个片段忽略大小写比较 */
+            bool http_view_equals(const http_string_view_t* view, const http_string_view_t* other) {
+                if (view->len != other->len) {
+                    return false;
+                }
+
+                for (size_t i = 0; i < view->len; i ++) {
+                    if (::tolower((unsigned char)view->data[i]) != ::tolower((unsigned char)other->data[i])) {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            /**
+             * 查找请求头, 忽略大小写
+             * @param  msg  http_message_t
+             * @param  name 请求头名称
+             * @return      请求头的值, 不存在时为NULL
+             */
+            const http_string_view_t* http_message_header(const http_message_t* msg, const char* name) {
+                for (size_t i = 0; i < msg->num_headers; i ++) {
+                    if (http_view_equals(&msg->headers[i].name, name)) {
+                        return &msg->headers[i].value;
+                    }
+                }
+
+                return NULL;
+            }
+
+            /** 是否为token字符(RFC 7230) */
+            bool __http_is_token(unsigned char c) {
+                static const unsigned char token[256] = {
+                    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0,
+                    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+                    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+                    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1,
+                    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+                    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0,
+                    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+                };
+
+                return token[c] == 1;
+            }
+
+            /** 是否为请求头的值中不允许出现的控制字符, 制表符与obs-text除外 */
+            bool __http_is_ctl(unsigned char c) {
+                return (c < 0x20 && c != '\t') || c == 0x7f;
+            }
+
+            /**
+             * 跳过请求头的值中的普通字符, 返回第一个控制字符(通常是\r或\n)的位置
+             * 支持SSE2时每次检查16个字节
+             */
+            const char* __http_scan_value(const char* p, const char* end) {
+    #ifdef HTTP_PARSER_SSE2
+                const __m128i space = _mm_set1_epi8(0x20);
+                const __m128i tab = _mm_set1_epi8('\t');
+                const __m128i del = _mm_set1_epi8(0x7f);
+                const __m128i minus = _mm_set1_epi8(-1);
+
+                while (end - p >= 16) {
+                    __m128i v = _mm_loadu_si128((const __m128i*)p);
+                    // 有符号比较下0x80以上为负数, 先排除掉, 剩下小于0x20的控制字符
+                    __m128i ctl = _mm_and_si128(_mm_cmplt_epi8(v, space), _mm_cmpgt_epi8(v, minus));
+                    ctl = _mm_andnot_si128(_mm_cmpeq_epi8(v, tab), ctl);
+                    ctl = _mm_or_si128(ctl, _mm_cmpeq_epi8(v, del));
+
+                    int mask = _mm_movemask_epi8(ctl);
+
+                    if (mask != 0) {
+        #if defined(__GNUC__)
+                        return p + __builtin_ctz(mask);
+        #else
+                        unsigned long index;
+                        _BitScanForward(&index, mask);
+                        return p + index;
+        #endif
+                    }
+
+                    p += 16;
+                }
+    #endif
+                while (p < end && !__http_is_ctl((unsigned char)*p)) {
+                    p ++;
+                }
+
+                return p;
+            }
+
+            /** 读取行尾, 支持\r\n与\n, 返回行尾之后的位置, 数据不足时为NULL, 格式错误时设置error */
+            const char* __http_eol(const char* p, const char* end, bool* error) {
+                if (p >= end) {
+                    return NULL;
+                }
+
+                if (*p == '\r') {
+                    if (p + 1 >= end) {
+                        return NULL;
+                    }
+
+                    if (p[1] != '\n') {
+                        *error = true;
+                        return NULL;
+                    }
+
+                    return p + 2;
+                }
+
+                if (*p == '\n') {
+                    return p + 1;
+                }
+
+                *error = true;
+                return NULL;
+            }
+
+            /** 解析HTTP/1.x, 返回之后的位置 */
+            const char* __http_parse_version(const char* p, const char* end, int* minor_version, bool* error) {
+                if (end - p < 8) {
+                    // 数据不足时检查已有部分, 尽早发现错误
+                    if (memcmp(p, "HTTP/1.", end - p < 7 ? end - p : 7) != 0) {
+                        *error = true;
+                    }
+
+                    return NULL;
+                }
+
+                if (memcmp(p, "HTTP/1.", 7) != 0 || p[7] < '0' || p[7] > '9') {
+                    *error = true;
+                    return NULL;
+                }
+
+                *minor_version = p[7] - '0';
+
+                return p + 8;
+            }
+
+            /** 在buf中查找空行, 从offset开始 */
+            bool __http_has_end(const char* buf, size_t len, size_t offset) {
+                const char* p = buf + offset;
+                const char* end = buf + len;
+
+                while ((p = (const char*)memchr(p, '\n', end - p)) != NULL) {
+                    if ((p + 1 < end && p[1] == '\n') || (p + 2 < end && p[1] == '\r' && p[2] == '\n')) {
+                        return true;
+                    }
+
+                    p ++;
+                }
+
+                return false;
+            }
+
+            /** 解析请求头列表, 返回空行之后的位置 */
+            const char* __http_parse_headers(const char* p, const char* end, http_message_t* msg, bool* error) {
+                msg->num_headers = 0;
+
+                while (true) {
+                    if (p >= end) {
+                        return NULL;
+                    }
+
+                    // 空行表示请求头结束
+                    if (*p == '\r' || *p == '\n') {
+                        return __http_eol(p, end, error);
+                    }
+
+                    if (msg->num_headers == HTTP_MAX_HEADERS) {
+                        *error = true;
+                        return NULL;
+                    }
+
+                    http_header_field_t* field = &msg->headers[msg->num_headers];
+                    const char* start = p;
+
+                    while (p < end && __http_is_token((unsigned char)*p)) {
+                        p ++;
+                    }
+
+                    if (p >= end) {
+                        return NULL;
+                    }
+
+                    // 名称不能为空, 名称与冒号之间不能有空白, 也不支持折行
+                    if (p == start || *p != ':') {
+                        *error = true;
+                        return NULL;
+                    }
+
+                    field->name.data = start;
+                    field->name.len = p - start;
+                    p ++;
+
+                    while (p < end && (*p == ' ' || *p == '\t')) {
+                        p ++;
+                    }
+
+                    start = p;
+                    p = __http_scan_value(p, end);
+
+                    if (p >= end) {
+                        return NULL;
+                    }
+
+                    const char* value_end = p;
+
+                    p = __http_eol(p, end, error);
+
+                    if (p == NULL) {
+                        return NULL;
+                    }
+
+                    while (value_end > start && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+                        value_end --;
+                    }
+
+                    field->value.data = start;
+                    field->value.len = value_end - start;
+                    msg->num_headers ++;
+                }
+            }
+
+            /**
+             * 单次遍历解析请求或响应头, 不拷贝数据
+             * 对不完整的数据可以在读取更多数据后用同一个缓冲区重新调用,
+             * last_len为上一次调用时的数据长度, 没有出现空行时可以快速返回
+             * @param  buf      缓冲区
+             * @param  len      数据长度
+             * @param  msg      解析结果, 片段指向buf
+             * @param  last_len 上一次解析时的长度, 第一次为0
+             * @return          头部的长度, 或者HTTP_PARSE_INCOMPLETE/HTTP_PARSE_ERROR
+             */
+            int http_parse_head(const char* buf, size_t len, http_message_t* msg, size_t last_len) {
+                const char* p = buf;
+                const char* end = buf + len;
+                bool error = false;
+
+                if (last_len > 0 && !__http_has_end(buf, len, last_len > 3 ? last_len - 3 : 0)) {
+                    return HTTP_PARSE_INCOMPLETE;
+                }
+
+                // 忽略消息之前的空行(RFC 7230 3.5)
+                while (p < end && (*p == '\r' || *p == '\n')) {
+                    p ++;
+                }
+
+                if (p >= end) {
+                    return HTTP_PARSE_INCOMPLETE;
+                }
+
+                const char* start_line = p;
+
+                msg->status = 0;
+                msg->minor_version = -1;
+                msg->method.data = msg->path.data = msg->reason.data = NULL;
+                msg->method.len = msg->path.len = msg->reason.len = 0;
+
+                // 只有已有的字节都与"HTTP/"的前缀一致时才是响应, "HEA"之类的是不完整的请求
+                size_t prefix = end - p < 5 ? end - p : 5;
+
+                if (memcmp(p, "HTTP/", prefix) == 0 && prefix < 5) {
+                    return HTTP_PARSE_INCOMPLETE;
+                }
+
+                if (prefix == 5 && memcmp(p, "HTTP/", 5) == 0) {
+                    // 响应: HTTP/1.1 200 OK
+                    msg->type = HTTP_MESSAGE_RESPONSE;
+                    p = __http_parse_version(p, end, &msg->minor_version, &error);
+
+                    if (p == NULL) {
+                        return error ? HTTP_PARSE_ERROR : HTTP_PARSE_INCOMPLETE;
+                    }
+
+                    if (end - p < 4) {
+                        return HTTP_PARSE_INCOMPLETE;
+                    }
+
+                    if (*p != ' ' || p[1] < '0' || p[1] > '9' || p[2] < '0' || p[2] > '9' || p[3] < '0' || p[3] > '9') {
+                        return HTTP_PARSE_ERROR;
+                    }
+
+                    msg->status = (p[1] - '0') * 100 + (p[2] - '0') * 10 + (p[3] - '0');
+                    p += 4;
+
+                    if (p < end && *p == ' ') {
+                        p ++;
+                    }
+
+                    msg->reason.data = p;
+                    p = __http_scan_value(p, end);
+                    msg->reason.len = p - msg->reason.data;
+                } else {
+                    // 请求: GET /path HTTP/1.1
+                    msg->type = HTTP_MESSAGE_REQUEST;
+                    msg->method.data = p;
+
+                    while (p < end && __http_is_token((unsigned char)*p)) {
+                        p ++;
+                    }
+
+                    if (p >= end) {
+                        return HTTP_PARSE_INCOMPLETE;
+                    }
+
+                    if (p == msg->method.data || *p != ' ') {
+                        return HTTP_PARSE_ERROR;
+                    }
+
+                    msg->method.len = p - msg->method.data;
+                    msg->path.data = ++ p;
+
+                    while (p < end && (unsigned char)*p > 0x20 && *p != 0x7f) {
+                        p ++;
+                    }
+
+                    if (p >= end) {
+                        return HTTP_PARSE_INCOMPLETE;
+                    }
+
+                    if (p == msg->path.data || *p != ' ') {
+                        return HTTP_PARSE_ERROR;
+                    }
+
+                    msg->path.len = p - msg->path.data;
+                    p = __http_parse_version(p + 1, end, &msg->minor_version, &error);
+
+                    if (p == NULL) {
+                        return error ? HTTP_PARSE_ERROR : HTTP_PARSE_INCOMPLETE;
+                    }
+                }
+
+                p = __http_eol(p, end, &error);
+
+                if (p != NULL) {
+                    msg->start_line_len = p - start_line;
+                    p = __http_parse_headers(p, end, msg, &error);
+                }
+
+                if (p == NULL) {
+                    return error ? HTTP_PARSE_ERROR : HTTP_PARSE_INCOMPLETE;
+                }
+
+                return p - buf;
+            }
+
+            /**
+             * 严格解析Content-Length, 只允许数字
+             * @param  view   请求头的值
+             * @param  length 解析结果
+             * @return        是否合法
+             */
+            bool http_parse_content_length(const http_string_view_t* view, unsigned long long int* length) {
+                unsigned long long int value = 0;
+
+                if (view->len == 0 || view->len > 19) {
+                    return false;
+                }
+
+                for (size_t i = 0; i < view->len; i ++) {
+                    if (view->data[i] < '0' || view->data[i] > '9') {
+                        return false;
+                    }
+
+                    value = value * 10 + (view->data[i] - '0');
+                }
+
+                *length = value;
+
+                return true;
+            }
+
+            /**
+             * Transfer-Encoding的最后一个编码是否为chunked
+             * @param  view 请求头的值
+             * @return      true/false
+             */
+            bool http_is_chunked(const http_string_view_t* view) {
+                const char* end = view->data + view->len;
+
+                while (end > view->data && (end[-1] == ' ' || end[-1] == '\t')) {
+                    end --;
+                }
+
+                const char* start = end;
+
+                while (start > view->data && start[-1] != ',' && start[-1] != ' ' && start[-1] != '\t') {
+                    start --;
+                }
+
+                http_string_view_t last = {start, (size_t)(end - start)};
+
+                return http_view_equals(&last, "chunked");
+            }
+
+            /**
+             * 逗号分隔的请求头(如Connection)中是否包含指定的值, 忽略大小写
+             * @param  view  请求头的值
+             * @param  token 需要查找的值
+             * @return       true/false
+             */
+            bool http_has_token(const http_string_view_t* view, const char* token) {
+                const char* p = view->data;
+                const char* end = view->data + view->len;
+
+                while (p < end) {
+                    while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+                        p ++;
+                    }
+
+                    const char* start = p;
+
+                    while (p < end && *p != ',') {
+                        p ++;
+                    }
+
+                    const char* last = p;
+
+                    while (last > start && (last[-1] == ' ' || last[-1] == '\t')) {
+                        last --;
+                    }
+
+                    http_string_view_t item = {start, (size_t)(last - start)};
+
+                    if (item.len > 0 && http_view_equals(&item, token)) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            /**
+             * 消息结束后连接是否可以继续使用, HTTP/1.1默认保持连接, HTTP/1.0需要Connection: keep-alive
+             * 没有长度的响应body以关闭连接结束, 调用者需要自行判断
+             * @param  msg http_message_t
+             * @return     true/false
+             */
+            bool http_should_keep_alive(const http_message_t* msg) {
+                const http_string_view_t* connection = http_message_header(msg, "Connection");
+
+                if (msg->minor_version >= 1) {
+                    return connection == NULL || !http_has_token(connection, "close");
+                }
+
+                return connection != NULL && http_has_token(connection, "keep-alive");
+            }
+
+            /**
+             * chunked传输编码的解码器, 可以在任意位置分割输入
+             * chunk数据以指向输入的片段返回, 不做拷贝
+             */
+            typedef struct {
+                int state; // HTTP_CHUNK_*
+                unsigned long long int remaining; // 当前chunk剩余的长度
+                int digits; // 当前chunk长度的位数
+                size_t line_len; // trailer当前行的长度
+                bool cr; // 上一个字符是CR, 下一个字符必须是LF
+                std::string trailer; // 最后一个chunk之后的trailer, 每行以\n结尾
+            } http_chunked_decoder_t;
+
+            /**
+             * 初始化解码器
+             * @param decoder http_chunked_decoder_t
+             */
+            void http_chunked_init(http_chunked_decoder_t* decoder) {
+                decoder->state = HTTP_CHUNK_SIZE;
+                decoder->remaining = 0;
+                decoder->digits = 0;
+                decoder->line_len = 0;
+                decoder->cr = false;
+                decoder->trailer.clear();
+            }
+
+            /** 十六进制字符的值, 不是十六进制字符时返回-1 */
+            int __http_hex_value(char c) {
+                if (c >= '0' && c <= '9') {
+                    return c - '0';
+                }
+
+                c |= 0x20;
+
+                return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+            }
+
+            /**
+             * 解码一段输入, 遇到chunk数据时立即返回
+             * 调用方应当跳过已处理的长度后循环调用, 直到返回HTTP_CHUNKED_NEED_MORE/HTTP_CHUNKED_DONE/HTTP_CHUNKED_ERROR
+             * @param  decoder  http_chunked_decoder_t
+             * @param  buf      输入数据
+             * @param  len      输入长度
+             * @param  consumed 已处理的长度
+             * @param  data     HTTP_CHUNKED_DATA时指向输入中的chunk数据
+             * @return          HTTP_CHUNKED_*
+             */
+            int http_chunked_decode(http_chunked_decoder_t* decoder, const char* buf, size_t len, size_t* consumed, http_string_view_t* data) {
+                size_t i = 0;
+
+                data->data = NULL;
+                data->len = 0;
+
+                while (i < len) {
+                    if (decoder->state == HTTP_CHUNK_DATA) {
+                        size_t size = decoder->remaining < len - i ? decoder->remaining : len - i;
+
+                        data->data = buf + i;
+                        data->len = size;
+                        decoder->remaining -= size;
+
+                        if (decoder->remaining == 0) {
+                            decoder->state = HTTP_CHUNK_END;
+                        }
+
+                        *consumed = i + size;
+                        return HTTP_CHUNKED_DATA;
+                    }
+
+                    if (decoder->state == HTTP_CHUNK_DONE || decoder->state == HTTP_CHUNK_ERROR) {
+                        break;
+                    }
+
+                    char c = buf[i ++];
+
+                    // CR只能紧接在LF之前, 其它位置的CR会让两端对消息边界的理解不一致
+                    if (decoder->cr) {
+                        if (c != '\n') {
+                            decoder->state = HTTP_CHUNK_ERROR;
+                            break;
+                        }
+
+                        decoder->cr = false;
+                    } else if (c == '\r') {
+                        decoder->cr = true;
+                        continue;
+                    }
+
+                    switch (decoder->state) {
+                        case HTTP_CHUNK_SIZE: {
+                            int digit = __http_hex_value(c);
+
+                            if (digit >= 0) {
+                                // 最多15位, 避免溢出
+                                if (++ decoder->digits > 15) {
+                                    decoder->state = HTTP_CHUNK_ERROR;
+                                }
+
+                                decoder->remaining = (decoder->remaining << 4) | digit;
+                            } else if (decoder->digits == 0) {
+                                decoder->state = HTTP_CHUNK_ERROR;
+                            } else if (c == ';' || c == ' ' || c == '\t') {
+                                decoder->state = HTTP_CHUNK_EXT;
+                            } else if (c == '\n') {
+                                decoder->state = decoder->remaining > 0 ? HTTP_CHUNK_DATA : HTTP_CHUNK_TRAILER;
+                            } else {
+                                decoder->state = HTTP_CHUNK_ERROR;
+                            }
+
+                            break;
+                        }
+                        case HTTP_CHUNK_EXT:
+                            // 跳过chunk扩展
+                            if (c == '\n') {
+                                decoder->state = decoder->remaining > 0 ? HTTP_CHUNK_DATA : HTTP_CHUNK_TRAILER;
+                            }
+
+                            break;
+                        case HTTP_CHUNK_END:
+                            if (c == '\n') {
+                                decoder->state = HTTP_CHUNK_SIZE;
+                                decoder->digits = 0;
+                                decoder->remaining = 0;
+                            } else {
+                                decoder->state = HTTP_CHUNK_ERROR;
+                            }
+
+                            break;
+                        case HTTP_CHUNK_TRAILER:
+                            if (c == '\n') {
+                                if (decoder->line_len == 0) {
+                                    decoder->state = HTTP_CHUNK_DONE;
+                                } else {
+                                    decoder->trailer += c;
+                                    decoder->line_len = 0;
+                                }
+                            } else {
+                                decoder->trailer += c;
+                                decoder->line_len ++;
+
+                                if (decoder->trailer.size() > HTTP_MAX_TRAILER_SIZE) {
+                                    decoder->state = HTTP_CHUNK_ERROR;
+                                }
+                            }
+
+                            break;
+                    }
+                }
+
+                if (decoder->state == HTTP_CHUNK_ERROR) {
+                    *consumed = i > 0 ? i - 1 : 0;
+                    return HTTP_CHUNKED_ERROR;
+                }
+
+                *consumed = i;
+
+                return decoder->state == HTTP_CHUNK_DONE ? HTTP_CHUNKED_DONE : HTTP_CHUNKED_NEED_MORE;
+            }
+
+            /**
+             * 推送式的解析器, 在多次feed之间保存状态, 用于非阻塞的套字节
+             * 一次读取中包含多个消息(pipelining)时会依次解析
+             */
+            typedef struct {
+                int state;
+                http_message_t message; // HTTP_EVENT_HEADERS之后可用, 在下一次feed之前有效
+                std::string head; // 跨多次feed的不完整头部
+                bool head_used; // head中保存的是已经解析过的头部
+                http_limits_t limits;
+                unsigned long long int body_size; // 当前消息已输出的body长度
+                unsigned long long int content_length; // 没有时为0
+                bool chunked;
+                unsigned long long int remaining; // 当前body剩余的长度
+                http_chunked_decoder_t chunk; // chunked的解码状态, 消息结束后trailer可用
+                bool skip_body; // 下一个响应对应HEAD请求, 没有body
+            } http_parser_t;
+
+            /**
+             * 推送式解析的事件
+             */
+            typedef struct {
+                int type; // HTTP_EVENT_*
+                http_string_view_t data; // HTTP_EVENT_BODY的数据, 指向feed的输入
+            } http_event_t;
+
+            /**
+             * 初始化解析器
+             * @param parser   http_parser_t
+             */
+            void http_parser_init(http_parser_t* parser) {
+                parser->state = HTTP_STATE_HEAD;
+                parser->head.clear();
+                parser->head_used = false;
+                http_limits_init(&parser->limits);
+                parser->body_size = 0;
+                parser->content_length = 0;
+                parser->chunked = false;
+                parser->remaining = 0;
+                http_chunked_init(&parser->chunk);
+                parser->skip_body = false;
+                parser->message.num_headers = 0;
+            }
+
+            /**
+             * 标记下一个响应对应HEAD请求(或者其它没有body的请求)
+             * @param parser http_parser_t
+             */
+            void http_parser_skip_body(http_parser_t* parser) {
+                parser->skip_body = true;
+            }
+
+            /** 根据头部决定body的读取方式 */
+            int __http_parser_body_state(http_parser_t* parser) {
+                http_message_t* msg = &parser->message;
+                const http_string_view_t* transfer_encoding = http_message_header(msg, "Transfer-Encoding");
+                const http_string_view_t* content_length = http_message_header(msg, "Content-Length");
+
+                parser->chunked = false;
+                parser->content_length = 0;
+                parser->body_size = 0;
+
+                if (msg->type == HTTP_MESSAGE_RESPONSE) {
+                    bool skip = parser->skip_body;
+                    bool interim = msg->status >= 100 && msg->status < 200;
+
+                    // 临时响应之后还有同一个请求的最终响应
+                    if (!interim) {
+                        parser->skip_body = false;
+                    }
+
+                    // 1xx, 204, 304与HEAD请求的响应没有body(RFC 7230 3.3.3)
+                    if (skip || interim || msg->status == 204 || msg->status == 304) {
+                        return HTTP_STATE_COMPLETE;
+                    }
+                }
+
+                if (transfer_encoding != NULL) {
+                    if (http_is_chunked(transfer_encoding)) {
+                        parser->chunked = true;
+                        http_chunked_init(&parser->chunk);
+                        return HTTP_STATE_CHUNKED;
+                    }
+
+                    // 请求的最后一个编码不是chunked时无法确定长度
+                    return msg->type == HTTP_MESSAGE_REQUEST ? HTTP_STATE_ERROR : HTTP_STATE_BODY_EOF;
+                }
+
+                if (content_length != NULL) {
+                    if (!http_parse_content_length(content_length, &parser->content_length) || !http_check_body(parser->content_length, &parser->limits)) {
+                        return HTTP_STATE_ERROR;
+                    }
+
+                    parser->remaining = parser->content_length;
+
+                    return parser->remaining > 0 ? HTTP_STATE_BODY : HTTP_STATE_COMPLETE;
+                }
+
+                return msg->type == HTTP_MESSAGE_REQUEST ? HTTP_STATE_COMPLETE : HTTP_STATE_BODY_EOF;
+            }
+
+            /** 解析头部, 尽量直接在输入上解析, 不完整时才拷贝到head中 */
+            size_t __http_parser_head(http_parser_t* parser, const char* buf, size_t len, http_event_t* event) {
+                if (parser->head_used) {
+                    parser->head.clear();
+                    parser->head_used = false;
+                }
+
+                int ret;
+                size_t consumed;
+
+                if (parser->head.empty()) {
+                    ret = http_parse_head(buf, len, &parser->message, 0);
+                    consumed = ret > 0 ? ret : len;
+
+                    if (ret == HTTP_PARSE_INCOMPLETE) {
+                        parser->head.assign(buf, len);
+                    }
+                } else {
+                    size_t last_len = parser->head.size();
+                    parser->head.append(buf, len);
+                    ret = http_parse_head(parser->head.data(), parser->head.size(), &parser->message, last_len);
+                    consumed = ret > 0 ? ret - last_len : len;
+
+                    if (ret > 0) {
+                        // 多拷贝的部分属于body, 不影响头部片段的地址
+                        parser->head.resize(ret);
+                        parser->head_used = true;
+                    }
+                }
+
+                if (ret == HTTP_PARSE_INCOMPLETE) {
+                    if (!http_check_partial_head(parser->head.data(), parser->head.size(), &parser->limits)) {
+                        parser->state = HTTP_STATE_ERROR;
+                        event->type = HTTP_EVENT_ERROR;
+                    } else {
+                        event->type = HTTP_EVENT_NEED_MORE;
+                    }
+
+                    return consumed;
+                }
+
+                if (ret == HTTP_PARSE_ERROR || !http_check_head(&parser->message, ret, &parser->limits)) {
+                    parser->state = HTTP_STATE_ERROR;
+                    event->type = HTTP_EVENT_ERROR;
+                    return 0;
+                }
+
+                parser->state = __http_parser_body_state(parser);
+                event->type = parser->state == HTTP_STATE_ERROR ? HTTP_EVENT_ERROR : HTTP_EVENT_HEADERS;
+
+                return consumed;
+            }
+
+            /** 输出一段body */
+            size_t __http_parser_body(http_parser_t* parser, const char* buf, size_t len, http_event_t* event) {
+                size_t size = parser->remaining < len ? parser->remaining : len;
+
+                event->type = HTTP_EVENT_BODY;
+                event->data.data = buf;
+                event->data.len = size;
+                parser->remaining -= size;
+
+                if (parser->remaining == 0) {
+                    parser->state = HTTP_STATE_COMPLETE;
+                }
+
+                return size;
+            }
+
+            /** 统计长度不确定的body, 超过限制时进入错误状态 */
+            void __http_parser_count(http_parser_t* parser, http_event_t* event) {
+                parser->body_size += event->data.len;
+
+                if (!http_check_body(parser->body_size, &parser->limits)) {
+                    parser->state = HTTP_STATE_ERROR;
+                    event->type = HTTP_EVENT_ERROR;
+                    event->data.data = NULL;
+                    event->data.len = 0;
+                }
+            }
+
+            /**
+             * 输入数据并获取下一个事件, 每次调用最多产生一个事件
+             * 调用方应当循环调用直到返回HTTP_EVENT_NEED_MORE或者HTTP_EVENT_ERROR, 每次跳过已处理的长度
+             * @param  parser http_parser_t
+             * @param  buf    收到的数据
+             * @param  len    数据长度
+             * @param  event  产生的事件
+             * @return        已处理的长度
+             */
+            size_t http_parser_feed(http_parser_t* parser, const char* buf, size_t len, http_event_t* event) {
+                size_t offset = 0;
+
+                event->data.data = NULL;
+                event->data.len = 0;
+
+                while (true) {
+                    switch (parser->state) {
+                        case HTTP_STATE_COMPLETE:
+                            parser->state = HTTP_STATE_HEAD;
+                            event->type = HTTP_EVENT_COMPLETE;
+                            return offset;
+                        case HTTP_STATE_ERROR:
+                            event->type = HTTP_EVENT_ERROR;
+                            return offset;
+                        default:
+                            break;
+                    }
+
+                    if (offset == len) {
+                        event->type = HTTP_EVENT_NEED_MORE;
+                        return offset;
+                    }
+
+                    switch (parser->state) {
+                        case HTTP_STATE_HEAD:
+                            return offset + __http_parser_head(parser, buf + offset, len - offset, event);
+                        case HTTP_STATE_BODY:
+                            return offset + __http_parser_body(parser, buf + offset, len - offset, event);
+                        case HTTP_STATE_BODY_EOF:
+                            event->type = HTTP_EVENT_BODY;
+                            event->data.data = buf + offset;
+                            event->data.len = len - offset;
+                            __http_parser_count(parser, event);
+                            return len;
+                        default: {
+                            size_t consumed;
+                            int ret = http_chunked_decode(&parser->chunk, buf + offset, len - offset, &consumed, &event->data);
+                            offset += consumed;
+
+                            if (ret == HTTP_CHUNKED_DATA) {
+                                event->type = HTTP_EVENT_BODY;
+                                __http_parser_count(parser, event);
+                                return offset;
+                            }
+
+                            // chunk的长度行与结束符不产生事件, 继续处理之后的数据
+                            if (ret == HTTP_CHUNKED_DONE) {
+                                parser->state = HTTP_STATE_COMPLETE;
+                            } else if (ret == HTTP_CHUNKED_ERROR) {
+                                parser->state = HTTP_STATE_ERROR;
+                            }
+
+                            break;
+                        }
+                    }
+                }
+            }
+
+            /**
+             * 连接关闭时调用, 以关闭连接结束的body会在这里完成
+             * @param  parser http_parser_t
+             * @param  event  HTTP_EVENT_COMPLETE/HTTP_EVENT_NEED_MORE(没有未完成的消息)/HTTP_EVENT_ERROR
+             */
+            void http_parser_eof(http_parser_t* parser, http_event_t* event) {
+                event->data.data = NULL;
+                event->data.len = 0;
+
+                if (parser->state == HTTP_STATE_BODY_EOF || parser->state == HTTP_STATE_COMPLETE) {
+                    parser->state = HTTP_STATE_HEAD;
+                    event->type = HTTP_EVENT_COMPLETE;
+                } else if (parser->state == HTTP_STATE_HEAD && (parser->head.empty() || parser->head_used)) {
+                    event->type = HTTP_EVENT_NEED_MORE;
+                } else {
+                    parser->state = HTTP_STATE_ERROR;
+                    event->type = HTTP_EVENT_ERROR;
+                }
+            }
+        }
+    }
+}
+
+#endif
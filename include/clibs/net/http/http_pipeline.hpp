@@ -0,0 +1,592 @@
+#ifndef _CLIBS_HTTP_PIPELINE_H_
+#define _CLIBS_HTTP_PIPELINE_H_ 1
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <poll.h>
+#include "clibs/net/socket.hpp"
+#include "clibs/net/sslsocket.hpp"
+#include "clibs/net/connector.hpp"
+#include "clibs/net/output_buffer.hpp"
+#include "clibs/net/url.hpp"
+#include "clibs/net/http/http_header.hpp"
+#include "clibs/net/http/http_parser.hpp"
+#include "clibs/net/http/http_reader.hpp"
+#include "clibs/net/http/http_pool.hpp"
+
+#define HTTP_PIPELINE_DEPTH 16 // 单个连接上默认最多等待响应的请求数
+#define HTTP_PIPELINE_BUFFER 16384 // 单次读取的长度
+#define HTTP_PIPELINE_MAX_FAILURES 3 // 连续多少个连接没有任何响应后放弃
+
+#define HTTP_PIPELINE_OK 0 // 收到了完整的响应
+#define HTTP_PIPELINE_PENDING 1 // 还没有执行
+#define HTTP_PIPELINE_CONNECT -1 // 无法建立连接
+#define HTTP_PIPELINE_CLOSED -2 // 连接在响应之前关闭, 请求不能安全地重发
+#define HTTP_PIPELINE_PARSE -3 // 响应不合法或超过限制
+#define HTTP_PIPELINE_TIMEOUT -4 // 读取或发送超时
+
+#define __HTTP_PIPELINE_MORE 0 // 连接还可以继续使用
+#define __HTTP_PIPELINE_EOF 1 // 连接已经关闭或者不能继续使用
+
+namespace clibs {
+    namespace net {
+        namespace http {
+            /**
+             * pipelining中的单个请求
+             */
+            typedef struct {
+                std::string method;
+                std::string target; // 路径与查询参数
+                CHttpHeader headers;
+                std::string body;
+            } http_pipeline_request_t;
+
+            /**
+             * 在同一个keep-alive连接上连续发送多个请求, 按顺序匹配响应(HTTP/1.1 pipelining)
+             * 同一批请求只需要约 请求数/深度 个往返, 而不是每个请求一个往返
+             * 连接提前关闭时自动重连并重发还没有响应的幂等请求, 对方不响应Connection: close时深度减半
+             */
+            class CHttpPipeline {
+                protected:
+                    url_t m_url;
+                    bool m_is_ssl;
+                    std::string m_key; // 连接池使用的key
+                    std::vector<http_pipeline_request_t> m_requests;
+                    std::vector<http_response_t> m_responses;
+                    std::vector<int> m_results; // 每个请求的结果, HTTP_PIPELINE_*
+                    std::deque<size_t> m_waiting; // 还没有发送的请求
+                    std::deque<size_t> m_inflight; // 已经发送, 等待响应的请求
+                    http_pool_t* m_pool; // 连接池, 为NULL时每次execute使用新连接
+                    http_conn_t* m_conn;
+                    bool m_reused; // 当前连接是否来自连接池的空闲连接
+                    bool m_closing; // 对方在响应中要求关闭连接
+                    size_t m_closing_index; // 带有Connection: close的响应对应的请求
+                    unsigned int m_depth; // 当前的深度
+                    unsigned int m_max_depth; // 设置的深度
+                    unsigned int m_connect_timeout; // 连接超时时间(秒)
+                    unsigned int m_read_timeout; // 读取超时时间(秒)
+                    unsigned int m_connections; // 本次execute使用的连接数
+                    socket_tuning_t m_tuning;
+                    ssl_context_t* m_ssl_context;
+                    http_limits_t m_limits;
+                    output_buffer_t m_output;
+                    http_parser_t m_parser;
+                    std::string m_error;
+
+                public:
+                    CHttpPipeline() {
+                        m_is_ssl = false;
+                        m_pool = NULL;
+                        m_conn = NULL;
+                        m_reused = false;
+                        m_closing = false;
+                        m_closing_index = 0;
+                        m_depth = m_max_depth = HTTP_PIPELINE_DEPTH;
+                        m_connect_timeout = 15;
+                        m_read_timeout = 15;
+                        m_connections = 0;
+                        m_ssl_context = NULL;
+                        socket_tuning_preset(&m_tuning, TUNING_LOW_LATENCY);
+                        http_limits_init(&m_limits);
+                        output_buffer_init(&m_output);
+                    }
+
+                    ~CHttpPipeline() {
+                        __close(false);
+                    }
+
+                    /**
+                     * 设置主机, 之后添加的请求只需要路径
+                     * @param  url scheme://host:port, 路径会被忽略
+                     * @return     true/false
+                     */
+                    bool set_url(const std::string& url) {
+                        if (!url_parse(&m_url, url) || (m_url.protocol != "http" && m_url.protocol != "https")) {
+                            m_error = "Failed to parse URL.";
+                            return false;
+                        }
+
+                        m_is_ssl = m_url.protocol == "https";
+                        m_key = http_pool_key(m_url.protocol, m_url.host, m_url.port);
+
+                        return true;
+                    }
+
+                    /**
+                     * 设置单个连接上最多等待响应的请求数, 1为不使用pipelining
+                     * @param depth 深度
+                     */
+                    void set_depth(unsigned int depth) {
+                        m_max_depth = depth > 0 ? depth : 1;
+                    }
+
+                    /**
+                     * 使用连接池, 执行结束后可以复用的连接归还到连接池
+                     * @param pool http_pool_t
+                     */
+                    void set_pool(http_pool_t* pool) {
+                        m_pool = pool;
+                    }
+
+                    /** 设置连接超时(秒) */
+                    void set_connect_timeout(unsigned int timeout) {
+                        m_connect_timeout = timeout;
+                    }
+
+                    /** 设置读取超时(秒), 超过该时间没有收到任何数据时失败 */
+                    void set_read_timeout(unsigned int timeout) {
+                        m_read_timeout = timeout;
+                    }
+
+                    /** 设置tcp调优参数 */
+                    void set_tuning(const socket_tuning_t* tuning) {
+                        m_tuning = *tuning;
+                    }
+
+                    /** 设置ssl上下文 */
+                    void set_ssl_context(ssl_context_t* context) {
+                        m_ssl_context = context;
+                    }
+
+                    /** 设置对每个响应的限制 */
+                    void set_limits(const http_limits_t* limits) {
+                        m_limits = *limits;
+                    }
+
+                    /**
+                     * 添加请求
+                     * @param  method  请求方法
+                     * @param  target  路径与查询参数
+                     * @param  body    请求body
+                     * @param  headers 请求头, 可以为NULL
+                     * @return         请求的下标
+                     */
+                    size_t add(const std::string& method, const std::string& target, const std::string& body, const CHttpHeader* headers) {
+                        http_pipeline_request_t request;
+
+                        request.method = method;
+                        request.target = target;
+                        request.body = body;
+
+                        if (headers != NULL) {
+                            request.headers = *headers;
+                        }
+
+                        m_requests.push_back(request);
+                        m_responses.push_back(http_response_t());
+                        m_results.push_back(HTTP_PIPELINE_PENDING);
+
+                        return m_requests.size() - 1;
+                    }
+
+                    /** 添加GET请求 */
+                    size_t get(const std::string& target) {
+                        return add("GET", target, "", NULL);
+                    }
+
+                    /** 请求数量 */
+                    size_t size() {
+                        return m_requests.size();
+                    }
+
+                    /** 清空请求与响应, 连接保持不变 */
+                    void clear() {
+                        m_requests.clear();
+                        m_responses.clear();
+                        m_results.clear();
+                    }
+
+                    /** 获取请求的结果, HTTP_PIPELINE_* */
+                    int get_result(size_t index) {
+                        return m_results[index];
+                    }
+
+                    /** 获取请求的响应 */
+                    http_response_t* get_response(size_t index) {
+                        return &m_responses[index];
+                    }
+
+                    /** 最近一次execute使用的连接数 */
+                    unsigned int get_connections() {
+                        return m_connections;
+                    }
+
+                    /** 获取错误描述 */
+                    std::string error() {
+                        return m_error;
+                    }
+
+                    /** 请求是否可以安全地重发 */
+                    bool __replayable(size_t index) {
+                        const std::string& method = m_requests[index].method;
+
+                        return method == "GET" || method == "HEAD" || method == "OPTIONS" || method == "TRACE"
+                            || method == "PUT" || method == "DELETE" || m_requests[index].headers.contains("Idempotency-Key");
+                    }
+
+                    /** 将请求写入输出缓冲区 */
+                    void __write_request(size_t index) {
+                        const http_pipeline_request_t* request = &m_requests[index];
+                        std::string data;
+
+                        data.reserve(128 + request->body.size());
+                        data.append(request->method).append(" ").append(request->target).append(" HTTP/1.1\r\n");
+
+                        if (!request->headers.contains(HTTP_HEADER_HOST)) {
+                            data.append("Host: ").append(m_url.host).append("\r\n");
+                        }
+
+                        request->headers.write(&data);
+
+                        if (!request->body.empty() || request->method == "POST" || request->method == "PUT") {
+                            data.append("Content-Length: ").append(std::to_string(request->body.size())).append("\r\n");
+                        }
+
+                        data.append("\r\n").append(request->body);
+                        output_buffer_append(&m_output, std::move(data));
+                    }
+
+                    /** 下一个响应对应HEAD请求时不读取body */
+                    void __expect_next() {
+                        if (!m_inflight.empty() && m_requests[m_inflight.front()].method == "HEAD") {
+                            http_parser_skip_body(&m_parser);
+                        }
+                    }
+
+                    /** 取得连接, 优先使用连接池中的空闲连接, 之后切换到非阻塞模式 */
+                    bool __open() {
+                        m_reused = false;
+                        m_closing = false;
+
+                        if (m_pool != NULL) {
+                            int ret = http_pool_acquire(m_pool, m_key, &m_conn, m_connect_timeout * 1000);
+
+                            if (ret == HTTP_POOL_REUSED) {
+                                m_reused = true;
+                                return socket_blocking(&m_conn->socket, false);
+                            } else if (ret != HTTP_POOL_NEW) {
+                                m_conn = NULL;
+                                m_error = "No connection available in the pool";
+                                return false;
+                            }
+                        } else {
+                            m_conn = http_conn_new(m_key);
+                        }
+
+                        m_connections ++;
+
+                        if (!socket_connect_dual_stack(&m_conn->socket, m_url.host.c_str(), m_url.port, SOCK_STREAM, m_connect_timeout * 1000, 250, &m_tuning)) {
+                            m_error = "Failed to connect to the server";
+                            return false;
+                        }
+
+                        if (m_is_ssl) {
+                            ssl_socket_t* ssock = &m_conn->ssl_socket;
+
+                            if (!socket_ssl_use_context(ssock, m_ssl_context != NULL ? m_ssl_context : socket_ssl_shared_context())
+                                || !socket_ssl_bind(ssock, &m_conn->socket) || !socket_ssl_set_host(ssock, m_url.host.c_str(), m_url.port)
+                                || !socket_ssl_connect(ssock)) {
+                                m_error = "SSL connection failed";
+                                return false;
+                            }
+                        }
+
+                        return socket_blocking(&m_conn->socket, false);
+                    }
+
+                    /**
+                     * 归还或关闭连接, 连接池中的连接恢复为阻塞模式
+                     * @param reusable 连接上没有未完成的请求与数据
+                     */
+                    void __close(bool reusable) {
+                        if (m_conn == NULL) {
+                            return;
+                        }
+
+                        if (m_conn->socket.sockfd != -1 && !socket_blocking(&m_conn->socket, true)) {
+                            reusable = false;
+                        }
+
+                        if (m_pool != NULL) {
+                            http_pool_release(m_pool, m_conn, reusable);
+                        } else {
+                            __http_conn_close(m_conn);
+                        }
+
+                        m_conn = NULL;
+                        output_buffer_clear(&m_output);
+                    }
+
+                    /**
+                     * 处理收到的数据, 完成的响应按顺序对应m_inflight中的请求
+                     * @return __HTTP_PIPELINE_*或HTTP_PIPELINE_PARSE
+                     */
+                    int __feed(const char* buf, size_t len) {
+                        size_t offset = 0;
+
+                        while (true) {
+                            http_event_t event;
+                            offset += http_parser_feed(&m_parser, buf + offset, len - offset, &event);
+
+                            if (event.type == HTTP_EVENT_NEED_MORE) {
+                                return __HTTP_PIPELINE_MORE;
+                            } else if (event.type == HTTP_EVENT_ERROR || m_inflight.empty()) {
+                                return HTTP_PIPELINE_PARSE;
+                            }
+
+                            http_response_t* response = &m_responses[m_inflight.front()];
+
+                            if (event.type == HTTP_EVENT_HEADERS) {
+                                http_message_t* msg = &m_parser.message;
+
+                                response->status_code = msg->status;
+                                response->status_message = http_view_str(&msg->reason);
+                                response->headers.clear();
+                                response->body.clear();
+
+                                for (size_t i = 0; i < msg->num_headers; i ++) {
+                                    response->headers.append(msg->headers[i].name, msg->headers[i].value);
+                                }
+
+                                // 对方在这个响应之后不会再处理后面的请求
+                                if (msg->status >= 200 && !http_should_keep_alive(msg)) {
+                                    m_closing = true;
+                                    m_closing_index = m_inflight.front();
+                                }
+                            } else if (event.type == HTTP_EVENT_BODY) {
+                                response->body.append(event.data.data, event.data.len);
+                            } else if (event.type == HTTP_EVENT_COMPLETE) {
+                                // 100 Continue等临时响应之后还有最终的响应
+                                if (response->status_code >= 100 && response->status_code < 200 && response->status_code != 101) {
+                                    continue;
+                                }
+
+                                m_results[m_inflight.front()] = HTTP_PIPELINE_OK;
+                                m_inflight.pop_front();
+                                __expect_next();
+
+                                if (m_closing) {
+                                    return __HTTP_PIPELINE_EOF;
+                                }
+                            }
+                        }
+                    }
+
+                    /**
+                     * 发送输出缓冲区中的数据并读取所有可读的数据
+                     * @return __HTTP_PIPELINE_*, HTTP_PIPELINE_PARSE或HTTP_PIPELINE_TIMEOUT
+                     */
+                    int __step() {
+                        bool want_write = false;
+
+                        if (output_buffer_size(&m_output) > 0) {
+                            int ret = m_is_ssl ? output_buffer_flush(&m_output, &m_conn->ssl_socket, &m_conn->socket) : output_buffer_flush(&m_output, &m_conn->socket);
+
+                            if (ret == OUTPUT_ERROR) {
+                                return __HTTP_PIPELINE_EOF;
+                            }
+
+                            want_write = ret == OUTPUT_PENDING;
+                        }
+
+                        char buffer[HTTP_PIPELINE_BUFFER];
+                        bool waited = false;
+
+                        while (true) {
+                            int len;
+
+                            if (m_is_ssl) {
+                                size_t bytes;
+                                int status = socket_ssl_read(&m_conn->ssl_socket, buffer, sizeof(buffer), &bytes);
+
+                                if (status == SSL_STATUS_WANT_READ || status == SSL_STATUS_WANT_WRITE) {
+                                    len = -1;
+                                    want_write = want_write || status == SSL_STATUS_WANT_WRITE;
+                                } else if (status != SSL_STATUS_OK) {
+                                    len = 0;
+                                } else {
+                                    len = bytes;
+                                }
+                            } else {
+                                len = socket_recv(&m_conn->socket, buffer, sizeof(buffer));
+
+                                if (len < 0 && errno == EINTR) {
+                                    continue;
+                                } else if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                                    len = 0;
+                                }
+                            }
+
+                            if (len == 0) {
+                                // 以关闭连接结束的响应
+                                http_event_t event;
+                                http_parser_eof(&m_parser, &event);
+
+                                if (event.type == HTTP_EVENT_COMPLETE && !m_inflight.empty()) {
+                                    m_results[m_inflight.front()] = HTTP_PIPELINE_OK;
+                                    m_inflight.pop_front();
+                                }
+
+                                return __HTTP_PIPELINE_EOF;
+                            } else if (len > 0) {
+                                int ret = __feed(buffer, len);
+
+                                if (ret != __HTTP_PIPELINE_MORE || m_inflight.empty()) {
+                                    return ret;
+                                }
+
+                                continue;
+                            }
+
+                            // 已经读完了可读的数据, 或者第一次等待就有了结果
+                            if (waited) {
+                                return __HTTP_PIPELINE_MORE;
+                            }
+
+                            struct pollfd pfd;
+                            pfd.fd = m_conn->socket.sockfd;
+                            pfd.events = POLLIN | (want_write ? POLLOUT : 0);
+                            pfd.revents = 0;
+
+                            int ret = poll(&pfd, 1, m_read_timeout * 1000);
+
+                            if (ret < 0 && errno == EINTR) {
+                                continue;
+                            } else if (ret == 0) {
+                                return HTTP_PIPELINE_TIMEOUT;
+                            } else if (ret < 0) {
+                                return __HTTP_PIPELINE_EOF;
+                            }
+
+                            if (!(pfd.revents & (POLLIN | POLLERR | POLLHUP))) {
+                                // 只有可写, 回到外层继续发送
+                                return __HTTP_PIPELINE_MORE;
+                            }
+
+                            waited = true;
+                        }
+                    }
+
+                    /** 连接结束时处理还没有响应的请求, 可以重发的请求放回队列的前面 */
+                    void __requeue(bool graceful) {
+                        while (!m_inflight.empty()) {
+                            size_t index = m_inflight.back();
+                            m_inflight.pop_back();
+
+                            // 对方声明关闭连接时不会处理之后的请求, 都可以重发
+                            // 带有声明的响应没有读完时, 对应的请求已经被处理, 只有幂等的请求可以重发
+                            if ((graceful && !(m_closing && index == m_closing_index)) || __replayable(index)) {
+                                m_waiting.push_front(index);
+                            } else {
+                                m_results[index] = HTTP_PIPELINE_CLOSED;
+                            }
+                        }
+                    }
+
+                    /** 将剩余的请求全部标记为失败 */
+                    void __fail(int result) {
+                        __requeue(true);
+
+                        for (std::deque<size_t>::iterator it = m_waiting.begin(); it != m_waiting.end(); it ++) {
+                            m_results[*it] = result;
+                        }
+
+                        m_waiting.clear();
+                    }
+
+                    /**
+                     * 发送所有请求并按顺序读取响应, 结果通过get_result与get_response获取
+                     * @return 所有请求都收到了响应时返回true
+                     */
+                    bool execute() {
+                        unsigned int failures = 0;
+
+                        m_waiting.clear();
+                        m_inflight.clear();
+                        m_depth = m_max_depth;
+                        m_connections = 0;
+                        m_error = "";
+
+                        for (size_t i = 0; i < m_requests.size(); i ++) {
+                            m_results[i] = HTTP_PIPELINE_PENDING;
+                            m_waiting.push_back(i);
+                        }
+
+                        while (!m_waiting.empty()) {
+                            if (!__open()) {
+                                __close(false);
+                                __fail(HTTP_PIPELINE_CONNECT);
+                                return false;
+                            }
+
+                            http_parser_init(&m_parser);
+                            m_parser.limits = m_limits;
+
+                            size_t answered = 0;
+                            int ret = __HTTP_PIPELINE_MORE;
+
+                            while (ret == __HTTP_PIPELINE_MORE && (!m_waiting.empty() || !m_inflight.empty())) {
+                                // 保持发送窗口, 对方要求关闭后不再发送
+                                while (!m_closing && !m_waiting.empty() && m_inflight.size() < m_depth) {
+                                    m_inflight.push_back(m_waiting.front());
+                                    m_waiting.pop_front();
+                                    __write_request(m_inflight.back());
+
+                                    if (m_inflight.size() == 1) {
+                                        __expect_next();
+                                    }
+                                }
+
+                                size_t before = m_inflight.size();
+                                ret = __step();
+                                answered += before - m_inflight.size();
+                            }
+
+                            if (ret == HTTP_PIPELINE_TIMEOUT || ret == HTTP_PIPELINE_PARSE) {
+                                // 连接上的数据已经无法对齐, 当前的请求失败, 之后的请求换新连接
+                                if (!m_inflight.empty()) {
+                                    m_results[m_inflight.front()] = ret;
+                                    m_inflight.pop_front();
+                                }
+
+                                m_error = ret == HTTP_PIPELINE_TIMEOUT ? "Timed out reading the response" : "Invalid response";
+                                __requeue(false);
+                                __close(false);
+                                continue;
+                            }
+
+                            bool reusable = ret == __HTTP_PIPELINE_MORE && !m_closing && m_inflight.empty() && output_buffer_size(&m_output) == 0
+                                && m_parser.state == HTTP_STATE_HEAD && (m_parser.head.empty() || m_parser.head_used);
+
+                            if (!reusable && !m_inflight.empty() && !m_closing && !(m_reused && answered == 0)) {
+                                // 对方没有声明就关闭了连接, 可能不支持pipelining
+                                m_depth = m_depth / 2 > 0 ? m_depth / 2 : 1;
+                            }
+
+                            failures = answered > 0 ? 0 : failures + 1;
+                            __requeue(m_closing);
+                            __close(reusable);
+
+                            if (failures >= HTTP_PIPELINE_MAX_FAILURES) {
+                                m_error = "Connection closed without responses";
+                                __fail(HTTP_PIPELINE_CLOSED);
+                                break;
+                            }
+                        }
+
+                        for (size_t i = 0; i < m_results.size(); i ++) {
+                            if (m_results[i] != HTTP_PIPELINE_OK) {
+                                return false;
+                            }
+                        }
+
+                        return true;
+                    }
+            };
+        }
+    }
+}
+
+#endif
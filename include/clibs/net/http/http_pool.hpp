@@ -0,0 +1,463 @@
+#ifndef _CLIBS_HTTP_POOL_H_
+#define _CLIBS_HTTP_POOL_H_ 1
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include "clibs/net/socket.hpp"
+#include "clibs/net/sslsocket.hpp"
+
+#define HTTP_POOL_MAX_PER_HOST 8 // 每个主机默认最多的连接数
+#define HTTP_POOL_MAX_TOTAL 256 // 默认最多的连接总数
+#define HTTP_POOL_IDLE_TIMEOUT 60000 // 空闲连接默认的超时时间(毫秒)
+
+#define HTTP_POOL_REUSED 1 // 取得了空闲的连接
+#define HTTP_POOL_NEW 0 // 取得了新连接的名额, 需要调用者建立连接
+#define HTTP_POOL_TIMEOUT -1 // 等待名额超时
+#define HTTP_POOL_CLOSED -2 // 连接池已经关闭
+
+namespace clibs {
+    namespace net {
+        namespace http {
+            /**
+             * 连接池中的连接, 使用者在归还之前独占
+             */
+            typedef struct {
+                std::string key; // scheme://host:port
+                socket_t socket;
+                ssl_socket_t ssl_socket; // ssl为NULL时是普通连接
+                unsigned int requests; // 已经完成的请求数
+                std::chrono::steady_clock::time_point last_used; // 上一次归还的时间
+            } http_conn_t;
+
+            /**
+             * 线程安全的keep-alive连接池, 按scheme, host与port区分连接
+             * 连接数同时受每个主机与总数的限制, 包括空闲与正在使用的连接
+             */
+            typedef struct {
+                std::mutex lock;
+                std::condition_variable condition_variable; // 有连接归还或关闭时通知
+                std::unordered_map<std::string, std::vector<http_conn_t*>> idle; // 每个主机的空闲连接, 最近归还的在末尾
+                std::unordered_map<std::string, unsigned int> host_conns; // 每个主机的连接数
+                unsigned int total; // 连接总数
+                unsigned int idle_count; // 空闲连接数
+                unsigned int max_per_host; // 每个主机最多的连接数
+                unsigned int max_total; // 最多的连接总数
+                unsigned int idle_timeout; // 空闲超时(毫秒), 0为不超时
+                unsigned int max_requests; // 每个连接最多的请求数, 0为不限制
+                bool running;
+                std::thread evictor; // 定时关闭超时的空闲连接
+
+                unsigned long long int reused; // 复用连接的次数
+                unsigned long long int created; // 新建连接的次数
+                unsigned long long int stale; // 健康检查发现对方已经关闭的次数
+                unsigned long long int evicted; // 超时关闭的次数
+            } http_pool_t;
+
+            /**
+             * 生成连接池使用的key
+             * @param  scheme http/https
+             * @param  host   主机名
+             * @param  port   端口
+             * @return        key
+             */
+            std::string http_pool_key(const std::string& scheme, const std::string& host, unsigned int port) {
+                return scheme + "://" + host + ":" + std::to_string(port);
+            }
+
+            /**
+             * 创建还未连接的连接, 不使用连接池时由__http_conn_close关闭
+             * @param  key http_pool_key生成的key
+             * @return     http_conn_t
+             */
+            http_conn_t* http_conn_new(const std::string& key) {
+                http_conn_t* conn = new http_conn_t();
+
+                conn->key = key;
+                conn->socket.sockfd = -1;
+                conn->ssl_socket.ssl = NULL;
+                conn->ssl_socket.ctx = NULL;
+                conn->requests = 0;
+
+                return conn;
+            }
+
+            /** 关闭连接并释放内存 */
+            void __http_conn_close(http_conn_t* conn) {
+                if (conn->ssl_socket.ctx != NULL) {
+                    socket_ssl_close(&conn->ssl_socket);
+                }
+
+                if (conn->socket.sockfd != -1) {
+                    socket_shutdown(&conn->socket, SHUT_RDWR);
+                    socket_close(&conn->socket);
+                }
+
+                delete conn;
+            }
+
+            /**
+             * 检查空闲连接是否可用, 空闲的连接上不应该有任何数据
+             * 对方关闭, 出错或收到了多余的数据时返回false, ssl连接上的tls1.3 ticket会被正常处理
+             * @param  conn http_conn_t
+             * @return      true/false
+             */
+            bool http_conn_alive(const http_conn_t* conn) {
+                if (conn->ssl_socket.ssl != NULL) {
+                    if (socket_ssl_pending(&conn->ssl_socket) > 0 || !socket_blocking(&conn->socket, false)) {
+                        return false;
+                    }
+
+                    char c;
+                    size_t bytes = 0;
+                    int status = SSL_peek_ex(conn->ssl_socket.ssl, &c, 1, &bytes) == 1 ? SSL_STATUS_OK : __socket_ssl_status(&conn->ssl_socket, 0);
+
+                    return socket_blocking(&conn->socket, true) && status == SSL_STATUS_WANT_READ;
+                }
+
+                char c;
+                int len = socket_recv(&conn->socket, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+                return len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+            }
+
+            /** 连接被关闭时减少计数, 需要持有锁 */
+            void __http_pool_forget(http_pool_t* pool, http_conn_t* conn) {
+                pool->total --;
+
+                std::unordered_map<std::string, unsigned int>::iterator it = pool->host_conns.find(conn->key);
+
+                if (it != pool->host_conns.end() && -- it->second == 0) {
+                    pool->host_conns.erase(it);
+                }
+            }
+
+            /** 取出所有超时的空闲连接, 需要持有锁 */
+            void __http_pool_expired(http_pool_t* pool, std::vector<http_conn_t*>* expired) {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+                for (std::unordered_map<std::string, std::vector<http_conn_t*>>::iterator it = pool->idle.begin(); it != pool->idle.end();) {
+                    std::vector<http_conn_t*>& list = it->second;
+                    size_t keep = 0;
+
+                    // 越早归还的越靠前
+                    while (keep < list.size() && now - list[keep]->last_used >= std::chrono::milliseconds(pool->idle_timeout)) {
+                        expired->push_back(list[keep]);
+                        __http_pool_forget(pool, list[keep]);
+                        keep ++;
+                    }
+
+                    list.erase(list.begin(), list.begin() + keep);
+                    pool->idle_count -= keep;
+
+                    if (list.empty()) {
+                        it = pool->idle.erase(it);
+                    } else {
+                        it ++;
+                    }
+                }
+            }
+
+            /**
+             * 关闭超时的空闲连接
+             * @param  pool http_pool_t
+             * @return      关闭的连接数
+             */
+            size_t http_pool_evict(http_pool_t* pool) {
+                std::vector<http_conn_t*> expired;
+
+                if (pool->idle_timeout == 0) {
+                    return 0;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(pool->lock);
+                    __http_pool_expired(pool, &expired);
+                    pool->evicted += expired.size();
+                }
+
+                if (!expired.empty()) {
+                    pool->condition_variable.notify_all();
+                }
+
+                // 在锁外关闭, 避免阻塞其它线程
+                for (size_t i = 0; i < expired.size(); i ++) {
+                    __http_conn_close(expired[i]);
+                }
+
+                return expired.size();
+            }
+
+            /**
+             * 初始化连接池, 空闲超时不为0时启动一个线程定时关闭超时的连接
+             * @param pool         http_pool_t
+             * @param max_per_host 每个主机最多的连接数
+             * @param max_total    最多的连接总数
+             * @param idle_timeout 空闲超时(毫秒)
+             */
+            void http_pool_init(http_pool_t* pool, unsigned int max_per_host, unsigned int max_total, unsigned int idle_timeout) {
+                pool->total = 0;
+                pool->idle_count = 0;
+                pool->max_per_host = max_per_host > 0 ? max_per_host : 1;
+                pool->max_total = max_total > 0 ? max_total : 1;
+                pool->idle_timeout = idle_timeout;
+                pool->max_requests = 0;
+                pool->running = true;
+                pool->reused = 0;
+                pool->created = 0;
+                pool->stale = 0;
+                pool->evicted = 0;
+
+                if (idle_timeout == 0) {
+                    return;
+                }
+
+                pool->evictor = std::thread([pool]() {
+                    // 检查的间隔为超时的一半, 连接最多在超时的1.5倍时间后关闭
+                    std::chrono::milliseconds interval(pool->idle_timeout / 2 > 0 ? pool->idle_timeout / 2 : 1);
+
+                    while (true) {
+                        {
+                            std::unique_lock<std::mutex> lock(pool->lock);
+
+                            if (pool->condition_variable.wait_for(lock, interval, [pool]() { return !pool->running; })) {
+                                return;
+                            }
+                        }
+
+                        http_pool_evict(pool);
+                    }
+                });
+            }
+
+            void http_pool_init(http_pool_t* pool) {
+                http_pool_init(pool, HTTP_POOL_MAX_PER_HOST, HTTP_POOL_MAX_TOTAL, HTTP_POOL_IDLE_TIMEOUT);
+            }
+
+            /** 总数已满时关闭其它主机最久未使用的空闲连接, 需要持有锁 */
+            http_conn_t* __http_pool_steal(http_pool_t* pool) {
+                std::unordered_map<std::string, std::vector<http_conn_t*>>::iterator oldest = pool->idle.end();
+
+                for (std::unordered_map<std::string, std::vector<http_conn_t*>>::iterator it = pool->idle.begin(); it != pool->idle.end(); it ++) {
+                    if (oldest == pool->idle.end() || it->second.front()->last_used < oldest->second.front()->last_used) {
+                        oldest = it;
+                    }
+                }
+
+                if (oldest == pool->idle.end()) {
+                    return NULL;
+                }
+
+                http_conn_t* conn = oldest->second.front();
+                oldest->second.erase(oldest->second.begin());
+                pool->idle_count --;
+                __http_pool_forget(pool, conn);
+
+                if (oldest->second.empty()) {
+                    pool->idle.erase(oldest);
+                }
+
+                return conn;
+            }
+
+            /**
+             * 取得一个连接, 优先使用最近归还的空闲连接, 没有时占用一个新连接的名额
+             * 空闲连接在返回前会做健康检查, 已经关闭的连接被丢弃
+             * @param  pool    http_pool_t
+             * @param  key     http_pool_key生成的key
+             * @param  conn    取得的连接, 返回HTTP_POOL_NEW时socket与ssl_socket需要调用者建立
+             * @param  timeout 连接数达到上限时最多等待的时间(毫秒)
+             * @return         HTTP_POOL_*
+             */
+            int http_pool_acquire(http_pool_t* pool, const std::string& key, http_conn_t** conn, unsigned int timeout) {
+                std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+                while (true) {
+                    http_conn_t* idle = NULL;
+                    http_conn_t* victim = NULL;
+
+                    {
+                        std::unique_lock<std::mutex> lock(pool->lock);
+
+                        while (true) {
+                            if (!pool->running) {
+                                return HTTP_POOL_CLOSED;
+                            }
+
+                            std::unordered_map<std::string, std::vector<http_conn_t*>>::iterator it = pool->idle.find(key);
+
+                            if (it != pool->idle.end()) {
+                                idle = it->second.back();
+                                it->second.pop_back();
+                                pool->idle_count --;
+
+                                if (it->second.empty()) {
+                                    pool->idle.erase(it);
+                                }
+
+                                break;
+                            }
+
+                            std::unordered_map<std::string, unsigned int>::iterator count = pool->host_conns.find(key);
+
+                            if (count == pool->host_conns.end() || count->second < pool->max_per_host) {
+                                if (pool->total >= pool->max_total) {
+                                    victim = __http_pool_steal(pool);
+                                }
+
+                                if (pool->total < pool->max_total) {
+                                    pool->total ++;
+                                    pool->host_conns[key] ++;
+                                    pool->created ++;
+                                    break;
+                                }
+                            }
+
+                            if (pool->condition_variable.wait_until(lock, deadline) == std::cv_status::timeout) {
+                                return HTTP_POOL_TIMEOUT;
+                            }
+                        }
+                    }
+
+                    if (victim != NULL) {
+                        __http_conn_close(victim);
+                    }
+
+                    if (idle == NULL) {
+                        *conn = http_conn_new(key);
+                        return HTTP_POOL_NEW;
+                    }
+
+                    // 健康检查在锁外进行
+                    if (http_conn_alive(idle)) {
+                        std::lock_guard<std::mutex> lock(pool->lock);
+                        pool->reused ++;
+                        *conn = idle;
+
+                        return HTTP_POOL_REUSED;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(pool->lock);
+                        pool->stale ++;
+                        __http_pool_forget(pool, idle);
+                    }
+
+                    __http_conn_close(idle);
+                    pool->condition_variable.notify_all();
+                }
+            }
+
+            /**
+             * 归还连接, 不可复用, 超过请求数限制或连接池已经关闭时关闭连接
+             * @param pool     http_pool_t
+             * @param conn     http_conn_t
+             * @param reusable 连接上的响应是否已经完整读取并且可以保持连接
+             */
+            void http_pool_release(http_pool_t* pool, http_conn_t* conn, bool reusable) {
+                bool close = false;
+
+                {
+                    std::lock_guard<std::mutex> lock(pool->lock);
+
+                    conn->requests ++;
+
+                    if (reusable && conn->socket.sockfd != -1 && pool->running && (pool->max_requests == 0 || conn->requests < pool->max_requests)) {
+                        conn->last_used = std::chrono::steady_clock::now();
+                        pool->idle[conn->key].push_back(conn);
+                        pool->idle_count ++;
+                    } else {
+                        __http_pool_forget(pool, conn);
+                        close = true;
+                    }
+                }
+
+                pool->condition_variable.notify_all();
+
+                if (close) {
+                    __http_conn_close(conn);
+                }
+            }
+
+            /**
+             * 关闭连接池与所有空闲连接, 正在使用的连接在归还时关闭
+             * @param pool http_pool_t
+             */
+            void http_pool_shutdown(http_pool_t* pool) {
+                std::vector<http_conn_t*> conns;
+
+                {
+                    std::lock_guard<std::mutex> lock(pool->lock);
+
+                    if (!pool->running) {
+                        return;
+                    }
+
+                    pool->running = false;
+
+                    for (std::unordered_map<std::string, std::vector<http_conn_t*>>::iterator it = pool->idle.begin(); it != pool->idle.end(); it ++) {
+                        for (size_t i = 0; i < it->second.size(); i ++) {
+                            conns.push_back(it->second[i]);
+                            __http_pool_forget(pool, it->second[i]);
+                        }
+                    }
+
+                    pool->idle.clear();
+                    pool->idle_count = 0;
+                }
+
+                pool->condition_variable.notify_all();
+
+                if (pool->evictor.joinable()) {
+                    pool->evictor.join();
+                }
+
+                for (size_t i = 0; i < conns.size(); i ++) {
+                    __http_conn_close(conns[i]);
+                }
+            }
+
+            /** 类形式调用的封装 */
+            class CHttpPool {
+                public:
+                    CHttpPool() {
+                        http_pool_init(&m_pool);
+                    }
+
+                    CHttpPool(unsigned int max_per_host, unsigned int max_total, unsigned int idle_timeout) {
+                        http_pool_init(&m_pool, max_per_host, max_total, idle_timeout);
+                    }
+
+                    ~CHttpPool() {
+                        http_pool_shutdown(&m_pool);
+                    }
+
+                    /** 设置每个连接最多的请求数, 0为不限制 */
+                    void set_max_requests(unsigned int max_requests) {
+                        std::lock_guard<std::mutex> lock(m_pool.lock);
+                        m_pool.max_requests = max_requests;
+                    }
+
+                    /** 关闭超时的空闲连接 */
+                    size_t evict() {
+                        return http_pool_evict(&m_pool);
+                    }
+
+                    /** 获取连接池, 用于CHttpClient::set_pool */
+                    http_pool_t* pool() {
+                        return &m_pool;
+                    }
+
+                protected:
+                    http_pool_t m_pool;
+            };
+        }
+    }
+}
+
+#endif
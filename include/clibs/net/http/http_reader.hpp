@@ -4,16 +4,37 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <cstring>
+#include <functional>
+#include <climits>
+#include <memory>
 #include "clibs/net/socket.hpp"
 #include "clibs/net/sslsocket.hpp"
 #include "clibs/io/select.hpp"
 #include "clibs/net/http/http_header.hpp"
+#include "clibs/net/http/http_parser.hpp"
+
+#define HTTP_READER_BUFFER 16384 // 读取缓冲区的初始大小
+#define HTTP_MAX_RESERVE 268435456 // 按Content-Length预分配的最大长度
 
 namespace clibs {
     namespace net {
         namespace http {
             typedef std::map<std::string, std::vector<std::string>> http_header;
 
+            /** 接收body数据的回调, 返回false时停止读取 */
+            typedef std::function<bool(const char* data, size_t length)> http_body_callback;
+
+            /**
+             * 完整读取的响应, 用于异步请求与pipelining, 出错时包含已经收到的部分
+             */
+            typedef struct {
+                int status_code;
+                std::string status_message;
+                CHttpHeader headers;
+                std::string body;
+            } http_response_t;
+
             /**
              * 读取http包依赖的结构体
              */
@@ -35,7 +56,8 @@ namespace clibs {
 
                 unsigned long long int content_length;
                 bool chunked;
-                unsigned long int chunked_package_size;
+                bool keep_alive; // 消息结束后连接是否可以继续使用
+                http_chunked_decoder_t chunk_decoder; // chunked的解码状态, 读取完成后trailer可用
                 unsigned long long int readed_size;
 
                 socket_t *socket;
@@ -44,6 +66,11 @@ namespace clibs {
                 io::select_result_t *select_result;
 
                 unsigned int read_timeout;
+                http_limits_t limits; // 对头部与body的限制
+
+                std::vector<char> buffer; // 读取缓冲区
+                size_t buffer_start; // 缓冲区中未读数据的起始位置
+                size_t buffer_end; // 缓冲区中未读数据的结束位置
             } http_reader_t;
 
             /**
@@ -56,14 +83,28 @@ namespace clibs {
                 reader->status_code = 0;
                 reader->final = false;
                 reader->chunked = false;
+                reader->keep_alive = false;
                 reader->content_length = 0;
                 reader->readed_size = 0;
-                reader->chunked_package_size = 0;
+                http_chunked_init(&reader->chunk_decoder);
                 reader->socket = sock;
                 reader->ssl_socket = ssl_sock;
                 reader->select = NULL;
                 reader->select_result = NULL;
                 reader->parsed_header = false;
+                reader->buffer.resize(HTTP_READER_BUFFER);
+                reader->buffer_start = 0;
+                reader->buffer_end = 0;
+                http_limits_init(&reader->limits);
+            }
+
+            /**
+             * 设置对头部与body的限制
+             * @param reader http_reader_t
+             * @param limits http_limits_t
+             */
+            void reader_set_limits(http_reader_t* reader, const http_limits_t* limits) {
+                reader->limits = *limits;
             }
 
             /**
@@ -118,30 +159,87 @@ namespace clibs {
                 return true;
             }
 
-            /** 接收一个字符 */
-            int reader_recv(http_reader_t* reader) {
+            /** 直接从套字节接收数据 */
+            int __reader_recv_raw(http_reader_t* reader, char* buffer, int length) {
                 if (!reader_doselect(reader)) {
                     return -1;
                 }
 
                 if (reader->ssl_socket != NULL) {
-                    return socket_ssl_recv(reader->ssl_socket);
+                    int len = socket_ssl_recv(reader->ssl_socket, buffer, length);
+                    __socket_count_recv(reader->socket, len);
+                    return len;
                 } else {
-                    return socket_recv(reader->socket);
+                    return socket_recv(reader->socket, buffer, length);
                 }
             }
 
-            /** 接收数据 */
+            /** 缓冲区中未读数据的长度 */
+            size_t reader_buffered(const http_reader_t* reader) {
+                return reader->buffer_end - reader->buffer_start;
+            }
+
+            /**
+             * 向缓冲区中读入更多数据, 缓冲区满时先移动未读数据, 仍然不足时扩大缓冲区
+             * @param  reader http_reader_t
+             * @param  limit  缓冲区的最大长度
+             * @return        读取到的长度
+             */
+            int __reader_fill(http_reader_t* reader, size_t limit) {
+                if (reader->buffer_start == reader->buffer_end) {
+                    reader->buffer_start = reader->buffer_end = 0;
+                } else if (reader->buffer_end == reader->buffer.size()) {
+                    if (reader->buffer_start > 0) {
+                        memmove(reader->buffer.data(), reader->buffer.data() + reader->buffer_start, reader_buffered(reader));
+                        reader->buffer_end -= reader->buffer_start;
+                        reader->buffer_start = 0;
+                    } else if (reader->buffer.size() < limit) {
+                        reader->buffer.resize(reader->buffer.size() * 2 > limit ? limit : reader->buffer.size() * 2);
+                    } else {
+                        return -1;
+                    }
+                }
+
+                int len = __reader_recv_raw(reader, reader->buffer.data() + reader->buffer_end, reader->buffer.size() - reader->buffer_end);
+
+                if (len > 0) {
+                    reader->buffer_end += len;
+                }
+
+                return len;
+            }
+
+            /** 接收数据, 优先使用缓冲区中的数据 */
             int reader_recv(http_reader_t* reader, char* buffer, int length) {
-                if (!reader_doselect(reader)) {
-                    return -1;
+                if (length <= 0) {
+                    return 0;
                 }
 
-                if (reader->ssl_socket != NULL) {
-                    return socket_ssl_recv(reader->ssl_socket, buffer, length);
-                } else {
-                    return socket_recv(reader->socket, buffer, length);
+                if (reader_buffered(reader) == 0) {
+                    // 大块读取直接写入目标, 避免多一次拷贝
+                    if ((size_t)length >= reader->buffer.size()) {
+                        return __reader_recv_raw(reader, buffer, length);
+                    }
+
+                    int len = __reader_fill(reader, reader->buffer.size());
+
+                    if (len <= 0) {
+                        return len;
+                    }
                 }
+
+                size_t size = reader_buffered(reader) < (size_t)length ? reader_buffered(reader) : length;
+                memcpy(buffer, reader->buffer.data() + reader->buffer_start, size);
+                reader->buffer_start += size;
+
+                return size;
+            }
+
+            /** 接收一个字符 */
+            int reader_recv(http_reader_t* reader) {
+                return __socket_read_char([reader](char* buffer) -> int {
+                    return reader_recv(reader, buffer, 1);
+                });
             }
 
             /** 接收固定长度数据 */
@@ -155,170 +253,213 @@ namespace clibs {
              * 接收单行数据
              * @param  reader 
              * @param  buffer 单行数据的输出
-             * @return        读取到的数据长度
+             * @param  size   缓存长度
+             * @return        读取到的数据长度, 超过缓存长度时返回SOCKET_LINE_TOO_LONG
              */
-            int reader_recvline(http_reader_t* reader, char* buffer) {
-                return __socket_readline(buffer, [reader]() -> int {
+            int reader_recvline(http_reader_t* reader, char* buffer, size_t size) {
+                return __socket_readline(buffer, size, [reader]() -> int {
                     return reader_recv(reader);
                 });
             }
 
             /**
-             * 解析http请求头
+             * 接收单行数据, 不检查缓存长度
+             * @param  reader 
+             * @param  buffer 单行数据的输出
+             * @return        读取到的数据长度
+             */
+            int reader_recvline(http_reader_t* reader, char* buffer) {
+                return reader_recvline(reader, buffer, SIZE_MAX);
+            }
+
+            /**
+             * 取出缓冲区中还未读取的数据, 用于头部之后转为其它协议(如websocket)
+             * @param  reader http_reader_t
+             * @return        未读取的数据
+             */
+            std::string reader_take_buffer(http_reader_t* reader) {
+                std::string data(reader->buffer.data() + reader->buffer_start, reader_buffered(reader));
+                reader->buffer_start = reader->buffer_end = 0;
+
+                return data;
+            }
+
+            /**
+             * 解析http请求头, 数据先读入缓冲区, 再由http_parse_head单次遍历解析
              * @param  reader   
              * @param  pHeaders 用来接收请求头参数的map
              * @return          true/false
              */
             bool reader_parse_header(http_reader_t* reader, CHttpHeader* pHeaders) {
-                std::string strHeader;
-                int nFlags = 0, nChar, nTopLineLength;
-                char strTopLine[200];
+                http_message_t msg;
+                size_t last_len = 0;
+                int header_len;
 
-                // 读取首行
-                nTopLineLength = reader_recvline(reader, strTopLine);
+                while (true) {
+                    size_t len = reader_buffered(reader);
+                    header_len = len > 0 ? http_parse_head(reader->buffer.data() + reader->buffer_start, len, &msg, last_len) : HTTP_PARSE_INCOMPLETE;
 
-                if (nTopLineLength <= 0) {
-                    return false;
-                } else {
-                    strTopLine[nTopLineLength] = '\0';
-                }
+                    if (header_len > 0) {
+                        break;
+                    } else if (header_len == HTTP_PARSE_ERROR || !http_check_partial_head(reader->buffer.data() + reader->buffer_start, len, &reader->limits)) {
+                        return false;
+                    }
 
-                /** 读取完整请求头 */
-                while (nFlags < 4) {
-                    nChar = reader_recv(reader);
+                    last_len = len;
 
-                    if (nChar == -1) {
+                    // 缓冲区最多比头部的限制多一个字节, 用来发现超过限制的头部
+                    if (__reader_fill(reader, reader->limits.max_header_size + 1) <= 0) {
                         return false;
-                    } else {
-                        if (nChar == 10 || nChar == 13) {
-                            nFlags ++;
-                        } else {
-                            nFlags = 0;
-                        }
-
-                        strHeader += (char)nChar;
                     }
                 }
 
-                std::string strFirstLine = strTopLine;
-
-                // 如果是请求数据
-                if (test("^[A-Z]+\\s.+\\sHTTP/1\\.\\d", strFirstLine)) {
-                    CRegexp reg("^([A-Z]+)\\s(.+)\\sHTTP/1\\.\\d");
-                    CMatcher m = reg.matches(strFirstLine);
-                    std::smatch sm = m.result();
-                    reader->url = sm.str(2);
-                    reader->method = sm.str(1);
+                if (!http_check_head(&msg, header_len, &reader->limits)) {
+                    return false;
                 }
-                // 如果是响应数据
-                 else if (test("^HTTP/1\\.\\d\\s\\d+\\s.*", strFirstLine)) {
-                    CRegexp reg("^HTTP/1\\.\\d\\s(\\d+)\\s(.*)");
-                    CMatcher m = reg.matches(strFirstLine);
-                    std::smatch sm = m.result();
-                    reader->status_code = std::atoi(sm.str(1).c_str());
-                    reader->error = sm.str(2);
+
+                if (msg.type == HTTP_MESSAGE_REQUEST) {
+                    reader->method = http_view_str(&msg.method);
+                    reader->url = http_view_str(&msg.path);
                 } else {
-                    return false;
+                    reader->status_code = msg.status;
+                    reader->error = http_view_str(&msg.reason);
                 }
 
-                /**
-                 * 解析请求头中的参数
-                 */
-                CRegexp cReg("([\\w-]+):\\s(.+)");
-                std::string strKey, strValue;
-                CMatcher cMatches = cReg.matches(strHeader);
+                const http_string_view_t* content_length = NULL;
+                const http_string_view_t* transfer_encoding = NULL;
 
-                while (cMatches.find()) {
-                    std::smatch cSmatch = cMatches.result();
+                for (size_t i = 0; i < msg.num_headers; i ++) {
+                    pHeaders->append(msg.headers[i].name, msg.headers[i].value);
 
-                    strKey = cSmatch.str(1);
-                    strValue = cSmatch.str(2);
-                    pHeaders->append(strKey, strValue);
+                    if (http_view_equals(&msg.headers[i].name, "Content-Length")) {
+                        content_length = &msg.headers[i].value;
+                    } else if (http_view_equals(&msg.headers[i].name, "Transfer-Encoding")) {
+                        transfer_encoding = &msg.headers[i].value;
+                    }
                 }
 
                 /**
-                 * 判断body的长度
+                 * 判断body的长度, chunked优先于Content-Length(RFC 7230 3.3.3)
                  */
-                std::string content_length_str = pHeaders->get("Content-Length");
-
-                if (content_length_str != "") {
-                    reader->content_length = std::atol(content_length_str.c_str());
+                if (transfer_encoding != NULL && http_is_chunked(transfer_encoding)) {
+                    reader->chunked = true;
+                    http_chunked_init(&reader->chunk_decoder);
+                } else if (content_length != NULL) {
+                    if (!http_parse_content_length(content_length, &reader->content_length) || !http_check_body(reader->content_length, &reader->limits)) {
+                        return false;
+                    }
 
                     if (reader->content_length == 0) {
                         reader->final = true;
                     }
                 } else {
-                    std::string transfer_encoding = pHeaders->get("Transfer-Encoding");
+                    reader->final = true;
+                }
 
-                    if (transfer_encoding != "" && transfer_encoding == "chunked") {
-                        reader->chunked = true;
-                    } else {
-                        reader->final = true;
-                    }
+                reader->keep_alive = http_should_keep_alive(&msg);
+
+                // 没有长度的响应body以关闭连接结束
+                if (msg.type == HTTP_MESSAGE_RESPONSE && !reader->chunked && content_length == NULL && msg.status >= 200 && msg.status != 204 && msg.status != 304) {
+                    reader->keep_alive = false;
                 }
 
+                reader->buffer_start += header_len;
                 reader->parsed_header = true;
 
                 return true;
             }
 
-            /** 读取http的body内容的封装 */
-            int reader_read(http_reader_t* pReader, char* buffer, int length) {
-                if (pReader->final || !pReader->parsed_header) {
-                    buffer[0] = '\0';
-                    return -1;
-                }
+            /**
+             * 准备读取同一连接上的下一个消息, 保留缓冲区中已经收到的数据, 用于跳过1xx的中间响应
+             * @param reader http_reader_t
+             */
+            void reader_next_message(http_reader_t* reader) {
+                reader->status_code = 0;
+                reader->final = false;
+                reader->chunked = false;
+                reader->keep_alive = false;
+                reader->content_length = 0;
+                reader->readed_size = 0;
+                reader->parsed_header = false;
+                http_chunked_init(&reader->chunk_decoder);
+            }
 
-                int len;
+            /**
+             * 解码缓冲区中的chunked数据, 返回指向缓冲区的chunk数据, 不做拷贝
+             * @param  reader http_reader_t
+             * @param  data   chunk数据
+             * @param  max    最多返回的长度
+             * @return        chunk数据的长度, 读取结束时返回0, 出错时返回-1
+             */
+            int __reader_chunk_view(http_reader_t* reader, const char** data, size_t max) {
+                while (true) {
+                    if (reader_buffered(reader) == 0) {
+                        int len = __reader_fill(reader, reader->buffer.size());
 
-                // 如果请求头包含transfer-coding: chuncked
-                if (pReader->chunked) {
-                    // 读取分包的大小
-                    if (pReader->chunked_package_size == 0) {
-                        char strPkgSize[100];
-                        int nHexLen = reader_recvline(pReader, strPkgSize);
-
-                        if (nHexLen <= 0) {
-                            buffer[0] = '\0';
-                            return nHexLen;
-                        } else {
-                            strPkgSize[nHexLen] = '\0';
+                        if (len <= 0) {
+                            reader->final = true;
+                            return -1;
                         }
+                    }
 
-                        // hex to int
-                        std::stringstream strHex;
-                        strHex << std::hex << strPkgSize;
-                        strHex >> pReader->chunked_package_size;
+                    size_t len = reader_buffered(reader) < max ? reader_buffered(reader) : max;
+                    size_t consumed;
+                    http_string_view_t chunk;
+                    int ret = http_chunked_decode(&reader->chunk_decoder, reader->buffer.data() + reader->buffer_start, len, &consumed, &chunk);
 
-                        if (pReader->chunked_package_size == 0) {
-                            pReader->final = true;
+                    reader->buffer_start += consumed;
+
+                    if (ret == HTTP_CHUNKED_DATA) {
+                        reader->readed_size += chunk.len;
+
+                        if (!http_check_body(reader->readed_size, &reader->limits)) {
+                            reader->final = true;
                             return -1;
                         }
+
+                        *data = chunk.data;
+                        return chunk.len;
+                    } else if (ret == HTTP_CHUNKED_DONE) {
+                        reader->final = true;
+                        return 0;
+                    } else if (ret == HTTP_CHUNKED_ERROR) {
+                        reader->final = true;
+                        return -1;
                     }
+                }
+            }
 
-                    // 计算可以读取的数据大小
-                    unsigned long long int read_size = pReader->chunked_package_size > length ? length : pReader->chunked_package_size;
+            /** 读取http的body内容的封装 */
+            int reader_read(http_reader_t* pReader, char* buffer, int length) {
+                if (length <= 0) {
+                    return 0;
+                }
 
-                    len = reader_recv(pReader, buffer, read_size);
+                if (pReader->final || !pReader->parsed_header) {
+                    buffer[0] = '\0';
+                    return -1;
+                }
 
-                    pReader->readed_size += (len > 0 ? len : 0);
+                int len;
 
-                    if (len < 0) {
-                        pReader->final = true;
+                // 如果请求头包含transfer-coding: chuncked
+                if (pReader->chunked) {
+                    const char* data;
+                    len = __reader_chunk_view(pReader, &data, length);
+
+                    if (len <= 0) {
+                        buffer[0] = '\0';
                         return -1;
                     }
 
-                    pReader->chunked_package_size -= (len > 0) ? len : 0;
-
-                    if (pReader->chunked_package_size == 0) { // 如果当前包读取完毕，清除末尾的\r\n
-                        char strTemp[2];
-                        reader_recv_must(pReader, strTemp, 2);
-                    }
+                    memcpy(buffer, data, len);
 
                     return len;
                 } else { // 请求头中有指定content-length
                     if (pReader->readed_size < pReader->content_length) {
-                        len = reader_recv(pReader, buffer, length);
+                        // 不读取超过body的数据, 缓冲区中可能已经有下一个响应
+                        unsigned long long int remain = pReader->content_length - pReader->readed_size;
+                        len = reader_recv(pReader, buffer, remain < (unsigned long long int)length ? remain : length);
 
                         if (len <= 0) {
                             pReader->final = true;
@@ -337,25 +478,165 @@ namespace clibs {
                 return -1;
             }
 
-            /** 读取完整的http_body */
-            std::string reader_full_read(http_reader_t* pReader) {
-                std::string res;
-                char buff[1024];
-                int len;
+            /** 已知Content-Length时直接返回缓冲区中的body数据, 不做拷贝 */
+            int __reader_body_view(http_reader_t* reader, const char** data) {
+                if (reader_buffered(reader) == 0) {
+                    int len = __reader_fill(reader, reader->buffer.size());
 
-                while (!pReader->final) {
-                    memset(buff, 0, 1024);
-                    len = reader_read(pReader, buff, 1024);
+                    if (len <= 0) {
+                        reader->final = true;
+                        return len;
+                    }
+                }
 
-                    if (len == -1) {
-                        break;
-                    } else {
-                        buff[len] = '\0';
+                unsigned long long int remain = reader->content_length - reader->readed_size;
+                size_t size = reader_buffered(reader) < remain ? reader_buffered(reader) : remain;
+
+                *data = reader->buffer.data() + reader->buffer_start;
+                reader->buffer_start += size;
+                reader->readed_size += size;
+
+                if (reader->readed_size >= reader->content_length) {
+                    reader->final = true;
+                }
+
+                return size;
+            }
+
+            /**
+             * body已经完整读取, 缓冲区中没有多余数据, 并且对方允许保持连接时, 连接可以用于下一个请求
+             * @param  reader http_reader_t
+             * @return        true/false
+             */
+            bool reader_reusable(const http_reader_t* reader) {
+                if (!reader->parsed_header || !reader->keep_alive || !reader->final || reader_buffered(reader) > 0) {
+                    return false;
+                }
+
+                return reader->chunked ? reader->chunk_decoder.state == HTTP_CHUNK_DONE : reader->readed_size == reader->content_length;
+            }
+
+            /**
+             * 以流的方式读取body, 每读到一段数据调用一次回调, 内存占用与body大小无关
+             * @param  reader   http_reader_t
+             * @param  callback 接收数据的回调
+             * @return          读取的总长度, 连接出错, body不完整或回调返回false时返回-1
+             */
+            long long int reader_read_to(http_reader_t* reader, const http_body_callback& callback) {
+                if (!reader->parsed_header) {
+                    return -1;
+                }
+
+                long long int total = 0;
+
+                while (!reader->final) {
+                    const char* data;
+                    int len = reader->chunked ? __reader_chunk_view(reader, &data, INT_MAX) : __reader_body_view(reader, &data);
+
+                    if (len <= 0) {
+                        // 只有读到chunked的结束包与trailer才是正常结束
+                        return reader->chunked && reader->chunk_decoder.state == HTTP_CHUNK_DONE ? total : -1;
+                    }
+
+                    if (!callback(data, len)) {
+                        return -1;
                     }
 
-                    res += buff;
+                    total += len;
+                }
+
+                return total;
+            }
+
+            /**
+             * 写入文件描述符的回调
+             * @param  fd 文件描述符
+             * @return    http_body_callback
+             */
+            http_body_callback http_fd_sink(int fd) {
+                return [fd](const char* data, size_t length) -> bool {
+                    while (length > 0) {
+                        ssize_t len = ::write(fd, data, length);
+
+                        if (len < 0 && errno == EINTR) {
+                            continue;
+                        } else if (len <= 0) {
+                            return false;
+                        }
+
+                        data += len;
+                        length -= len;
+                    }
+
+                    return true;
+                };
+            }
+
+            /**
+             * 写入调用者提供的缓存的回调, 数据超过缓存长度时返回false
+             * @param  buffer 缓存
+             * @param  length 缓存长度
+             * @return        http_body_callback
+             */
+            http_body_callback http_buffer_sink(char* buffer, size_t length) {
+                std::shared_ptr<size_t> offset = std::make_shared<size_t>(0);
+
+                return [buffer, length, offset](const char* data, size_t size) -> bool {
+                    if (size > length - *offset) {
+                        return false;
+                    }
+
+                    memcpy(buffer + *offset, data, size);
+                    *offset += size;
+
+                    return true;
+                };
+            }
+
+            /**
+             * 将body写入文件描述符
+             * @param  reader http_reader_t
+             * @param  fd     文件描述符
+             * @return        写入的总长度, 失败返回-1
+             */
+            long long int reader_read_to(http_reader_t* reader, int fd) {
+                return reader_read_to(reader, http_fd_sink(fd));
+            }
+
+            /**
+             * 将body读入调用者提供的缓存
+             * @param  reader http_reader_t
+             * @param  buffer 缓存
+             * @param  length 缓存长度
+             * @return        读取的总长度, body超过缓存长度时返回-1
+             */
+            long long int reader_read_to(http_reader_t* reader, char* buffer, size_t length) {
+                return reader_read_to(reader, http_buffer_sink(buffer, length));
+            }
+
+            /**
+             * body的长度
+             * @param  reader http_reader_t
+             * @return        Content-Length, chunked时返回-1
+             */
+            long long int reader_content_length(const http_reader_t* reader) {
+                return reader->chunked ? -1 : reader->content_length;
+            }
+
+            /** 读取完整的http_body, 已知长度时只分配一次内存 */
+            std::string reader_full_read(http_reader_t* pReader) {
+                std::string res;
+
+                if (!pReader->chunked && pReader->content_length > pReader->readed_size) {
+                    unsigned long long int remain = pReader->content_length - pReader->readed_size;
+                    res.reserve(remain < HTTP_MAX_RESERVE ? remain : HTTP_MAX_RESERVE);
                 }
 
+                reader_read_to(pReader, [&res](const char* data, size_t length) -> bool {
+                    res.append(data, length);
+                    return true;
+                });
+
                 return res;
             }
 
@@ -366,11 +647,22 @@ namespace clibs {
                 });
             }
 
-            /** 从body中读取一行 */
-            int reader_readline(http_reader_t* reader, char* buffer) {
-                return __socket_readline(buffer, [reader]() -> int {
+            /**
+             * 从body中读取一行
+             * @param  reader http_reader_t
+             * @param  buffer 单行数据的输出
+             * @param  size   缓存长度
+             * @return        读取到的数据长度, 超过缓存长度时返回SOCKET_LINE_TOO_LONG
+             */
+            int reader_readline(http_reader_t* reader, char* buffer, size_t size) {
+                return __socket_readline(buffer, size, [reader]() -> int {
                     return reader_read(reader);
-                });  
+                });
+            }
+
+            /** 从body中读取一行, 不检查缓存长度 */
+            int reader_readline(http_reader_t* reader, char* buffer) {
+                return reader_readline(reader, buffer, SIZE_MAX);
             }
 
             /** 从body中读取固定长度数据 */
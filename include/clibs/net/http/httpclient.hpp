@@ -4,24 +4,57 @@
 #include <iostream>
 #include <map>
 #include <sstream>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include "clibs/net/sslsocket.hpp"
+#include "clibs/net/connector.hpp"
+#include "clibs/net/output_buffer.hpp"
 #include "clibs/net/url.hpp"
 #include "clibs/io/select.hpp"
 #include "clibs/error.hpp"
 #include "clibs/net/http/http_header.hpp"
 #include "clibs/net/http/http_reader.hpp"
+#include "clibs/net/http/http_encoding.hpp"
+#include "clibs/net/http/http_pool.hpp"
+
+#define HTTP_BODY_CHUNK 65536 // 流式发送body时每次读取的长度
 
 namespace clibs {
     namespace net {
         namespace http {
+            /** 提供请求body的回调, 返回读取的长度, 结束时返回0, 出错时返回-1 */
+            typedef std::function<long long int(char* buffer, size_t size)> http_body_source;
+
+            /**
+             * 从文件描述符读取body的回调, 用于管道等不能sendfile的描述符
+             * @param  fd 文件描述符
+             * @return    http_body_source
+             */
+            http_body_source http_fd_source(int fd) {
+                return [fd](char* buffer, size_t size) -> long long int {
+                    while (true) {
+                        ssize_t len = ::read(fd, buffer, size);
+
+                        if (len < 0 && errno == EINTR) {
+                            continue;
+                        }
+
+                        return len;
+                    }
+                };
+            }
+
             /**
              * http客户端封装
+             * 需要链接-lssl -lcrypto -lz, 响应的解压见http_encoding.hpp
              */
             class CHttpClient {
                 protected:
                     url_t m_url; // url信息
                     socket_t m_socket; // socket信息
                     ssl_socket_t m_ssl_socket; // ssl_socket信息
+                    ssl_context_t* m_ssl_context; // 共享的ssl上下文与会话缓存
+                    bool m_ktls; // 是否尝试启用内核tls
                     io::select_t m_select; // select信息
                     io::select_result_t m_select_result; // select结果保存目标
                     http_reader_t m_reader; // http读取器
@@ -31,6 +64,25 @@ namespace clibs {
                     CHttpHeader m_headers; // 请求头信息
                     unsigned int m_connect_timeout; // 连接超时时间
                     unsigned int m_read_timeout; // 读取超时时间
+                    socket_tuning_t m_tuning; // 连接时应用的tcp调优参数
+                    output_buffer_t m_output; // 待发送的数据
+                    http_limits_t m_limits; // 对响应头与body的限制
+                    bool m_accept_encoding; // 是否请求压缩的响应并自动解码
+                    http_decoder_t m_decoder; // 响应body的解码器
+                    bool m_decoding; // 响应body是否需要解码
+                    std::string m_body; // set_body设置的请求body
+                    int m_body_encoding; // 请求body的编码, 没有body时为HTTP_ENCODING_UNSUPPORTED
+                    http_body_source m_source; // 流式发送的请求body
+                    int m_body_fd; // 通过sendfile发送的请求body, 没有时为-1
+                    off_t m_body_offset; // body在文件中的起始位置
+                    bool m_body_fd_owned; // 文件由set_body_file打开, close时关闭
+                    long long int m_body_length; // 流式body的长度, 为-1时使用chunked发送
+                    bool m_expect_continue; // 是否发送Expect: 100-continue并等待服务端确认
+                    unsigned int m_expect_timeout; // 等待100 Continue的时间, 超时后直接发送body
+                    http_pool_t* m_pool; // 连接池, 为NULL时不复用连接
+                    http_conn_t* m_conn; // 从连接池取得的连接
+                    bool m_reused; // 当前连接是否为连接池中的空闲连接
+                    bool m_streamed; // 是否已经通过send发送了数据, 之后不能自动重发请求
                     std::string m_error;
                     bool m_closed;
                 public:
@@ -41,9 +93,28 @@ namespace clibs {
                         m_socket.sockfd = -1;
                         m_ssl_socket.ssl = NULL;
                         m_ssl_socket.ctx = NULL;
+                        m_ssl_context = NULL;
+                        m_ktls = false;
                         m_connect_timeout = 15;
                         m_read_timeout = 15;
                         m_closed = false;
+                        m_accept_encoding = false;
+                        http_limits_init(&m_limits);
+                        m_decoding = false;
+                        m_body_encoding = HTTP_ENCODING_UNSUPPORTED;
+                        m_body_fd = -1;
+                        m_body_offset = 0;
+                        m_body_fd_owned = false;
+                        m_body_length = -1;
+                        m_expect_continue = false;
+                        m_expect_timeout = 1;
+                        m_pool = NULL;
+                        m_conn = NULL;
+                        m_reused = false;
+                        m_streamed = false;
+                        reader_init(&m_reader, &m_socket, NULL);
+                        socket_tuning_preset(&m_tuning, TUNING_LOW_LATENCY);
+                        output_buffer_init(&m_output);
                         io::select_init(&m_select);
                     }
 
@@ -85,7 +156,7 @@ namespace clibs {
 
                     /** 添加多个请求头 */
                     void add_headers(CHttpHeader* headers) {
-                        m_headers = CHttpHeader(headers->data());
+                        m_headers = *headers;
                     }
 
                     /**
@@ -104,6 +175,181 @@ namespace clibs {
                         m_read_timeout = timeout;
                     }
 
+                    /**
+                     * 设置tcp调优参数, 默认使用TUNING_LOW_LATENCY
+                     * @param tuning socket_tuning_t
+                     */
+                    void set_tuning(const socket_tuning_t* tuning) {
+                        m_tuning = *tuning;
+                    }
+
+                    /**
+                     * 使用预设的tcp调优参数
+                     * @param preset TUNING_*
+                     */
+                    void set_tuning(int preset) {
+                        socket_tuning_preset(&m_tuning, preset);
+                    }
+
+                    /**
+                     * 设置ssl上下文, 默认使用进程内共享的上下文, 同一主机的连接可以恢复会话
+                     * @param context ssl_context_t
+                     */
+                    void set_ssl_context(ssl_context_t* context) {
+                        m_ssl_context = context;
+                    }
+
+                    /**
+                     * 尝试在握手后启用内核tls, 大量数据下载时减少用户态的加解密与拷贝
+                     * 内核或openssl不支持时自动使用用户态加密
+                     * @param enable true/false
+                     */
+                    void set_ktls(bool enable) {
+                        m_ktls = enable;
+                    }
+
+                    /**
+                     * 设置对响应头与body的限制, 解压后的body同样受max_body_size限制
+                     * @param limits http_limits_t
+                     */
+                    void set_limits(const http_limits_t* limits) {
+                        m_limits = *limits;
+                    }
+
+                    /**
+                     * 发送Accept-Encoding并在读取时自动解压响应body, 支持gzip, deflate与br(需要定义CLIBS_HTTP_BROTLI)
+                     * 只有read系列的函数会解压, 已经添加的Accept-Encoding请求头不会被覆盖
+                     * @param enable true/false
+                     */
+                    void set_accept_encoding(bool enable) {
+                        m_accept_encoding = enable;
+                    }
+
+                    /**
+                     * 设置请求body, 在connect之前调用, 会和请求头一起发送并自动添加Content-Length
+                     * @param  data     body数据
+                     * @param  length   长度
+                     * @param  encoding 压缩body使用的编码, 同时添加Content-Encoding
+                     * @return          压缩失败时返回false
+                     */
+                    bool set_body(const char* data, size_t length, int encoding = HTTP_ENCODING_IDENTITY) {
+                        __clear_body();
+
+                        if (!http_encode(encoding, data, length, &m_body)) {
+                            m_body_encoding = HTTP_ENCODING_UNSUPPORTED;
+                            m_error = "Failed to encode request body";
+                            return false;
+                        }
+
+                        m_body_encoding = encoding;
+
+                        return true;
+                    }
+
+                    /**
+                     * 设置流式发送的请求body, 在connect之前调用, body在get_response时边读取边发送
+                     * 回调中的数据不能重发, 复用的连接失效时不会自动重试
+                     * @param source 提供body的回调
+                     * @param length body长度, 为-1时使用Transfer-Encoding: chunked
+                     */
+                    void set_body_source(const http_body_source& source, long long int length = -1) {
+                        __clear_body();
+                        m_source = source;
+                        m_body_length = length;
+                    }
+
+                #ifndef _WIN32
+                    /**
+                     * 从文件描述符发送请求body, 普通文件从当前位置开始通过sendfile发送, 其它描述符读取后chunked发送
+                     * 不改变文件的读写位置, 描述符由调用者关闭
+                     * @param  fd     文件描述符
+                     * @param  length body长度, 为-1时普通文件发送到文件末尾
+                     * @return        true/false
+                     */
+                    bool set_body_fd(int fd, long long int length = -1) {
+                        struct stat st;
+
+                        __clear_body();
+
+                        if (fstat(fd, &st) != 0) {
+                            m_error = "Failed to stat request body";
+                            return false;
+                        }
+
+                        if (!S_ISREG(st.st_mode)) {
+                            m_source = http_fd_source(fd);
+                            m_body_length = length;
+                            return true;
+                        }
+
+                        off_t offset = lseek(fd, 0, SEEK_CUR);
+
+                        m_body_fd = fd;
+                        m_body_offset = offset > 0 ? offset : 0;
+                        m_body_length = length >= 0 ? length : (st.st_size > m_body_offset ? st.st_size - m_body_offset : 0);
+
+                        return true;
+                    }
+
+                    /**
+                     * 通过sendfile发送文件作为请求body, 文件在close时关闭
+                     * @param  path 文件路径
+                     * @return      true/false
+                     */
+                    bool set_body_file(const std::string& path) {
+                        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+                        if (fd < 0) {
+                            __clear_body();
+                            m_error = "Failed to open " + path;
+                            return false;
+                        }
+
+                        if (!set_body_fd(fd)) {
+                            ::close(fd);
+                            return false;
+                        }
+
+                        m_body_fd_owned = true;
+
+                        return true;
+                    }
+                #endif
+
+                    /**
+                     * 发送Expect: 100-continue, 收到100 Continue后才发送body
+                     * 服务端直接返回最终响应时不发送body, 连接不再复用; 超时没有响应时直接发送body
+                     * @param enable  true/false
+                     * @param timeout 等待100 Continue的时间(秒)
+                     */
+                    void set_expect_continue(bool enable, unsigned int timeout = 1) {
+                        m_expect_continue = enable;
+                        m_expect_timeout = timeout;
+                    }
+
+                    /**
+                     * 使用连接池, 同一scheme, host与port的请求复用keep-alive连接
+                     * close时响应已经完整读取的连接归还到连接池, 否则关闭
+                     * 复用的连接在收到响应之前被对方关闭时, 幂等的请求会自动使用新连接重发
+                     * @param pool http_pool_t, 需要比httpclient先创建后关闭
+                     */
+                    void set_pool(http_pool_t* pool) {
+                        m_pool = pool;
+                    }
+
+                    /** 当前请求是否复用了连接池中的连接 */
+                    bool connection_reused() {
+                        return m_reused;
+                    }
+
+                    /**
+                     * 本次连接是否恢复了之前的ssl会话
+                     * @return true/false
+                     */
+                    bool ssl_session_reused() {
+                        return m_is_ssl && m_ssl_socket.ssl != NULL && socket_ssl_session_reused(&m_ssl_socket);
+                    }
+
                     /**
                      * 关闭httpclient
                      */
@@ -112,125 +358,331 @@ namespace clibs {
                             return;
                         }
 
+                        if (m_conn != NULL) {
+                            __release_conn(output_buffer_size(&m_output) == 0 && reader_reusable(&m_reader));
+                        }
+
                         if (m_ssl_socket.ctx != NULL) {
                             socket_ssl_close(&m_ssl_socket);
                         }
 
                         if (m_socket.sockfd != -1) {
+                            // 关闭的描述符留在select中会使下一次请求的select失败
+                            io::select_remove(&m_select, m_socket.sockfd, ST_READ | ST_EXCEPT);
                             socket_shutdown(&m_socket, SHUT_RDWR);
                             socket_close(&m_socket);
                         }
 
+                        output_buffer_clear(&m_output);
+
+                        if (m_decoding) {
+                            http_decoder_free(&m_decoder);
+                            m_decoding = false;
+                        }
+
+                        if (m_body_fd_owned) {
+                            __clear_body();
+                        }
+
                         m_closed = true;
                     }
 
+                    /** 清除之前设置的请求body */
+                    void __clear_body() {
+                        if (m_body_fd_owned) {
+                            ::close(m_body_fd);
+                        }
+
+                        m_body.clear();
+                        m_body_encoding = HTTP_ENCODING_UNSUPPORTED;
+                        m_source = nullptr;
+                        m_body_fd = -1;
+                        m_body_fd_owned = false;
+                        m_body_length = -1;
+                    }
+
+                    /** 是否设置了流式发送的body */
+                    bool __streaming_body() {
+                        return m_body_fd != -1 || m_source;
+                    }
+
                     /**
-                     * 发送请求头
+                     * 将请求头写入输出缓冲区, 与之后的body合并发送
+                     * 流式body与需要等待100 Continue的body在get_response时发送
                      */
                     bool __send_header() {
-                        std::stringstream data;
+                        std::string data;
+
+                        data.reserve(256);
+                        data.append(m_method).append(" ").append(m_url.path).append(m_url.query).append(m_url.hash).append(" HTTP/1.1\r\n");
+                        data.append("Host: ").append(m_url.host).append("\r\n");
+                        m_headers.write(&data);
+
+                        if (m_accept_encoding && !m_headers.contains(HTTP_HEADER_ACCEPT_ENCODING)) {
+                            data.append("Accept-Encoding: ").append(http_accept_encoding()).append("\r\n");
+                        }
+
+                        if (m_body_encoding != HTTP_ENCODING_UNSUPPORTED) {
+                            data.append("Content-Length: ").append(std::to_string(m_body.size())).append("\r\n");
+
+                            if (m_body_encoding != HTTP_ENCODING_IDENTITY) {
+                                data.append("Content-Encoding: ").append(http_encoding_name(m_body_encoding)).append("\r\n");
+                            }
+                        } else if (__streaming_body()) {
+                            if (m_body_length >= 0) {
+                                data.append("Content-Length: ").append(std::to_string(m_body_length)).append("\r\n");
+                            } else {
+                                data.append("Transfer-Encoding: chunked\r\n");
+                            }
+                        }
+
+                        if (__expect_continue()) {
+                            data.append("Expect: 100-continue\r\n");
+                        }
+
+                        data.append("\r\n");
+
+                        output_buffer_append(&m_output, std::move(data));
 
-                        data << m_method << " " << m_url.path << m_url.query << m_url.hash << " HTTP/1.1" << "\r\n";
-                        data << "Host: " << m_url.host << "\r\n";
-                        data << m_headers.str();
-                        data << "\r\n";
+                        if (m_body_encoding != HTTP_ENCODING_UNSUPPORTED && !m_body.empty() && !__expect_continue()) {
+                            output_buffer_append_ref(&m_output, m_body.data(), m_body.size(), NULL);
+                        }
+
+                        return true;
+                    }
 
-                        std::string header_string = data.str();
-                        const char* header = header_string.c_str();
+                    /**
+                     * 发送输出缓冲区中的所有数据
+                     */
+                    bool __flush() {
+                        int ret = m_is_ssl ? output_buffer_flush(&m_output, &m_ssl_socket, &m_socket) : output_buffer_flush(&m_output, &m_socket);
+
+                        if (ret != OUTPUT_FLUSHED) {
+                            output_buffer_clear(&m_output);
+                            m_error = "Failed to send request data";
+                            return false;
+                        }
 
-                        return __send_data(header, strlen(header));
+                        return true;
                     }
 
                     /**
-                     * 循环发送完整数据
+                     * 发送完整数据, 和未发送的请求头一起通过一次writev发出
                      * @param    data       需要发送的数据
                      * @param    length     数据长度
                      */
                     bool __send_data(const char* data, int length) {
-                        int offset = 0, len;
+                        output_buffer_append_ref(&m_output, data, length, NULL);
+
+                        return __flush();
+                    }
+
+                    /** 请求是否需要等待100 Continue, 没有body时不发送Expect */
+                    bool __expect_continue() {
+                        return m_expect_continue && (__streaming_body() || (m_body_encoding != HTTP_ENCODING_UNSUPPORTED && !m_body.empty()));
+                    }
+
+                    /**
+                     * 逐段读取回调中的body并发送, 长度未知时使用chunked编码
+                     */
+                    bool __send_source() {
+                        std::vector<char> buffer(HTTP_BODY_CHUNK);
+                        long long int total = 0;
+
+                        m_streamed = true;
+
+                        while (m_body_length < 0 || total < m_body_length) {
+                            size_t size = m_body_length < 0 || m_body_length - total > (long long int)buffer.size() ? buffer.size() : m_body_length - total;
+                            long long int len = m_source(buffer.data(), size);
 
-                        while (offset < length) {
-                            if (m_is_ssl) {
-                                len = socket_ssl_send(&m_ssl_socket, data + offset, length - offset);
+                            if (len < 0 || (len == 0 && m_body_length >= 0)) {
+                                m_error = len < 0 ? "Failed to read request body" : "Request body is shorter than Content-Length";
+                                return false;
+                            }
+
+                            if (m_body_length < 0) {
+                                char head[20];
+                                int head_len = snprintf(head, sizeof(head), "%llx\r\n", len);
+
+                                output_buffer_append(&m_output, head, head_len);
+                                output_buffer_append_ref(&m_output, buffer.data(), len, NULL);
+                                output_buffer_append(&m_output, "\r\n", 2);
                             } else {
-                                len = socket_send(&m_socket, data + offset, length - offset);
+                                output_buffer_append_ref(&m_output, buffer.data(), len, NULL);
                             }
 
-                            if (len <= 0) {
-                                m_error = "Failed to send request data";
+                            if (!__flush()) {
                                 return false;
                             }
 
-                            offset += len;
+                            // 长度为0的chunk同时是结束标记
+                            if (len == 0) {
+                                break;
+                            }
+
+                            total += len;
                         }
 
                         return true;
                     }
 
                     /**
-                     * 连接服务器并发送请求头
+                     * 发送请求头之后的body, 文件通过sendfile发送
                      */
-                    bool connect() {
-                        if (!socket_set_address(&m_socket, m_url.host.c_str(), m_url.port)) {
-                            m_error = "Unable to get host address";
-                            return false;
+                    bool __send_body() {
+                        if (m_body_encoding != HTTP_ENCODING_UNSUPPORTED) {
+                            return m_body.empty() || __send_data(m_body.data(), m_body.size());
                         }
 
-                        if (!socket_new(m_socket.addr.sin_family, SOCK_STREAM, 0, &m_socket)) {
-                            m_error = "Failed to initialize socket";
-                            return false;
-                        }
+                    #ifndef _WIN32
+                        if (m_body_fd != -1) {
+                            long long int len = m_is_ssl ? socket_ssl_sendfile(&m_ssl_socket, m_body_fd, m_body_offset, m_body_length) : socket_sendfile(&m_socket, m_body_fd, m_body_offset, m_body_length);
 
-                        if (!socket_blocking(&m_socket, false)) {
-                            m_error = "Failed to set socket blocking";
-                            return false;
+                            if (len != m_body_length) {
+                                m_error = "Failed to send request body";
+                                return false;
+                            }
+
+                            return true;
                         }
+                    #endif
 
-                        socket_connect(&m_socket);
+                        return !m_source || __send_source();
+                    }
 
-                        io::select_append(&m_select, m_socket.sockfd, ST_WRITE | ST_EXCEPT);
+                    /**
+                     * 解析响应头, 跳过1xx的中间响应
+                     * @param  expect 是否在100 Continue处停止
+                     */
+                    bool __parse_header(bool expect) {
+                        while (true) {
+                            m_fields.clear();
 
-                        int ret = io::select_wait(&m_select, &m_select_result, m_connect_timeout);
+                            if (!reader_parse_header(&m_reader, &m_fields)) {
+                                return false;
+                            }
 
-                        if (ret <= 0) {
-                            m_error = "Failed to connect to the server";
-                            return false;
+                            if (m_reader.status_code >= 200 || m_reader.status_code == 101 || (expect && m_reader.status_code == 100)) {
+                                return true;
+                            }
+
+                            reader_next_message(&m_reader);
+                        }
+                    }
+
+                    /**
+                     * 将连接交还连接池, 不可复用的连接由连接池关闭
+                     * @param reusable 是否可以复用
+                     */
+                    void __release_conn(bool reusable) {
+                        if (m_socket.sockfd != -1) {
+                            io::select_remove(&m_select, m_socket.sockfd, ST_READ | ST_EXCEPT);
                         }
 
-                        if (io::select_find(&m_select_result.exception, m_socket.sockfd) != m_select_result.exception.end()) {
-                            m_error = "An error occurred while connecting to the server";
+                        m_conn->socket = m_socket;
+                        m_conn->ssl_socket = m_ssl_socket;
+                        http_pool_release(m_pool, m_conn, reusable);
+
+                        m_conn = NULL;
+                        m_socket.sockfd = -1;
+                        m_ssl_socket.ssl = NULL;
+                        m_ssl_socket.ctx = NULL;
+                    }
+
+                    /** 请求是否可以安全地重发, 只有幂等的方法或带有Idempotency-Key的请求 */
+                    bool __replayable() {
+                        return m_method == "GET" || m_method == "HEAD" || m_method == "OPTIONS" || m_method == "TRACE"
+                            || m_method == "PUT" || m_method == "DELETE" || m_headers.contains("Idempotency-Key");
+                    }
+
+                    /**
+                     * 复用的连接在收到任何响应数据之前就被对方关闭时, 认为是对方关闭了空闲连接, 使用新连接重新发送请求
+                     * 读取超时或已经通过send发送了数据时不会重发
+                     */
+                    bool __retry() {
+                        if (m_conn == NULL || !m_reused || m_streamed || m_reader.parsed_header || m_reader.buffer_end > 0 || !__replayable()) {
                             return false;
                         }
 
-                        if (io::select_find(&m_select_result.write, m_socket.sockfd) == m_select_result.write.end()) {
-                            m_error = "Output waiting failed";
+                        char c;
+                        int len = socket_recv(&m_socket, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+                        if (len > 0 || (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) {
                             return false;
                         }
 
-                        io::select_remove(&m_select, m_socket.sockfd, ST_WRITE | ST_EXCEPT);
+                        __release_conn(false);
+                        output_buffer_clear(&m_output);
+                        m_error = "";
+
+                        return connect();
+                    }
 
-                        if (!socket_blocking(&m_socket, true)) {
-                            m_error = "Failed to restore socket blocking";
+                    /** 建立tcp与ssl连接 */
+                    bool __connect() {
+                        if (!socket_connect_dual_stack(&m_socket, m_url.host.c_str(), m_url.port, SOCK_STREAM, m_connect_timeout * 1000, 250, &m_tuning)) {
+                            m_error = "Failed to connect to the server";
                             return false;
                         }
 
                         if (m_is_ssl) {
-                            if (!socket_ssl_new(&m_ssl_socket)) {
+                            if (!socket_ssl_use_context(&m_ssl_socket, m_ssl_context != NULL ? m_ssl_context : socket_ssl_shared_context())) {
                                 m_error = "Failed to initialize SSL";
                                 return false;
                             }
 
-                            if (!socket_ssl_bind(&m_ssl_socket, &m_socket)) {
+                            if (!socket_ssl_bind(&m_ssl_socket, &m_socket) || !socket_ssl_set_host(&m_ssl_socket, m_url.host.c_str(), m_url.port)) {
                                 m_error = "Socket to SSL connection failed";
                                 return false;
                             }
 
+                            if (m_ktls) {
+                                socket_ssl_enable_ktls(&m_ssl_socket);
+                            }
+
                             if (!socket_ssl_connect(&m_ssl_socket)) {
                                 m_error = "SSL connection failed";
                                 return false;
                             }
                         }
-                        
+
+                        return true;
+                    }
+
+                    /**
+                     * 连接服务器并准备请求头, 请求头在send或get_response时发出
+                     * 设置了连接池时优先使用空闲的连接
+                     */
+                    bool connect() {
+                        m_closed = false;
+                        m_reused = false;
+                        m_streamed = false;
+                        reader_init(&m_reader, &m_socket, NULL);
+
+                        if (m_pool != NULL) {
+                            int ret = http_pool_acquire(m_pool, http_pool_key(m_url.protocol, m_url.host, m_url.port), &m_conn, m_connect_timeout * 1000);
+
+                            if (ret == HTTP_POOL_REUSED) {
+                                m_socket = m_conn->socket;
+                                m_ssl_socket = m_conn->ssl_socket;
+                                m_reused = true;
+
+                                return __send_header();
+                            } else if (ret != HTTP_POOL_NEW) {
+                                m_conn = NULL;
+                                m_error = ret == HTTP_POOL_TIMEOUT ? "Timed out waiting for a pooled connection" : "Connection pool is closed";
+                                return false;
+                            }
+                        }
+
+                        if (!__connect()) {
+                            if (m_conn != NULL) {
+                                __release_conn(false);
+                            }
+
+                            return false;
+                        }
+
                         return __send_header();
                     }
 
@@ -239,7 +691,15 @@ namespace clibs {
                      * @param    data       需要发送的数据
                      * @param    length     数据长度                     */
                     bool send(const char* data, int length) {
-                        return __send_data(data, length);
+                        while (!__send_data(data, length)) {
+                            if (!__retry()) {
+                                return false;
+                            }
+                        }
+
+                        m_streamed = true;
+
+                        return true;
                     }
 
                     /**
@@ -247,10 +707,75 @@ namespace clibs {
                      * @return   true/false
                      */
                     bool get_response() {
-                        io::select_append(&m_select, m_socket.sockfd, ST_READ | ST_EXCEPT);
+                        while (!__get_response()) {
+                            if (!__retry()) {
+                                return false;
+                            }
+                        }
+
+                        // HEAD请求的响应没有body
+                        if (m_method == "HEAD") {
+                            m_reader.final = true;
+                            m_reader.chunked = false;
+                            m_reader.content_length = m_reader.readed_size = 0;
+                        }
+
+                        if (m_decoding) {
+                            http_decoder_free(&m_decoder);
+                            m_decoding = false;
+                        }
+
+                        // 不支持的编码保持原样返回
+                        if (m_accept_encoding) {
+                            int encoding = http_encoding_parse(m_fields.get("Content-Encoding"));
+
+                            if (encoding > HTTP_ENCODING_IDENTITY) {
+                                m_decoding = http_decoder_init(&m_decoder, encoding);
+                                m_decoder.max_size = m_limits.max_body_size;
+                            }
+                        }
+
+                        return true;
+                    }
+
+                    /** 发送请求并解析响应头 */
+                    bool __get_response() {
+                        bool expect = __expect_continue();
+
                         reader_init(&m_reader, &m_socket, m_is_ssl ? &m_ssl_socket : NULL);
-                        reader_set_select(&m_reader, &m_select, &m_select_result, m_read_timeout);
-                        return reader_parse_header(&m_reader, &m_fields);
+
+                        if (!__flush()) {
+                            return false;
+                        }
+
+                        io::select_append(&m_select, m_socket.sockfd, ST_READ | ST_EXCEPT);
+                        reader_set_select(&m_reader, &m_select, &m_select_result, expect ? m_expect_timeout : m_read_timeout);
+                        reader_set_limits(&m_reader, &m_limits);
+
+                        // 超时没有收到响应时认为服务端不支持Expect, 直接发送body
+                        if (expect && reader_doselect(&m_reader)) {
+                            m_reader.read_timeout = m_read_timeout;
+
+                            if (!__parse_header(true)) {
+                                return false;
+                            }
+
+                            // 服务端拒绝了请求, body没有发送, 连接上的数据不完整
+                            if (m_reader.status_code != 100) {
+                                m_reader.keep_alive = false;
+                                return true;
+                            }
+
+                            reader_next_message(&m_reader);
+                        }
+
+                        m_reader.read_timeout = m_read_timeout;
+
+                        if ((expect || __streaming_body()) && !__send_body()) {
+                            return false;
+                        }
+
+                        return __parse_header(false);
                     }
 
                     /** 获取响应码 */
@@ -265,7 +790,51 @@ namespace clibs {
 
                     /** 读取全部响应body */
                     std::string read() {
-                        return reader_full_read(&m_reader);
+                        if (!m_decoding) {
+                            return reader_full_read(&m_reader);
+                        }
+
+                        std::string res;
+
+                        read([&res](const char* data, size_t length) -> bool {
+                            res.append(data, length);
+                            return true;
+                        });
+
+                        return res;
+                    }
+
+                    /**
+                     * 以流的方式读取响应body, 适合大文件下载
+                     * @param  callback 接收数据的回调, 返回false时停止读取
+                     * @return          读取的总长度, 失败返回-1
+                     */
+                    long long int read(const http_body_callback& callback) {
+                        return m_decoding ? reader_read_decoded(&m_reader, &m_decoder, callback) : reader_read_to(&m_reader, callback);
+                    }
+
+                    /**
+                     * 将响应body写入文件描述符
+                     * @param  fd 文件描述符
+                     * @return    写入的总长度, 失败返回-1
+                     */
+                    long long int read(int fd) {
+                        return read(http_fd_sink(fd));
+                    }
+
+                    /**
+                     * 将响应body读入提供的缓存, 可以先通过get_content_length确定长度
+                     * @param  buffer 缓存
+                     * @param  length 缓存长度
+                     * @return        读取的总长度, body超过缓存长度时返回-1
+                     */
+                    long long int read(char* buffer, size_t length) {
+                        return read(http_buffer_sink(buffer, length));
+                    }
+
+                    /** 获取响应body的长度, chunked或需要解压时返回-1 */
+                    long long int get_content_length() {
+                        return m_decoding ? -1 : reader_content_length(&m_reader);
                     }
 
                     /** 获取errno */
@@ -275,22 +844,35 @@ namespace clibs {
 
                     /** 获取所有指定响应头信息 */
                     std::vector<std::string> get_fields(std::string name) {
-                        return m_headers.get_fields(name);
+                        return m_fields.get_fields(name);
                     }
 
                     /** 从响应头信息中依据下标获取内容 */
                     std::string get_field(std::string name, int index) {
-                        return m_headers.get(name, index);
+                        return m_fields.get(name, index);
                     }
 
                     /** 获取响应头信息 */
                     std::string get_field(std::string name) {
-                        return m_headers.get(name);
+                        return m_fields.get(name);
                     }
 
                     /** 获取整个响应头 */
                     CHttpHeader* get_response_headers() {
-                        return &m_headers;
+                        return &m_fields;
+                    }
+
+                    /**
+                     * 获取连接的统计信息, 需要定义CLIBS_SOCKET_STATS
+                     * ssl连接统计的是明文数据的长度
+                     */
+                    bool get_socket_stats(socket_stats_t* stats) {
+                        return socket_stats(&m_socket, stats);
+                    }
+
+                    /** 按interval毫秒的间隔采样连接的TCP_INFO(rtt, 重传, 拥塞窗口等), 需要在close之前调用 */
+                    bool get_tcp_info(socket_tcp_info_t* info, unsigned int interval) {
+                        return socket_tcp_info_sample(&m_socket, info, interval);
                     }
 
                     /** 获取错误描述 */
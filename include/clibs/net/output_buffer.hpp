@@ -0,0 +1,334 @@
+#ifndef _CLIBS_OUTPUT_BUFFER_H_
+#define _CLIBS_OUTPUT_BUFFER_H_ 1
+
+#include <iostream>
+#include <deque>
+#include <string>
+#include <functional>
+#include "clibs/net/socket.hpp"
+#include "clibs/net/sslsocket.hpp"
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+#define OUTPUT_FLUSHED 0 // 数据已全部发送
+#define OUTPUT_PENDING 1 // 套字节暂时不可写, 需要等待可写后继续发送
+#define OUTPUT_ERROR -1 // 发送失败
+
+#define OUTPUT_COALESCE_SIZE 16384 // 小于该长度的数据会被拷贝合并到上一段中
+#define OUTPUT_MAX_IOV 64 // 单次writev最多发送的段数
+#define OUTPUT_TLS_RECORD 16384 // tls单个记录的最大明文长度
+
+namespace clibs {
+    namespace net {
+        /** 水位变化的通知, true为超过高水位, false为回落到低水位以下 */
+        typedef std::function<void(bool above)> output_watermark_callback;
+
+        /**
+         * 待发送的数据段, 可以持有数据也可以引用外部数据
+         */
+        typedef struct {
+            std::string owned; // 持有的数据
+            const char* ref; // 引用的外部数据, 为NULL时使用owned
+            size_t length; // 引用数据的长度
+            size_t offset; // 已经发送的长度
+            std::function<void()> release; // 引用数据发送完成后的回调
+        } output_segment_t;
+
+        /**
+         * 连接的输出缓冲区
+         */
+        typedef struct {
+            std::deque<output_segment_t> segments;
+            size_t size; // 未发送的总长度
+            size_t high_watermark; // 高水位, 0为不限制
+            size_t low_watermark; // 低水位
+            bool above; // 是否处于高水位之上
+            size_t tls_retry; // 上一次未完成的SSL_write的长度
+            output_watermark_callback on_watermark;
+        } output_buffer_t;
+
+        /**
+         * 初始化输出缓冲区
+         * @param buf            output_buffer_t
+         * @param high_watermark 高水位, 0为不限制
+         * @param low_watermark  低水位
+         */
+        void output_buffer_init(output_buffer_t* buf, size_t high_watermark, size_t low_watermark) {
+            buf->segments.clear();
+            buf->size = 0;
+            buf->high_watermark = high_watermark;
+            buf->low_watermark = low_watermark;
+            buf->above = false;
+            buf->tls_retry = 0;
+            buf->on_watermark = NULL;
+        }
+
+        void output_buffer_init(output_buffer_t* buf) {
+            output_buffer_init(buf, 0, 0);
+        }
+
+        /** 数据段的起始位置 */
+        const char* __output_segment_data(const output_segment_t* seg) {
+            return (seg->ref != NULL ? seg->ref : seg->owned.data()) + seg->offset;
+        }
+
+        /** 数据段剩余的长度 */
+        size_t __output_segment_size(const output_segment_t* seg) {
+            return (seg->ref != NULL ? seg->length : seg->owned.size()) - seg->offset;
+        }
+
+        /** 检查是否越过水位线 */
+        void __output_buffer_check(output_buffer_t* buf) {
+            if (buf->high_watermark == 0) {
+                return;
+            }
+
+            if (!buf->above && buf->size >= buf->high_watermark) {
+                buf->above = true;
+            } else if (buf->above && buf->size <= buf->low_watermark) {
+                buf->above = false;
+            } else {
+                return;
+            }
+
+            if (buf->on_watermark != NULL) {
+                buf->on_watermark(buf->above);
+            }
+        }
+
+        /** 获取一个可以追加拷贝数据的尾部数据段 */
+        output_segment_t* __output_buffer_tail(output_buffer_t* buf) {
+            if (!buf->segments.empty()) {
+                output_segment_t* tail = &buf->segments.back();
+
+                if (tail->ref == NULL && tail->owned.size() < OUTPUT_COALESCE_SIZE) {
+                    return tail;
+                }
+            }
+
+            output_segment_t seg;
+            seg.ref = NULL;
+            seg.length = 0;
+            seg.offset = 0;
+            seg.release = NULL;
+            buf->segments.push_back(seg);
+
+            return &buf->segments.back();
+        }
+
+        /**
+         * 追加数据, 小数据拷贝合并到上一段中
+         * @param buf    output_buffer_t
+         * @param data   数据
+         * @param length 数据长度
+         */
+        void output_buffer_append(output_buffer_t* buf, const char* data, size_t length) {
+            if (length == 0) {
+                return;
+            }
+
+            __output_buffer_tail(buf)->owned.append(data, length);
+            buf->size += length;
+            __output_buffer_check(buf);
+        }
+
+        /**
+         * 追加数据, 较大的数据直接移入缓冲区, 不做拷贝
+         * @param buf  output_buffer_t
+         * @param data 数据
+         */
+        void output_buffer_append(output_buffer_t* buf, std::string&& data) {
+            if (data.size() < OUTPUT_COALESCE_SIZE) {
+                output_buffer_append(buf, data.data(), data.size());
+                return;
+            }
+
+            output_segment_t seg;
+            seg.owned = std::move(data);
+            seg.ref = NULL;
+            seg.length = 0;
+            seg.offset = 0;
+            seg.release = NULL;
+            buf->size += seg.owned.size();
+            buf->segments.push_back(std::move(seg));
+            __output_buffer_check(buf);
+        }
+
+        /**
+         * 追加外部数据的引用, 数据在发送完成并调用release之前必须保持有效
+         * @param buf     output_buffer_t
+         * @param data    数据
+         * @param length  数据长度
+         * @param release 发送完成或缓冲区清空时的回调, 可以为NULL
+         */
+        void output_buffer_append_ref(output_buffer_t* buf, const char* data, size_t length, std::function<void()> release) {
+            if (length == 0) {
+                if (release != NULL) {
+                    release();
+                }
+
+                return;
+            }
+
+            output_segment_t seg;
+            seg.ref = data;
+            seg.length = length;
+            seg.offset = 0;
+            seg.release = release;
+            buf->size += length;
+            buf->segments.push_back(std::move(seg));
+            __output_buffer_check(buf);
+        }
+
+        /**
+         * 标记已发送的数据
+         * @param buf    output_buffer_t
+         * @param length 已发送的长度
+         */
+        void output_buffer_consume(output_buffer_t* buf, size_t length) {
+            buf->size -= length;
+
+            while (length > 0 && !buf->segments.empty()) {
+                output_segment_t* seg = &buf->segments.front();
+                size_t remain = __output_segment_size(seg);
+
+                if (length < remain) {
+                    seg->offset += length;
+                    break;
+                }
+
+                length -= remain;
+
+                if (seg->release != NULL) {
+                    seg->release();
+                }
+
+                buf->segments.pop_front();
+            }
+
+            __output_buffer_check(buf);
+        }
+
+        /** 未发送的数据长度 */
+        size_t output_buffer_size(const output_buffer_t* buf) {
+            return buf->size;
+        }
+
+        /** 是否已经超过高水位, 生产者应当暂停写入 */
+        bool output_buffer_full(const output_buffer_t* buf) {
+            return buf->above;
+        }
+
+        /** 清空缓冲区 */
+        void output_buffer_clear(output_buffer_t* buf) {
+            output_buffer_consume(buf, buf->size);
+            buf->tls_retry = 0;
+        }
+
+        /**
+         * 使用writev尽可能多地发送数据, 非阻塞套字节返回OUTPUT_PENDING时需要等待可写后再次调用
+         * @param  buf  output_buffer_t
+         * @param  sock socket_t
+         * @return      OUTPUT_FLUSHED/OUTPUT_PENDING/OUTPUT_ERROR
+         */
+        int output_buffer_flush(output_buffer_t* buf, const socket_t* sock) {
+            while (buf->size > 0) {
+    #ifdef _WIN32
+                output_segment_t* seg = &buf->segments.front();
+                int len = socket_send(sock, __output_segment_data(seg), __output_segment_size(seg));
+    #else
+                struct iovec iov[OUTPUT_MAX_IOV];
+                int count = 0;
+                size_t total = 0;
+
+                for (std::deque<output_segment_t>::iterator it = buf->segments.begin(); it != buf->segments.end() && count < OUTPUT_MAX_IOV; it ++, count ++) {
+                    iov[count].iov_base = (void*)__output_segment_data(&(*it));
+                    iov[count].iov_len = __output_segment_size(&(*it));
+                    total += iov[count].iov_len;
+                }
+
+                int len = writev(sock->sockfd, iov, count);
+                __socket_count_send(sock, len, total);
+    #endif
+
+                if (len < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    return (errno == EAGAIN || errno == EWOULDBLOCK) ? OUTPUT_PENDING : OUTPUT_ERROR;
+                } else if (len == 0) {
+                    return OUTPUT_ERROR;
+                }
+
+                output_buffer_consume(buf, len);
+            }
+
+            return OUTPUT_FLUSHED;
+        }
+
+        /**
+         * 通过ssl发送数据, 小数据段会被合并成完整的tls记录后再写入
+         * @param  buf   output_buffer_t
+         * @param  ssock ssl_socket_t
+         * @param  sock  ssl下层的socket_t, 用来统计发送的明文
+         * @return       OUTPUT_FLUSHED/OUTPUT_PENDING/OUTPUT_ERROR
+         */
+        int output_buffer_flush(output_buffer_t* buf, const ssl_socket_t* ssock, const socket_t* sock) {
+            char record[OUTPUT_TLS_RECORD];
+
+            // 合并后的记录与原数据段不在同一地址, 重试时需要允许缓冲区移动
+            SSL_set_mode(ssock->ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+            while (buf->size > 0) {
+                output_segment_t* seg = &buf->segments.front();
+                const char* data = __output_segment_data(seg);
+                size_t length = __output_segment_size(seg);
+
+                if (buf->tls_retry > 0) {
+                    // SSL_write返回WANT_*后必须使用相同的长度重试
+                    length = buf->tls_retry;
+                } else if (length < OUTPUT_TLS_RECORD) {
+                    length = buf->size < OUTPUT_TLS_RECORD ? buf->size : OUTPUT_TLS_RECORD;
+                }
+
+                // 首段不足时将后续的数据段合并成一个记录
+                if (__output_segment_size(seg) < length) {
+                    size_t offset = 0;
+
+                    for (std::deque<output_segment_t>::iterator it = buf->segments.begin(); it != buf->segments.end() && offset < length; it ++) {
+                        size_t size = __output_segment_size(&(*it));
+                        size = size > length - offset ? length - offset : size;
+                        memcpy(record + offset, __output_segment_data(&(*it)), size);
+                        offset += size;
+                    }
+
+                    data = record;
+                }
+
+                int len = socket_ssl_send(ssock, data, length);
+                __socket_count_send(sock, len, length);
+
+                if (len <= 0) {
+                    int error = SSL_get_error(ssock->ssl, len);
+
+                    if (error == SSL_ERROR_WANT_WRITE || error == SSL_ERROR_WANT_READ) {
+                        buf->tls_retry = length;
+                        return OUTPUT_PENDING;
+                    }
+
+                    return OUTPUT_ERROR;
+                }
+
+                buf->tls_retry = 0;
+                output_buffer_consume(buf, len);
+            }
+
+            return OUTPUT_FLUSHED;
+        }
+    }
+}
+
+#endif
@@ -11,12 +11,26 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/un.h>
+#include <netinet/tcp.h>
 #include <fcntl.h>
 #endif
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
 #include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <vector>
+#include <chrono>
 #include <functional>
+#include <cstdint>
+
+#define SOCKET_LINE_TOO_LONG -2 // 单行数据超过缓存长度
 
 #ifdef _WIN32
 #define SHUT_RD SD_RECEIVE
@@ -31,14 +45,112 @@ typedef void SOCK_OPTVAL;
 
 namespace clibs {
     namespace net {
+        /**
+         * TCP_INFO中常用的指标
+         */
+        typedef struct {
+            unsigned int rtt; // 平滑后的rtt(微秒)
+            unsigned int rttvar; // rtt方差(微秒)
+            unsigned int snd_cwnd; // 拥塞窗口(报文段数量)
+            unsigned int snd_ssthresh; // 慢启动阈值
+            unsigned int snd_mss; // 发送mss
+            unsigned int unacked; // 未确认的报文段
+            unsigned int lost; // 判定为丢失的报文段
+            unsigned int retransmits; // 当前未恢复的重传次数
+            unsigned int total_retrans; // 累计重传次数
+        } socket_tcp_info_t;
+
+        /**
+         * 单个连接的统计信息, 需要定义CLIBS_SOCKET_STATS才会计数
+         */
+        typedef struct {
+            unsigned long long int bytes_in; // 接收的字节数
+            unsigned long long int bytes_out; // 发送的字节数
+            unsigned long long int recv_calls; // 接收的系统调用次数
+            unsigned long long int send_calls; // 发送的系统调用次数
+            unsigned long long int eagain; // 返回EAGAIN的次数
+            unsigned long long int partial_writes; // 只发送了部分数据的次数
+            long long int sampled_at; // 上一次采样TCP_INFO的时间(毫秒), 0为未采样
+            socket_tcp_info_t tcp_info; // 上一次采样的TCP_INFO
+        } socket_stats_t;
+
         /**
          * 保存socket基本信息的结构体
          */
         typedef struct {
             SOCKET sockfd;
-            struct sockaddr_in addr;
+            struct sockaddr_storage addr; // 同时兼容ipv4与ipv6的地址信息
+    #ifdef CLIBS_SOCKET_STATS
+            mutable socket_stats_t stats; // 收发函数在const socket_t上也需要计数
+    #endif
         } socket_t;
 
+        /**
+         * 清空统计信息
+         * @param sock socket_t
+         */
+        void socket_stats_reset(const socket_t* sock) {
+    #ifdef CLIBS_SOCKET_STATS
+            memset(&sock->stats, 0, sizeof(sock->stats));
+    #else
+            (void)sock;
+    #endif
+        }
+
+        /**
+         * 获取统计信息
+         * @param  sock  socket_t
+         * @param  stats 接收统计信息
+         * @return       未定义CLIBS_SOCKET_STATS时为false
+         */
+        bool socket_stats(const socket_t* sock, socket_stats_t* stats) {
+    #ifdef CLIBS_SOCKET_STATS
+            *stats = sock->stats;
+            return true;
+    #else
+            (void)sock;
+            memset(stats, 0, sizeof(socket_stats_t));
+            return false;
+    #endif
+        }
+
+        /** 统计一次接收 */
+        void __socket_count_recv(const socket_t* sock, int len) {
+    #ifdef CLIBS_SOCKET_STATS
+            sock->stats.recv_calls ++;
+
+            if (len > 0) {
+                sock->stats.bytes_in += len;
+            } else if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                sock->stats.eagain ++;
+            }
+    #else
+            (void)sock;
+            (void)len;
+    #endif
+        }
+
+        /** 统计一次发送 */
+        void __socket_count_send(const socket_t* sock, int len, unsigned int length) {
+    #ifdef CLIBS_SOCKET_STATS
+            sock->stats.send_calls ++;
+
+            if (len > 0) {
+                sock->stats.bytes_out += len;
+
+                if ((unsigned int)len < length) {
+                    sock->stats.partial_writes ++;
+                }
+            } else if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                sock->stats.eagain ++;
+            }
+    #else
+            (void)sock;
+            (void)len;
+            (void)length;
+    #endif
+        }
+
     /**
      *  windows上加载和释放ws2_32的两个函数
      */
@@ -77,57 +189,135 @@ namespace clibs {
          */
         SOCKET socket_new(int family, int type, int protocol, socket_t* sock) {
             sock->sockfd = socket(family, type, protocol);
+            socket_stats_reset(sock);
             return sock->sockfd;
         }
 
         /**
-         * 填充socket_t的ip与端口信息
+         * 获取socket_t中地址信息的实际长度
          * @param  sock socket_t
-         * @param  host 主机名称
-         * @param  port 主机端口
-         * @return      是否填充成功
+         * @return      地址长度
          */
-        bool socket_set_address(socket_t* sock, const char* host, unsigned int port) {
-            hostent *hp;
+        socklen_t socket_addrlen(const socket_t* sock) {
+            switch (sock->addr.ss_family) {
+                case AF_INET:
+                    return sizeof(struct sockaddr_in);
+                case AF_INET6:
+                    return sizeof(struct sockaddr_in6);
+    #ifndef _WIN32
+                case AF_UNIX: {
+                    const struct sockaddr_un* un = (const struct sockaddr_un*)&sock->addr;
+
+                    // 抽象命名空间的地址以'\0'开头, 长度不包含结尾
+                    if (un->sun_path[0] == '\0') {
+                        return offsetof(struct sockaddr_un, sun_path) + 1 + strlen(un->sun_path + 1);
+                    }
+
+                    return offsetof(struct sockaddr_un, sun_path) + strlen(un->sun_path) + 1;
+                }
+    #endif
+                default:
+                    return sizeof(sock->addr);
+            }
+        }
+
+        /**
+         * 解析主机的所有地址
+         * @param  host   主机名称
+         * @param  port   主机端口
+         * @param  family 限定的ip协议簇, AF_UNSPEC为不限定
+         * @param  type   套字节类型
+         * @param  list   接收解析结果的数组
+         * @return        是否解析成功
+         */
+        bool socket_resolve(const char* host, unsigned int port, int family, int type, std::vector<socket_t>* list) {
+            struct addrinfo hints, *res = NULL, *it;
+            char service[16];
+
+            memset(&hints, 0, sizeof(hints));
+            hints.ai_family = family;
+            hints.ai_socktype = type;
+            snprintf(service, sizeof(service), "%u", port);
+
+            if (getaddrinfo(host, service, &hints, &res) != 0 || res == NULL) {
+                return false;
+            }
+
+            for (it = res; it != NULL; it = it->ai_next) {
+                if (it->ai_family != AF_INET && it->ai_family != AF_INET6) {
+                    continue;
+                }
 
-            hp = gethostbyname(host);
+                socket_t item;
+                item.sockfd = -1;
+                memset(&item.addr, 0, sizeof(item.addr));
+                memcpy(&item.addr, it->ai_addr, it->ai_addrlen);
+                list->push_back(item);
+            }
+
+            freeaddrinfo(res);
+
+            return list->size() > 0;
+        }
+
+        /**
+         * 填充socket_t的ip与端口信息
+         * @param  sock   socket_t
+         * @param  host   主机名称
+         * @param  port   主机端口
+         * @param  family 限定的ip协议簇, AF_UNSPEC时优先使用ipv4地址
+         * @return        是否填充成功
+         */
+        bool socket_set_address(socket_t* sock, const char* host, unsigned int port, int family) {
+            std::vector<socket_t> list;
 
-            if (hp == NULL) {
+            if (!socket_resolve(host, port, family, 0, &list)) {
                 return false;
-            } else {
-                sock->addr.sin_family = hp->h_addrtype;
-                sock->addr.sin_port = htons(port);
-                char* ip_address = inet_ntoa(*((struct in_addr*)hp->h_addr_list[0]));
-                sock->addr.sin_addr.s_addr = inet_addr(ip_address);
+            }
+
+            sock->addr = list[0].addr;
+
+            // 未限定协议簇时与旧版gethostbyname的行为保持一致, 优先选择ipv4
+            for (std::vector<socket_t>::iterator it = list.begin(); it != list.end(); it ++) {
+                if (it->addr.ss_family == AF_INET) {
+                    sock->addr = it->addr;
+                    break;
+                }
             }
 
             return true;
         }
 
+        bool socket_set_address(socket_t* sock, const char* host, unsigned int port) {
+            return socket_set_address(sock, host, port, AF_UNSPEC);
+        }
+
         /**
-         * 从sockaddr_in中提取端口
+         * 从地址信息中提取端口
          * @param  sock socket_t
          * @return      端口号
          */
         int socket_get_port(const socket_t* sock) {
-            return ntohs(sock->addr.sin_port);
+            if (sock->addr.ss_family == AF_INET6) {
+                return ntohs(((const struct sockaddr_in6*)&sock->addr)->sin6_port);
+            }
+
+            return ntohs(((const struct sockaddr_in*)&sock->addr)->sin_port);
         }
 
         /**
-         * 从sockaddr_in中提取ip地址
+         * 从地址信息中提取ip地址
          * @param  sock socket_t
          * @return      ip地址
          */
         std::string socket_get_ip(const socket_t* sock) {
-            int len = sock->addr.sin_family == AF_INET6 ? INET6_ADDRSTRLEN : INET_ADDRSTRLEN;
-            char ip[len];
-            struct in_addr in = sock->addr.sin_addr;
-    #ifdef _WIN32
-            return inet_ntoa(in);
-    #else
-            inet_ntop(sock->addr.sin_family, &in, ip, sizeof(ip));
+            char ip[INET6_ADDRSTRLEN] = {0};
+
+            if (getnameinfo((const struct sockaddr*)&sock->addr, socket_addrlen(sock), ip, sizeof(ip), NULL, 0, NI_NUMERICHOST) != 0) {
+                return "";
+            }
+
             return ip;
-    #endif
         }
 
         /**
@@ -157,9 +347,7 @@ namespace clibs {
          * @return      是否绑定成功
          */
         bool socket_bind(const socket_t* sock) {
-            socklen_t length = sizeof(sock->addr);
-
-            return bind(sock->sockfd, (struct sockaddr*)&sock->addr, length) != -1;
+            return bind(sock->sockfd, (struct sockaddr*)&sock->addr, socket_addrlen(sock)) != -1;
         }
 
         /**
@@ -196,6 +384,7 @@ namespace clibs {
         SOCKET socket_accept(const socket_t* sock, socket_t* new_socket) {
             socklen_t len = sizeof(new_socket->addr);
             new_socket->sockfd = accept(sock->sockfd, (struct sockaddr*)&new_socket->addr, &len);
+            socket_stats_reset(new_socket);
             return new_socket->sockfd;
         }
 
@@ -205,7 +394,7 @@ namespace clibs {
          * @return      是否连接成功
          */
         bool socket_connect(const socket_t* sock) {
-            return connect(sock->sockfd, (struct sockaddr*)&sock->addr, sizeof(sock->addr)) != -1;
+            return connect(sock->sockfd, (struct sockaddr*)&sock->addr, socket_addrlen(sock)) != -1;
         }
 
         /**
@@ -232,7 +421,9 @@ namespace clibs {
          * @return        返回接收到的数据长度
          */
         int socket_recv(const socket_t* sock, char* buffer, unsigned int length, int flags) {
-            return recv(sock->sockfd, buffer, length, flags);
+            int len = recv(sock->sockfd, buffer, length, flags);
+            __socket_count_recv(sock, len);
+            return len;
         }
 
         int socket_recv(const socket_t* sock, char* buffer, unsigned int length) {
@@ -279,12 +470,12 @@ namespace clibs {
             return socket_recv_must(sock, buffer, length, 0);
         }
 
-        /** 接收单个字符通用函数 */
+        /** 接收单个字符通用函数, 字符按无符号返回, 出错返回-1, 连接关闭返回-2 */
         int __socket_read_char(std::function<int(char*)> callback) {
             char buffer[1] = {0};
             int len = callback(buffer);
 
-            return len == -1 ? -1 : len == 0 ? -2 : buffer[0];
+            return len < 0 ? -1 : len == 0 ? -2 : (unsigned char)buffer[0];
         }
 
         /**
@@ -298,50 +489,73 @@ namespace clibs {
             });
         }
 
-        /** 读取单行数据通用函数 */
-        int __socket_readline(char* buffer, std::function<int()> callback) {
-            int offset = 0, c; 
+        /**
+         * 读取单行数据通用函数, 去掉行尾的换行符
+         * @param  buffer   接收数据的缓存
+         * @param  size     缓存长度, 包括结尾的'\0'
+         * @param  callback 读取一个字符, 出错或连接关闭时返回负数
+         * @return          行的长度, 超过缓存长度时返回SOCKET_LINE_TOO_LONG
+         */
+        int __socket_readline(char* buffer, size_t size, std::function<int()> callback) {
+            size_t offset = 0;
+            int c = 0;
+
+            if (size == 0) {
+                return SOCKET_LINE_TOO_LONG;
+            }
 
             while (c != '\n') {
                 c = callback();
 
-                if (c == -1) {
+                if (c < 0) {
                     break;
-                } else {
-                    *(buffer + offset) = c;
-                    offset += 1;
                 }
-            }
 
-            offset--;
+                if (offset + 1 >= size) {
+                    buffer[offset] = '\0';
+                    return SOCKET_LINE_TOO_LONG;
+                }
 
-            while(offset > 0) {
-                char temp = *(buffer + offset);
+                buffer[offset ++] = c;
+            }
 
-                if (temp == '\n' || temp == '\r') {
-                    offset--;
-                } else {
-                    break;
-                }
+            while (offset > 0 && (buffer[offset - 1] == '\n' || buffer[offset - 1] == '\r')) {
+                offset --;
             }
 
-            buffer[++offset] = '\0';
+            buffer[offset] = '\0';
 
             return offset;
         }
 
+        /** 读取单行数据通用函数, 不检查缓存长度 */
+        int __socket_readline(char* buffer, std::function<int()> callback) {
+            return __socket_readline(buffer, SIZE_MAX, callback);
+        }
+
         /**
          * 读取单行数据
          * @param  sock   socket_t
          * @param  buffer 接收数据的缓存
-         * @return        返回接收到的数据大小 
+         * @param  size   缓存长度
+         * @return        返回接收到的数据大小, 超过缓存长度时返回SOCKET_LINE_TOO_LONG
          */
-        int socket_readline(const socket_t* sock, char* buffer) {
-            return __socket_readline(buffer, [sock]() -> int {
+        int socket_readline(const socket_t* sock, char* buffer, size_t size) {
+            return __socket_readline(buffer, size, [sock]() -> int {
                 return socket_recv(sock);
             });
         }
 
+        /**
+         * 读取单行数据, 不检查缓存长度, 对不可信的对端应当使用带size的版本
+         * @param  sock   socket_t
+         * @param  buffer 接收数据的缓存
+         * @return        返回接收到的数据大小 
+         */
+        int socket_readline(const socket_t* sock, char* buffer) {
+            return socket_readline(sock, buffer, SIZE_MAX);
+        }
+
         /**
          * 发送数据
          * @param  sock   socket_t
@@ -351,7 +565,9 @@ namespace clibs {
          * @return        已经发送的长度
          */
         int socket_send(const socket_t* sock, const char* data, unsigned int length, int flags) {
-            return send(sock->sockfd, data, length, flags);
+            int len = send(sock->sockfd, data, length, flags);
+            __socket_count_send(sock, len, length);
+            return len;
         }
 
         int socket_send(const socket_t* sock, const char* data, unsigned int length) {
@@ -378,7 +594,9 @@ namespace clibs {
          */
         int socket_recvfrom(const socket_t* sock, char* buffer, unsigned int length, int flags, socket_t* new_socket) {
             socklen_t len = sizeof(new_socket->addr);
-            return recvfrom(sock->sockfd, buffer, length, flags, (struct sockaddr*)&new_socket->addr, &len);
+            int ret = recvfrom(sock->sockfd, buffer, length, flags, (struct sockaddr*)&new_socket->addr, &len);
+            __socket_count_recv(sock, ret);
+            return ret;
         }
 
         int socket_recvfrom(socket_t* sock, char* buffer, unsigned int length, socket_t* new_socket) {
@@ -395,13 +613,256 @@ namespace clibs {
          * @return         已经发送长度
          */
         int socket_sendto(const socket_t* sock, const char* data, unsigned int length, int flags, socket_t* to_sock) {
-            return sendto(sock->sockfd, data, length, flags, (struct sockaddr*)&to_sock->addr, sizeof(to_sock->addr));
+            int len = sendto(sock->sockfd, data, length, flags, (struct sockaddr*)&to_sock->addr, socket_addrlen(to_sock));
+            __socket_count_send(sock, len, length);
+            return len;
         }
 
         int socket_sendto(const socket_t* sock, const char* data, unsigned int length, socket_t* to_sock) {
             return socket_sendto(sock, data, length, 0, to_sock);
         }
 
+    #ifndef _WIN32
+        /**
+         * 填充unix域套字节的地址
+         * @param  sock     socket_t
+         * @param  path     文件路径, 抽象命名空间时为名称
+         * @param  abstract 是否使用linux的抽象命名空间(不会在文件系统中创建文件)
+         * @return          是否填充成功
+         */
+        bool socket_set_unix_address(socket_t* sock, const char* path, bool abstract) {
+            struct sockaddr_un* un = (struct sockaddr_un*)&sock->addr;
+            size_t length = strlen(path), offset = abstract ? 1 : 0;
+
+            if (length + offset >= sizeof(un->sun_path)) {
+                errno = ENAMETOOLONG;
+                return false;
+            }
+
+            memset(&sock->addr, 0, sizeof(sock->addr));
+            un->sun_family = AF_UNIX;
+            memcpy(un->sun_path + offset, path, length);
+
+            return true;
+        }
+
+        /**
+         * 获取unix域套字节的路径, 抽象命名空间的名称以'@'开头
+         * @param  sock socket_t
+         * @return      路径
+         */
+        std::string socket_get_path(const socket_t* sock) {
+            const struct sockaddr_un* un = (const struct sockaddr_un*)&sock->addr;
+
+            if (sock->addr.ss_family != AF_UNIX) {
+                return "";
+            }
+
+            if (un->sun_path[0] == '\0') {
+                return un->sun_path[1] == '\0' ? "" : std::string("@") + (un->sun_path + 1);
+            }
+
+            return un->sun_path;
+        }
+
+        /**
+         * 绑定unix域套字节, 非抽象地址需要调用方在绑定前删除残留的文件
+         * @param  sock     socket_t
+         * @param  path     文件路径或抽象名称
+         * @param  abstract 是否使用抽象命名空间
+         * @return          是否绑定成功
+         */
+        bool socket_bind_unix(socket_t* sock, const char* path, bool abstract) {
+            if (!socket_set_unix_address(sock, path, abstract)) {
+                return false;
+            }
+
+            return socket_bind(sock);
+        }
+
+        /**
+         * 连接unix域套字节
+         * @param  sock     socket_t
+         * @param  path     文件路径或抽象名称
+         * @param  abstract 是否使用抽象命名空间
+         * @return          是否连接成功
+         */
+        bool socket_connect_unix(socket_t* sock, const char* path, bool abstract) {
+            if (!socket_set_unix_address(sock, path, abstract)) {
+                return false;
+            }
+
+            return socket_connect(sock);
+        }
+
+        /**
+         * 创建一对相互连接的unix域套字节
+         * @param  type 套字节类型, SOCK_STREAM或SOCK_DGRAM
+         * @param  a    socket_t
+         * @param  b    socket_t
+         * @return      是否创建成功
+         */
+        bool socket_pair(int type, socket_t* a, socket_t* b) {
+            int fds[2];
+
+            if (socketpair(AF_UNIX, type, 0, fds) != 0) {
+                return false;
+            }
+
+            memset(&a->addr, 0, sizeof(a->addr));
+            memset(&b->addr, 0, sizeof(b->addr));
+            a->addr.ss_family = AF_UNIX;
+            b->addr.ss_family = AF_UNIX;
+            a->sockfd = fds[0];
+            b->sockfd = fds[1];
+            socket_stats_reset(a);
+            socket_stats_reset(b);
+
+            return true;
+        }
+
+        /**
+         * 通过SCM_RIGHTS发送文件描述符, 可以把已接收的连接交给其它进程
+         * @param  sock   unix域socket_t
+         * @param  fd     需要发送的描述符
+         * @param  data   同时发送的数据, 为空时发送一个'\0'
+         * @param  length 数据长度
+         * @return        已经发送的数据长度
+         */
+        int socket_send_fd(const socket_t* sock, int fd, const char* data, unsigned int length) {
+            struct msghdr msg;
+            struct iovec iov;
+            char placeholder = '\0';
+            char control[CMSG_SPACE(sizeof(int))];
+
+            memset(&msg, 0, sizeof(msg));
+            memset(control, 0, sizeof(control));
+
+            iov.iov_base = length > 0 ? (void*)data : (void*)&placeholder;
+            iov.iov_len = length > 0 ? length : 1;
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+            int len = sendmsg(sock->sockfd, &msg, 0);
+            __socket_count_send(sock, len, iov.iov_len);
+            return len;
+        }
+
+        /**
+         * 接收SCM_RIGHTS传递的文件描述符
+         * @param  sock   unix域socket_t
+         * @param  fd     接收到的描述符, 没有时为-1
+         * @param  buffer 接收数据的缓存
+         * @param  length 缓存大小
+         * @return        接收到的数据长度
+         */
+        int socket_recv_fd(const socket_t* sock, int* fd, char* buffer, unsigned int length) {
+            struct msghdr msg;
+            struct iovec iov;
+            char control[CMSG_SPACE(sizeof(int))];
+            int flags = 0;
+
+            memset(&msg, 0, sizeof(msg));
+            iov.iov_base = buffer;
+            iov.iov_len = length;
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            *fd = -1;
+
+        #ifdef MSG_CMSG_CLOEXEC
+            flags |= MSG_CMSG_CLOEXEC;
+        #endif
+
+            int len = recvmsg(sock->sockfd, &msg, flags);
+            __socket_count_recv(sock, len);
+
+            if (len < 0) {
+                return len;
+            }
+
+            for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                    memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+                }
+            }
+
+            return len;
+        }
+
+        /**
+         * 发送文件的一部分, linux上使用sendfile在内核中完成拷贝, 否则读取后通过send发送
+         * 不改变文件描述符的读写位置, 用于阻塞的套字节
+         * @param  sock   socket_t
+         * @param  fd     文件描述符
+         * @param  offset 文件中的起始位置
+         * @param  size   发送长度
+         * @return        已经发送的长度, 失败时为-1
+         */
+        long long int socket_sendfile(const socket_t* sock, int fd, off_t offset, size_t size) {
+            size_t sent = 0;
+
+        #ifdef __linux__
+            while (sent < size) {
+                off_t pos = offset + sent;
+                ssize_t len = sendfile(sock->sockfd, fd, &pos, size - sent);
+                __socket_count_send(sock, len, size - sent);
+
+                if (len < 0 && errno == EINTR) {
+                    continue;
+                } else if (len < 0 && sent == 0 && (errno == EINVAL || errno == ENOSYS)) {
+                    break; // 不支持sendfile的文件, 改为读取后发送
+                } else if (len <= 0) {
+                    return sent > 0 ? sent : -1;
+                }
+
+                sent += len;
+            }
+
+            if (sent == size) {
+                return sent;
+            }
+        #endif
+
+            char buffer[16384];
+
+            while (sent < size) {
+                size_t length = size - sent < sizeof(buffer) ? size - sent : sizeof(buffer);
+                ssize_t len = pread(fd, buffer, length, offset + sent);
+
+                if (len < 0 && errno == EINTR) {
+                    continue;
+                } else if (len <= 0) {
+                    break;
+                }
+
+                for (ssize_t pos = 0; pos < len;) {
+                    int ret = socket_send(sock, buffer + pos, len - pos);
+
+                    if (ret < 0 && errno == EINTR) {
+                        continue;
+                    } else if (ret <= 0) {
+                        return sent > 0 ? sent : -1;
+                    }
+
+                    pos += ret;
+                    sent += ret;
+                }
+            }
+
+            return sent;
+        }
+    #endif
+
         /**
          * 设置阻塞
          * @param  sock  socket_t
@@ -450,6 +911,69 @@ namespace clibs {
         bool socket_getsockopt(const socket_t* sock, int level, int optname, SOCK_OPTVAL *optval, socklen_t* optlen) {
             return getsockopt(sock->sockfd, level, optname, optval, optlen) == 0;
         }
+
+        /**
+         * 读取TCP_INFO, 仅支持linux
+         * @param  sock socket_t
+         * @param  info 接收结果
+         * @return      是否读取成功
+         */
+        bool socket_tcp_info(const socket_t* sock, socket_tcp_info_t* info) {
+            memset(info, 0, sizeof(socket_tcp_info_t));
+    #if defined(TCP_INFO) && !defined(_WIN32) && !defined(__APPLE__)
+            struct tcp_info raw;
+            socklen_t len = sizeof(raw);
+
+            if (!socket_getsockopt(sock, IPPROTO_TCP, TCP_INFO, (SOCK_OPTVAL*)&raw, &len)) {
+                return false;
+            }
+
+            info->rtt = raw.tcpi_rtt;
+            info->rttvar = raw.tcpi_rttvar;
+            info->snd_cwnd = raw.tcpi_snd_cwnd;
+            info->snd_ssthresh = raw.tcpi_snd_ssthresh;
+            info->snd_mss = raw.tcpi_snd_mss;
+            info->unacked = raw.tcpi_unacked;
+            info->lost = raw.tcpi_lost;
+            info->retransmits = raw.tcpi_retransmits;
+            info->total_retrans = raw.tcpi_total_retrans;
+
+            return true;
+    #else
+            return false;
+    #endif
+        }
+
+        /**
+         * 按间隔采样TCP_INFO, 距离上次采样不足interval毫秒时直接返回缓存的结果
+         * 需要定义CLIBS_SOCKET_STATS, 否则每次都会读取
+         * @param  sock     socket_t
+         * @param  info     接收结果
+         * @param  interval 采样间隔(毫秒)
+         * @return          是否读取成功
+         */
+        bool socket_tcp_info_sample(const socket_t* sock, socket_tcp_info_t* info, unsigned int interval) {
+    #ifdef CLIBS_SOCKET_STATS
+            long long int now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+            if (sock->stats.sampled_at != 0 && now - sock->stats.sampled_at < interval) {
+                *info = sock->stats.tcp_info;
+                return true;
+            }
+
+            if (!socket_tcp_info(sock, &sock->stats.tcp_info)) {
+                return false;
+            }
+
+            sock->stats.sampled_at = now;
+            *info = sock->stats.tcp_info;
+
+            return true;
+    #else
+            (void)interval;
+            return socket_tcp_info(sock, info);
+    #endif
+        }
     }
 }
 
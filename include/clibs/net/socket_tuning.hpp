@@ -0,0 +1,153 @@
+#ifndef _CLIBS_SOCKET_TUNING_H_
+#define _CLIBS_SOCKET_TUNING_H_ 1
+
+#include "clibs/net/socket.hpp"
+
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+
+#define TUNING_NONE 0
+#define TUNING_LOW_LATENCY 1 // 低延迟的小请求(RPC)
+#define TUNING_BULK 2 // 大量数据传输
+#define TUNING_LISTENER 3 // 服务端监听套字节
+
+namespace clibs {
+    namespace net {
+        /**
+         * tcp调优参数, 值为-1的项不做设置
+         */
+        typedef struct {
+            int nodelay; // TCP_NODELAY
+            int fastopen_connect; // TCP_FASTOPEN_CONNECT, 客户端启用tcp fast open
+            int fastopen_queue; // TCP_FASTOPEN, 服务端fast open队列长度
+            int recv_buffer; // SO_RCVBUF
+            int send_buffer; // SO_SNDBUF
+            int notsent_lowat; // TCP_NOTSENT_LOWAT
+            int busy_poll; // SO_BUSY_POLL(微秒)
+            int keepalive; // SO_KEEPALIVE
+            int keepalive_idle; // TCP_KEEPIDLE(秒)
+            int keepalive_interval; // TCP_KEEPINTVL(秒)
+            int keepalive_count; // TCP_KEEPCNT
+            int defer_accept; // TCP_DEFER_ACCEPT(秒)
+        } socket_tuning_t;
+
+        /**
+         * 初始化调优参数, 所有项都不做设置
+         * @param tuning socket_tuning_t
+         */
+        void socket_tuning_init(socket_tuning_t* tuning) {
+            tuning->nodelay = -1;
+            tuning->fastopen_connect = -1;
+            tuning->fastopen_queue = -1;
+            tuning->recv_buffer = -1;
+            tuning->send_buffer = -1;
+            tuning->notsent_lowat = -1;
+            tuning->busy_poll = -1;
+            tuning->keepalive = -1;
+            tuning->keepalive_idle = -1;
+            tuning->keepalive_interval = -1;
+            tuning->keepalive_count = -1;
+            tuning->defer_accept = -1;
+        }
+
+        /**
+         * 使用预设填充调优参数
+         * @param tuning socket_tuning_t
+         * @param preset 预设名称, TUNING_*
+         */
+        void socket_tuning_preset(socket_tuning_t* tuning, int preset) {
+            socket_tuning_init(tuning);
+
+            switch (preset) {
+                case TUNING_LOW_LATENCY:
+                    tuning->nodelay = 1;
+                    tuning->notsent_lowat = 16384;
+                    tuning->keepalive = 1;
+                    tuning->keepalive_idle = 60;
+                    tuning->keepalive_interval = 10;
+                    tuning->keepalive_count = 6;
+                    break;
+                case TUNING_BULK:
+                    // 不设置SO_RCVBUF/SO_SNDBUF, linux上固定缓冲区大小会关闭自动调整, 并且会被rmem_max/wmem_max截断
+                    tuning->nodelay = 0;
+                    tuning->keepalive = 1;
+                    tuning->keepalive_idle = 60;
+                    tuning->keepalive_interval = 10;
+                    tuning->keepalive_count = 6;
+                    break;
+                case TUNING_LISTENER:
+                    tuning->nodelay = 1;
+                    tuning->fastopen_queue = 256;
+                    tuning->defer_accept = 1;
+                    break;
+            }
+        }
+
+        /** 设置单个整数参数, 值为-1时跳过 */
+        bool __socket_tune_int(const socket_t* sock, int level, int optname, int value) {
+            if (value < 0) {
+                return true;
+            }
+
+            return socket_setsockopt(sock, level, optname, (const SOCK_OPTVAL*)&value, sizeof(value));
+        }
+
+        /**
+         * 应用调优参数, 客户端需在connect之前调用, 服务端需在listen之前调用
+         * 当前平台不支持的参数会被忽略
+         * @param  sock   socket_t
+         * @param  tuning socket_tuning_t
+         * @return        是否全部设置成功
+         */
+        bool socket_tune(const socket_t* sock, const socket_tuning_t* tuning) {
+            bool ok = true;
+
+            ok = __socket_tune_int(sock, IPPROTO_TCP, TCP_NODELAY, tuning->nodelay) && ok;
+            ok = __socket_tune_int(sock, SOL_SOCKET, SO_RCVBUF, tuning->recv_buffer) && ok;
+            ok = __socket_tune_int(sock, SOL_SOCKET, SO_SNDBUF, tuning->send_buffer) && ok;
+            ok = __socket_tune_int(sock, SOL_SOCKET, SO_KEEPALIVE, tuning->keepalive) && ok;
+    #ifdef TCP_FASTOPEN_CONNECT
+            ok = __socket_tune_int(sock, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, tuning->fastopen_connect) && ok;
+    #endif
+    #ifdef TCP_FASTOPEN
+            ok = __socket_tune_int(sock, IPPROTO_TCP, TCP_FASTOPEN, tuning->fastopen_queue) && ok;
+    #endif
+    #ifdef TCP_NOTSENT_LOWAT
+            ok = __socket_tune_int(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, tuning->notsent_lowat) && ok;
+    #endif
+    #ifdef SO_BUSY_POLL
+            ok = __socket_tune_int(sock, SOL_SOCKET, SO_BUSY_POLL, tuning->busy_poll) && ok;
+    #endif
+    #ifdef TCP_KEEPIDLE
+            ok = __socket_tune_int(sock, IPPROTO_TCP, TCP_KEEPIDLE, tuning->keepalive_idle) && ok;
+    #endif
+    #ifdef TCP_KEEPINTVL
+            ok = __socket_tune_int(sock, IPPROTO_TCP, TCP_KEEPINTVL, tuning->keepalive_interval) && ok;
+    #endif
+    #ifdef TCP_KEEPCNT
+            ok = __socket_tune_int(sock, IPPROTO_TCP, TCP_KEEPCNT, tuning->keepalive_count) && ok;
+    #endif
+    #ifdef TCP_DEFER_ACCEPT
+            ok = __socket_tune_int(sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, tuning->defer_accept) && ok;
+    #endif
+
+            return ok;
+        }
+
+        /**
+         * 使用预设调优套字节
+         * @param  sock   socket_t
+         * @param  preset 预设名称, TUNING_*
+         * @return        是否全部设置成功
+         */
+        bool socket_tune(const socket_t* sock, int preset) {
+            socket_tuning_t tuning;
+            socket_tuning_preset(&tuning, preset);
+
+            return socket_tune(sock, &tuning);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,285 @@
+#ifndef _CLIBS_SSL_ENGINE_H_
+#define _CLIBS_SSL_ENGINE_H_ 1
+
+#include <iostream>
+#include <string>
+#include "clibs/net/sslsocket.hpp"
+#include "clibs/net/output_buffer.hpp"
+
+#define SSL_ENGINE_RECORD 16384 // 单个tls记录的最大明文长度
+
+namespace clibs {
+    namespace net {
+        /**
+         * 基于内存BIO的tls引擎, 不绑定文件描述符
+         * 从网络收到的密文通过ssl_engine_feed写入, 需要发送的密文通过ssl_engine_drain取出
+         * 可以承载在任意的传输方式上
+         */
+        typedef struct {
+            ssl_socket_t ssock; // ssl与上下文, 可以直接使用socket_ssl_*的函数(如SNI, ALPN)
+            BIO* rbio; // 网络 -> ssl
+            BIO* wbio; // ssl -> 网络
+            bool is_server;
+            std::string pending; // 等待合并成完整记录的明文
+            size_t record_size; // 合并的记录长度
+        } ssl_engine_t;
+
+        /**
+         * 初始化引擎
+         * @param  engine    ssl_engine_t
+         * @param  ctx       ssl上下文, 引擎会持有一个引用
+         * @param  is_server 是否为服务端
+         * @return           是否成功
+         */
+        bool ssl_engine_init(ssl_engine_t* engine, SSL_CTX* ctx, bool is_server) {
+            engine->ssock.ctx = NULL;
+            engine->ssock.ssl = NULL;
+            engine->rbio = NULL;
+            engine->wbio = NULL;
+            engine->is_server = is_server;
+            engine->pending.clear();
+            engine->record_size = SSL_ENGINE_RECORD;
+
+            if (SSL_CTX_up_ref(ctx) != 1) {
+                return false;
+            }
+
+            engine->ssock.ctx = ctx;
+            engine->ssock.ssl = SSL_new(ctx);
+
+            if (engine->ssock.ssl == NULL) {
+                return false;
+            }
+
+            engine->rbio = BIO_new(BIO_s_mem());
+            engine->wbio = BIO_new(BIO_s_mem());
+
+            if (engine->rbio == NULL || engine->wbio == NULL) {
+                BIO_free(engine->rbio);
+                BIO_free(engine->wbio);
+                engine->rbio = NULL;
+                engine->wbio = NULL;
+                return false;
+            }
+
+            // 读到空的内存BIO时返回WANT_READ而不是EOF
+            BIO_set_mem_eof_return(engine->rbio, -1);
+            SSL_set_bio(engine->ssock.ssl, engine->rbio, engine->wbio);
+
+            if (is_server) {
+                SSL_set_accept_state(engine->ssock.ssl);
+            } else {
+                SSL_set_connect_state(engine->ssock.ssl);
+            }
+
+            return true;
+        }
+
+        /**
+         * 设置合并的记录长度, 较小的记录可以降低首字节的延迟
+         * @param engine      ssl_engine_t
+         * @param record_size 记录长度, 最大为SSL_ENGINE_RECORD
+         */
+        void ssl_engine_record_size(ssl_engine_t* engine, size_t record_size) {
+            engine->record_size = record_size == 0 || record_size > SSL_ENGINE_RECORD ? SSL_ENGINE_RECORD : record_size;
+        }
+
+        /**
+         * 写入从网络收到的密文
+         * @param  engine ssl_engine_t
+         * @param  data   密文
+         * @param  length 长度
+         * @return        是否成功
+         */
+        bool ssl_engine_feed(ssl_engine_t* engine, const char* data, size_t length) {
+            while (length > 0) {
+                int len = BIO_write(engine->rbio, data, length);
+
+                if (len <= 0) {
+                    return false;
+                }
+
+                data += len;
+                length -= len;
+            }
+
+            return true;
+        }
+
+        /**
+         * 推进握手, 返回SSL_STATUS_WANT_READ时需要发送已有的密文并等待对方的数据
+         * @param  engine ssl_engine_t
+         * @return        SSL_STATUS_*
+         */
+        int ssl_engine_handshake(ssl_engine_t* engine) {
+            return socket_ssl_handshake(&engine->ssock, engine->is_server);
+        }
+
+        /** 握手是否已经完成 */
+        bool ssl_engine_established(const ssl_engine_t* engine) {
+            return SSL_is_init_finished(engine->ssock.ssl) == 1;
+        }
+
+        /**
+         * 读取解密后的明文, 没有完整的记录时返回SSL_STATUS_WANT_READ
+         * @param  engine ssl_engine_t
+         * @param  buffer 接收数据的缓存
+         * @param  length 缓存长度
+         * @param  bytes  读取到的长度
+         * @return        SSL_STATUS_*
+         */
+        int ssl_engine_read(ssl_engine_t* engine, char* buffer, size_t length, size_t* bytes) {
+            return socket_ssl_read(&engine->ssock, buffer, length, bytes);
+        }
+
+        /** 将一段明文加密成记录 */
+        int __ssl_engine_seal(ssl_engine_t* engine, const char* data, size_t length) {
+            size_t bytes;
+            int status = socket_ssl_write(&engine->ssock, data, length, &bytes);
+
+            // 写入内存BIO不会阻塞, 除了握手未完成外总是一次写完
+            return status == SSL_STATUS_OK && bytes != length ? SSL_STATUS_ERROR : status;
+        }
+
+        /**
+         * 写入需要发送的明文, 不足一个记录的数据会被暂存, 与后续的写入合并
+         * 握手完成前写入的数据会一直暂存, 握手完成后调用ssl_engine_flush发出
+         * @param  engine ssl_engine_t
+         * @param  data   明文
+         * @param  length 长度
+         * @return        SSL_STATUS_*
+         */
+        int ssl_engine_write(ssl_engine_t* engine, const char* data, size_t length) {
+            // 先补齐暂存的数据
+            if (!engine->pending.empty()) {
+                size_t fill = engine->pending.size() < engine->record_size ? engine->record_size - engine->pending.size() : 0;
+                fill = fill > length ? length : fill;
+
+                engine->pending.append(data, fill);
+                data += fill;
+                length -= fill;
+
+                if (engine->pending.size() < engine->record_size) {
+                    return SSL_STATUS_OK;
+                }
+
+                int status = __ssl_engine_seal(engine, engine->pending.data(), engine->pending.size());
+
+                if (status != SSL_STATUS_OK) {
+                    engine->pending.append(data, length);
+                    return status;
+                }
+
+                engine->pending.clear();
+            }
+
+            // 完整的记录直接加密, 不做拷贝
+            while (length >= engine->record_size) {
+                int status = __ssl_engine_seal(engine, data, engine->record_size);
+
+                if (status != SSL_STATUS_OK) {
+                    engine->pending.assign(data, length);
+                    return status;
+                }
+
+                data += engine->record_size;
+                length -= engine->record_size;
+            }
+
+            engine->pending.append(data, length);
+
+            return SSL_STATUS_OK;
+        }
+
+        /**
+         * 将暂存的明文加密成一个记录, 在一批写入结束后调用
+         * @param  engine ssl_engine_t
+         * @return        SSL_STATUS_*
+         */
+        int ssl_engine_flush(ssl_engine_t* engine) {
+            if (engine->pending.empty()) {
+                return SSL_STATUS_OK;
+            }
+
+            int status = __ssl_engine_seal(engine, engine->pending.data(), engine->pending.size());
+
+            if (status == SSL_STATUS_OK) {
+                engine->pending.clear();
+            }
+
+            return status;
+        }
+
+        /** 等待发送的密文长度 */
+        size_t ssl_engine_output_size(const ssl_engine_t* engine) {
+            return BIO_ctrl_pending(engine->wbio);
+        }
+
+        /**
+         * 取出等待发送的密文
+         * @param  engine ssl_engine_t
+         * @param  buffer 接收数据的缓存
+         * @param  length 缓存长度
+         * @return        取出的长度
+         */
+        size_t ssl_engine_drain(ssl_engine_t* engine, char* buffer, size_t length) {
+            int len = BIO_read(engine->wbio, buffer, length);
+
+            return len > 0 ? len : 0;
+        }
+
+        /**
+         * 取出所有等待发送的密文并追加到输出缓冲区
+         * @param  engine ssl_engine_t
+         * @param  output output_buffer_t
+         * @return        取出的长度
+         */
+        size_t ssl_engine_drain(ssl_engine_t* engine, output_buffer_t* output) {
+            size_t size = ssl_engine_output_size(engine);
+
+            if (size == 0) {
+                return 0;
+            }
+
+            std::string data(size, '\0');
+            size = ssl_engine_drain(engine, &data[0], size);
+            data.resize(size);
+            output_buffer_append(output, std::move(data));
+
+            return size;
+        }
+
+        /**
+         * 发送close_notify, 之后需要取出密文发送给对方
+         * @param  engine ssl_engine_t
+         * @return        SSL_STATUS_*
+         */
+        int ssl_engine_shutdown(ssl_engine_t* engine) {
+            int status = ssl_engine_flush(engine);
+
+            return status == SSL_STATUS_OK ? socket_ssl_shutdown(&engine->ssock) : status;
+        }
+
+        /**
+         * 释放引擎, BIO随ssl一起释放
+         * @param engine ssl_engine_t
+         */
+        void ssl_engine_free(ssl_engine_t* engine) {
+            if (engine->ssock.ssl != NULL) {
+                SSL_free(engine->ssock.ssl);
+            }
+
+            if (engine->ssock.ctx != NULL) {
+                SSL_CTX_free(engine->ssock.ctx);
+            }
+
+            engine->ssock.ssl = NULL;
+            engine->ssock.ctx = NULL;
+            engine->rbio = NULL;
+            engine->wbio = NULL;
+            engine->pending.clear();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,307 @@
+#ifndef _CLIBS_SSL_SERVER_H_
+#define _CLIBS_SSL_SERVER_H_ 1
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <openssl/x509v3.h>
+#include <openssl/pem.h>
+#include "clibs/net/sslsocket.hpp"
+
+namespace clibs {
+    namespace net {
+        /**
+         * 一组证书与私钥, 握手时根据SNI选中后设置到连接上
+         */
+        typedef struct {
+            X509* cert;
+            EVP_PKEY* key;
+            STACK_OF(X509)* chain; // 中间证书
+            std::vector<std::string> names; // 证书适用的主机名, 可以包含*.example.com形式的通配符
+        } ssl_server_cert_t;
+
+        typedef std::shared_ptr<ssl_server_cert_t> ssl_server_cert_ptr;
+
+        /**
+         * tls服务端上下文, 多个连接共享, 根据SNI选择证书并协商ALPN
+         * 证书可以在运行中重新加载, 已经建立的连接不受影响
+         */
+        typedef struct {
+            SSL_CTX* ctx;
+            std::mutex lock;
+            std::map<std::string, ssl_server_cert_ptr> certs; // 主机名(小写)对应的证书
+            ssl_server_cert_ptr default_cert; // 没有SNI或者没有匹配时使用的证书
+            std::string alpn; // 服务端支持的ALPN协议, 按优先级编码
+        } ssl_server_t;
+
+        /** 释放证书 */
+        void __ssl_server_cert_free(ssl_server_cert_t* cert) {
+            X509_free(cert->cert);
+            EVP_PKEY_free(cert->key);
+            sk_X509_pop_free(cert->chain, X509_free);
+            delete cert;
+        }
+
+        /** 主机名转为小写 */
+        std::string __ssl_server_lower(std::string name) {
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            return name;
+        }
+
+        /**
+         * 查找主机名对应的证书, 先精确匹配, 再匹配上一级的通配符
+         * @param  server ssl_server_t
+         * @param  name   主机名
+         * @return        证书, 没有时为默认证书
+         */
+        ssl_server_cert_ptr ssl_server_find(ssl_server_t* server, const char* name) {
+            std::lock_guard<std::mutex> lock(server->lock);
+
+            if (name != NULL) {
+                std::string host = __ssl_server_lower(name);
+                std::map<std::string, ssl_server_cert_ptr>::iterator it = server->certs.find(host);
+
+                if (it != server->certs.end()) {
+                    return it->second;
+                }
+
+                // 通配符只匹配一级子域名
+                size_t dot = host.find('.');
+
+                if (dot != std::string::npos && dot > 0) {
+                    it = server->certs.find("*" + host.substr(dot));
+
+                    if (it != server->certs.end()) {
+                        return it->second;
+                    }
+                }
+            }
+
+            return server->default_cert;
+        }
+
+        /** 握手时根据SNI设置证书 */
+        int __ssl_server_cert_callback(SSL* ssl, void* arg) {
+            ssl_server_cert_ptr cert = ssl_server_find((ssl_server_t*)arg, SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name));
+
+            if (!cert) {
+                return 0;
+            }
+
+            return SSL_use_cert_and_key(ssl, cert->cert, cert->key, cert->chain, 1);
+        }
+
+        /** 按服务端的优先级选择ALPN协议 */
+        int __ssl_server_alpn_callback(SSL* ssl, const unsigned char** out, unsigned char* outlen, const unsigned char* in, unsigned int inlen, void* arg) {
+            ssl_server_t* server = (ssl_server_t*)arg;
+
+            if (server->alpn.empty()) {
+                return SSL_TLSEXT_ERR_NOACK;
+            }
+
+            unsigned char* selected = NULL;
+
+            if (SSL_select_next_proto(&selected, outlen, (const unsigned char*)server->alpn.data(), server->alpn.size(), in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+                return SSL_TLSEXT_ERR_NOACK;
+            }
+
+            *out = selected;
+
+            return SSL_TLSEXT_ERR_OK;
+        }
+
+        /**
+         * 初始化服务端上下文
+         * @param  server ssl_server_t
+         * @return        是否成功
+         */
+        bool ssl_server_init(ssl_server_t* server) {
+            server->ctx = SSL_CTX_new(TLS_server_method());
+
+            if (server->ctx == NULL) {
+                return false;
+            }
+
+            SSL_CTX_set_app_data(server->ctx, server);
+            SSL_CTX_set_cert_cb(server->ctx, __ssl_server_cert_callback, server);
+            SSL_CTX_set_alpn_select_cb(server->ctx, __ssl_server_alpn_callback, server);
+
+            return true;
+        }
+
+        /**
+         * 设置服务端支持的ALPN协议, 需要在开始接收连接之前调用
+         * @param server    ssl_server_t
+         * @param protocols 按优先级排列的协议, 例如h2, http/1.1
+         */
+        void ssl_server_set_alpn(ssl_server_t* server, const std::vector<std::string>& protocols) {
+            server->alpn = __ssl_alpn_encode(protocols);
+        }
+
+        /** 读取证书中的主机名, 优先使用subjectAltName, 没有时使用CN */
+        std::vector<std::string> __ssl_server_cert_names(X509* cert) {
+            std::vector<std::string> names;
+            GENERAL_NAMES* sans = (GENERAL_NAMES*)X509_get_ext_d2i(cert, NID_subject_alt_name, NULL, NULL);
+
+            if (sans != NULL) {
+                for (int i = 0; i < sk_GENERAL_NAME_num(sans); i ++) {
+                    GENERAL_NAME* name = sk_GENERAL_NAME_value(sans, i);
+
+                    if (name->type == GEN_DNS) {
+                        names.push_back(std::string((const char*)ASN1_STRING_get0_data(name->d.dNSName), ASN1_STRING_length(name->d.dNSName)));
+                    }
+                }
+
+                GENERAL_NAMES_free(sans);
+            }
+
+            if (names.empty()) {
+                char cn[256];
+                int length = X509_NAME_get_text_by_NID(X509_get_subject_name(cert), NID_commonName, cn, sizeof(cn));
+
+                if (length > 0) {
+                    names.push_back(std::string(cn, length));
+                }
+            }
+
+            return names;
+        }
+
+        /** 从pem文件中读取证书链与私钥 */
+        ssl_server_cert_ptr __ssl_server_load(const char* cert_file, const char* private_key_file) {
+            ssl_server_cert_ptr cert(new ssl_server_cert_t(), __ssl_server_cert_free);
+            cert->cert = NULL;
+            cert->key = NULL;
+            cert->chain = sk_X509_new_null();
+
+            FILE* fp = fopen(cert_file, "r");
+
+            if (fp == NULL) {
+                return ssl_server_cert_ptr();
+            }
+
+            cert->cert = PEM_read_X509(fp, NULL, NULL, NULL);
+
+            X509* ca;
+
+            while ((ca = PEM_read_X509(fp, NULL, NULL, NULL)) != NULL) {
+                sk_X509_push(cert->chain, ca);
+            }
+
+            fclose(fp);
+            ERR_clear_error(); // 读取到文件末尾时留下的错误
+
+            fp = fopen(private_key_file, "r");
+
+            if (fp == NULL) {
+                return ssl_server_cert_ptr();
+            }
+
+            cert->key = PEM_read_PrivateKey(fp, NULL, NULL, NULL);
+            fclose(fp);
+
+            if (cert->cert == NULL || cert->key == NULL || X509_check_private_key(cert->cert, cert->key) != 1) {
+                return ssl_server_cert_ptr();
+            }
+
+            cert->names = __ssl_server_cert_names(cert->cert);
+
+            return cert;
+        }
+
+        /**
+         * 添加或替换证书, 相同主机名的旧证书会被替换, 可以在运行中调用来重新加载证书
+         * @param  server           ssl_server_t
+         * @param  cert_file        pem格式的证书(可以包含中间证书)
+         * @param  private_key_file pem格式的私钥
+         * @param  names            证书适用的主机名, 为空时从证书中读取
+         * @param  is_default       是否作为默认证书, 第一个添加的证书总是默认证书
+         * @return                  是否添加成功
+         */
+        bool ssl_server_add_cert(ssl_server_t* server, const char* cert_file, const char* private_key_file, const std::vector<std::string>& names, bool is_default) {
+            ssl_server_cert_ptr cert = __ssl_server_load(cert_file, private_key_file);
+
+            if (!cert) {
+                return false;
+            }
+
+            if (!names.empty()) {
+                cert->names = names;
+            }
+
+            std::lock_guard<std::mutex> lock(server->lock);
+
+            for (std::vector<std::string>::iterator it = cert->names.begin(); it != cert->names.end(); it ++) {
+                ssl_server_cert_ptr& slot = server->certs[__ssl_server_lower(*it)];
+
+                // 重新加载默认证书时同时替换默认证书
+                if (slot && slot == server->default_cert) {
+                    is_default = true;
+                }
+
+                slot = cert;
+            }
+
+            if (is_default || !server->default_cert) {
+                server->default_cert = cert;
+            }
+
+            return true;
+        }
+
+        bool ssl_server_add_cert(ssl_server_t* server, const char* cert_file, const char* private_key_file) {
+            return ssl_server_add_cert(server, cert_file, private_key_file, std::vector<std::string>(), false);
+        }
+
+        /**
+         * 移除主机名对应的证书
+         * @param server ssl_server_t
+         * @param name   主机名
+         */
+        void ssl_server_remove_cert(ssl_server_t* server, const std::string& name) {
+            std::lock_guard<std::mutex> lock(server->lock);
+            server->certs.erase(__ssl_server_lower(name));
+        }
+
+        /**
+         * 为新连接创建ssl, 之后使用socket_ssl_accept或socket_ssl_handshake完成握手
+         * @param  server ssl_server_t
+         * @param  ssock  ssl_socket_t, 持有上下文的引用, 使用socket_ssl_close释放
+         * @param  sock   已接收的连接
+         * @return        是否成功
+         */
+        bool ssl_server_bind(ssl_server_t* server, ssl_socket_t* ssock, socket_t* sock) {
+            ssock->ssl = NULL;
+
+            if (SSL_CTX_up_ref(server->ctx) != 1) {
+                ssock->ctx = NULL;
+                return false;
+            }
+
+            return socket_ssl_bind(ssock, server->ctx, sock);
+        }
+
+        /**
+         * 释放服务端上下文, 需要在进行中的握手结束后调用, 已经建立的连接不受影响
+         * @param server ssl_server_t
+         */
+        void ssl_server_free(ssl_server_t* server) {
+            std::lock_guard<std::mutex> lock(server->lock);
+
+            server->certs.clear();
+            server->default_cert.reset();
+
+            if (server->ctx != NULL) {
+                SSL_CTX_free(server->ctx);
+                server->ctx = NULL;
+            }
+        }
+    }
+}
+
+#endif
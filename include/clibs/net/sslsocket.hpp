@@ -5,13 +5,30 @@
 #include <openssl/err.h>
 #include <openssl/conf.h>
 #include <functional>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <mutex>
+#include <memory>
+#include "clibs/os.h"
 #include "clibs/net/socket.hpp"
 
+#ifdef OS_LINUX
+#include "clibs/io/event_loop.hpp"
+#endif
+
 #ifdef _WIN32
 #pragma comment(lib, "libeay32.lib")
 #pragma comment(lib, "ssleay32.lib")
 #endif
 
+#define SSL_STATUS_OK 0 // 操作完成
+#define SSL_STATUS_WANT_READ 1 // 需要等待套字节可读后重试
+#define SSL_STATUS_WANT_WRITE 2 // 需要等待套字节可写后重试
+#define SSL_STATUS_CLOSED 3 // 对方已关闭ssl连接
+#define SSL_STATUS_ERROR -1 // 出错
+
 namespace clibs {
     namespace net {
         typedef struct {
@@ -19,6 +36,22 @@ namespace clibs {
             SSL_CTX *ctx;
         } ssl_socket_t;
 
+        /**
+         * 可以被多个连接共享的ssl上下文, 同时缓存客户端的会话用来恢复连接
+         */
+        typedef struct {
+            SSL_SESSION* session;
+            std::list<std::string>::iterator order; // 在ssl_context_t.order中的位置
+        } ssl_cached_session_t;
+
+        typedef struct {
+            SSL_CTX* ctx;
+            std::mutex lock;
+            std::map<std::string, ssl_cached_session_t> sessions; // host:port对应的会话
+            std::list<std::string> order; // 会话的key, 最近使用的在前, 缓存满时淘汰最后一个
+            size_t max_sessions; // 最多缓存的会话数量
+        } ssl_context_t;
+
         /**
          * 加载ssl
          */
@@ -61,6 +94,131 @@ namespace clibs {
             return socket_ssl_new(ssock, false);
         }
 
+        /** 释放ssl上保存的会话缓存key */
+        void __ssl_session_key_free(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) {
+            delete (std::string*)ptr;
+        }
+
+        /** ssl上保存会话缓存key的ex_data下标 */
+        int __ssl_session_key_index() {
+            static int index = SSL_get_ex_new_index(0, NULL, NULL, NULL, __ssl_session_key_free);
+            return index;
+        }
+
+        /** 收到新的会话(tls1.3中为握手后的session ticket)时保存到缓存中 */
+        int __ssl_new_session(SSL* ssl, SSL_SESSION* session) {
+            ssl_context_t* context = (ssl_context_t*)SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+            std::string* key = (std::string*)SSL_get_ex_data(ssl, __ssl_session_key_index());
+
+            if (context == NULL || key == NULL) {
+                return 0;
+            }
+
+            std::lock_guard<std::mutex> lock(context->lock);
+            std::map<std::string, ssl_cached_session_t>::iterator it = context->sessions.find(*key);
+
+            if (it != context->sessions.end()) {
+                SSL_SESSION_free(it->second.session);
+                it->second.session = session;
+                context->order.splice(context->order.begin(), context->order, it->second.order);
+            } else {
+                if (context->sessions.size() >= context->max_sessions && !context->sessions.empty()) {
+                    std::map<std::string, ssl_cached_session_t>::iterator oldest = context->sessions.find(context->order.back());
+                    SSL_SESSION_free(oldest->second.session);
+                    context->sessions.erase(oldest);
+                    context->order.pop_back();
+                }
+
+                context->order.push_front(*key);
+                ssl_cached_session_t cached = {session, context->order.begin()};
+                context->sessions[*key] = cached;
+            }
+
+            return 1; // 返回1表示接管了session的引用
+        }
+
+        /**
+         * 创建一个可共享的ssl上下文, 客户端上下文会缓存会话并使用session ticket恢复连接
+         * @param  context   ssl_context_t
+         * @param  is_server 是否为服务端
+         * @return           是否成功
+         */
+        bool socket_ssl_context_new(ssl_context_t* context, bool is_server) {
+            context->ctx = SSL_CTX_new(is_server ? TLS_server_method() : TLS_client_method());
+            context->max_sessions = 1024;
+
+            if (context->ctx == NULL) {
+                return false;
+            }
+
+            SSL_CTX_set_app_data(context->ctx, context);
+
+            if (!is_server) {
+                SSL_CTX_set_session_cache_mode(context->ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+                SSL_CTX_sess_set_new_cb(context->ctx, __ssl_new_session);
+            }
+
+            return true;
+        }
+
+        /**
+         * 释放ssl上下文与缓存的会话, 仍在使用该上下文的连接不受影响
+         * @param context ssl_context_t
+         */
+        void socket_ssl_context_free(ssl_context_t* context) {
+            std::lock_guard<std::mutex> lock(context->lock);
+
+            for (std::map<std::string, ssl_cached_session_t>::iterator it = context->sessions.begin(); it != context->sessions.end(); it ++) {
+                SSL_SESSION_free(it->second.session);
+            }
+
+            context->sessions.clear();
+            context->order.clear();
+
+            if (context->ctx != NULL) {
+                SSL_CTX_set_app_data(context->ctx, NULL);
+                SSL_CTX_free(context->ctx);
+                context->ctx = NULL;
+            }
+        }
+
+        /**
+         * 进程内共享的客户端ssl上下文, 不会被释放
+         * @return ssl_context_t
+         */
+        ssl_context_t* socket_ssl_shared_context() {
+            static ssl_context_t* context = NULL;
+            static std::once_flag flag;
+
+            std::call_once(flag, []() {
+                ssl_context_t* shared = new ssl_context_t();
+
+                if (socket_ssl_context_new(shared, false)) {
+                    context = shared;
+                } else {
+                    delete shared;
+                }
+            });
+
+            return context;
+        }
+
+        /**
+         * 让ssl_socket_t使用共享的上下文, 会增加上下文的引用计数, socket_ssl_close时释放
+         * @param  ssock   ssl_socket_t
+         * @param  context ssl_context_t
+         * @return         是否成功
+         */
+        bool socket_ssl_use_context(ssl_socket_t* ssock, ssl_context_t* context) {
+            if (context == NULL || context->ctx == NULL || SSL_CTX_up_ref(context->ctx) != 1) {
+                return false;
+            }
+
+            ssock->ctx = context->ctx;
+
+            return true;
+        }
+
         /**
          * 为ssl_ctx添加证书
          * @param  ssock            ssl_socket_t
@@ -121,6 +279,126 @@ namespace clibs {
             return socket_ssl_bind(ssock, ssock->ctx, sock);
         }
 
+        /**
+         * 设置连接的主机名(SNI), 如果缓存中有该主机的会话则尝试恢复, 需要在socket_ssl_connect之前调用
+         * @param  ssock ssl_socket_t
+         * @param  host  主机名
+         * @param  port  端口
+         * @return       是否设置成功
+         */
+        bool socket_ssl_set_host(const ssl_socket_t* ssock, const char* host, unsigned int port) {
+            std::string* key = new std::string(std::string(host) + ":" + std::to_string(port));
+
+            if (SSL_set_ex_data(ssock->ssl, __ssl_session_key_index(), key) != 1) {
+                delete key;
+                return false;
+            }
+
+            if (SSL_set_tlsext_host_name(ssock->ssl, host) != 1) {
+                return false;
+            }
+
+            ssl_context_t* context = (ssl_context_t*)SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssock->ssl));
+
+            if (context != NULL) {
+                std::lock_guard<std::mutex> lock(context->lock);
+                std::map<std::string, ssl_cached_session_t>::iterator it = context->sessions.find(*key);
+
+                if (it != context->sessions.end()) {
+                    if (SSL_SESSION_is_resumable(it->second.session)) {
+                        SSL_set_session(ssock->ssl, it->second.session);
+                        context->order.splice(context->order.begin(), context->order, it->second.order);
+                    } else {
+                        SSL_SESSION_free(it->second.session);
+                        context->order.erase(it->second.order);
+                        context->sessions.erase(it);
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        /** 将协议列表编码为ALPN的格式(长度前缀) */
+        std::string __ssl_alpn_encode(const std::vector<std::string>& protocols) {
+            std::string wire;
+
+            for (std::vector<std::string>::const_iterator it = protocols.begin(); it != protocols.end(); it ++) {
+                if (it->empty() || it->size() > 255) {
+                    continue;
+                }
+
+                wire += (char)it->size();
+                wire += *it;
+            }
+
+            return wire;
+        }
+
+        /**
+         * 设置客户端支持的ALPN协议, 需要在握手之前调用
+         * @param  ssock     ssl_socket_t
+         * @param  protocols 按优先级排列的协议, 例如h2, http/1.1
+         * @return           是否设置成功
+         */
+        bool socket_ssl_set_alpn(const ssl_socket_t* ssock, const std::vector<std::string>& protocols) {
+            std::string wire = __ssl_alpn_encode(protocols);
+
+            // 注意SSL_set_alpn_protos成功时返回0
+            return SSL_set_alpn_protos(ssock->ssl, (const unsigned char*)wire.data(), wire.size()) == 0;
+        }
+
+        /**
+         * 获取握手协商出的ALPN协议
+         * @param  ssock ssl_socket_t
+         * @return       协议名称, 没有协商时为空
+         */
+        std::string socket_ssl_alpn(const ssl_socket_t* ssock) {
+            const unsigned char* data = NULL;
+            unsigned int length = 0;
+
+            SSL_get0_alpn_selected(ssock->ssl, &data, &length);
+
+            return data == NULL ? std::string() : std::string((const char*)data, length);
+        }
+
+        /**
+         * 判断连接是否复用了缓存的会话
+         * @param  ssock ssl_socket_t
+         * @return       true/false
+         */
+        bool socket_ssl_session_reused(const ssl_socket_t* ssock) {
+            return SSL_session_reused(ssock->ssl) == 1;
+        }
+
+        /**
+         * 恢复的会话允许发送的0-RTT数据长度, 为0时不支持early data
+         * @param  ssock ssl_socket_t
+         * @return       允许发送的长度
+         */
+        unsigned int socket_ssl_max_early_data(const ssl_socket_t* ssock) {
+            SSL_SESSION* session = SSL_get_session(ssock->ssl);
+
+            return session == NULL ? 0 : SSL_SESSION_get_max_early_data(session);
+        }
+
+        /**
+         * 在握手完成前发送0-RTT数据, 只能用于可以安全重放的请求
+         * @param  ssock  ssl_socket_t
+         * @param  data   发送的数据
+         * @param  length 数据长度
+         * @return        已经发送的长度, 失败时为-1
+         */
+        int socket_ssl_send_early_data(const ssl_socket_t* ssock, const char* data, unsigned int length) {
+            size_t written = 0;
+
+            if (SSL_write_early_data(ssock->ssl, data, length, &written) != 1) {
+                return -1;
+            }
+
+            return written;
+        }
+
         /**
          * socket连接转ssl连接
          * @param  ssock sslsocket_
@@ -203,14 +481,25 @@ namespace clibs {
 
         /**
          * 读取单行数据
+         * @param  ssock  ssl_socket_t
+         * @param  buffer 接收数据的缓存
+         * @param  size   缓存长度
+         * @return        返回接收到的数据大小, 超过缓存长度时返回SOCKET_LINE_TOO_LONG
+         */
+        int socket_ssl_readline(const ssl_socket_t* ssock, char* buffer, size_t size) {
+            return __socket_readline(buffer, size, [ssock]() -> int {
+                return socket_ssl_recv(ssock);
+            });
+        }
+
+        /**
+         * 读取单行数据, 不检查缓存长度, 对不可信的对端应当使用带size的版本
          * @param  ssock   ssl_socket_t
          * @param  buffer 接收数据的缓存
          * @return        返回接收到的数据大小 
          */
         int socket_ssl_readline(const ssl_socket_t* ssock, char* buffer) {
-            return __socket_readline(buffer, [ssock]() -> int {
-                return socket_ssl_recv(ssock);
-            });
+            return socket_ssl_readline(ssock, buffer, SIZE_MAX);
         }
         
         /**
@@ -223,6 +512,272 @@ namespace clibs {
         int socket_ssl_send(const ssl_socket_t* ssock, const char* data, unsigned int length) {
             return SSL_write(ssock->ssl, data, length);
         }
+
+        /**
+         * 请求在握手后启用内核tls(kTLS), 需要在握手之前调用
+         * 是否真正启用取决于openssl的编译选项, 内核的tls模块与协商出的加密套件, 不满足时自动使用用户态加密
+         * @param  ssock ssl_socket_t
+         * @return       当前openssl是否支持kTLS
+         */
+        bool socket_ssl_enable_ktls(const ssl_socket_t* ssock) {
+    #if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+            SSL_set_options(ssock->ssl, SSL_OP_ENABLE_KTLS);
+            return true;
+    #else
+            return false;
+    #endif
+        }
+
+        /**
+         * 握手后发送方向是否由内核加密
+         * @param  ssock ssl_socket_t
+         * @return       true/false
+         */
+        bool socket_ssl_ktls_send(const ssl_socket_t* ssock) {
+    #if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+            return BIO_get_ktls_send(SSL_get_wbio(ssock->ssl));
+    #else
+            return false;
+    #endif
+        }
+
+        /**
+         * 握手后接收方向是否由内核解密
+         * @param  ssock ssl_socket_t
+         * @return       true/false
+         */
+        bool socket_ssl_ktls_recv(const ssl_socket_t* ssock) {
+    #if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+            return BIO_get_ktls_recv(SSL_get_rbio(ssock->ssl));
+    #else
+            return false;
+    #endif
+        }
+
+    #ifndef _WIN32
+        /**
+         * 发送文件的一部分, 启用kTLS时使用SSL_sendfile在内核中完成加密, 否则读取后通过SSL_write发送
+         * 用于阻塞的套字节
+         * @param  ssock  ssl_socket_t
+         * @param  fd     文件描述符
+         * @param  offset 文件中的起始位置
+         * @param  size   发送长度
+         * @return        已经发送的长度, 失败时为-1
+         */
+        long long int socket_ssl_sendfile(const ssl_socket_t* ssock, int fd, off_t offset, size_t size) {
+            size_t sent = 0;
+
+    #if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+            if (socket_ssl_ktls_send(ssock)) {
+                while (sent < size) {
+                    ossl_ssize_t len = SSL_sendfile(ssock->ssl, fd, offset + sent, size - sent, 0);
+
+                    if (len <= 0) {
+                        // errno只在SSL_ERROR_SYSCALL时由底层调用设置, 其它情况下可能是之前遗留的值
+                        switch (SSL_get_error(ssock->ssl, len)) {
+                            case SSL_ERROR_WANT_WRITE:
+                                continue;
+                            case SSL_ERROR_SYSCALL:
+                                if (errno == EINTR) {
+                                    continue;
+                                }
+                                break;
+                        }
+
+                        return sent > 0 ? sent : -1;
+                    }
+
+                    sent += len;
+                }
+
+                return sent;
+            }
+    #endif
+
+            char buffer[16384];
+
+            while (sent < size) {
+                size_t length = size - sent < sizeof(buffer) ? size - sent : sizeof(buffer);
+                ssize_t len = pread(fd, buffer, length, offset + sent);
+
+                if (len < 0 && errno == EINTR) {
+                    continue;
+                } else if (len <= 0) {
+                    break;
+                }
+
+                if (SSL_write(ssock->ssl, buffer, len) != len) {
+                    return sent > 0 ? sent : -1;
+                }
+
+                sent += len;
+            }
+
+            return sent;
+        }
+    #endif
+
+        /** 将ssl操作的返回值转换为SSL_STATUS_* */
+        int __socket_ssl_status(const ssl_socket_t* ssock, int ret) {
+            switch (SSL_get_error(ssock->ssl, ret)) {
+                case SSL_ERROR_NONE:
+                    return SSL_STATUS_OK;
+                case SSL_ERROR_WANT_READ:
+                    return SSL_STATUS_WANT_READ;
+                case SSL_ERROR_WANT_WRITE:
+                    return SSL_STATUS_WANT_WRITE;
+                case SSL_ERROR_ZERO_RETURN:
+                    return SSL_STATUS_CLOSED;
+                default:
+                    return SSL_STATUS_ERROR;
+            }
+        }
+
+        /**
+         * 在非阻塞套字节上推进握手, 返回WANT_*时等待对应事件后再次调用
+         * @param  ssock     ssl_socket_t
+         * @param  is_server 是否为服务端
+         * @return           SSL_STATUS_*
+         */
+        int socket_ssl_handshake(const ssl_socket_t* ssock, bool is_server) {
+            if (SSL_in_before(ssock->ssl)) {
+                if (is_server) {
+                    SSL_set_accept_state(ssock->ssl);
+                } else {
+                    SSL_set_connect_state(ssock->ssl);
+                }
+            }
+
+            int ret = SSL_do_handshake(ssock->ssl);
+
+            return ret == 1 ? SSL_STATUS_OK : __socket_ssl_status(ssock, ret);
+        }
+
+        /**
+         * 非阻塞读取数据, 握手中的重协商或tls1.3的ticket可能让读操作返回WANT_WRITE
+         * @param  ssock  ssl_socket_t
+         * @param  buffer 接收数据的缓存
+         * @param  length 读取长度
+         * @param  bytes  实际读取到的长度
+         * @return        SSL_STATUS_*
+         */
+        int socket_ssl_read(const ssl_socket_t* ssock, char* buffer, unsigned int length, size_t* bytes) {
+            *bytes = 0;
+            int ret = SSL_read_ex(ssock->ssl, buffer, length, bytes);
+
+            return ret == 1 ? SSL_STATUS_OK : __socket_ssl_status(ssock, ret);
+        }
+
+        /**
+         * 非阻塞发送数据, 返回WANT_*后必须使用相同的数据与长度重试
+         * @param  ssock  ssl_socket_t
+         * @param  data   发送的数据
+         * @param  length 数据长度
+         * @param  bytes  实际发送的长度
+         * @return        SSL_STATUS_*
+         */
+        int socket_ssl_write(const ssl_socket_t* ssock, const char* data, unsigned int length, size_t* bytes) {
+            *bytes = 0;
+            int ret = SSL_write_ex(ssock->ssl, data, length, bytes);
+
+            return ret == 1 ? SSL_STATUS_OK : __socket_ssl_status(ssock, ret);
+        }
+
+        /**
+         * 非阻塞地发送close_notify, 不等待对方的回应
+         * @param  ssock ssl_socket_t
+         * @return       SSL_STATUS_*
+         */
+        int socket_ssl_shutdown(const ssl_socket_t* ssock) {
+            int ret = SSL_shutdown(ssock->ssl);
+
+            return ret >= 0 ? SSL_STATUS_OK : __socket_ssl_status(ssock, ret);
+        }
+
+    #ifdef OS_LINUX
+        /** SSL_STATUS_*对应需要监听的事件 */
+        int socket_ssl_events(int status) {
+            return status == SSL_STATUS_WANT_WRITE ? EVENT_WRITE : EVENT_READ;
+        }
+
+        /** 异步握手结束的回调, 失败时status为SSL_STATUS_ERROR/SSL_STATUS_CLOSED, 超时为SSL_STATUS_WANT_* */
+        typedef std::function<void(bool ok, int status)> ssl_handshake_callback;
+
+        /** 异步握手过程中保存的状态 */
+        typedef struct {
+            const ssl_socket_t* ssock;
+            SOCKET sockfd;
+            bool is_server;
+            int events; // 当前监听的事件, 0为还未加入事件循环
+            io::event_loop_t* loop;
+            unsigned long long int timer;
+            ssl_handshake_callback callback;
+        } __async_handshake_t;
+
+        /** 推进握手, 结束时从事件循环中移除描述符并执行回调 */
+        void __socket_ssl_handshake_step(std::shared_ptr<__async_handshake_t> task) {
+            int status = socket_ssl_handshake(task->ssock, task->is_server);
+
+            if (status == SSL_STATUS_WANT_READ || status == SSL_STATUS_WANT_WRITE) {
+                int events = socket_ssl_events(status);
+
+                if (task->events == 0) {
+                    // 监听回调持有task, 握手结束移除监听时释放
+                    io::event_loop_add(task->loop, task->sockfd, events, [task](SOCKET, int) {
+                        __socket_ssl_handshake_step(task);
+                    });
+                } else if (task->events != events) {
+                    io::event_loop_modify(task->loop, task->sockfd, events);
+                }
+
+                task->events = events;
+                return;
+            }
+
+            if (task->events != 0) {
+                io::event_loop_remove(task->loop, task->sockfd);
+            }
+
+            io::event_loop_cancel_timer(task->loop, task->timer);
+            task->callback(status == SSL_STATUS_OK, status);
+        }
+
+        /**
+         * 在事件循环上异步完成握手, 描述符在握手期间由本函数监听, 结束后移除
+         * ssock在回调之前必须保持有效, 套字节需为非阻塞模式
+         * @param loop      event_loop_t
+         * @param ssock     已经绑定套字节的ssl_socket_t
+         * @param sockfd    套字节描述符
+         * @param is_server 是否为服务端
+         * @param timeout   超时时间(毫秒), 0为不限制
+         * @param callback  握手结束后的回调, 只会被调用一次
+         */
+        void socket_ssl_handshake_async(io::event_loop_t* loop, const ssl_socket_t* ssock, SOCKET sockfd, bool is_server, unsigned int timeout, ssl_handshake_callback callback) {
+            std::shared_ptr<__async_handshake_t> task = std::make_shared<__async_handshake_t>();
+
+            task->ssock = ssock;
+            task->sockfd = sockfd;
+            task->is_server = is_server;
+            task->events = 0;
+            task->loop = loop;
+            task->timer = 0;
+            task->callback = callback;
+
+            if (timeout > 0) {
+                task->timer = io::event_loop_add_timer(loop, timeout, [task]() {
+                    task->timer = 0;
+
+                    if (task->events != 0) {
+                        io::event_loop_remove(task->loop, task->sockfd);
+                    }
+
+                    task->callback(false, task->events == EVENT_WRITE ? SSL_STATUS_WANT_WRITE : SSL_STATUS_WANT_READ);
+                });
+            }
+
+            __socket_ssl_handshake_step(task);
+        }
+    #endif
     }
 }
 
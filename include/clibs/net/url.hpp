@@ -28,14 +28,16 @@ namespace clibs {
         bool url_parse(url_t* url, std::string url_content) {
             std::string port;
 
-            CRegexp reg("^([a-zA-Z]+)://([^/:]+|)(:[\\d]+|)(/[^\\?#]+|)(\\?[^#]+|)(#.+|)$");
+            // 正则只编译一次, 异步请求时url解析运行在事件循环的线程中
+            static CRegexp reg("^([a-zA-Z]+)://([^/:]+|)(:[\\d]+|)(/[^\\?#]*|)(\\?[^#]+|)(#.+|)$");
             CMatcher matcher = reg.matches(url_content);
 
             if (matcher.find()) {
                 std::smatch smatch = matcher.result();
                 url->protocol = smatch.format("$1");
                 url->host = smatch.format("$2");
-                port = std::regex_replace(smatch.format("$3"), std::regex(":"), "");
+                port = smatch.format("$3");
+                port = port.empty() ? port : port.substr(1);
                 url->path = smatch.format("$4");
                 url->query = smatch.format("$5");
                 url->hash = smatch.format("$6");
@@ -5,6 +5,8 @@
 #include <cstring>
 #include <sstream>
 #include "clibs/net/sslsocket.hpp"
+#include "clibs/net/connector.hpp"
+#include "clibs/net/output_buffer.hpp"
 #include "clibs/net/url.hpp"
 #include "clibs/io/select.hpp"
 #include "clibs/net/http/http_reader.hpp"
@@ -39,9 +41,13 @@ namespace clibs {
             typedef struct {
                 socket_t socket;
                 ssl_socket_t ssl_socket;
+                ssl_context_t* ssl_context; // 共享的ssl上下文, 为NULL时使用进程内共享的上下文
                 unsigned int connect_timeout;
                 unsigned int read_timeout;
                 bool is_ssl;
+                socket_tuning_t tuning;
+                output_buffer_t output; // 待发送的数据
+                std::string buffered; // 读取握手响应时多读入的数据, 先于套字节中的数据读取
                 std::string error;
             } websocket_t;
 
@@ -55,62 +61,28 @@ namespace clibs {
                 ws->socket.sockfd = -1;
                 ws->ssl_socket.ssl = NULL;
                 ws->ssl_socket.ctx = NULL;
+                ws->ssl_context = NULL;
+                ws->buffered.clear();
                 ws->connect_timeout = 15;
                 ws->read_timeout = 15;
+                socket_tuning_preset(&ws->tuning, TUNING_LOW_LATENCY);
+                output_buffer_init(&ws->output);
             }
 
             /** 连接服务器 */
             bool websocket_connect(websocket_t* ws, url_t* url, io::select_t* s_select, io::select_result_t* result) {
-                if (!socket_set_address(&ws->socket, url->host.c_str(), url->port)) {
-                    ws->error = "Unable to get host address";
-                    return false;
-                }
-
-                if (!socket_new(ws->socket.addr.sin_family, SOCK_STREAM, 0, &ws->socket)) {
-                    ws->error = "Failed to initialize socket";
-                    return false;
-                }
-
-                if (!socket_blocking(&ws->socket, false)) {
-                    ws->error = "Failed to set socket blocking";
-                    return false;
-                }
-
-                socket_connect(&ws->socket);
-
-                io::select_append(s_select, ws->socket.sockfd, ST_WRITE | ST_EXCEPT);
-
-                int ret = io::select_wait(s_select, result, ws->connect_timeout);
-
-                if (ret <= 0) {
+                if (!socket_connect_dual_stack(&ws->socket, url->host.c_str(), url->port, SOCK_STREAM, ws->connect_timeout * 1000, 250, &ws->tuning)) {
                     ws->error = "Failed to connect to the server";
                     return false;
                 }
 
-                if (io::select_find(&result->exception, ws->socket.sockfd) != result->exception.end()) {
-                    ws->error = "An error occurred while connecting to the server";
-                    return false;
-                }
-
-                if (io::select_find(&result->write, ws->socket.sockfd) == result->write.end()) {
-                    ws->error = "Output waiting failed";
-                    return false;
-                }
-
-                io::select_remove(s_select, ws->socket.sockfd, ST_WRITE | ST_EXCEPT);
-
-                if (!socket_blocking(&ws->socket, true)) {
-                    ws->error = "Failed to restore socket blocking";
-                    return false;
-                }
-
                 if (ws->is_ssl) {
-                    if (!socket_ssl_new(&ws->ssl_socket)) {
+                    if (!socket_ssl_use_context(&ws->ssl_socket, ws->ssl_context != NULL ? ws->ssl_context : socket_ssl_shared_context())) {
                         ws->error = "Failed to initialize SSL";
                         return false;
                     }
 
-                    if (!socket_ssl_bind(&ws->ssl_socket, &ws->socket)) {
+                    if (!socket_ssl_bind(&ws->ssl_socket, &ws->socket) || !socket_ssl_set_host(&ws->ssl_socket, url->host.c_str(), url->port)) {
                         ws->error = "Socket to SSL connection failed";
                         return false;
                     }
@@ -144,29 +116,26 @@ namespace clibs {
                 return b64key;
             }
 
-            /** 发送socket数据 */
-            bool websocket_send_data(websocket_t* ws, const char* data, unsigned int length) {
-                int offset = 0;
-                int len;
-
-                while (offset < length) {
-                    if (ws->is_ssl) {
-                        len = socket_ssl_send(&ws->ssl_socket, data + offset, length - offset);
-                    } else {
-                        len = socket_send(&ws->socket, data + offset, length - offset);
-                    }
+            /** 发送输出缓冲区中的所有数据 */
+            bool websocket_flush(websocket_t* ws) {
+                int ret = ws->is_ssl ? output_buffer_flush(&ws->output, &ws->ssl_socket, &ws->socket) : output_buffer_flush(&ws->output, &ws->socket);
 
-                    if (len <= 0) {
-                        ws->error = "Failed to send data";
-                        return false;
-                    } else {
-                        offset += len;
-                    }
+                if (ret != OUTPUT_FLUSHED) {
+                    output_buffer_clear(&ws->output);
+                    ws->error = "Failed to send data";
+                    return false;
                 }
 
                 return true;
             }
 
+            /** 发送socket数据 */
+            bool websocket_send_data(websocket_t* ws, const char* data, unsigned int length) {
+                output_buffer_append_ref(&ws->output, data, length, NULL);
+
+                return websocket_flush(ws);
+            }
+
             /** 发送握手请求 */
             bool websocket_send_handshake(websocket_t* ws, url_t *url, std::string key, int version, std::string protocol) {
                 std::stringstream stream;
@@ -215,6 +184,9 @@ namespace clibs {
                 if (!http::reader_parse_header(&reader, headers)) {
                     return false;
                 } else {
+                    // 服务端可能紧跟着握手响应发送了数据帧
+                    ws->buffered = http::reader_take_buffer(&reader);
+
                     if (reader.status_code != 101 && !headers->contains("Sec-WebSocket-Accept")) {
                         return false;
                     } else {
@@ -225,11 +197,28 @@ namespace clibs {
 
             /** 接收socket数据 */
             int websocket_recv_must(websocket_t* ws, char* buffer, unsigned int length) {
+                unsigned int offset = 0;
+
+                if (!ws->buffered.empty()) {
+                    offset = ws->buffered.size() < length ? ws->buffered.size() : length;
+                    memcpy(buffer, ws->buffered.data(), offset);
+                    ws->buffered.erase(0, offset);
+
+                    if (offset == length) {
+                        return length;
+                    }
+                }
+
+                int len;
+
                 if (ws->is_ssl) {
-                    return socket_ssl_recv_must(&ws->ssl_socket, buffer, length);
+                    len = socket_ssl_recv_must(&ws->ssl_socket, buffer + offset, length - offset);
+                    __socket_count_recv(&ws->socket, len);
                 } else {
-                    return socket_recv_must(&ws->socket, buffer, length);
+                    len = socket_recv_must(&ws->socket, buffer + offset, length - offset);
                 }
+
+                return len <= 0 ? len : len + offset;
             }
 
             /** 解析websocket包的信息 */
@@ -309,20 +298,14 @@ namespace clibs {
                 }
             }
 
-            /** 发送websocket数据包 */
+            /** 发送websocket数据包, 帧头与数据通过一次writev发出 */
             bool websocket_send(websocket_t* ws, bool is_fin, int opcode, bool use_mask, const char* data, unsigned int length) {
-                int header_size = 14, real_size = 0;
-                char pkg_data[length + 14], *pkg = pkg_data;
-
-                if (is_fin) {
-                    *pkg = 0x80;
-                }
+                int real_size = 0;
+                char header[14], *pkg = header;
 
+                *pkg = is_fin ? 0x80 : 0x00;
                 *pkg++ |= opcode;
-
-                if (use_mask) {
-                    *pkg = 0x80;
-                }
+                *pkg = use_mask ? 0x80 : 0x00;
 
                 if (length < 126) {
                     *pkg++ |= (length & 0x7F);
@@ -332,13 +315,10 @@ namespace clibs {
                     *pkg++ = (length >> 8) & 0xFF;
                     *pkg++ = (length >> 0) & 0xFF;
                     real_size = 4;
-                } else if (length < 0xFFFFFFFF) {
+                } else {
                     *pkg++ |= 0x7F;
 
-                    // *pkg++ = (length >> 56) & 0xFF;
-                    // *pkg++ = (length >> 48) & 0xFF;
-                    // *pkg++ = (length >> 40) & 0xFF;
-                    // *pkg++ = (length >> 32) & 0xFF;
+                    // unsigned int的长度不会超过32位
                     *pkg++ = 0;
                     *pkg++ = 0;
                     *pkg++ = 0;
@@ -354,22 +334,21 @@ namespace clibs {
                 if (use_mask) {
                     char mask_buffer[4];
                     websocket_random_mask(mask_buffer, 4);
-                    *pkg++ = mask_buffer[0];
-                    *pkg++ = mask_buffer[1];
-                    *pkg++ = mask_buffer[2];
-                    *pkg++ = mask_buffer[3];
+                    memcpy(pkg, mask_buffer, 4);
                     real_size += 4;
 
-                    memcpy(pkg, data, length);
-                    websocket_mask(mask_buffer, pkg, length);
+                    // 掩码会修改数据, 拷贝一份后移入输出缓冲区
+                    std::string payload(data, length);
+                    websocket_mask(mask_buffer, &payload[0], length);
+
+                    output_buffer_append(&ws->output, header, real_size);
+                    output_buffer_append(&ws->output, std::move(payload));
                 } else {
-                    memcpy(pkg, data, length);
+                    output_buffer_append(&ws->output, header, real_size);
+                    output_buffer_append_ref(&ws->output, data, length, NULL);
                 }
 
-                real_size += length;
-                pkg_data[real_size] = '\0';
-
-                return websocket_send_data(ws, pkg_data, real_size);
+                return websocket_flush(ws);
             }
 
             /** 基类封装 */
@@ -407,6 +386,31 @@ namespace clibs {
                         m_websocket.read_timeout = timeout;
                     }
 
+                    /** 设置tcp调优参数, 默认使用TUNING_LOW_LATENCY */
+                    void set_tuning(const socket_tuning_t* tuning) {
+                        m_websocket.tuning = *tuning;
+                    }
+
+                    /** 使用预设的tcp调优参数 */
+                    void set_tuning(int preset) {
+                        socket_tuning_preset(&m_websocket.tuning, preset);
+                    }
+
+                    /** 设置ssl上下文, 默认使用进程内共享的上下文 */
+                    void set_ssl_context(ssl_context_t* context) {
+                        m_websocket.ssl_context = context;
+                    }
+
+                    /** 获取连接的统计信息, 需要定义CLIBS_SOCKET_STATS */
+                    bool get_socket_stats(socket_stats_t* stats) {
+                        return socket_stats(&m_websocket.socket, stats);
+                    }
+
+                    /** 按interval毫秒的间隔采样连接的TCP_INFO */
+                    bool get_tcp_info(socket_tcp_info_t* info, unsigned int interval) {
+                        return socket_tcp_info_sample(&m_websocket.socket, info, interval);
+                    }
+
                     /** 获取错误信息 */
                     std::string error() {
                         return m_websocket.error == "" ? errstr() : m_websocket.error;
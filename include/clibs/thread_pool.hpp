@@ -109,7 +109,11 @@ namespace clibs {
 
     /** 关闭线程池 */
     void thread_pool_shutdown(thread_pool_t* thread_pool) {
-        thread_pool->running = false;
+        // 持有锁修改状态, 避免线程在检查条件之后, 进入等待之前错过通知
+        {
+            std::unique_lock<std::mutex> lock{ thread_pool->lock };
+            thread_pool->running = false;
+        }
 
         thread_pool->condition_variable.notify_all();
 
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <vector>
+#include "clibs/net/acceptor.hpp"
+#include "clibs/io/event_loop.hpp"
+#include "clibs/error.hpp"
+
+using namespace clibs;
+using namespace clibs::net;
+using namespace clibs::io;
+
+int main(int argc, char const *argv[])
+{
+    event_loop_t loop;
+    socket_t server;
+    acceptor_t acceptor;
+    std::vector<socket_t> clients, conns;
+    int total = 64;
+
+    event_loop_init(&loop);
+    socket_new(AF_INET, SOCK_STREAM, 0, &server);
+
+    int val = 1;
+    socket_setsockopt(&server, SOL_SOCKET, SO_REUSEADDR, (void*)&val, sizeof(val));
+
+    if (!socket_bind(&server, "127.0.0.1", 1234) || !socket_listen(&server, 128)) {
+        std::cout << errstr() << std::endl;
+        exit(1);
+    }
+
+    // 每次唤醒最多接收16个连接, 最多同时保持32个连接
+    acceptor_init(&acceptor, &server, 16, 32);
+    acceptor_attach(&acceptor, &loop, [&conns](socket_t* sock) {
+        conns.push_back(*sock);
+    });
+
+    for (int i = 0; i < total; i ++) {
+        socket_t client;
+        socket_new(AF_INET, SOCK_STREAM, 0, &client);
+        socket_connect(&client, "127.0.0.1", 1234);
+        clients.push_back(client);
+    }
+
+    for (int i = 0; i < 10; i ++) {
+        event_loop_run_once(&loop, 10);
+    }
+
+    std::cout << "accepted: " << acceptor.accepted << ", active: " << acceptor.active << ", paused: " << acceptor.paused << std::endl;
+
+    // 关闭一半的连接, 监听恢复后接收剩余的连接
+    for (int i = 0; i < 16; i ++) {
+        socket_close(&conns[i]);
+        acceptor_release(&acceptor);
+    }
+
+    for (int i = 0; i < 10; i ++) {
+        event_loop_run_once(&loop, 10);
+    }
+
+    std::cout << "accepted: " << acceptor.accepted << ", active: " << acceptor.active << ", paused: " << acceptor.paused << std::endl;
+    std::cout << "rejected: " << acceptor.rejected << ", emfile: " << acceptor.emfile << std::endl;
+
+    for (std::vector<socket_t>::iterator it = clients.begin(); it != clients.end(); it ++) {
+        socket_close(&(*it));
+    }
+
+    acceptor_close(&acceptor);
+    socket_close(&server);
+    event_loop_close(&loop);
+
+    return 0;
+}
@@ -0,0 +1,14 @@
+#ifndef _CLIBS_TESTS_CHECK_H_
+#define _CLIBS_TESTS_CHECK_H_ 1
+
+#include <iostream>
+
+/**
+ * 测试共用的断言, 输出每一项的结果
+ */
+
+void check(const char* name, bool ok) {
+	std::cout << (ok ? "[ok]   " : "[FAIL] ") << name << std::endl;
+}
+
+#endif
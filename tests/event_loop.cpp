@@ -0,0 +1,119 @@
+#include <iostream>
+#include <vector>
+#include <sys/resource.h>
+#include "clibs/net/connector.hpp"
+#include "clibs/io/event_loop.hpp"
+#include "clibs/error.hpp"
+
+using namespace clibs;
+using namespace clibs::net;
+using namespace clibs::io;
+
+int main(int argc, char const *argv[])
+{
+    event_loop_t loop;
+    socket_t server;
+    int total = argc > 1 ? atoi(argv[1]) : 1000, finished = 0, connected = 0, accepted = 0;
+
+    if (!event_loop_init(&loop)) {
+        std::cout << "Failed to init event loop." << std::endl;
+        exit(1);
+    }
+
+    socket_new(AF_INET, SOCK_STREAM, 0, &server);
+
+    int val = 1;
+    socket_setsockopt(&server, SOL_SOCKET, SO_REUSEADDR, (void*)&val, sizeof(val));
+
+    if (!socket_bind(&server, "127.0.0.1", 1234) || !socket_listen(&server, 4096)) {
+        std::cout << errstr() << std::endl;
+        exit(1);
+    }
+
+    event_loop_add(&loop, server.sockfd, EVENT_READ, [&server, &accepted](SOCKET sockfd, int events) {
+        socket_t client;
+
+        if (socket_accept(&server, &client) != -1) {
+            accepted ++;
+            socket_close(&client);
+        }
+    });
+
+    for (int i = 0; i < total; i ++) {
+        connector_async(&loop, "127.0.0.1", 1234, SOCK_STREAM, 5000, [&](bool ok, socket_t* sock, int error) {
+            finished ++;
+
+            if (ok) {
+                connected ++;
+                socket_close(sock);
+            } else {
+                std::cout << "connect failed: " << strerror(error) << std::endl;
+            }
+        });
+    }
+
+    // 连接一个没有监听的端口, 应当很快失败
+    connector_async(&loop, "127.0.0.1", 1, SOCK_STREAM, 5000, [&](bool ok, socket_t* sock, int error) {
+        std::cout << "closed port: " << (ok ? "connected" : strerror(error)) << std::endl;
+    });
+
+    while (finished < total || accepted < connected) {
+        if (event_loop_run_once(&loop, 1000) <= 0 && finished >= total) {
+            break;
+        }
+    }
+
+    std::cout << "connected: " << connected << "/" << total << ", accepted: " << accepted << std::endl;
+
+    // 不足1毫秒的定时器不会让循环以0超时空转
+    bool fired = false;
+    int wakeups = 0;
+
+    event_loop_add_timer(&loop, 1, [&fired]() {
+        fired = true;
+    });
+
+    while (!fired) {
+        event_loop_run_once(&loop, 1000);
+        wakeups ++;
+    }
+
+    std::cout << "timer wakeups: " << wakeups << std::endl;
+
+    // 同步连接使用poll, 描述符超过FD_SETSIZE时也可以使用
+    struct rlimit limit;
+    std::vector<int> fillers;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_max > FD_SETSIZE + 64) {
+        limit.rlim_cur = FD_SETSIZE + 64;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    while (fillers.size() < FD_SETSIZE) {
+        int fd = dup(server.sockfd);
+
+        if (fd < 0) {
+            break;
+        }
+
+        fillers.push_back(fd);
+    }
+
+    socket_t blocking;
+    bool blocking_ok = socket_connect_dual_stack(&blocking, "127.0.0.1", 1234, SOCK_STREAM, 5000, 250, NULL);
+    std::cout << "blocking connect with fd " << (blocking_ok ? blocking.sockfd : -1) << ": " << (blocking_ok ? "ok" : strerror(errno)) << std::endl;
+
+    if (blocking_ok) {
+        socket_close(&blocking);
+    }
+
+    for (size_t i = 0; i < fillers.size(); i ++) {
+        close(fillers[i]);
+    }
+
+    event_loop_remove(&loop, server.sockfd);
+    socket_close(&server);
+    event_loop_close(&loop);
+
+    return 0;
+}
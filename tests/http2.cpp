@@ -0,0 +1,455 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include "local_server.hpp"
+#include "clibs/net/http/http2.hpp"
+
+using namespace clibs::net;
+using namespace clibs::net::http;
+
+/**
+ * HTTP/2客户端测试, 在本地启动一个h2c服务端, 每次读取后等待1ms模拟网络往返
+ * 用法: http2 [端口]
+ */
+
+std::atomic<int> goaway_after(0); // 每个连接处理多少个流后发送GOAWAY, 0为不限制
+std::atomic<int> server_max_streams(1000); // 服务端的SETTINGS_MAX_CONCURRENT_STREAMS
+std::atomic<int> server_window(HTTP2_DEFAULT_WINDOW); // 服务端的SETTINGS_INITIAL_WINDOW_SIZE
+std::atomic<int> max_open(0); // 服务端同时打开的流的最大数量
+
+std::string unhex(const std::string& hex) {
+	std::string data;
+
+	for (size_t i = 0; i < hex.size(); i += 2) {
+		data.push_back((char)strtol(hex.substr(i, 2).c_str(), NULL, 16));
+	}
+
+	return data;
+}
+
+/** 服务端的流 */
+typedef struct {
+	std::string method;
+	std::string path;
+	std::string body;
+	bool ended; // 请求已经完整
+	bool responded;
+	std::string data; // 等待发送的响应body
+	size_t sent;
+	bool trailers;
+	long long int window;
+} server_stream_t;
+
+/** 按路径生成响应: /big/N返回N字节, /trailers带trailer, /header带很长的响应头, POST返回请求body, 其它路径返回路径本身 */
+void server_respond(hpack_encoder_t* encoder, unsigned int id, server_stream_t* stream, std::string* output) {
+	std::string block;
+	std::string status = "200";
+
+	if (stream->path.compare(0, 5, "/big/") == 0) {
+		stream->data.assign(atoi(stream->path.c_str() + 5), 'x');
+	} else if (stream->method == "POST") {
+		stream->data = stream->body;
+	} else {
+		stream->data = stream->path;
+	}
+
+	std::string length = std::to_string(stream->data.size());
+	hpack_encode_field(encoder, {":status", 7}, {status.data(), status.size()}, &block);
+	hpack_encode_field(encoder, {"content-length", 14}, {length.data(), length.size()}, &block);
+	hpack_encode_field(encoder, {"x-path", 6}, {stream->path.data(), stream->path.size()}, &block);
+
+	if (stream->path == "/header") {
+		std::string large(6000, 'h');
+		hpack_encode_field(encoder, {"x-large", 7}, {large.data(), large.size()}, &block);
+	}
+
+	stream->trailers = stream->path == "/trailers";
+
+	if (stream->method == "HEAD") {
+		stream->data.clear();
+	}
+
+	// 头部块按1024字节拆分, 测试CONTINUATION
+	http2_headers_append(output, id, block, stream->data.empty() && !stream->trailers, 1024);
+	stream->responded = true;
+}
+
+/** 在客户端的流量控制窗口内发送响应body */
+void server_pump(std::map<unsigned int, server_stream_t>* streams, hpack_encoder_t* encoder, long long int* window, std::string* output) {
+	for (std::map<unsigned int, server_stream_t>::iterator it = streams->begin(); it != streams->end(); ) {
+		server_stream_t* stream = &it->second;
+
+		while (stream->responded && stream->sent < stream->data.size() && stream->window > 0 && *window > 0) {
+			long long int length = stream->data.size() - stream->sent;
+			length = std::min(length, (long long int)HTTP2_DEFAULT_FRAME_SIZE);
+			length = std::min(length, stream->window);
+			length = std::min(length, *window);
+
+			bool last = stream->sent + length == stream->data.size() && !stream->trailers;
+			http2_frame_append(output, HTTP2_FRAME_DATA, last ? HTTP2_FLAG_END_STREAM : 0, it->first, stream->data.data() + stream->sent, length);
+			stream->sent += length;
+			stream->window -= length;
+			*window -= length;
+		}
+
+		if (stream->responded && stream->sent == stream->data.size()) {
+			if (stream->trailers) {
+				std::string block;
+				hpack_encode_field(encoder, {"x-checksum", 10}, {"abc", 3}, &block);
+				http2_headers_append(output, it->first, block, true, HTTP2_DEFAULT_FRAME_SIZE);
+			}
+
+			it = streams->erase(it);
+		} else {
+			it ++;
+		}
+	}
+}
+
+void serve(socket_t nsock) {
+	hpack_encoder_t encoder;
+	hpack_decoder_t decoder;
+	std::map<unsigned int, server_stream_t> streams;
+	std::string input, block, output;
+	unsigned int block_stream = 0, last_stream = HTTP2_MAX_STREAM_ID, handled = 0;
+	bool block_end = false, preface = false, closing = false;
+	long long int window = HTTP2_DEFAULT_WINDOW, initial_window = HTTP2_DEFAULT_WINDOW;
+	char buffer[HTTP2_BUFFER];
+
+	hpack_encoder_init(&encoder);
+	hpack_decoder_init(&decoder, 0);
+	http2_settings_append(&output, {
+		{HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, (unsigned int)server_max_streams},
+		{HTTP2_SETTINGS_INITIAL_WINDOW_SIZE, (unsigned int)server_window}
+	});
+
+	while (true) {
+		if (!output.empty()) {
+			socket_send(&nsock, output.data(), output.size());
+			output.clear();
+		}
+
+		if (closing && streams.empty()) {
+			break;
+		}
+
+		int len = socket_recv(&nsock, buffer, sizeof(buffer));
+
+		if (len <= 0) {
+			break;
+		}
+
+		input.append(buffer, len);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		if (!preface) {
+			if (input.size() < HTTP2_PREFACE_LENGTH) {
+				continue;
+			}
+
+			input.erase(0, HTTP2_PREFACE_LENGTH);
+			preface = true;
+		}
+
+		size_t offset = 0;
+
+		while (input.size() - offset >= HTTP2_FRAME_HEADER_SIZE) {
+			http2_frame_t frame;
+			http2_frame_parse(input.data() + offset, &frame);
+
+			if (input.size() - offset - HTTP2_FRAME_HEADER_SIZE < frame.length) {
+				break;
+			}
+
+			const char* payload = input.data() + offset + HTTP2_FRAME_HEADER_SIZE;
+			size_t start, length;
+			offset += HTTP2_FRAME_HEADER_SIZE + frame.length;
+
+			if (frame.type == HTTP2_FRAME_SETTINGS && !(frame.flags & HTTP2_FLAG_ACK)) {
+				for (size_t i = 0; i < frame.length; i += 6) {
+					if (payload[i + 1] == HTTP2_SETTINGS_INITIAL_WINDOW_SIZE) {
+						long long int value = __http2_get32(payload + i + 2);
+
+						for (std::map<unsigned int, server_stream_t>::iterator it = streams.begin(); it != streams.end(); it ++) {
+							it->second.window += value - initial_window;
+						}
+
+						initial_window = value;
+					}
+				}
+
+				http2_frame_append(&output, HTTP2_FRAME_SETTINGS, HTTP2_FLAG_ACK, 0, NULL, 0);
+			} else if (frame.type == HTTP2_FRAME_WINDOW_UPDATE) {
+				long long int increment = __http2_get32(payload);
+
+				if (frame.stream_id == 0) {
+					window += increment;
+				} else if (streams.count(frame.stream_id)) {
+					streams[frame.stream_id].window += increment;
+				}
+			} else if (frame.type == HTTP2_FRAME_HEADERS || frame.type == HTTP2_FRAME_CONTINUATION) {
+				if (frame.type == HTTP2_FRAME_HEADERS) {
+					http2_frame_payload(&frame, payload, &start, &length);
+					block.assign(payload + start, length);
+					block_stream = frame.stream_id;
+					block_end = frame.flags & HTTP2_FLAG_END_STREAM;
+				} else {
+					block.append(payload, frame.length);
+				}
+
+				if (!(frame.flags & HTTP2_FLAG_END_HEADERS)) {
+					continue;
+				}
+
+				std::vector<hpack_header_t> headers;
+				hpack_decode(&decoder, block.data(), block.size(), &headers);
+
+				// GOAWAY之后的流不处理, 超过并发限制的流拒绝, 客户端可以重发
+				if (block_stream > last_stream) {
+					continue;
+				} else if (streams.size() >= (size_t)server_max_streams) {
+					http2_rst_stream_append(&output, block_stream, HTTP2_REFUSED_STREAM);
+					continue;
+				}
+
+				server_stream_t stream = {"", "", "", block_end, false, "", 0, false, initial_window};
+
+				for (size_t i = 0; i < headers.size(); i ++) {
+					if (headers[i].name == ":method") {
+						stream.method = headers[i].value;
+					} else if (headers[i].name == ":path") {
+						stream.path = headers[i].value;
+					}
+				}
+
+				streams[block_stream] = stream;
+				handled ++;
+
+				if (goaway_after > 0 && handled == (unsigned int)goaway_after) {
+					last_stream = block_stream;
+					closing = true;
+					http2_goaway_append(&output, last_stream, HTTP2_NO_ERROR);
+				}
+			} else if (frame.type == HTTP2_FRAME_DATA) {
+				http2_frame_payload(&frame, payload, &start, &length);
+
+				if (frame.length > 0) {
+					http2_window_update_append(&output, 0, frame.length);
+				}
+
+				if (streams.count(frame.stream_id)) {
+					server_stream_t* stream = &streams[frame.stream_id];
+					stream->body.append(payload + start, length);
+					stream->ended = frame.flags & HTTP2_FLAG_END_STREAM;
+
+					if (frame.length > 0 && !stream->ended) {
+						http2_window_update_append(&output, frame.stream_id, frame.length);
+					}
+				}
+			} else if (frame.type == HTTP2_FRAME_RST_STREAM) {
+				streams.erase(frame.stream_id);
+			} else if (frame.type == HTTP2_FRAME_PING && !(frame.flags & HTTP2_FLAG_ACK)) {
+				http2_frame_append(&output, HTTP2_FRAME_PING, HTTP2_FLAG_ACK, 0, payload, 8);
+			} else if (frame.type == HTTP2_FRAME_GOAWAY) {
+				closing = true;
+			}
+		}
+
+		input.erase(0, offset);
+
+		int open = 0;
+
+		for (std::map<unsigned int, server_stream_t>::iterator it = streams.begin(); it != streams.end(); it ++) {
+			open ++;
+
+			if (it->second.ended && !it->second.responded) {
+				server_respond(&encoder, it->first, &it->second, &output);
+			}
+		}
+
+		while (open > max_open) {
+			int current = max_open;
+			max_open.compare_exchange_weak(current, open);
+		}
+
+		server_pump(&streams, &encoder, &window, &output);
+	}
+
+	socket_shutdown(&nsock, SHUT_RDWR);
+	socket_close(&nsock);
+}
+
+/** 添加n个GET请求, 检查所有响应的body都是请求路径 */
+bool run_gets(CHttp2Client* client, int n, const std::string& prefix) {
+	client->clear();
+
+	for (int i = 0; i < n; i ++) {
+		client->get(prefix + std::to_string(i));
+	}
+
+	bool ok = client->execute();
+
+	for (int i = 0; i < n; i ++) {
+		ok = ok && client->get_response(i)->status_code == 200 && client->get_response(i)->body == prefix + std::to_string(i);
+	}
+
+	return ok;
+}
+
+int main(int argc, char const *argv[])
+{
+	int port = argc > 1 ? atoi(argv[1]) : 8048;
+	std::string base = "http://127.0.0.1:" + std::to_string(port);
+	socket_t sock;
+
+	// RFC 7541 C.4中使用huffman编码的请求
+	{
+		hpack_decoder_t decoder;
+		hpack_decoder_init(&decoder, 0);
+		const char* blocks[] = {
+			"828684418cf1e3c2e5f23a6ba0ab90f4ff",
+			"828684be5886a8eb10649cbf",
+			"828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"
+		};
+		std::vector<hpack_header_t> headers;
+		bool ok = true;
+
+		for (int i = 0; i < 3; i ++) {
+			std::string block = unhex(blocks[i]);
+			headers.clear();
+			ok = ok && hpack_decode(&decoder, block.data(), block.size(), &headers) == HPACK_OK;
+		}
+
+		check("hpack decode", ok && headers.size() == 5 && headers[3].value == "www.example.com" && headers[4].name == "custom-key"
+			&& headers[4].value == "custom-value" && decoder.table.size == 164);
+	}
+
+	// 重复的请求头在动态表中只发送一次
+	{
+		hpack_encoder_t encoder;
+		hpack_decoder_t decoder;
+		hpack_encoder_init(&encoder);
+		hpack_decoder_init(&decoder, 0);
+		bool ok = true;
+		size_t first = 0, second = 0;
+
+		for (int i = 0; i < 2; i ++) {
+			std::string block, path = "/item/" + std::to_string(i);
+			std::vector<hpack_header_t> headers;
+
+			hpack_encode_field(&encoder, {":method", 7}, {"GET", 3}, &block);
+			hpack_encode_field(&encoder, {":path", 5}, {path.data(), path.size()}, &block);
+			hpack_encode_field(&encoder, {"user-agent", 10}, {"clibs-http2-test/1.0", 20}, &block);
+			hpack_encode_field(&encoder, {"x-binary", 8}, {"\x01\xff\x80", 3}, &block);
+			ok = ok && hpack_decode(&decoder, block.data(), block.size(), &headers) == HPACK_OK && headers.size() == 4
+				&& headers[1].value == path && headers[3].value == "\x01\xff\x80";
+			(i == 0 ? first : second) = block.size();
+		}
+
+		check("hpack round trip", ok && second < first / 2);
+	}
+
+	if (!serve_local(&sock, port, serve)) {
+		return 1;
+	}
+
+	CHttp2Client client;
+	client.set_url(base);
+
+	// 所有请求在一个连接上并发执行
+	{
+		check("concurrent streams", run_gets(&client, 200, "/s/"));
+		check("one connection", accepted == 1 && client.get_connections() == 1);
+		check("connection kept between batches", run_gets(&client, 10, "/again/") && accepted == 1 && client.get_connections() == 0);
+	}
+
+	// 双向的流量控制, 服务端的窗口只有16KB, 客户端的窗口使用默认值
+	{
+		server_window = 16384;
+		client.close();
+		client.set_window(HTTP2_DEFAULT_WINDOW);
+
+		std::string body;
+
+		for (int i = 0; i < (1 << 20); i ++) {
+			body.push_back((char)('a' + i % 26));
+		}
+
+		client.clear();
+		client.add("POST", "/echo", body, NULL);
+		client.get("/big/3000000");
+		bool ok = client.execute();
+
+		check("flow control", ok && client.get_response(0)->body == body && client.get_response(1)->body.size() == 3000000);
+		server_window = HTTP2_DEFAULT_WINDOW;
+		client.set_window(HTTP2_STREAM_WINDOW);
+		client.close();
+	}
+
+	// HEAD, trailer与拆分为CONTINUATION的响应头
+	{
+		CHttpHeader headers;
+		headers.append("Connection", "keep-alive");
+		headers.append("X-Request", "value");
+
+		client.clear();
+		client.add("HEAD", "/head", "", &headers);
+		client.get("/trailers");
+		client.get("/header");
+		bool ok = client.execute();
+
+		check("HEAD, trailers and CONTINUATION", ok && client.get_response(0)->body.empty() && client.get_response(0)->headers.get("Content-Length") == "5"
+			&& client.get_response(1)->body == "/trailers" && client.get_response(1)->headers.get("X-Checksum") == "abc"
+			&& client.get_response(2)->headers.get("X-Large").size() == 6000);
+	}
+
+	// 遵守服务端的SETTINGS_MAX_CONCURRENT_STREAMS, 收到SETTINGS之前多打开的流被拒绝后重发
+	{
+		server_max_streams = 10;
+		max_open = 0;
+		client.close();
+
+		check("max concurrent streams", run_gets(&client, 100, "/m/") && max_open <= 10 && max_open > 1);
+		server_max_streams = 1000;
+		client.close();
+	}
+
+	// 服务端发送GOAWAY后没有处理的请求在新连接上重发
+	{
+		accepted = 0;
+		goaway_after = 50;
+
+		bool ok = run_gets(&client, 120, "/goaway/");
+		check("GOAWAY", ok && accepted == 3 && client.get_connections() == 3);
+		goaway_after = 0;
+	}
+
+	// 单个流与多个流对比
+	{
+		int count = 200;
+		client.close();
+		client.set_max_streams(1);
+
+		bool ok = true;
+
+		double serial = elapsed_ms([&]() {
+			ok = run_gets(&client, count, "/bench/");
+		});
+
+		client.set_max_streams(HTTP2_MAX_STREAMS);
+
+		double multiplexed = elapsed_ms([&]() {
+			ok = ok && run_gets(&client, count, "/bench/");
+		});
+
+		check("benchmark requests", ok);
+		std::cout << count << " requests, one stream at a time: " << serial << " ms, multiplexed: " << multiplexed << " ms" << std::endl;
+	}
+
+	client.close();
+	stop_local(&sock);
+
+	return 0;
+}
@@ -0,0 +1,197 @@
+#include <iostream>
+#include <map>
+#include <chrono>
+#include <sys/resource.h>
+#include "clibs/net/acceptor.hpp"
+#include "clibs/net/http/http_async.hpp"
+#include "check.hpp"
+
+using namespace clibs::net;
+using namespace clibs::net::http;
+using namespace clibs::io;
+
+/**
+ * 异步http客户端测试, 服务端与所有请求在同一个线程的事件循环中运行
+ * 用法: http_async [并发请求数] [端口]
+ */
+
+/** 服务端连接收到的请求数据 */
+std::map<SOCKET, std::string> requests;
+
+void server_close(event_loop_t* loop, acceptor_t* acceptor, socket_t sock) {
+	event_loop_remove(loop, sock.sockfd);
+	socket_close(&sock);
+	requests.erase(sock.sockfd);
+	acceptor_release(acceptor);
+}
+
+/** 按请求路径返回不同的响应, /slow不响应, /chunked使用chunked编码, 其它路径返回路径本身 */
+void server_respond(event_loop_t* loop, acceptor_t* acceptor, socket_t sock, const std::string& path) {
+	std::string response;
+
+	if (path == "/slow") {
+		return;
+	} else if (path == "/chunked") {
+		response = "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n";
+	} else {
+		response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(path.size()) + "\r\nX-Path: " + path + "\r\n\r\n" + path;
+	}
+
+	socket_send(&sock, response.data(), response.size());
+	server_close(loop, acceptor, sock);
+}
+
+int main(int argc, char const *argv[])
+{
+	int total = argc > 1 ? atoi(argv[1]) : 2000;
+	int port = argc > 2 ? atoi(argv[2]) : 8046;
+	std::string base = "http://127.0.0.1:" + std::to_string(port);
+
+	// 每个请求同时占用客户端与服务端两个描述符
+	struct rlimit limit;
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+
+	event_loop_t* loop;
+	CHttpAsyncClient client;
+	loop = client.loop();
+	event_loop_maxevents(loop, 1024);
+
+	socket_t server;
+	acceptor_t acceptor;
+	socket_new(AF_INET, SOCK_STREAM, 0, &server);
+
+	int val = 1;
+	socket_setsockopt(&server, SOL_SOCKET, SO_REUSEADDR, (void*)&val, sizeof(val));
+
+	if (!socket_bind(&server, "127.0.0.1", port) || !socket_listen(&server, 4096)) {
+		std::cout << "Failed to listen on " << port << std::endl;
+		return 1;
+	}
+
+	acceptor_init(&acceptor, &server, 256, 0);
+	acceptor_attach(&acceptor, loop, [loop, &acceptor](socket_t* sock) {
+		socket_t conn = *sock;
+
+		event_loop_add(loop, conn.sockfd, EVENT_READ, [loop, &acceptor, conn](SOCKET sockfd, int events) {
+			char buffer[4096];
+			int len = socket_recv(&conn, buffer, sizeof(buffer));
+
+			if (len <= 0) {
+				if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+					server_close(loop, &acceptor, conn);
+				}
+
+				return;
+			}
+
+			std::string& data = requests[sockfd];
+			data.append(buffer, len);
+
+			if (data.find("\r\n\r\n") != std::string::npos) {
+				size_t start = data.find(' ') + 1;
+				server_respond(loop, &acceptor, conn, data.substr(start, data.find(' ', start) - start));
+			}
+		});
+	});
+
+	int pending = 0;
+	auto wait = [loop, &pending]() {
+		while (pending > 0) {
+			event_loop_run_once(loop, 100);
+		}
+	};
+
+	// 大量并发请求
+	{
+		int ok = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < total; i ++) {
+			std::string path = "/req/" + std::to_string(i);
+			pending ++;
+
+			client.get(base + path, [&pending, &ok, path](int error, http_response_t* response) {
+				pending --;
+
+				if (error == HTTP_ASYNC_OK && response->status_code == 200 && response->body == path && response->headers.get("X-Path") == path) {
+					ok ++;
+				}
+			});
+		}
+
+		wait();
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		check("concurrent requests", ok == total);
+		std::cout << total << " requests in " << seconds << "s (" << (int)(total / seconds) << " req/s) on one thread" << std::endl;
+	}
+
+	// 临时响应之后的chunked响应, body交给回调
+	{
+		http_request_t request;
+		std::string streamed;
+		int result = 1;
+
+		http_request_init(&request, "GET", base + "/chunked");
+		request.on_body = [&streamed](const char* data, size_t length) -> bool {
+			streamed.append(data, length);
+			return true;
+		};
+
+		pending ++;
+		client.request(&request, [&pending, &result](int error, http_response_t* response) {
+			pending --;
+			result = error == HTTP_ASYNC_OK && response->status_code == 200 && response->body.empty() ? 0 : error;
+		});
+
+		wait();
+		check("chunked body to callback", result == 0 && streamed == "hello world");
+	}
+
+	// 每个请求单独的超时
+	{
+		int slow = 1, fast = 1;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		client.set_timeout(200);
+		pending += 2;
+		client.get(base + "/slow", [&pending, &slow](int error, http_response_t* response) {
+			pending --;
+			slow = error;
+		});
+		client.get(base + "/fast", [&pending, &fast](int error, http_response_t* response) {
+			pending --;
+			fast = error;
+		});
+
+		wait();
+		long long int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		check("request deadline", slow == HTTP_ASYNC_TIMEOUT_ERROR && fast == HTTP_ASYNC_OK && elapsed >= 200 && elapsed < 1000);
+	}
+
+	// 连接失败与url错误
+	{
+		int refused = 0, bad = 0;
+
+		pending += 2;
+		client.get("http://127.0.0.1:1/", [&pending, &refused](int error, http_response_t* response) {
+			pending --;
+			refused = error;
+		});
+		client.get("ftp://127.0.0.1/file", [&pending, &bad](int error, http_response_t* response) {
+			pending --;
+			bad = error;
+		});
+
+		wait();
+		check("connection refused", refused == HTTP_ASYNC_CONNECT);
+		check("bad url", bad == HTTP_ASYNC_BAD_URL);
+	}
+
+	acceptor_close(&acceptor);
+	socket_close(&server);
+
+	return 0;
+}
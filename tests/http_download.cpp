@@ -0,0 +1,275 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include "local_server.hpp"
+#include "clibs/net/http/http_download.hpp"
+
+using namespace clibs;
+using namespace clibs::net;
+using namespace clibs::net::http;
+
+/**
+ * 分段下载测试, 在本地启动一个支持Range的服务端
+ * /norange 忽略Range返回完整的文件
+ * /long 分段的body多一个字节, /overflow 同上但使用chunked发送
+ * 用法: http_download [端口]
+ */
+
+std::string content;
+std::mutex etag_lock;
+std::string etag = "\"v1\"";
+std::atomic<int> broken(0); // 接下来多少个分段请求只发送一半的body后关闭连接
+std::atomic<unsigned long long int> unavailable_from(ULLONG_MAX); // 起始位置不小于该值的分段返回503
+std::atomic<unsigned long long int> served(0); // 发送的body长度, 包括探测请求的1个字节
+std::atomic<int> active(0);
+std::atomic<int> max_active(0);
+
+std::string header(const std::string& head, const std::string& name) {
+	size_t pos = head.find("\r\n" + name + ": ");
+
+	if (pos == std::string::npos) {
+		return "";
+	}
+
+	pos += name.size() + 4;
+
+	return head.substr(pos, head.find("\r\n", pos) - pos);
+}
+
+void serve(socket_t nsock) {
+	std::string data;
+	char buffer[4096];
+
+	int value = ++ active, seen = max_active;
+
+	while (value > seen && !max_active.compare_exchange_weak(seen, value)) {
+	}
+
+	while (true) {
+		size_t end;
+
+		while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+			int len = socket_recv(&nsock, buffer, sizeof(buffer));
+
+			if (len <= 0) {
+				goto done;
+			}
+
+			data.append(buffer, len);
+		}
+
+		std::string head = data.substr(0, end + 2);
+		data.erase(0, end + 4);
+
+		std::string path = head.substr(4, head.find(' ', 4) - 4);
+		std::string range = header(head, "Range");
+		std::string if_range = header(head, "If-Range");
+		std::string current;
+		std::string response;
+		unsigned long long int start = 0, last = content.size() - 1;
+
+		{
+			std::lock_guard<std::mutex> lock(etag_lock);
+			current = etag;
+		}
+
+		bool partial = path != "/norange" && !range.empty() && (if_range.empty() || if_range == current);
+
+		if (partial) {
+			sscanf(range.c_str(), "bytes=%llu-%llu", &start, &last);
+		}
+
+		if (partial && start >= unavailable_from) {
+			response = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+			socket_send(&nsock, response.data(), response.size());
+			continue;
+		}
+
+		std::string body = content.substr(start, last - start + 1);
+
+		if (partial) {
+			response = "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " + std::to_string(start) + "-" + std::to_string(last) + "/" + std::to_string(content.size()) + "\r\n";
+		} else {
+			response = "HTTP/1.1 200 OK\r\n";
+		}
+
+		if (partial && last > 0 && (path == "/long" || path == "/overflow")) {
+			body.push_back('x');
+		}
+
+		if (path == "/overflow") {
+			char size[32];
+			snprintf(size, sizeof(size), "%zx\r\n", body.size());
+			response.append("ETag: " + current + "\r\nTransfer-Encoding: chunked\r\n\r\n");
+			body = size + body + "\r\n0\r\n\r\n";
+		} else {
+			response.append("ETag: " + current + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n");
+		}
+
+		int remaining = broken;
+
+		while (partial && start > 0 && remaining > 0 && !broken.compare_exchange_weak(remaining, remaining - 1)) {
+		}
+
+		if (partial && start > 0 && remaining > 0) {
+			body.resize(body.size() / 2);
+			served += body.size();
+			response.append(body);
+			socket_send(&nsock, response.data(), response.size());
+			break;
+		}
+
+		// 在发送之前计数, 客户端收到数据时计数已经完成
+		served += body.size();
+		response.append(body);
+
+		for (size_t offset = 0; offset < response.size();) {
+			int len = socket_send(&nsock, response.data() + offset, response.size() - offset);
+
+			if (len <= 0) {
+				goto done;
+			}
+
+			offset += len;
+		}
+	}
+
+done:
+	active --;
+	socket_shutdown(&nsock, SHUT_RDWR);
+	socket_close(&nsock);
+}
+
+std::string read_file(const std::string& path) {
+	std::ifstream in(path, std::ios::binary);
+	return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+bool exists(const std::string& path) {
+	return access(path.c_str(), F_OK) == 0;
+}
+
+int main(int argc, char const *argv[])
+{
+	int port = argc > 1 ? atoi(argv[1]) : 8050;
+	std::string base = "http://127.0.0.1:" + std::to_string(port);
+	std::string path = "/tmp/http_download_" + std::to_string(getpid());
+	socket_t sock;
+
+	if (!serve_local(&sock, port, serve)) {
+		return 1;
+	}
+
+	content.resize(3 * 1024 * 1024 + 1234);
+
+	for (size_t i = 0; i < content.size(); i ++) {
+		content[i] = (char)(i * 131 + i / 4099);
+	}
+
+	// Content-Range的解析
+	{
+		unsigned long long int start, end;
+		long long int total;
+
+		check("content range", http_parse_content_range("bytes 10-19/100", &start, &end, &total) && start == 10 && end == 19 && total == 100
+			&& http_parse_content_range("bytes 0-0/*", &start, &end, &total) && total == -1
+			&& http_parse_content_range("bytes */0", &start, &end, &total) && total == 0
+			&& !http_parse_content_range("bytes 19-10/100", &start, &end, &total) && !http_parse_content_range("items 0-1/2", &start, &end, &total));
+	}
+
+	CHttpDownloader downloader;
+	downloader.set_url(base + "/file");
+	downloader.set_connections(4);
+	downloader.set_range_size(256 * 1024);
+
+	// 多个连接并发下载所有分段
+	{
+		bool ok = downloader.download(path);
+		check("parallel download", ok && downloader.ranges_supported() && read_file(path) == content && !exists(path + ".download"));
+		check("concurrent connections", max_active > 1);
+	}
+
+	// 连接中断的分段从中断的位置继续
+	{
+		broken = 5;
+		served = 0;
+		bool ok = downloader.download(path);
+		check("broken connections", ok && read_file(path) == content && broken == 0 && served == content.size() + 1);
+	}
+
+	// 分段重试失败后保留断点, 再次下载时只下载剩余的部分
+	{
+		downloader.set_retries(1);
+		unavailable_from = content.size() / 2;
+
+		bool ok = !downloader.download(path) && downloader.get_result() == HTTP_DOWNLOAD_INCOMPLETE && exists(path + ".download");
+		unsigned long long int saved = downloader.get_downloaded();
+
+		unavailable_from = ULLONG_MAX;
+		served = 0;
+		ok = ok && downloader.download(path) && downloader.resumed() && served == content.size() - saved + 1 && saved > 0;
+		check("resume from checkpoint", ok && read_file(path) == content && !exists(path + ".download"));
+		downloader.set_retries(HTTP_DOWNLOAD_RETRIES);
+	}
+
+	// 文件变化后断点失效, 重新下载
+	{
+		unavailable_from = content.size() / 2;
+		downloader.set_retries(0);
+		downloader.download(path);
+		unavailable_from = ULLONG_MAX;
+
+		{
+			std::lock_guard<std::mutex> lock(etag_lock);
+			etag = "\"v2\"";
+		}
+
+		served = 0;
+		bool ok = downloader.download(path) && !downloader.resumed() && served == content.size() + 1;
+		check("changed file", ok && read_file(path) == content);
+		downloader.set_retries(HTTP_DOWNLOAD_RETRIES);
+	}
+
+	// 不支持Range时使用单个连接
+	{
+		CHttpDownloader single;
+		single.set_url(base + "/norange");
+
+		bool ok = single.download(path);
+		check("no range support", ok && !single.ranges_supported() && single.get_size() == (long long int)content.size() && read_file(path) == content);
+	}
+
+	// body超出请求的分段时失败, 不写入相邻的分段
+	{
+		CHttpDownloader longer;
+		longer.set_range_size(256 * 1024);
+		longer.set_retries(0);
+
+		longer.set_url(base + "/long");
+		bool ok = !longer.download(path) && longer.get_result() == HTTP_DOWNLOAD_STATUS;
+		unlink((path + ".download").c_str());
+
+		longer.set_url(base + "/overflow");
+		ok = ok && !longer.download(path) && longer.get_result() == HTTP_DOWNLOAD_STATUS;
+		unlink((path + ".download").c_str());
+
+		check("range overflow", ok);
+	}
+
+	// 使用外部的线程池
+	{
+		CThreadPool pool(2);
+		CHttpDownloader pooled;
+		pooled.set_url(base + "/file");
+		pooled.set_range_size(256 * 1024);
+		pooled.set_thread_pool(&pool);
+
+		check("external thread pool", pooled.download(path) && read_file(path) == content);
+	}
+
+	unlink(path.c_str());
+	stop_local(&sock);
+
+	return 0;
+}
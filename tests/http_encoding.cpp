@@ -0,0 +1,99 @@
+#include <iostream>
+#include <string>
+#include "clibs/net/http/http_encoding.hpp"
+#include "check.hpp"
+
+using namespace clibs::net::http;
+
+/** 每次写入step个字节, 返回解码后的数据, 出错时以!结尾 */
+std::string decode(int encoding, const std::string& data, size_t step, unsigned long long int max_size = 0) {
+	http_decoder_t decoder;
+	std::string result;
+
+	http_decoder_init(&decoder, encoding);
+	decoder.max_size = max_size;
+
+	for (size_t pos = 0; pos < data.size(); pos += step) {
+		size_t len = pos + step < data.size() ? step : data.size() - pos;
+
+		if (!http_decoder_write(&decoder, data.data() + pos, len, [&result](const char* buf, size_t length) -> bool {
+			result.append(buf, length);
+			return true;
+		})) {
+			http_decoder_free(&decoder);
+			return result + "!";
+		}
+	}
+
+	bool finished = http_decoder_finish(&decoder);
+	http_decoder_free(&decoder);
+
+	return finished ? result : result + "?";
+}
+
+int main(int argc, char const *argv[])
+{
+	// 模拟接口返回的json
+	std::string json = "[";
+
+	for (int i = 0; i < 2000; i ++) {
+		json += (i > 0 ? "," : "") + std::string("{\"id\":") + std::to_string(i) + ",\"name\":\"user" + std::to_string(i)
+			+ "\",\"email\":\"user" + std::to_string(i) + "@example.com\",\"active\":" + (i % 3 ? "true" : "false") + "}";
+	}
+
+	json += "]";
+
+	// 找到brotli时由cmake定义CLIBS_HTTP_BROTLI
+#ifdef CLIBS_HTTP_BROTLI
+	int encodings[] = {HTTP_ENCODING_GZIP, HTTP_ENCODING_DEFLATE, HTTP_ENCODING_BROTLI};
+#else
+	int encodings[] = {HTTP_ENCODING_GZIP, HTTP_ENCODING_DEFLATE};
+#endif
+
+	for (int encoding : encodings) {
+		std::string compressed;
+		bool ok = http_encode(encoding, json.data(), json.size(), &compressed);
+		bool same = ok;
+
+		for (size_t step = 1; step < compressed.size() && same; step = step * 3 + 1) {
+			same = decode(encoding, compressed, step) == json;
+		}
+
+		std::cout << http_encoding_name(encoding) << ": " << json.size() << " -> " << compressed.size() << " bytes" << std::endl;
+		check("round trip at every step", same);
+		check("truncated stream", decode(encoding, compressed.substr(0, compressed.size() / 2), 100).back() == '?');
+		check("size limit", decode(encoding, compressed, 1000, 1000).back() == '!');
+	}
+
+	// 不带zlib头的deflate
+	std::string raw(1024, 'a');
+	std::string compressed;
+	z_stream zs = {};
+	deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+	compressed.resize(deflateBound(&zs, raw.size()));
+	zs.next_in = (Bytef*)raw.data();
+	zs.avail_in = raw.size();
+	zs.next_out = (Bytef*)&compressed[0];
+	zs.avail_out = compressed.size();
+	deflate(&zs, Z_FINISH);
+	compressed.resize(zs.total_out);
+	deflateEnd(&zs);
+	check("raw deflate", decode(HTTP_ENCODING_DEFLATE, compressed, 7) == raw);
+
+	// 多个gzip成员首尾相连
+	std::string first, second;
+	http_encode(HTTP_ENCODING_GZIP, "hello ", 6, &first);
+	http_encode(HTTP_ENCODING_GZIP, "world", 5, &second);
+	check("concatenated gzip members", decode(HTTP_ENCODING_GZIP, first + second, 5) == "hello world");
+
+	check("corrupt data", decode(HTTP_ENCODING_GZIP, "not gzip data", 100).back() == '!');
+	check("parse content-encoding", http_encoding_parse(" GZIP ") == HTTP_ENCODING_GZIP && http_encoding_parse("") == HTTP_ENCODING_IDENTITY
+		&& http_encoding_parse("gzip, br") == HTTP_ENCODING_UNSUPPORTED);
+#ifdef CLIBS_HTTP_BROTLI
+	check("parse br", http_encoding_parse("br") == HTTP_ENCODING_BROTLI);
+#else
+	check("br without brotli", http_encoding_parse("br") == HTTP_ENCODING_UNSUPPORTED);
+#endif
+
+	return 0;
+}
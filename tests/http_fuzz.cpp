@@ -0,0 +1,266 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "clibs/net/http/http_parser.hpp"
+
+using namespace clibs::net::http;
+
+/**
+ * http解析器的模糊测试
+ * 用法: http_fuzz [次数] [随机种子]
+ * 定义CLIBS_LIBFUZZER并使用-fsanitize=fuzzer编译时作为libFuzzer的入口
+ * 建议同时使用-fsanitize=address, 每个输入都拷贝到刚好大小的堆内存中, 越界读取会被发现
+ */
+
+static const char* seeds[] = {
+	"GET /index.html?a=1 HTTP/1.1\r\nHost: example.com\r\nAccept: */*\r\n\r\n",
+	"POST /upload HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello",
+	"HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nabcHTTP/1.1 204 No Content\r\n\r\n",
+	"HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip, chunked\r\n\r\n5;ext=\"a\"\r\nhello\r\n0\r\nX-Trailer: 1\r\n\r\n",
+	"HTTP/1.0 302 Found\nLocation: /\nSet-Cookie: a=b\n\nbody until close",
+	"HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n"
+};
+
+/** 片段必须落在输入的范围内 */
+static void check_view(const http_string_view_t* view, const char* buf, size_t len) {
+	if (view->data != NULL && (view->data < buf || view->data + view->len > buf + len)) {
+		std::cout << "view out of range" << std::endl;
+		abort();
+	}
+}
+
+static void fuzz_head(const char* buf, size_t len) {
+	http_message_t msg;
+	int ret = http_parse_head(buf, len, &msg, 0);
+
+	if (ret == HTTP_PARSE_INCOMPLETE || ret == HTTP_PARSE_ERROR) {
+		return;
+	}
+
+	if (ret <= 0 || (size_t)ret > len || msg.num_headers > HTTP_MAX_HEADERS || msg.start_line_len > (size_t)ret) {
+		std::cout << "bad head result " << ret << std::endl;
+		abort();
+	}
+
+	check_view(&msg.method, buf, ret);
+	check_view(&msg.path, buf, ret);
+	check_view(&msg.reason, buf, ret);
+
+	for (size_t i = 0; i < msg.num_headers; i ++) {
+		check_view(&msg.headers[i].name, buf, ret);
+		check_view(&msg.headers[i].value, buf, ret);
+	}
+
+	http_limits_t limits;
+	http_limits_init(&limits);
+	http_check_head(&msg, ret, &limits);
+}
+
+/** 头部解析出的字段 */
+static std::string describe(const http_message_t* msg) {
+	std::string result = std::to_string(msg->type) + " " + std::to_string(msg->minor_version) + " " + http_view_str(&msg->method) + " "
+		+ http_view_str(&msg->path) + " " + std::to_string(msg->status) + " " + http_view_str(&msg->reason);
+
+	for (size_t i = 0; i < msg->num_headers; i ++) {
+		result += "\n" + http_view_str(&msg->headers[i].name) + ": " + http_view_str(&msg->headers[i].value);
+	}
+
+	return result;
+}
+
+/**
+ * 按split分割输入, 每一段都在单独的堆内存中
+ * 返回事件和字段的记录, 连续的body合并记录, 与分割方式无关
+ */
+static std::string fuzz_push(const char* data, size_t len, size_t split, bool limited) {
+	http_parser_t parser;
+	http_event_t event;
+	std::string result, body;
+
+	http_parser_init(&parser);
+
+	if (limited) {
+		parser.limits.max_start_line = 32;
+		parser.limits.max_headers = 4;
+		parser.limits.max_header_size = 128;
+		parser.limits.max_body_size = 16;
+	}
+
+	for (size_t pos = 0; pos < len; pos += split) {
+		size_t size = pos + split < len ? split : len - pos;
+		std::vector<char> piece(data + pos, data + pos + size);
+		const char* buf = piece.data();
+		size_t remain = size;
+
+		// 每次调用要么有进展, 要么产生事件, 迭代次数有上限
+		for (size_t rounds = 0; rounds <= size * 2 + 16; rounds ++) {
+			size_t consumed = http_parser_feed(&parser, buf, remain, &event);
+
+			if (consumed > remain) {
+				std::cout << "consumed too much" << std::endl;
+				abort();
+			}
+
+			if (event.type == HTTP_EVENT_BODY) {
+				check_view(&event.data, buf, remain);
+				body += http_view_str(&event.data);
+			}
+
+			buf += consumed;
+			remain -= consumed;
+
+			if (event.type == HTTP_EVENT_NEED_MORE) {
+				break;
+			} else if (event.type == HTTP_EVENT_BODY) {
+				continue;
+			}
+
+			result += "[" + body + "]";
+			body.clear();
+
+			if (event.type == HTTP_EVENT_ERROR) {
+				return result + "error";
+			} else if (event.type == HTTP_EVENT_HEADERS) {
+				result += "headers(" + describe(&parser.message) + ")";
+			} else {
+				result += "complete";
+			}
+		}
+
+		if (event.type != HTTP_EVENT_NEED_MORE) {
+			std::cout << "parser made no progress" << std::endl;
+			abort();
+		}
+	}
+
+	http_parser_eof(&parser, &event);
+
+	// 不完整的头部在出现空行之前不做检查, 格式错误可能在eof时才发现
+	return result + "[" + body + "]" + (event.type == HTTP_EVENT_ERROR ? "error" : "eof" + std::to_string(event.type));
+}
+
+static void fuzz_chunked(const char* buf, size_t len) {
+	http_chunked_decoder_t decoder;
+	http_chunked_init(&decoder);
+
+	size_t offset = 0;
+
+	while (offset < len) {
+		size_t consumed;
+		http_string_view_t data;
+		int ret = http_chunked_decode(&decoder, buf + offset, len - offset, &consumed, &data);
+
+		if (consumed > len - offset) {
+			std::cout << "chunked consumed too much" << std::endl;
+			abort();
+		}
+
+		check_view(&data, buf + offset, len - offset);
+		offset += consumed;
+
+		if (ret != HTTP_CHUNKED_DATA) {
+			break;
+		}
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	std::vector<char> input(data, data + size);
+	const char* buf = input.data();
+
+	fuzz_head(buf, size);
+	std::string whole = fuzz_push(buf, size, size > 0 ? size : 1, false);
+	fuzz_push(buf, size, size > 0 ? data[0] % 7 + 1 : 1, size > 0 && data[0] % 2 == 0);
+
+	// 分割输入不能改变解析的结果
+	if (fuzz_push(buf, size, size > 0 ? data[size - 1] % 13 + 1 : 1, false) != whole || (size <= 128 && fuzz_push(buf, size, 1, false) != whole)) {
+		std::cout << "split input parsed differently" << std::endl;
+		abort();
+	}
+
+	fuzz_chunked(buf, size);
+
+	return 0;
+}
+
+#ifndef CLIBS_LIBFUZZER
+static uint64_t rng_state;
+
+static uint64_t next_random() {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+/** 在种子上做随机的修改 */
+static std::string mutate(std::string input) {
+	static const char special[] = {'\r', '\n', ':', ' ', '\t', ';', '0', 'f', '\0', '\x7f', '\x80', '\xff'};
+	int count = next_random() % 8 + 1;
+
+	for (int i = 0; i < count; i ++) {
+		size_t pos = input.empty() ? 0 : next_random() % input.size();
+
+		switch (next_random() % 6) {
+			case 0: // 替换成随机字节
+				if (!input.empty()) {
+					input[pos] = (char)next_random();
+				}
+				break;
+			case 1: // 替换成特殊字符
+				if (!input.empty()) {
+					input[pos] = special[next_random() % sizeof(special)];
+				}
+				break;
+			case 2: // 插入特殊字符
+				input.insert(pos, 1, special[next_random() % sizeof(special)]);
+				break;
+			case 3: // 删除一段
+				input.erase(pos, next_random() % 16);
+				break;
+			case 4: // 重复一段
+				input.insert(pos, input.substr(pos, next_random() % 32));
+				break;
+			case 5: // 插入很长的一段
+				input.insert(pos, next_random() % 4096, (char)(next_random() % 2 ? 'a' : '9'));
+				break;
+		}
+	}
+
+	return input;
+}
+
+int main(int argc, char const *argv[])
+{
+	int count = argc > 1 ? atoi(argv[1]) : 200000;
+	rng_state = argc > 2 ? strtoull(argv[2], NULL, 10) : 0x9e3779b97f4a7c15ULL;
+
+	if (rng_state == 0) {
+		rng_state = 1;
+	}
+
+	size_t seed_count = sizeof(seeds) / sizeof(seeds[0]);
+
+	for (size_t i = 0; i < seed_count; i ++) {
+		LLVMFuzzerTestOneInput((const uint8_t*)seeds[i], strlen(seeds[i]));
+	}
+
+	for (int i = 0; i < count; i ++) {
+		std::string input = mutate(seeds[next_random() % seed_count]);
+
+		// 偶尔把多个输入拼接成pipelining
+		if (next_random() % 4 == 0) {
+			input += mutate(seeds[next_random() % seed_count]);
+		}
+
+		LLVMFuzzerTestOneInput((const uint8_t*)input.data(), input.size());
+	}
+
+	std::cout << "fuzzed " << count << " inputs" << std::endl;
+
+	return 0;
+}
+#endif
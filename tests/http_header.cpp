@@ -0,0 +1,62 @@
+#include <iostream>
+#include <chrono>
+#include "clibs/net/http/http_header.hpp"
+#include "check.hpp"
+
+using namespace clibs::net::http;
+
+int main(int argc, char const *argv[])
+{
+	int count = argc > 1 ? atoi(argv[1]) : 100000;
+	CHttpHeader headers;
+
+	headers.append("content-length", 1234);
+	headers.append("Set-Cookie", "a=1");
+	headers.append("X-Request-Id", "abc");
+	headers.append("set-cookie", std::string("b=2"));
+	headers.append("x-request-ID", 'c');
+
+	check("case-insensitive lookup", headers.get("Content-Length") == "1234" && headers.get("CONTENT-LENGTH") == "1234");
+	http_string_view_t content_length = headers.get_view(HTTP_HEADER_CONTENT_LENGTH);
+	check("lookup by id", http_view_str(&content_length) == "1234" && !headers.contains(HTTP_HEADER_HOST));
+	check("multiple values", headers.get_fields("set-cookie") == std::vector<std::string>({"a=1", "b=2"}));
+	check("unknown header values", headers.get("X-Request-Id", 1) == "c" && headers.get("X-Request-Id", 2) == "" && !headers.contains("X-Missing"));
+	check("serialize in order", headers.str() == "Content-Length: 1234\r\nSet-Cookie: a=1\r\nX-Request-Id: abc\r\nSet-Cookie: b=2\r\nx-request-ID: c\r\n");
+
+	headers.remove("Set-Cookie", 0);
+	check("remove one value", headers.get("Set-Cookie") == "b=2");
+	headers.remove("x-request-id");
+	check("remove all values", !headers.contains("X-Request-Id") && headers.size() == 2);
+
+	// 大量删除后arena被压缩, 值保持不变
+	for (int i = 0; i < 1000; i ++) {
+		headers.append("X-Temp", std::string(100, 'a' + i % 26));
+	}
+
+	headers.remove("X-Temp");
+	check("compact after remove", headers.get("Content-Length") == "1234" && headers.get("Set-Cookie") == "b=2" && headers.size() == 2);
+
+	CHttpHeader copied(headers.data());
+	check("copy from map", copied.get("set-cookie") == "b=2");
+
+	// 典型响应头的添加, 查找与拼接
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t total = 0;
+
+	for (int i = 0; i < count; i ++) {
+		CHttpHeader h;
+		h.append("Date", "Mon, 19 Oct 2026 08:00:00 GMT");
+		h.append("Server", "nginx/1.24.0");
+		h.append("Content-Type", "application/json; charset=utf-8");
+		h.append("Content-Length", 1234);
+		h.append("Connection", "keep-alive");
+		h.append("Cache-Control", "private, max-age=0, no-cache");
+		h.append("X-Request-Id", "6f1c2b7a-4e2d-4a5b-9c1e-7d8f9a0b1c2d");
+		total += h.get_view(HTTP_HEADER_CONTENT_LENGTH).len + h.get("x-request-id").size() + h.str().size();
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << (int)(count / seconds) << " header sets/s (" << total << ")" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,445 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <functional>
+#include <vector>
+#include "clibs/regexp.hpp"
+#include "clibs/net/http/http_header.hpp"
+#include "clibs/net/http/http_parser.hpp"
+#include "check.hpp"
+
+using namespace clibs;
+using namespace clibs::net::http;
+
+static const char* response =
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Mon, 19 Oct 2026 08:00:00 GMT\r\n"
+    "Server: nginx/1.24.0\r\n"
+    "Content-Type: application/json; charset=utf-8\r\n"
+    "Content-Length: 1234\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: private, max-age=0, no-cache\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "X-Request-Id: 6f1c2b7a-4e2d-4a5b-9c1e-7d8f9a0b1c2d\r\n"
+    "Set-Cookie: session=abcdef0123456789; Path=/; HttpOnly; Secure\r\n"
+    "Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n"
+    "\r\n";
+
+/** 原来reader_parse_header中基于正则的解析, 用来对比 */
+int legacy_parse(const std::string& data, CHttpHeader* headers) {
+    size_t pos = data.find("\r\n");
+    std::string first = data.substr(0, pos);
+    std::string header = data.substr(pos + 2);
+    int status = 0;
+
+    if (test("^[A-Z]+\\s.+\\sHTTP/1\\.\\d", first)) {
+        CRegexp reg("^([A-Z]+)\\s(.+)\\sHTTP/1\\.\\d");
+        CMatcher m = reg.matches(first);
+        m.result();
+    } else if (test("^HTTP/1\\.\\d\\s\\d+\\s.*", first)) {
+        CRegexp reg("^HTTP/1\\.\\d\\s(\\d+)\\s(.*)");
+        CMatcher m = reg.matches(first);
+        std::smatch sm = m.result();
+        status = std::atoi(sm.str(1).c_str());
+    }
+
+    CRegexp cReg("([\\w-]+):\\s(.+)");
+    CMatcher cMatches = cReg.matches(header);
+
+    while (cMatches.find()) {
+        std::smatch cSmatch = cMatches.result();
+        headers->append(cSmatch.str(1), cSmatch.str(2));
+    }
+
+    return status;
+}
+
+/** 每次输入step个字节, 记录产生的事件 */
+std::string feed_all(const std::string& input, size_t step, bool eof) {
+    http_parser_t parser;
+    http_event_t event;
+    std::string result, chunk;
+
+    http_parser_init(&parser);
+
+    for (size_t pos = 0; pos < input.size(); pos += step) {
+        // 模拟每次读取到的数据在不同的缓冲区中
+        chunk = input.substr(pos, step);
+        const char* buf = chunk.data();
+        size_t len = chunk.size();
+
+        while (true) {
+            size_t n = http_parser_feed(&parser, buf, len, &event);
+            buf += n;
+            len -= n;
+
+            if (event.type == HTTP_EVENT_HEADERS) {
+                result += "[" + std::to_string(parser.message.status) + http_view_str(&parser.message.method) + "]";
+            } else if (event.type == HTTP_EVENT_BODY) {
+                result += http_view_str(&event.data);
+            } else if (event.type == HTTP_EVENT_COMPLETE) {
+                result += "|";
+            } else if (event.type == HTTP_EVENT_ERROR) {
+                return result + "!";
+            } else {
+                break;
+            }
+        }
+    }
+
+    if (eof) {
+        http_parser_eof(&parser, &event);
+        result += event.type == HTTP_EVENT_COMPLETE ? "|" : event.type == HTTP_EVENT_ERROR ? "!" : "";
+    }
+
+    return result;
+}
+
+/**
+ * 按sizes中的长度依次输入, 记录事件和解析出的字段, 连续的body合并记录
+ * 输入的分割方式不同时结果应当相同
+ */
+std::string transcript(const std::string& input, const std::vector<size_t>& sizes) {
+    http_parser_t parser;
+    http_event_t event;
+    std::string result, body;
+    size_t pos = 0;
+
+    http_parser_init(&parser);
+
+    for (size_t i = 0; i < sizes.size(); i ++) {
+        std::string chunk = input.substr(pos, sizes[i]);
+        const char* buf = chunk.data();
+        size_t len = chunk.size();
+
+        pos += sizes[i];
+
+        while (true) {
+            size_t n = http_parser_feed(&parser, buf, len, &event);
+            buf += n;
+            len -= n;
+
+            if (event.type == HTTP_EVENT_BODY) {
+                body += http_view_str(&event.data);
+                continue;
+            }
+
+            if (event.type == HTTP_EVENT_NEED_MORE) {
+                break;
+            }
+
+            if (!body.empty()) {
+                result += "body(" + body + ")";
+                body.clear();
+            }
+
+            if (event.type == HTTP_EVENT_HEADERS) {
+                http_message_t* msg = &parser.message;
+
+                result += "headers(" + std::to_string(msg->type) + " 1." + std::to_string(msg->minor_version) + " " + http_view_str(&msg->method) + " "
+                    + http_view_str(&msg->path) + " " + std::to_string(msg->status) + " " + http_view_str(&msg->reason);
+
+                for (size_t j = 0; j < msg->num_headers; j ++) {
+                    result += " " + http_view_str(&msg->headers[j].name) + "=" + http_view_str(&msg->headers[j].value);
+                }
+
+                result += ")";
+            } else if (event.type == HTTP_EVENT_COMPLETE) {
+                result += "complete(" + (parser.chunked ? parser.chunk.trailer : "") + ")";
+            } else {
+                return result + "error";
+            }
+        }
+    }
+
+    if (!body.empty()) {
+        result += "body(" + body + ")";
+    }
+
+    http_parser_eof(&parser, &event);
+
+    return result + "eof(" + std::to_string(event.type) + ")";
+}
+
+/** 原来reader_read中chunked的解码方式: 逐字节读取长度行, 再用stringstream转换 */
+std::string legacy_chunked(const std::string& input) {
+    size_t pos = 0;
+    std::string result;
+    std::function<int()> read_char = [&input, &pos]() -> int {
+        return pos < input.size() ? (unsigned char)input[pos ++] : -1;
+    };
+
+    while (true) {
+        char line[100];
+        int len = 0, c;
+
+        while ((c = read_char()) != -1 && c != '\n' && len < 99) {
+            line[len ++] = c;
+        }
+
+        line[len] = '\0';
+
+        std::stringstream hex;
+        unsigned long int size = 0;
+        hex << std::hex << line;
+        hex >> size;
+
+        if (size == 0) {
+            break;
+        }
+
+        result.append(input, pos, size);
+        pos += size + 2;
+    }
+
+    return result;
+}
+
+/** 用http_chunked_decode解码, 每次输入step个字节 */
+std::string decode_chunked(const std::string& input, size_t step, http_chunked_decoder_t* decoder) {
+    std::string result;
+    int ret = HTTP_CHUNKED_NEED_MORE;
+
+    http_chunked_init(decoder);
+
+    for (size_t pos = 0; pos < input.size() && ret != HTTP_CHUNKED_DONE; pos += step) {
+        const char* buf = input.data() + pos;
+        size_t len = pos + step < input.size() ? step : input.size() - pos;
+        size_t consumed;
+        http_string_view_t data;
+
+        while (len > 0) {
+            ret = http_chunked_decode(decoder, buf, len, &consumed, &data);
+            buf += consumed;
+            len -= consumed;
+
+            if (ret == HTTP_CHUNKED_DATA) {
+                result.append(data.data, data.len);
+            } else if (ret == HTTP_CHUNKED_ERROR) {
+                return result + "!";
+            } else {
+                break;
+            }
+        }
+    }
+
+    return ret == HTTP_CHUNKED_DONE ? result : result + "?";
+}
+
+int main(int argc, char const *argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    http_message_t msg;
+    size_t len = strlen(response);
+
+    // 正确性
+    check("response", http_parse_head(response, len, &msg, 0) == (int)len && msg.status == 200 && msg.num_headers == 10
+        && http_view_str(&msg.reason) == "OK" && http_view_str(http_message_header(&msg, "content-length")) == "1234");
+
+    const char* request = "GET /index.html?a=1 HTTP/1.0\nHost: example.com\nX-Empty:\n\nbody";
+    check("request with bare LF", http_parse_head(request, strlen(request), &msg, 0) == (int)strlen(request) - 4
+        && http_view_str(&msg.method) == "GET" && http_view_str(&msg.path) == "/index.html?a=1" && msg.minor_version == 0
+        && msg.num_headers == 2 && msg.headers[1].value.len == 0);
+
+    bool incomplete = true;
+
+    for (size_t i = 0; i < len; i ++) {
+        incomplete = incomplete && http_parse_head(response, i, &msg, i > 0 ? i - 1 : 0) == HTTP_PARSE_INCOMPLETE;
+    }
+
+    check("every prefix is incomplete", incomplete);
+    check("partial HEAD request", http_parse_head("HE", 2, &msg, 0) == HTTP_PARSE_INCOMPLETE && http_parse_head("HEA", 3, &msg, 0) == HTTP_PARSE_INCOMPLETE
+        && http_parse_head("HEAD", 4, &msg, 0) == HTTP_PARSE_INCOMPLETE && http_parse_head("HTTP", 4, &msg, 0) == HTTP_PARSE_INCOMPLETE);
+    check("bad version", http_parse_head("HTTP/2.0 200 OK\r\n\r\n", 19, &msg, 0) == HTTP_PARSE_ERROR);
+    check("space before colon", http_parse_head("HTTP/1.1 200 OK\r\nA : b\r\n\r\n", 26, &msg, 0) == HTTP_PARSE_ERROR);
+    check("control character", http_parse_head("HTTP/1.1 200 OK\r\nA: b\x01\r\n\r\n", 26, &msg, 0) == HTTP_PARSE_ERROR);
+    check("obs-fold rejected", http_parse_head("HTTP/1.1 200 OK\r\nA: b\r\n c\r\n\r\n", 29, &msg, 0) == HTTP_PARSE_ERROR);
+
+    http_string_view_t te = {"gzip, chunked", 13};
+    unsigned long long int length = 0;
+    http_string_view_t cl = {"12a", 3};
+    check("chunked as last coding", http_is_chunked(&te));
+    check("invalid content-length", !http_parse_content_length(&cl, &length));
+
+    // 推送式解析, 同一次读取中的多个响应
+    std::string pipelined =
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello"
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3;ext=1\r\nabc\r\n0A\r\n0123456789\r\n0\r\nX-Trailer: 1\r\n\r\n"
+        "HTTP/1.1 204 No Content\r\n\r\n"
+        "HTTP/1.1 200 OK\r\n\r\nuntil close";
+    std::string expected = "[200]hello|[200]abc0123456789|[204]|[200]until close|";
+    bool same = true;
+
+    for (size_t step = 1; step <= pipelined.size(); step ++) {
+        std::string result = feed_all(pipelined, step, true);
+
+        // 按连接关闭结束的body可能被分成多段, 拼接后相同
+        if (result != expected) {
+            std::cout << "step " << step << ": " << result << std::endl;
+            same = false;
+        }
+    }
+
+    check("pipelined responses at every split", same);
+    bool head_split = true;
+
+    for (size_t step = 2; step <= 4; step ++) {
+        head_split = head_split && feed_all("HEAD / HTTP/1.1\r\nHost: a\r\n\r\n", step, false) == "[0HEAD]|";
+    }
+
+    check("HEAD request split after 2, 3 or 4 bytes", head_split);
+    // 在任意位置分割或逐字节输入时, 事件和字段都与一次输入相同
+    std::vector<std::string> fixtures = {
+        "GET /index.html?a=1 HTTP/1.1\r\nHost: example.com\r\nAccept: */*\r\n\r\n",
+        "HEAD / HTTP/1.1\r\nHost: a\r\n\r\n",
+        "POST /upload HTTP/1.1\r\nContent-Length: 5\r\n\r\nhelloGET /next HTTP/1.0\nX: y\n\n",
+        "\r\nPUT /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3;ext=1\r\nabc\r\n0\r\nX-Trailer: 1\r\n\r\n",
+        "DELETE /bad\tpath HTTP/1.1\r\n\r\n",
+        response,
+        pipelined,
+        "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n",
+        "HTTP/1.0 302 Found\nLocation: /\nSet-Cookie: a=b\n\nbody until close",
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\r\n",
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhel"
+    };
+    bool equivalent = true;
+
+    for (size_t i = 0; i < fixtures.size(); i ++) {
+        const std::string& input = fixtures[i];
+        std::string whole = transcript(input, std::vector<size_t>(1, input.size()));
+
+        for (size_t cut = 0; cut <= input.size(); cut ++) {
+            std::vector<size_t> sizes = {cut, input.size() - cut};
+            std::string split = transcript(input, sizes);
+
+            if (split != whole) {
+                std::cout << "fixture " << i << " split at " << cut << ": " << split << std::endl << "whole: " << whole << std::endl;
+                equivalent = false;
+            }
+        }
+
+        if (transcript(input, std::vector<size_t>(input.size(), 1)) != whole) {
+            std::cout << "fixture " << i << " fed byte by byte differs" << std::endl;
+            equivalent = false;
+        }
+    }
+
+    check("split feed matches whole feed", equivalent);
+    check("requests", feed_all("POST /a HTTP/1.1\r\nContent-Length: 2\r\n\r\nokGET /b HTTP/1.1\r\n\r\n", 7, false) == "[0POST]ok|[0GET]|");
+    check("bad chunk size", feed_all("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", 100, false) == "[200]!");
+    check("truncated message", feed_all("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhel", 100, true) == "[200]hel!");
+
+    // 限制
+    http_limits_t limits;
+    http_limits_init(&limits);
+    limits.max_start_line = 64;
+    limits.max_headers = 2;
+    limits.max_body_size = 10;
+
+    std::string long_line = "GET /" + std::string(100, 'a') + " HTTP/1.1\r\n\r\n";
+    std::string many_headers = "HTTP/1.1 200 OK\r\nA: 1\r\nB: 2\r\nC: 3\r\n\r\n";
+    int head_len = http_parse_head(long_line.data(), long_line.size(), &msg, 0);
+    check("start line limit", head_len > 0 && !http_check_head(&msg, head_len, &limits));
+    check("unterminated start line", !http_check_partial_head(long_line.data(), 80, &limits) && http_check_partial_head(long_line.data(), 60, &limits));
+    head_len = http_parse_head(many_headers.data(), many_headers.size(), &msg, 0);
+    check("header count limit", head_len > 0 && !http_check_head(&msg, head_len, &limits));
+
+    http_parser_t limited;
+    http_event_t event;
+    const char* big_body = "HTTP/1.1 200 OK\r\nContent-Length: 11\r\n\r\n";
+    http_parser_init(&limited);
+    limited.limits = limits;
+    http_parser_feed(&limited, big_body, strlen(big_body), &event);
+    check("content-length limit", event.type == HTTP_EVENT_ERROR);
+
+    const char* big_chunks = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n6\r\nabcdef\r\n6\r\nabcdef\r\n";
+    size_t offset = 0;
+    http_parser_init(&limited);
+    limited.limits = limits;
+
+    do {
+        offset += http_parser_feed(&limited, big_chunks + offset, strlen(big_chunks) - offset, &event);
+    } while (event.type != HTTP_EVENT_ERROR && event.type != HTTP_EVENT_NEED_MORE);
+
+    check("chunked body limit", event.type == HTTP_EVENT_ERROR);
+
+    // chunked解码, 扩展与trailer
+    http_chunked_decoder_t decoder;
+    std::string chunked = "5;name=\"a;b\"\r\nhello\r\n1a\r\nabcdefghijklmnopqrstuvwxyz\r\n0;last\r\nX-Checksum: 1\r\nX-Other: 2\r\n\r\n";
+    bool decoded = true;
+
+    for (size_t step = 1; step <= chunked.size(); step ++) {
+        decoded = decoded && decode_chunked(chunked, step, &decoder) == "helloabcdefghijklmnopqrstuvwxyz"
+            && decoder.trailer == "X-Checksum: 1\nX-Other: 2\n";
+    }
+
+    check("chunked at every split", decoded);
+    check("chunk size overflow", decode_chunked("10000000000000000\r\n", 100, &decoder) == "!");
+    check("missing chunk CRLF", decode_chunked("3\r\nabcX\r\n", 100, &decoder) == "abc!");
+    check("truncated chunked", decode_chunked("3\r\nabc\r\n", 100, &decoder) == "abc?");
+
+    // CR只能出现在LF之前, 在每个分割位置都要拒绝
+    bool bare_cr = true;
+
+    for (size_t step = 1; step <= 8; step ++) {
+        bare_cr = bare_cr && decode_chunked("1\r1\r\nabcdefghijklmnopq\r\n0\r\n\r\n", step, &decoder) == "!"
+            && decode_chunked("1\r;ext\r\na\r\n0\r\n\r\n", step, &decoder) == "!"
+            && decode_chunked("1\r\r\na\r\n0\r\n\r\n", step, &decoder) == "!"
+            && decode_chunked("1\r\na\r\r\n0\r\n\r\n", step, &decoder) == "a!"
+            && decode_chunked("1\r\na\r\n0\r\nX-A: 1\r2\r\n\r\n", step, &decoder) == "a!";
+    }
+
+    check("CR inside chunk size", decode_chunked("1\r1\r\nabcdefghijklmnopq\r\n0\r\n\r\n", 100, &decoder) == "!");
+    check("CR before chunk extension", decode_chunked("1\r;ext\r\na\r\n0\r\n\r\n", 100, &decoder) == "!");
+    check("doubled CR before LF", decode_chunked("1\r\r\na\r\n0\r\n\r\n", 100, &decoder) == "!");
+    check("bare CR at every split", bare_cr);
+
+    // 大量小chunk的解码吞吐
+    std::string small_chunks;
+
+    for (int i = 0; i < count; i ++) {
+        small_chunks += "10\r\n0123456789abcdef\r\n";
+    }
+
+    small_chunks += "0\r\n\r\n";
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string fast_body = decode_chunked(small_chunks, 16384, &decoder);
+    double fast_chunked = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::string legacy_body = legacy_chunked(small_chunks);
+    double legacy_chunked_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    check("chunked matches legacy", fast_body == legacy_body && fast_body.size() == (size_t)count * 16);
+    std::cout << "http_chunked_decode: " << (int)(small_chunks.size() / fast_chunked / 1024 / 1024) << " MB/s" << std::endl;
+    std::cout << "stringstream (old):  " << (int)(small_chunks.size() / legacy_chunked_time / 1024 / 1024) << " MB/s" << std::endl;
+
+    // 吞吐对比
+    start = std::chrono::steady_clock::now();
+    size_t total = 0;
+
+    for (int i = 0; i < count; i ++) {
+        total += http_parse_head(response, len, &msg, 0) > 0 ? msg.num_headers : 0;
+    }
+
+    double fast = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::string data(response);
+    int legacy_count = count / 100 > 0 ? count / 100 : 1;
+    start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < legacy_count; i ++) {
+        CHttpHeader headers;
+        total += legacy_parse(data, &headers);
+    }
+
+    double legacy = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "http_parse_head: " << (int)(count / fast) << " headers/s, " << (int)(len * count / fast / 1024 / 1024) << " MB/s" << std::endl;
+    std::cout << "regex (old):     " << (int)(legacy_count / legacy) << " headers/s, " << (int)(len * legacy_count / legacy / 1024 / 1024) << " MB/s" << std::endl;
+    std::cout << "speedup: " << (int)((count / fast) / (legacy_count / legacy)) << "x (" << total << ")" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "local_server.hpp"
+#include "clibs/net/http/httpclient.hpp"
+#include "clibs/net/http/http_pipeline.hpp"
+
+using namespace clibs::net;
+using namespace clibs::net::http;
+
+/**
+ * pipelining测试, 在本地启动一个服务端, 每次读取后等待1ms模拟网络往返
+ * 用法: http_pipeline [端口]
+ */
+
+std::atomic<int> close_after(0); // 每个连接响应多少次后带上Connection: close并关闭, 0为不限制
+std::atomic<int> abort_after(0); // 每个连接响应多少次后不响应直接关闭, 0为不限制
+std::atomic<int> cut_posts(0); // 收到的POST /cut, 响应带Connection: close并在body中间关闭
+
+/** 一次处理缓冲区中所有完整的请求, 响应合并后一次发送 */
+void serve(socket_t nsock) {
+	std::string data;
+	char buffer[4096];
+	int served = 0;
+	bool closing = false;
+
+	while (!closing) {
+		int len = socket_recv(&nsock, buffer, sizeof(buffer));
+
+		if (len <= 0) {
+			break;
+		}
+
+		data.append(buffer, len);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		std::string responses;
+		size_t end;
+
+		while (!closing && (end = data.find("\r\n\r\n")) != std::string::npos) {
+			std::string head = data.substr(0, end + 4);
+			size_t length = 0, pos = head.find("Content-Length: ");
+
+			if (pos != std::string::npos) {
+				length = atoi(head.c_str() + pos + 16);
+			}
+
+			if (data.size() < head.size() + length) {
+				break;
+			}
+
+			std::string method = head.substr(0, head.find(' '));
+			std::string path = head.substr(method.size() + 1, head.find(' ', method.size() + 1) - method.size() - 1);
+			std::string body = method == "POST" ? data.substr(head.size(), length) : path;
+			data.erase(0, head.size() + length);
+
+			if (abort_after > 0 && served >= abort_after) {
+				closing = true;
+				break;
+			}
+
+			if (method == "POST" && path == "/cut") {
+				cut_posts ++;
+				responses.append("HTTP/1.1 200 OK\r\nContent-Length: 10\r\nConnection: close\r\n\r\npart");
+				closing = true;
+				break;
+			}
+
+			served ++;
+			closing = close_after > 0 && served >= close_after;
+
+			responses.append("HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n");
+			responses.append(closing ? "Connection: close\r\n\r\n" : "\r\n");
+
+			if (method != "HEAD") {
+				responses.append(body);
+			}
+		}
+
+		if (!responses.empty()) {
+			socket_send(&nsock, responses.data(), responses.size());
+		}
+	}
+
+	socket_shutdown(&nsock, SHUT_RDWR);
+	socket_close(&nsock);
+}
+
+/** 添加n个GET请求, 检查所有响应的body都是请求路径 */
+bool run_gets(CHttpPipeline* pipeline, int n, const std::string& prefix) {
+	pipeline->clear();
+
+	for (int i = 0; i < n; i ++) {
+		pipeline->get(prefix + std::to_string(i));
+	}
+
+	bool ok = pipeline->execute();
+
+	for (int i = 0; i < n; i ++) {
+		ok = ok && pipeline->get_response(i)->body == prefix + std::to_string(i);
+	}
+
+	return ok;
+}
+
+int main(int argc, char const *argv[])
+{
+	int port = argc > 1 ? atoi(argv[1]) : 8047;
+	std::string base = "http://127.0.0.1:" + std::to_string(port);
+	socket_t sock;
+
+	if (!serve_local(&sock, port, serve)) {
+		return 1;
+	}
+
+	CHttpPipeline pipeline;
+	pipeline.set_url(base);
+
+	// 所有请求在一个连接上按顺序得到响应
+	{
+		accepted = 0;
+		check("pipelined requests", run_gets(&pipeline, 100, "/p/"));
+		check("one connection", accepted == 1 && pipeline.get_connections() == 1);
+	}
+
+	// 服务端声明关闭连接后在新连接上继续
+	{
+		accepted = 0;
+		close_after = 10;
+		check("graceful close", run_gets(&pipeline, 100, "/g/") && accepted == 10);
+		close_after = 0;
+	}
+
+	// 服务端不声明就关闭连接, 幂等请求重发, POST失败
+	{
+		abort_after = 5;
+		pipeline.clear();
+
+		for (int i = 0; i < 40; i ++) {
+			if (i == 7) {
+				pipeline.add("POST", "/post", "data", NULL);
+			} else {
+				pipeline.get("/a/" + std::to_string(i));
+			}
+		}
+
+		pipeline.execute();
+		bool ok = pipeline.get_result(7) == HTTP_PIPELINE_CLOSED;
+
+		for (int i = 0; i < 40; i ++) {
+			ok = ok && (i == 7 || (pipeline.get_result(i) == HTTP_PIPELINE_OK && pipeline.get_response(i)->body == "/a/" + std::to_string(i)));
+		}
+
+		check("abrupt close", ok);
+		abort_after = 0;
+	}
+
+	// 声明关闭的响应在body中间断开, 已经被处理的POST不能重发, 之后的请求重发
+	{
+		pipeline.clear();
+		pipeline.get("/before");
+		pipeline.add("POST", "/cut", "data", NULL);
+		pipeline.get("/after");
+
+		pipeline.execute();
+		check("close response cut off", cut_posts == 1 && pipeline.get_result(1) == HTTP_PIPELINE_CLOSED
+			&& pipeline.get_response(0)->body == "/before" && pipeline.get_result(2) == HTTP_PIPELINE_OK && pipeline.get_response(2)->body == "/after");
+	}
+
+	// HEAD响应没有body, POST带body
+	{
+		pipeline.clear();
+		pipeline.add("HEAD", "/head", "", NULL);
+		pipeline.get("/after-head");
+		pipeline.add("POST", "/post", "posted", NULL);
+		pipeline.add("HEAD", "/head2", "", NULL);
+
+		bool ok = pipeline.execute();
+		check("HEAD and POST", ok && pipeline.get_response(0)->headers.get("Content-Length") == "5" && pipeline.get_response(0)->body.empty()
+			&& pipeline.get_response(1)->body == "/after-head" && pipeline.get_response(2)->body == "posted" && pipeline.get_response(3)->body.empty());
+	}
+
+	// 使用连接池时第二次执行复用连接
+	{
+		CHttpPool pool(4, 16, 60000);
+		pipeline.set_pool(pool.pool());
+		accepted = 0;
+
+		bool ok = run_gets(&pipeline, 20, "/pool/") && run_gets(&pipeline, 20, "/pool/");
+		check("pool reuse", ok && accepted == 1 && pool.pool()->reused == 1);
+		pipeline.set_pool(NULL);
+	}
+
+	// 与逐个请求对比
+	{
+		int count = 200;
+		CHttpPool pool;
+		bool ok = true;
+
+		double sequential = elapsed_ms([&]() {
+			for (int i = 0; i < count; i ++) {
+				CHttpClient client;
+				client.set_url(base + "/seq");
+				client.set_method("GET");
+				client.set_pool(pool.pool());
+				ok = ok && client.connect() && client.get_response() && client.read() == "/seq";
+				client.close();
+			}
+		});
+
+		double pipelined = elapsed_ms([&]() {
+			ok = ok && run_gets(&pipeline, count, "/bench/");
+		});
+
+		check("benchmark requests", ok);
+		std::cout << count << " requests, sequential: " << sequential << " ms, pipelined: " << pipelined << " ms" << std::endl;
+	}
+
+	stop_local(&sock);
+
+	return 0;
+}
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include "local_server.hpp"
+#include "clibs/net/http/httpclient.hpp"
+
+using namespace clibs::net;
+using namespace clibs::net::http;
+
+/**
+ * 连接池测试, 在本地启动一个keep-alive服务端
+ * 用法: http_pool [端口]
+ */
+
+std::atomic<int> serve_limit(0); // 每个连接响应多少次后不响应直接关闭, 0为不限制
+
+void serve(socket_t nsock) {
+	http_reader_t reader;
+	reader_init(&reader, &nsock, NULL);
+	int served = 0;
+
+	while (true) {
+		CHttpHeader headers;
+
+		if (!reader_parse_header(&reader, &headers)) {
+			break;
+		}
+
+		// 模拟服务端在收到请求时恰好关闭了空闲连接
+		if (serve_limit > 0 && served >= serve_limit) {
+			break;
+		}
+
+		std::string body = reader.url;
+		std::string response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+		socket_send(&nsock, response.data(), response.size());
+		served ++;
+
+		reader_init(&reader, &nsock, NULL);
+	}
+
+	socket_shutdown(&nsock, SHUT_RDWR);
+	socket_close(&nsock);
+}
+
+/** 发送一个请求, 返回响应body */
+std::string request(http_pool_t* pool, const std::string& url, bool* reused) {
+	CHttpClient client;
+	std::string body;
+
+	client.set_url(url);
+	client.set_method("GET");
+	client.set_pool(pool);
+
+	if (client.connect() && client.get_response()) {
+		body = client.read();
+	}
+
+	if (reused != NULL) {
+		*reused = client.connection_reused();
+	}
+
+	client.close();
+
+	return body;
+}
+
+int main(int argc, char const *argv[])
+{
+	int port = argc > 1 ? atoi(argv[1]) : 8045;
+	std::string base = "http://127.0.0.1:" + std::to_string(port);
+	socket_t sock;
+
+	if (!serve_local(&sock, port, serve)) {
+		return 1;
+	}
+
+	// 顺序请求只建立一个连接
+	{
+		CHttpPool pool(4, 16, 60000);
+		bool ok = true, reused = false;
+
+		for (int i = 0; i < 100; i ++) {
+			ok = ok && request(pool.pool(), base + "/seq/" + std::to_string(i), &reused) == "/seq/" + std::to_string(i);
+		}
+
+		check("sequential requests", ok && reused);
+		check("one connection for sequential requests", accepted == 1 && pool.pool()->created == 1 && pool.pool()->reused == 99);
+	}
+
+	// 服务端关闭空闲连接后自动重试
+	{
+		accepted = 0;
+		serve_limit = 3;
+		CHttpPool pool(4, 16, 60000);
+		bool ok = true;
+
+		for (int i = 0; i < 12; i ++) {
+			ok = ok && request(pool.pool(), base + "/stale/" + std::to_string(i), NULL) == "/stale/" + std::to_string(i);
+		}
+
+		check("retry on stale connection", ok && accepted == 4);
+		serve_limit = 0;
+	}
+
+	// 多线程共享连接池, 连接数不超过每个主机的限制
+	{
+		accepted = 0;
+		CHttpPool pool(4, 16, 60000);
+		std::atomic<int> failed(0);
+		std::vector<std::thread> threads;
+
+		for (int t = 0; t < 8; t ++) {
+			threads.emplace_back([&pool, &failed, &base, t]() {
+				for (int i = 0; i < 50; i ++) {
+					std::string path = "/mt/" + std::to_string(t) + "/" + std::to_string(i);
+
+					if (request(pool.pool(), base + path, NULL) != path) {
+						failed ++;
+					}
+				}
+			});
+		}
+
+		for (size_t i = 0; i < threads.size(); i ++) {
+			threads[i].join();
+		}
+
+		check("concurrent requests", failed == 0);
+		check("per-host limit", accepted <= 4 && pool.pool()->total <= 4);
+	}
+
+	// 空闲连接超时后被关闭
+	{
+		CHttpPool pool(4, 16, 100);
+		request(pool.pool(), base + "/idle", NULL);
+		bool idle = pool.pool()->idle_count == 1;
+		std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+		check("idle eviction", idle && pool.pool()->idle_count == 0 && pool.pool()->evicted == 1 && pool.pool()->total == 0);
+	}
+
+	// 与不使用连接池对比
+	{
+		int count = 500;
+		CHttpPool pool;
+
+		double without = elapsed_ms([&]() {
+			for (int i = 0; i < count; i ++) {
+				request(NULL, base + "/bench", NULL);
+			}
+		}) * 1000 / count;
+
+		double with = elapsed_ms([&]() {
+			for (int i = 0; i < count; i ++) {
+				request(pool.pool(), base + "/bench", NULL);
+			}
+		}) * 1000 / count;
+
+		std::cout << "without pool: " << without << " us/request, with pool: " << with << " us/request" << std::endl;
+	}
+
+	stop_local(&sock);
+
+	return 0;
+}
@@ -0,0 +1,314 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include "local_server.hpp"
+#include "clibs/net/http/httpclient.hpp"
+
+using namespace clibs::net;
+using namespace clibs::net::http;
+
+/**
+ * 流式上传测试, 在本地启动一个服务端, 返回收到的body
+ * /reject 对Expect返回417, /silent 不响应Expect, /hints 在最终响应前发送103
+ * 用法: http_upload [端口]
+ */
+
+/** 从连接读取数据直到缓冲区中至少有length字节 */
+bool fill(socket_t* nsock, std::string* data, size_t length) {
+	char buffer[65536];
+
+	while (data->size() < length) {
+		int len = socket_recv(nsock, buffer, sizeof(buffer));
+
+		if (len <= 0) {
+			return false;
+		}
+
+		data->append(buffer, len);
+	}
+
+	return true;
+}
+
+/** 读取到指定分隔符, 返回分隔符之前的内容 */
+bool read_until(socket_t* nsock, std::string* data, const char* delim, std::string* out) {
+	size_t pos;
+
+	while ((pos = data->find(delim)) == std::string::npos) {
+		if (!fill(nsock, data, data->size() + 1)) {
+			return false;
+		}
+	}
+
+	*out = data->substr(0, pos);
+	data->erase(0, pos + strlen(delim));
+
+	return true;
+}
+
+void serve(socket_t nsock) {
+	std::string data;
+
+	while (true) {
+		std::string head;
+
+		if (!read_until(&nsock, &data, "\r\n\r\n", &head)) {
+			break;
+		}
+
+		std::string path = head.substr(head.find(' ') + 1, head.find(' ', head.find(' ') + 1) - head.find(' ') - 1);
+		bool chunked = head.find("Transfer-Encoding: chunked") != std::string::npos;
+		bool expect = head.find("Expect: 100-continue") != std::string::npos;
+		size_t pos = head.find("Content-Length: ");
+		size_t length = pos != std::string::npos ? atol(head.c_str() + pos + 16) : 0;
+		std::string body;
+
+		if (expect && path == "/reject") {
+			std::string response = "HTTP/1.1 417 Expectation Failed\r\nContent-Length: 0\r\n\r\n";
+			socket_send(&nsock, response.data(), response.size());
+			continue;
+		} else if (expect && path != "/silent") {
+			socket_send(&nsock, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+		}
+
+		if (chunked) {
+			std::string line;
+
+			while (read_until(&nsock, &data, "\r\n", &line)) {
+				size_t size = strtoul(line.c_str(), NULL, 16);
+
+				if (!fill(&nsock, &data, size + 2)) {
+					break;
+				}
+
+				body.append(data, 0, size);
+				data.erase(0, size + 2);
+
+				if (size == 0) {
+					break;
+				}
+			}
+		} else {
+			if (!fill(&nsock, &data, length)) {
+				break;
+			}
+
+			body = data.substr(0, length);
+			data.erase(0, length);
+		}
+
+		std::string response;
+
+		if (path == "/hints") {
+			response.append("HTTP/1.1 103 Early Hints\r\nLink: </style.css>; rel=preload\r\n\r\n");
+		}
+
+		response.append("HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n");
+		response.append(chunked ? "X-Chunked: 1\r\n" : "");
+		response.append(expect ? "X-Expect: 1\r\n\r\n" : "\r\n");
+		response.append(body);
+		socket_send(&nsock, response.data(), response.size());
+	}
+
+	socket_shutdown(&nsock, SHUT_RDWR);
+	socket_close(&nsock);
+}
+
+/** 长度为size的测试数据 */
+std::string pattern(size_t size) {
+	std::string data(size, '\0');
+
+	for (size_t i = 0; i < size; i ++) {
+		data[i] = 'a' + (i * 7 + i / 997) % 26;
+	}
+
+	return data;
+}
+
+/** 每次最多提供step字节的回调 */
+http_body_source string_source(const std::string* data, size_t step, int* calls) {
+	std::shared_ptr<size_t> offset = std::make_shared<size_t>(0);
+
+	return [data, step, calls, offset](char* buffer, size_t size) -> long long int {
+		size_t len = std::min(std::min(size, step), data->size() - *offset);
+
+		memcpy(buffer, data->data() + *offset, len);
+		*offset += len;
+		(*calls) ++;
+
+		return len;
+	};
+}
+
+/** 执行请求, 返回响应body */
+std::string request(CHttpClient* client, const std::string& url) {
+	std::string body;
+
+	client->set_url(url);
+	client->set_method("POST");
+
+	if (client->connect() && client->get_response()) {
+		body = client->read();
+	}
+
+	return body;
+}
+
+int main(int argc, char const *argv[])
+{
+	int port = argc > 1 ? atoi(argv[1]) : 8049;
+	std::string base = "http://127.0.0.1:" + std::to_string(port);
+	socket_t sock;
+
+	if (!serve_local(&sock, port, serve)) {
+		return 1;
+	}
+
+	std::string payload = pattern(3 * 1024 * 1024 + 123);
+
+	// 长度未知时使用chunked
+	{
+		CHttpClient client;
+		int calls = 0;
+
+		client.set_body_source(string_source(&payload, 100000, &calls));
+		std::string body = request(&client, base + "/chunked");
+		check("chunked source", body == payload && client.get_field("X-Chunked") == "1" && calls > 1);
+		client.close();
+	}
+
+	// 长度已知时使用Content-Length, 不会多读
+	{
+		CHttpClient client;
+		int calls = 0;
+
+		client.set_body_source(string_source(&payload, 100000, &calls), 1000000);
+		std::string body = request(&client, base + "/length");
+		check("sized source", body == payload.substr(0, 1000000) && client.get_field("X-Chunked") == "");
+		client.close();
+	}
+
+	// 普通文件通过sendfile发送, 从当前位置开始
+	char path[] = "/tmp/http_upload_XXXXXX";
+	int fd = mkstemp(path);
+
+	if (fd < 0 || write(fd, payload.data(), payload.size()) != (ssize_t)payload.size()) {
+		std::cout << "Failed to create " << path << std::endl;
+		return 1;
+	}
+
+	{
+		CHttpClient client;
+
+		client.set_body_file(path);
+		check("file", request(&client, base + "/file") == payload && client.get_field("X-Chunked") == "");
+		client.close();
+
+		lseek(fd, 100, SEEK_SET);
+		client.set_body_fd(fd);
+		check("file offset", request(&client, base + "/offset") == payload.substr(100) && lseek(fd, 0, SEEK_CUR) == 100);
+		client.close();
+	}
+
+	// 管道不能sendfile, 读取后chunked发送
+	{
+		int fds[2];
+		CHttpClient client;
+
+		if (pipe(fds) != 0) {
+			return 1;
+		}
+
+		std::thread writer([&fds, &payload]() {
+			for (size_t offset = 0; offset < payload.size(); offset += 4096) {
+				if (write(fds[1], payload.data() + offset, std::min((size_t)4096, payload.size() - offset)) <= 0) {
+					break;
+				}
+			}
+
+			close(fds[1]);
+		});
+
+		client.set_body_fd(fds[0]);
+		std::string body = request(&client, base + "/pipe");
+		writer.join();
+		close(fds[0]);
+		check("pipe", body == payload && client.get_field("X-Chunked") == "1");
+		client.close();
+	}
+
+	// 收到100 Continue后发送body, 连接可以复用
+	{
+		CHttpPool pool;
+		CHttpClient client;
+
+		accepted = 0;
+		client.set_pool(pool.pool());
+		client.set_expect_continue(true, 5);
+		client.set_body_file(path);
+
+		bool ok = request(&client, base + "/expect") == payload && client.get_status_code() == 200 && client.get_field("X-Expect") == "1";
+		client.close();
+
+		client.set_body("small", 5);
+		ok = ok && request(&client, base + "/expect") == "small" && client.connection_reused();
+		client.close();
+
+		check("expect continue", ok && accepted == 1);
+	}
+
+	// 服务端拒绝时不发送body, 连接不再复用
+	{
+		CHttpPool pool;
+		CHttpClient client;
+		int calls = 0;
+
+		accepted = 0;
+		client.set_pool(pool.pool());
+		client.set_expect_continue(true, 5);
+		client.set_body_source(string_source(&payload, 100000, &calls));
+		request(&client, base + "/reject");
+		bool ok = client.get_status_code() == 417 && calls == 0;
+		client.close();
+
+		client.set_body("after", 5);
+		ok = ok && request(&client, base + "/after") == "after" && !client.connection_reused();
+		client.close();
+
+		check("expect rejected", ok && accepted == 2);
+	}
+
+	// 服务端不响应Expect时超时后发送body
+	{
+		CHttpClient client;
+
+		client.set_expect_continue(true, 1);
+		client.set_body("silent", 6);
+
+		bool ok = false;
+
+		double elapsed = elapsed_ms([&]() {
+			ok = request(&client, base + "/silent") == "silent";
+		});
+
+		check("expect timeout", ok && elapsed >= 900);
+		client.close();
+	}
+
+	// 跳过1xx的中间响应
+	{
+		CHttpClient client;
+
+		client.set_body("hints", 5);
+		check("interim response", request(&client, base + "/hints") == "hints" && client.get_status_code() == 200 && client.get_field("Link") == "");
+		client.close();
+	}
+
+	close(fd);
+	unlink(path);
+	stop_local(&sock);
+
+	return 0;
+}
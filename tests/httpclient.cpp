@@ -1,6 +1,12 @@
 #include <iostream>
+#include <fcntl.h>
 #include "clibs/net/http/httpclient.hpp"
 
+/**
+ * 用法: httpclient [url] [保存的文件]
+ * 指定文件时以流的方式写入文件, 内存占用与body大小无关
+ */
+
 int main(int argc, char const *argv[])
 {
 #ifdef _WIN32
@@ -10,7 +16,7 @@ int main(int argc, char const *argv[])
 
 	clibs::net::http::CHttpClient client;
 
-	std::string url = "https://www.baidu.com";
+	std::string url = argc > 1 ? argv[1] : "https://www.baidu.com";
 	// std::string url = "https://www.cnblogs.com/lnlvinso/p/11160827.html";
 	// std::string url = "https://www.google.com";
 	// std::string url = "http://localhost:1234";
@@ -29,8 +35,15 @@ int main(int argc, char const *argv[])
 	}
 	
 	if (client.get_response()) {
-		std::string res = client.read();
-		std::cout << res << std::endl;
+		if (argc > 2) {
+			int fd = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			std::cout << "Content-Length: " << client.get_content_length() << std::endl;
+			std::cout << "saved: " << client.read(fd) << std::endl;
+			::close(fd);
+		} else {
+			std::string res = client.read();
+			std::cout << res << std::endl;
+		}
 	}
 
 	std::cout << client.get_status_code() << std::endl;
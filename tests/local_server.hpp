@@ -0,0 +1,71 @@
+#ifndef _CLIBS_TESTS_LOCAL_SERVER_H_
+#define _CLIBS_TESTS_LOCAL_SERVER_H_ 1
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <csignal>
+#include "clibs/net/socket_tuning.hpp"
+#include "check.hpp"
+
+/**
+ * http测试共用的本地服务端
+ */
+
+std::atomic<int> accepted(0); // 本地服务端接受的连接数
+
+/**
+ * 在127.0.0.1上监听, 每个连接在单独的线程中交给serve处理, serve负责关闭连接
+ * @param  sock  监听套字节
+ * @param  port  端口
+ * @param  serve 连接的处理函数
+ * @return       是否监听成功
+ */
+bool serve_local(clibs::net::socket_t* sock, int port, void (*serve)(clibs::net::socket_t)) {
+	using namespace clibs::net;
+
+	signal(SIGPIPE, SIG_IGN);
+	socket_new(AF_INET, SOCK_STREAM, 0, sock);
+	socket_tune(sock, TUNING_LISTENER);
+
+	int val = 1;
+	socket_setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (void*)&val, sizeof(val));
+
+	if (!socket_bind(sock, "127.0.0.1", port) || !socket_listen(sock, 128)) {
+		std::cout << "Failed to listen on " << port << std::endl;
+		return false;
+	}
+
+	std::thread([sock, serve]() {
+		while (true) {
+			socket_t nsock;
+
+			if (socket_accept(sock, &nsock) == -1) {
+				return;
+			}
+
+			accepted ++;
+			std::thread(serve, nsock).detach();
+		}
+	}).detach();
+
+	return true;
+}
+
+/** 关闭本地服务端, 接收线程随之退出 */
+void stop_local(clibs::net::socket_t* sock) {
+	clibs::net::socket_shutdown(sock, SHUT_RDWR);
+	clibs::net::socket_close(sock);
+}
+
+/** 执行fn并返回耗时(毫秒) */
+double elapsed_ms(std::function<void()> fn) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	fn();
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif
@@ -0,0 +1,155 @@
+#define CLIBS_SOCKET_STATS 1
+
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <openssl/x509.h>
+#include <openssl/ec.h>
+#include "clibs/net/output_buffer.hpp"
+
+using namespace clibs;
+
+/** 在内存中生成一个自签名的ec证书 */
+bool make_cert(SSL_CTX* ctx) {
+	EVP_PKEY* key = NULL;
+	EVP_PKEY_CTX* kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+
+	if (kctx == NULL || EVP_PKEY_keygen_init(kctx) <= 0
+		|| EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1) <= 0
+		|| EVP_PKEY_keygen(kctx, &key) <= 0) {
+		EVP_PKEY_CTX_free(kctx);
+		return false;
+	}
+
+	EVP_PKEY_CTX_free(kctx);
+
+	X509* cert = X509_new();
+	ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+	X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+	X509_set_pubkey(cert, key);
+	X509_set_issuer_name(cert, X509_get_subject_name(cert));
+	X509_sign(cert, key, EVP_sha256());
+
+	bool ok = SSL_CTX_use_certificate(ctx, cert) == 1 && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+
+	X509_free(cert);
+	EVP_PKEY_free(key);
+
+	return ok;
+}
+
+/** 通过tls发送时同样统计下层套字节的发送 */
+void tls_stats() {
+	net::socket_t client, server;
+	net::ssl_socket_t client_ssl, server_ssl;
+	SSL_CTX* server_ctx = SSL_CTX_new(TLS_server_method());
+	std::string received;
+
+	if (!make_cert(server_ctx) || !net::socket_pair(SOCK_STREAM, &client, &server)) {
+		std::cout << "Failed to set up tls" << std::endl;
+		exit(1);
+	}
+
+	std::thread peer([&]() {
+		char buff[16384];
+		int len;
+
+		net::socket_ssl_bind(&server_ssl, server_ctx, &server);
+
+		if (net::socket_ssl_accept(&server_ssl)) {
+			while ((len = net::socket_ssl_recv(&server_ssl, buff, sizeof(buff))) > 0) {
+				received.append(buff, len);
+			}
+		}
+	});
+
+	net::socket_ssl_new(&client_ssl);
+	net::socket_ssl_bind(&client_ssl, &client);
+	net::socket_ssl_connect(&client_ssl);
+
+	net::output_buffer_t output;
+	net::output_buffer_init(&output, 1024 * 1024, 256 * 1024);
+
+	for (int i = 0; i < 10000; i ++) {
+		net::output_buffer_append(&output, "message;", 8);
+	}
+
+	int ret = net::output_buffer_flush(&output, &client_ssl, &client);
+	net::socket_stats_t stats;
+	net::socket_stats(&client, &stats);
+
+	SSL_shutdown(client_ssl.ssl);
+	net::socket_shutdown(&client, SHUT_WR);
+	peer.join();
+
+	std::cout << "tls out: " << stats.bytes_out << " bytes, " << stats.send_calls << " calls, data "
+		<< (ret == OUTPUT_FLUSHED && received.size() == 80000 && stats.bytes_out == 80000 && stats.send_calls > 0 ? "ok" : "mismatch") << std::endl;
+
+	net::socket_ssl_close(&client_ssl);
+	net::socket_ssl_close(&server_ssl);
+	net::socket_close(&client);
+	net::socket_close(&server);
+}
+
+int main(int argc, char const *argv[])
+{
+	net::socket_t writer, reader;
+	net::output_buffer_t output;
+	char buff[65536];
+	int len, total = 0;
+
+	if (!net::socket_pair(SOCK_STREAM, &writer, &reader)) {
+		std::cout << "Failed to create socket pair." << std::endl;
+		exit(1);
+	}
+
+	net::socket_blocking(&writer, false);
+
+	// 超过1MB时通知生产者暂停, 回落到256KB以下时恢复
+	net::output_buffer_init(&output, 1024 * 1024, 256 * 1024);
+	output.on_watermark = [](bool above) {
+		std::cout << (above ? "pause producer" : "resume producer") << std::endl;
+	};
+
+	// 大量小消息会被合并, 每次writev最多发送64段
+	for (int i = 0; i < 100000 && !net::output_buffer_full(&output); i ++) {
+		net::output_buffer_append(&output, "message;", 8);
+	}
+
+	std::string large(4 * 1024 * 1024, 'x');
+	net::output_buffer_append(&output, std::move(large));
+
+	std::cout << "buffered: " << net::output_buffer_size(&output) << std::endl;
+
+	while (true) {
+		int ret = net::output_buffer_flush(&output, &writer);
+
+		if (ret == OUTPUT_FLUSHED) {
+			break;
+		} else if (ret == OUTPUT_ERROR) {
+			std::cout << "flush error" << std::endl;
+			exit(1);
+		}
+
+		// 对方读取后继续发送
+		len = net::socket_recv(&reader, buff, sizeof(buff));
+		total += len > 0 ? len : 0;
+	}
+
+	net::socket_blocking(&reader, false);
+
+	while ((len = net::socket_recv(&reader, buff, sizeof(buff))) > 0) {
+		total += len;
+	}
+
+	std::cout << "received: " << total << std::endl;
+
+	net::socket_close(&writer);
+	net::socket_close(&reader);
+
+	net::socket_ssl_init();
+	tls_stats();
+
+	return 0;
+}
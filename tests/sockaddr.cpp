@@ -17,9 +17,17 @@ int main(int argc, char const *argv[])
 	std::cout << SHUT_RD << std::endl;
 	std::cout << SHUT_WR << std::endl;
 	std::cout << SHUT_RDWR << std::endl;
+
+	std::vector<net::socket_t> list;
+
+	if (net::socket_resolve("localhost", 8080, AF_UNSPEC, SOCK_STREAM, &list)) {
+		for (std::vector<net::socket_t>::iterator it = list.begin(); it != list.end(); it ++) {
+			std::cout << "[" << net::socket_get_ip(&(*it)) << "]:" << net::socket_get_port(&(*it)) << std::endl;
+		}
+	}
 #ifdef _WIN32
 	net::socket_winsock_free();
 #endif
 	
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,57 @@
+#define CLIBS_SOCKET_STATS 1
+
+#include <iostream>
+#include <cstring>
+#include "clibs/net/socket.hpp"
+#include "clibs/error.hpp"
+
+using namespace clibs;
+
+int main(int argc, char const *argv[])
+{
+	net::socket_t server, client, conn;
+	net::socket_stats_t stats;
+	net::socket_tcp_info_t info;
+	char buff[65536];
+
+	net::socket_new(AF_INET, SOCK_STREAM, 0, &server);
+
+	int val = 1;
+	net::socket_setsockopt(&server, SOL_SOCKET, SO_REUSEADDR, (void*)&val, sizeof(val));
+
+	if (!net::socket_bind(&server, "127.0.0.1", 1234) || !net::socket_listen(&server, 5)) {
+		std::cout << errstr() << std::endl;
+		exit(1);
+	}
+
+	net::socket_new(AF_INET, SOCK_STREAM, 0, &client);
+	net::socket_connect(&client, "127.0.0.1", 1234);
+	net::socket_accept(&server, &conn);
+
+	memset(buff, 'a', sizeof(buff));
+
+	for (int i = 0; i < 16; i ++) {
+		net::socket_send(&client, buff, sizeof(buff));
+		net::socket_recv_must(&conn, buff, sizeof(buff));
+	}
+
+	// 非阻塞读取空的接收缓冲区会得到EAGAIN
+	net::socket_blocking(&conn, false);
+	net::socket_recv(&conn, buff, sizeof(buff));
+
+	net::socket_stats(&client, &stats);
+	std::cout << "client out: " << stats.bytes_out << " bytes, " << stats.send_calls << " calls, " << stats.partial_writes << " partial" << std::endl;
+
+	net::socket_stats(&conn, &stats);
+	std::cout << "server in: " << stats.bytes_in << " bytes, " << stats.recv_calls << " calls, " << stats.eagain << " eagain" << std::endl;
+
+	if (net::socket_tcp_info_sample(&client, &info, 1000)) {
+		std::cout << "rtt: " << info.rtt << "us, rttvar: " << info.rttvar << "us, cwnd: " << info.snd_cwnd << ", retrans: " << info.total_retrans << std::endl;
+	}
+
+	net::socket_close(&conn);
+	net::socket_close(&client);
+	net::socket_close(&server);
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include "clibs/net/socket_tuning.hpp"
+#include "check.hpp"
+
+using namespace clibs::net;
+
+/**
+ * 应用每个预设后通过getsockopt读回设置的值
+ */
+
+int option(const socket_t* sock, int level, int optname) {
+	int value = -1;
+	socklen_t len = sizeof(value);
+
+	if (!socket_getsockopt(sock, level, optname, (SOCK_OPTVAL*)&value, &len)) {
+		return -1;
+	}
+
+	return value;
+}
+
+int main(int argc, char const *argv[])
+{
+	socket_t sock;
+
+	socket_new(AF_INET, SOCK_STREAM, 0, &sock);
+	int default_rcvbuf = option(&sock, SOL_SOCKET, SO_RCVBUF);
+	int default_sndbuf = option(&sock, SOL_SOCKET, SO_SNDBUF);
+	socket_close(&sock);
+
+	// 低延迟
+	{
+		socket_new(AF_INET, SOCK_STREAM, 0, &sock);
+		bool ok = socket_tune(&sock, TUNING_LOW_LATENCY);
+
+		check("low latency applied", ok);
+		check("low latency nodelay", option(&sock, IPPROTO_TCP, TCP_NODELAY) == 1);
+		check("low latency keepalive", option(&sock, SOL_SOCKET, SO_KEEPALIVE) == 1);
+#ifdef TCP_NOTSENT_LOWAT
+		check("low latency notsent lowat", option(&sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT) == 16384);
+#endif
+#ifdef TCP_KEEPIDLE
+		check("low latency keepalive params", option(&sock, IPPROTO_TCP, TCP_KEEPIDLE) == 60
+			&& option(&sock, IPPROTO_TCP, TCP_KEEPINTVL) == 10 && option(&sock, IPPROTO_TCP, TCP_KEEPCNT) == 6);
+#endif
+		socket_close(&sock);
+	}
+
+	// 大量数据传输, 缓冲区大小保持默认, 由内核自动调整
+	{
+		socket_new(AF_INET, SOCK_STREAM, 0, &sock);
+		bool ok = socket_tune(&sock, TUNING_BULK);
+
+		check("bulk applied", ok);
+		check("bulk nodelay", option(&sock, IPPROTO_TCP, TCP_NODELAY) == 0);
+		check("bulk keeps buffer autotuning", option(&sock, SOL_SOCKET, SO_RCVBUF) == default_rcvbuf && option(&sock, SOL_SOCKET, SO_SNDBUF) == default_sndbuf);
+		check("bulk keepalive", option(&sock, SOL_SOCKET, SO_KEEPALIVE) == 1);
+		socket_close(&sock);
+	}
+
+	// 需要固定缓冲区时单独设置, 内核可能翻倍或者按上限截断
+	{
+		socket_tuning_t tuning;
+		socket_tuning_preset(&tuning, TUNING_BULK);
+		tuning.recv_buffer = 48 * 1024;
+
+		socket_new(AF_INET, SOCK_STREAM, 0, &sock);
+		bool ok = socket_tune(&sock, &tuning);
+		int value = option(&sock, SOL_SOCKET, SO_RCVBUF);
+
+		check("explicit recv buffer", ok && value != default_rcvbuf && value >= 48 * 1024);
+		socket_close(&sock);
+	}
+
+	// 服务端监听
+	{
+		socket_new(AF_INET, SOCK_STREAM, 0, &sock);
+		bool ok = socket_tune(&sock, TUNING_LISTENER);
+
+		check("listener applied", ok);
+		check("listener nodelay", option(&sock, IPPROTO_TCP, TCP_NODELAY) == 1);
+		check("listener keepalive unset", option(&sock, SOL_SOCKET, SO_KEEPALIVE) == 0);
+#ifdef TCP_DEFER_ACCEPT
+		check("listener defer accept", option(&sock, IPPROTO_TCP, TCP_DEFER_ACCEPT) > 0);
+#endif
+		socket_close(&sock);
+	}
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <openssl/x509.h>
+#include <openssl/ec.h>
+#include "clibs/net/ssl_engine.hpp"
+
+using namespace clibs;
+
+/** 在内存中生成一个自签名的ec证书 */
+bool make_cert(SSL_CTX* ctx) {
+	EVP_PKEY* key = NULL;
+	EVP_PKEY_CTX* kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+
+	if (kctx == NULL || EVP_PKEY_keygen_init(kctx) <= 0
+		|| EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1) <= 0
+		|| EVP_PKEY_keygen(kctx, &key) <= 0) {
+		EVP_PKEY_CTX_free(kctx);
+		return false;
+	}
+
+	EVP_PKEY_CTX_free(kctx);
+
+	X509* cert = X509_new();
+	ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+	X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+	X509_set_pubkey(cert, key);
+	X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+	X509_set_issuer_name(cert, X509_get_subject_name(cert));
+	X509_sign(cert, key, EVP_sha256());
+
+	bool ok = SSL_CTX_use_certificate(ctx, cert) == 1 && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+
+	X509_free(cert);
+	EVP_PKEY_free(key);
+
+	return ok;
+}
+
+/** 把一端等待发送的密文交给另一端, 返回搬运的记录数量 */
+int pump(net::ssl_engine_t* from, net::ssl_engine_t* to) {
+	char buff[65536];
+	int records = 0;
+	size_t len;
+
+	while ((len = net::ssl_engine_drain(from, buff, sizeof(buff))) > 0) {
+		// 统计tls记录的数量, 每个记录有5字节的头
+		for (size_t offset = 0; offset + 5 <= len; records ++) {
+			offset += 5 + (((unsigned char)buff[offset + 3] << 8) | (unsigned char)buff[offset + 4]);
+		}
+
+		net::ssl_engine_feed(to, buff, len);
+	}
+
+	return records;
+}
+
+/** 读取所有明文 */
+std::string read_all(net::ssl_engine_t* engine) {
+	std::string result;
+	char buff[16384];
+	size_t len;
+
+	while (net::ssl_engine_read(engine, buff, sizeof(buff), &len) == SSL_STATUS_OK) {
+		result.append(buff, len);
+	}
+
+	return result;
+}
+
+int main(int argc, char const *argv[])
+{
+	net::socket_ssl_init();
+
+	SSL_CTX* server_ctx = SSL_CTX_new(TLS_server_method());
+	SSL_CTX* client_ctx = SSL_CTX_new(TLS_client_method());
+
+	if (!make_cert(server_ctx)) {
+		std::cout << "Failed to generate certificate" << std::endl;
+		return 1;
+	}
+
+	net::ssl_engine_t server, client;
+	net::ssl_engine_init(&server, server_ctx, true);
+	net::ssl_engine_init(&client, client_ctx, false);
+	net::socket_ssl_set_host(&client.ssock, "localhost", 443);
+
+	// 两端都不绑定套字节, 密文在内存中交换
+	for (int i = 0; i < 10 && !(net::ssl_engine_established(&client) && net::ssl_engine_established(&server)); i ++) {
+		net::ssl_engine_handshake(&client);
+		pump(&client, &server);
+		net::ssl_engine_handshake(&server);
+		pump(&server, &client);
+	}
+
+	std::cout << "handshake: " << (net::ssl_engine_established(&client) && net::ssl_engine_established(&server) ? "ok" : "failed") << std::endl;
+	read_all(&client); // 处理tls1.3的session ticket
+
+	// 1000次10字节的小写入, 合并后的记录数量
+	std::string expected;
+
+	for (int i = 0; i < 1000; i ++) {
+		char line[16];
+		snprintf(line, sizeof(line), "line %04d\n", i);
+		expected += line;
+		net::ssl_engine_write(&client, line, strlen(line));
+	}
+
+	net::ssl_engine_flush(&client);
+	size_t coalesced_bytes = net::ssl_engine_output_size(&client);
+	int coalesced = pump(&client, &server);
+	std::string received = read_all(&server);
+
+	std::cout << "coalesced: " << coalesced << " records, " << coalesced_bytes << " bytes on the wire, data " << (received == expected ? "ok" : "mismatch") << std::endl;
+
+	// 不合并时每次写入都是一个记录
+	for (int i = 0; i < 1000; i ++) {
+		net::ssl_engine_write(&client, expected.data() + i * 10, 10);
+		net::ssl_engine_flush(&client);
+	}
+
+	size_t single_bytes = net::ssl_engine_output_size(&client);
+	int single = pump(&client, &server);
+	received = read_all(&server);
+
+	std::cout << "per write: " << single << " records, " << single_bytes << " bytes on the wire, data " << (received == expected ? "ok" : "mismatch") << std::endl;
+
+	// 大数据直接按完整记录加密
+	std::string large(100000, 'x');
+	net::ssl_engine_write(&client, large.data(), large.size());
+	net::ssl_engine_flush(&client);
+	int large_records = pump(&client, &server);
+	received = read_all(&server);
+
+	std::cout << "large: " << large_records << " records, data " << (received == large ? "ok" : "mismatch") << std::endl;
+
+	net::ssl_engine_free(&client);
+	net::ssl_engine_free(&server);
+	SSL_CTX_free(client_ctx);
+	SSL_CTX_free(server_ctx);
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include "clibs/net/connector.hpp"
+#include "clibs/net/sslsocket.hpp"
+#include "clibs/io/event_loop.hpp"
+
+using namespace clibs;
+using namespace clibs::net;
+using namespace clibs::io;
+
+/**
+ * 在单个线程的事件循环上同时进行大量ssl握手
+ * 用法: ssl_handshake_async [host] [port] [count]
+ * 本地测试: openssl s_server -accept 4433 -cert cert.pem -key key.pem -www
+ */
+int main(int argc, char const *argv[])
+{
+    const char* host = argc > 1 ? argv[1] : "127.0.0.1";
+    unsigned int port = argc > 2 ? atoi(argv[2]) : 4433;
+    int total = argc > 3 ? atoi(argv[3]) : 200, finished = 0, success = 0;
+    event_loop_t loop;
+
+    socket_ssl_init();
+
+    if (!event_loop_init(&loop)) {
+        std::cout << "Failed to init event loop." << std::endl;
+        exit(1);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < total; i ++) {
+        connector_async(&loop, host, port, SOCK_STREAM, 5000, [&](bool ok, socket_t* sock, int error) {
+            if (!ok) {
+                finished ++;
+                std::cout << "connect failed: " << strerror(error) << std::endl;
+                return;
+            }
+
+            std::shared_ptr<ssl_socket_t> ssock = std::make_shared<ssl_socket_t>();
+            socket_t conn = *sock;
+
+            if (!socket_ssl_use_context(ssock.get(), socket_ssl_shared_context()) || !socket_ssl_bind(ssock.get(), &conn)) {
+                finished ++;
+                socket_close(&conn);
+                return;
+            }
+
+            socket_ssl_set_host(ssock.get(), host, port);
+
+            socket_ssl_handshake_async(&loop, ssock.get(), conn.sockfd, false, 5000, [&, ssock, conn](bool ok, int status) mutable {
+                finished ++;
+
+                if (ok) {
+                    success ++;
+                    socket_ssl_shutdown(ssock.get());
+                } else {
+                    std::cout << "handshake failed: " << status << std::endl;
+                }
+
+                socket_ssl_close(ssock.get());
+                socket_close(&conn);
+            });
+        });
+    }
+
+    while (finished < total) {
+        if (event_loop_run_once(&loop, 1000) < 0) {
+            break;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << success << "/" << total << " handshakes in " << seconds << "s" << std::endl;
+
+    event_loop_close(&loop);
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "clibs/net/sslsocket.hpp"
+#include "check.hpp"
+
+using namespace clibs;
+
+/**
+ * 对比每个连接新建SSL_CTX与共享上下文恢复会话时的握手速度
+ * 用法: ssl_resume [host] [port] [count]
+ * 本地测试: openssl s_server -accept 4433 -cert cert.pem -key key.pem -www
+ */
+bool handshake(const char* host, unsigned int port, net::ssl_context_t* context, bool* reused) {
+	net::socket_t sock;
+	net::ssl_socket_t ssock;
+	ssock.ssl = NULL;
+	ssock.ctx = NULL;
+
+	if (!net::socket_set_address(&sock, host, port) || net::socket_new(sock.addr.ss_family, SOCK_STREAM, 0, &sock) == -1) {
+		return false;
+	}
+
+	bool ok = net::socket_connect(&sock)
+		&& (context != NULL ? net::socket_ssl_use_context(&ssock, context) : net::socket_ssl_new(&ssock))
+		&& net::socket_ssl_bind(&ssock, &sock)
+		&& net::socket_ssl_set_host(&ssock, host, port)
+		&& SSL_connect(ssock.ssl) == 1;
+
+	if (ok) {
+		*reused = net::socket_ssl_session_reused(&ssock);
+		// tls1.3的session ticket在握手后发送, 读取一次让客户端收到ticket
+		net::socket_ssl_send(&ssock, "GET / HTTP/1.0\r\n\r\n", 18);
+		char buff[1024];
+		net::socket_ssl_recv(&ssock, buff, sizeof(buff));
+		SSL_shutdown(ssock.ssl);
+	}
+
+	net::socket_ssl_close(&ssock);
+	net::socket_close(&sock);
+
+	return ok;
+}
+
+/** 模拟连接host时收到了新的会话, 返回连接时是否命中了缓存 */
+bool visit(net::ssl_context_t* context, const char* host) {
+	net::ssl_socket_t ssock;
+	ssock.ssl = NULL;
+	ssock.ctx = NULL;
+
+	if (!net::socket_ssl_use_context(&ssock, context)) {
+		return false;
+	}
+
+	ssock.ssl = SSL_new(ssock.ctx);
+	net::socket_ssl_set_host(&ssock, host, 443);
+	bool hit = SSL_get_session(ssock.ssl) != NULL;
+
+	SSL_SESSION* session = SSL_SESSION_new();
+	SSL_SESSION_set1_id(session, (const unsigned char*)host, strlen(host));
+
+	if (net::__ssl_new_session(ssock.ssl, session) == 0) {
+		SSL_SESSION_free(session);
+	}
+
+	net::socket_ssl_close(&ssock);
+
+	return hit;
+}
+
+/** 缓存满时应淘汰最久未使用的会话 */
+void cache_eviction() {
+	net::ssl_context_t context;
+	net::socket_ssl_context_new(&context, false);
+	context.max_sessions = 2;
+
+	visit(&context, "a.test");
+	visit(&context, "b.test");
+	visit(&context, "a.test"); // a最近使用过, b是最久未使用的
+	visit(&context, "c.test");
+
+	check("cache keeps max_sessions entries", context.sessions.size() == 2);
+	check("recently used session kept", visit(&context, "a.test"));
+	check("least recently used session evicted", !visit(&context, "b.test"));
+
+	net::socket_ssl_context_free(&context);
+}
+
+void bench(const char* name, const char* host, unsigned int port, int count, net::ssl_context_t* context) {
+	int success = 0, reused_count = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < count; i ++) {
+		bool reused = false;
+
+		if (handshake(host, port, context, &reused)) {
+			success ++;
+			reused_count += reused ? 1 : 0;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << name << ": " << success << "/" << count << " ok, "
+		<< reused_count << " resumed, "
+		<< (int)(success / seconds) << " handshakes/s" << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+	const char* host = argc > 1 ? argv[1] : "127.0.0.1";
+	unsigned int port = argc > 2 ? atoi(argv[2]) : 4433;
+	int count = argc > 3 ? atoi(argv[3]) : 500;
+
+	net::socket_ssl_init();
+	cache_eviction();
+
+	bench("new SSL_CTX per connection", host, port, count, NULL);
+	bench("shared context + resumption", host, port, count, net::socket_ssl_shared_context());
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <openssl/x509.h>
+#include <openssl/ec.h>
+#include "clibs/net/sslsocket.hpp"
+
+using namespace clibs;
+
+/**
+ * 在回环上对比启用kTLS的SSL_sendfile与用户态加密的吞吐
+ * 用法: ssl_sendfile [大小(MB)]
+ * 需要内核加载tls模块(/proc/sys/net/ipv4/tcp_available_ulp中包含tls)才能真正启用kTLS
+ */
+bool make_cert(SSL_CTX* ctx) {
+	EVP_PKEY* key = NULL;
+	EVP_PKEY_CTX* kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+
+	if (kctx == NULL || EVP_PKEY_keygen_init(kctx) <= 0
+		|| EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1) <= 0
+		|| EVP_PKEY_keygen(kctx, &key) <= 0) {
+		EVP_PKEY_CTX_free(kctx);
+		return false;
+	}
+
+	EVP_PKEY_CTX_free(kctx);
+
+	X509* cert = X509_new();
+	ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+	X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+	X509_set_pubkey(cert, key);
+	X509_set_issuer_name(cert, X509_get_subject_name(cert));
+	X509_sign(cert, key, EVP_sha256());
+
+	bool ok = SSL_CTX_use_certificate(ctx, cert) == 1 && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+
+	X509_free(cert);
+	EVP_PKEY_free(key);
+
+	return ok;
+}
+
+void bench(SSL_CTX* server_ctx, int fd, size_t size, bool ktls) {
+	net::socket_t listener, client;
+	net::socket_new(AF_INET, SOCK_STREAM, 0, &listener);
+
+	int val = 1;
+	net::socket_setsockopt(&listener, SOL_SOCKET, SO_REUSEADDR, (void*)&val, sizeof(val));
+	net::socket_bind(&listener, "127.0.0.1", 4455);
+	net::socket_listen(&listener, 1);
+
+	bool ktls_active = false;
+	long long int sent = 0;
+
+	std::thread server([&]() {
+		net::socket_t conn;
+		net::ssl_socket_t ssock;
+
+		net::socket_accept(&listener, &conn);
+		SSL_CTX_up_ref(server_ctx);
+		net::socket_ssl_bind(&ssock, server_ctx, &conn);
+
+		if (ktls) {
+			net::socket_ssl_enable_ktls(&ssock);
+		}
+
+		if (net::socket_ssl_accept(&ssock)) {
+			ktls_active = net::socket_ssl_ktls_send(&ssock);
+			sent = net::socket_ssl_sendfile(&ssock, fd, 0, size);
+			SSL_shutdown(ssock.ssl);
+		}
+
+		net::socket_ssl_close(&ssock);
+		net::socket_close(&conn);
+	});
+
+	net::ssl_socket_t ssock;
+	net::socket_new(AF_INET, SOCK_STREAM, 0, &client);
+	net::socket_connect(&client, "127.0.0.1", 4455);
+	net::socket_ssl_new(&ssock);
+	net::socket_ssl_bind(&ssock, &client);
+	net::socket_ssl_connect(&ssock);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	char buff[65536];
+	size_t received = 0;
+	int len;
+
+	while ((len = net::socket_ssl_recv(&ssock, buff, sizeof(buff))) > 0) {
+		received += len;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	server.join();
+
+	std::cout << (ktls ? "kTLS requested" : "userspace     ") << ": active=" << (ktls_active ? "yes" : "no")
+		<< " sent=" << sent << " received=" << received
+		<< " " << (int)(received / seconds / 1024 / 1024) << " MB/s" << std::endl;
+
+	net::socket_ssl_close(&ssock);
+	net::socket_close(&client);
+	net::socket_close(&listener);
+}
+
+int main(int argc, char const *argv[])
+{
+	size_t size = (argc > 1 ? atoi(argv[1]) : 256) * 1024 * 1024;
+
+	net::socket_ssl_init();
+
+	SSL_CTX* server_ctx = SSL_CTX_new(TLS_server_method());
+
+	if (!make_cert(server_ctx)) {
+		std::cout << "Failed to generate certificate" << std::endl;
+		return 1;
+	}
+
+	FILE* fp = tmpfile();
+	std::string chunk(1024 * 1024, 'x');
+
+	for (size_t i = 0; i < size; i += chunk.size()) {
+		fwrite(chunk.data(), 1, chunk.size(), fp);
+	}
+
+	fflush(fp);
+
+	bench(server_ctx, fileno(fp), size, false);
+	bench(server_ctx, fileno(fp), size, true);
+
+	fclose(fp);
+	SSL_CTX_free(server_ctx);
+
+	return 0;
+}
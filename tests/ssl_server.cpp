@@ -0,0 +1,87 @@
+#include <iostream>
+#include <cstring>
+#include <csignal>
+#include <vector>
+#include <string>
+#include "clibs/net/ssl_server.hpp"
+
+using namespace clibs;
+
+static volatile sig_atomic_t reload = 0;
+
+/**
+ * 根据SNI选择证书的tls服务, 收到SIGHUP时重新加载所有证书
+ * 用法: ssl_server port cert.pem key.pem [cert.pem key.pem ...]
+ * 测试: openssl s_client -connect 127.0.0.1:port -servername a.example.com -alpn h2
+ */
+int main(int argc, char const *argv[])
+{
+	if (argc < 4 || argc % 2 != 0) {
+		std::cout << "usage: " << argv[0] << " port cert.pem key.pem [cert.pem key.pem ...]" << std::endl;
+		return 1;
+	}
+
+	// 不使用SA_RESTART, 让阻塞的accept被信号打断
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = [](int sig) { reload = 1; };
+	sigaction(SIGHUP, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	net::socket_ssl_init();
+
+	net::ssl_server_t server;
+	net::ssl_server_init(&server);
+	net::ssl_server_set_alpn(&server, {"h2", "http/1.1"});
+
+	for (int i = 2; i < argc; i += 2) {
+		if (!net::ssl_server_add_cert(&server, argv[i], argv[i + 1])) {
+			std::cout << "Failed to load " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+
+	net::socket_t sock;
+	net::socket_new(AF_INET, SOCK_STREAM, 0, &sock);
+
+	int val = 1;
+	net::socket_setsockopt(&sock, SOL_SOCKET, SO_REUSEADDR, (void*)&val, sizeof(val));
+
+	if (!net::socket_bind(&sock, "127.0.0.1", atoi(argv[1])) || !net::socket_listen(&sock, 128)) {
+		std::cout << "Failed to listen" << std::endl;
+		return 1;
+	}
+
+	while (true) {
+		net::socket_t nsock;
+
+		if (net::socket_accept(&sock, &nsock) == -1) {
+			if (reload) {
+				reload = 0;
+
+				for (int i = 2; i < argc; i += 2) {
+					std::cout << "reload " << argv[i] << ": " << (net::ssl_server_add_cert(&server, argv[i], argv[i + 1]) ? "ok" : "failed") << std::endl;
+				}
+			}
+
+			continue;
+		}
+
+		net::ssl_socket_t ssock;
+
+		if (net::ssl_server_bind(&server, &ssock, &nsock) && net::socket_ssl_accept(&ssock)) {
+			const char* name = SSL_get_servername(ssock.ssl, TLSEXT_NAMETYPE_host_name);
+			std::string alpn = net::socket_ssl_alpn(&ssock);
+			std::string reply = std::string("sni=") + (name ? name : "-") + " alpn=" + (alpn.empty() ? "-" : alpn) + "\n";
+
+			std::cout << reply;
+			net::socket_ssl_send(&ssock, reply.c_str(), reply.size());
+			net::socket_ssl_shutdown(&ssock);
+		}
+
+		net::socket_ssl_close(&ssock);
+		net::socket_close(&nsock);
+	}
+
+	return 0;
+}
@@ -1,6 +1,6 @@
 #include <iostream>
 #include <cstring>
-#include "clibs/net/socket.hpp"
+#include "clibs/net/socket_tuning.hpp"
 
 using namespace clibs;
 
@@ -13,6 +13,7 @@ int main(int argc, char const *argv[])
 
 	net::socket_new(AF_INET, SOCK_STREAM, 0, &sock);
 
+	net::socket_tune(&sock, TUNING_LISTENER);
 	net::socket_bind(&sock, "127.0.0.1", 1234);
 	net::socket_listen(&sock, 5);
 
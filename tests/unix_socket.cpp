@@ -0,0 +1,66 @@
+#include <iostream>
+#include <cstring>
+#include "clibs/net/socket.hpp"
+
+using namespace clibs;
+
+int main(int argc, char const *argv[])
+{
+	net::socket_t server, client, conn;
+	char buff[1024];
+	int len;
+
+	// 抽象命名空间的stream套字节
+	net::socket_new(AF_UNIX, SOCK_STREAM, 0, &server);
+
+	if (!net::socket_bind_unix(&server, "clibs-unix-test", true) || !net::socket_listen(&server, 5)) {
+		std::cout << "Failed to bind unix socket." << std::endl;
+		exit(1);
+	}
+
+	std::cout << "listen: " << net::socket_get_path(&server) << std::endl;
+
+	net::socket_new(AF_UNIX, SOCK_STREAM, 0, &client);
+	net::socket_connect_unix(&client, "clibs-unix-test", true);
+	net::socket_accept(&server, &conn);
+
+	net::socket_send(&client, "hello", 5);
+	len = net::socket_recv(&conn, buff, 1024);
+	buff[len] = '\0';
+	std::cout << "stream: " << buff << std::endl;
+
+	// 通过SCM_RIGHTS把管道的写端传递给对方
+	int pipefd[2];
+	pipe(pipefd);
+
+	net::socket_send_fd(&conn, pipefd[1], "pipe", 4);
+	close(pipefd[1]);
+
+	int fd;
+	len = net::socket_recv_fd(&client, &fd, buff, 1024);
+	buff[len] = '\0';
+	std::cout << "received fd: " << (fd >= 0) << " with: " << buff << std::endl;
+
+	write(fd, "through pipe", 12);
+	close(fd);
+	len = read(pipefd[0], buff, 1024);
+	buff[len] = '\0';
+	std::cout << "pipe: " << buff << std::endl;
+	close(pipefd[0]);
+
+	// datagram套字节对
+	net::socket_t a, b;
+	net::socket_pair(SOCK_DGRAM, &a, &b);
+	net::socket_send(&a, "datagram", 8);
+	len = net::socket_recv(&b, buff, 1024);
+	buff[len] = '\0';
+	std::cout << "dgram: " << buff << std::endl;
+
+	net::socket_close(&a);
+	net::socket_close(&b);
+	net::socket_close(&conn);
+	net::socket_close(&client);
+	net::socket_close(&server);
+
+	return 0;
+}